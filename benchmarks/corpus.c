@@ -0,0 +1,956 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2022 Jeffrey Stedfast
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <gmime/gmime.h>
+
+#include "corpus.h"
+
+
+/* Everything in here must depend only on the seed: no locale, no
+ * clock and no hash table iteration order, so that two runs (or two
+ * machines) given the same seed benchmark exactly the same bytes. */
+
+static const char *words[] = {
+	"the", "message", "header", "parser", "stream", "filter", "mailbox", "server",
+	"client", "account", "please", "review", "attached", "document", "meeting", "schedule",
+	"quarterly", "report", "project", "update", "status", "release", "version", "feature",
+	"request", "thanks", "regards", "about", "with", "into", "over", "under",
+	"between", "during", "before", "after", "today", "tomorrow", "yesterday", "week",
+	"month", "year", "team", "group", "office", "network", "database", "backup",
+	"archive", "invoice", "payment", "order", "shipping", "delivery", "customer", "support",
+	"question", "answer", "problem", "solution", "change", "review", "build", "test"
+};
+
+static const char *first_names[] = {
+	"Alice", "Bob", "Carol", "David", "Erin", "Frank", "Grace", "Heidi",
+	"Ivan", "Judy", "Mallory", "Niaj", "Olivia", "Peggy", "Rupert", "Sybil",
+	"Trent", "Victor", "Walter", "Yolanda"
+};
+
+static const char *last_names[] = {
+	"Anderson", "Brown", "Clark", "Davis", "Evans", "Fischer", "Garcia", "Harris",
+	"Ito", "Johnson", "Kowalski", "Lopez", "Martin", "Nguyen", "O'Brien", "Patel",
+	"Quinn", "Rossi", "Schmidt", "Tanaka"
+};
+
+static const char *domains[] = {
+	"example.com", "example.org", "example.net", "mail.example.com",
+	"lists.example.org", "corp.example.net", "students.example.edu", "example.co.uk"
+};
+
+static const char *tlds[] = { "com", "org", "net", "io" };
+
+static const char *wdays[] = { "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun" };
+
+static const char *months[] = {
+	"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+	"Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+static const char *tz_offsets[] = {
+	"+0000", "-0500", "-0800", "+0100", "+0200", "+0530", "+0900", "-0300"
+};
+
+static struct {
+	const char *name;
+	const char *words[8];
+} scripts[] = {
+	{ "latin",    { "café", "naïve", "façade", "über", "Straße", "señor", "déjà", "crème" } },
+	{ "cyrillic", { "привет", "мир", "письмо", "сообщение", "почта", "сервер", "отчёт", "неделя" } },
+	{ "japanese", { "こんにちは", "世界", "メール", "日本語", "会議", "報告", "添付", "確認" } },
+};
+
+static struct {
+	const char *charset;
+	int script;
+	GMimeContentEncoding encoding;
+} charsets[] = {
+	{ "iso-8859-1",   0, GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE },
+	{ "iso-8859-15",  0, GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE },
+	{ "windows-1252", 0, GMIME_CONTENT_ENCODING_8BIT },
+	{ "koi8-r",       1, GMIME_CONTENT_ENCODING_8BIT },
+	{ "windows-1251", 1, GMIME_CONTENT_ENCODING_BASE64 },
+	{ "iso-2022-jp",  2, GMIME_CONTENT_ENCODING_7BIT },
+	{ "shift_jis",    2, GMIME_CONTENT_ENCODING_BASE64 },
+	{ "euc-jp",       2, GMIME_CONTENT_ENCODING_8BIT },
+	{ "utf-8",        1, GMIME_CONTENT_ENCODING_BASE64 },
+};
+
+static const char *kind_names[] = {
+	"plain-text",
+	"html-newsletter",
+	"attachments",
+	"nested-multipart",
+	"huge-cc",
+	"many-received",
+	"mixed-charsets"
+};
+
+#define PICK(rand, array) (array[corpus_random_next (rand) % G_N_ELEMENTS (array)])
+
+/* Note: the order in which function arguments are evaluated is
+ * unspecified, so never draw more than one random value in the
+ * argument list of a single call. */
+
+
+/**
+ * corpus_random_init:
+ * @rand: a #CorpusRandom
+ * @seed: the seed
+ *
+ * Seeds @rand. The state is scrambled with a splitmix64 step so that
+ * adjacent seeds produce unrelated sequences.
+ **/
+void
+corpus_random_init (CorpusRandom *rand, guint32 seed)
+{
+	guint64 z = (guint64) seed + G_GUINT64_CONSTANT (0x9e3779b97f4a7c15);
+	
+	z = (z ^ (z >> 30)) * G_GUINT64_CONSTANT (0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27)) * G_GUINT64_CONSTANT (0x94d049bb133111eb);
+	z ^= z >> 31;
+	
+	rand->state = z ? z : 1;
+}
+
+
+/**
+ * corpus_random_next:
+ * @rand: a #CorpusRandom
+ *
+ * Gets the next value from the xorshift64* sequence.
+ *
+ * Returns: a pseudo-random 32-bit value.
+ **/
+guint32
+corpus_random_next (CorpusRandom *rand)
+{
+	guint64 x = rand->state;
+	
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	rand->state = x;
+	
+	return (guint32) ((x * G_GUINT64_CONSTANT (0x2545f4914f6cdd1d)) >> 32);
+}
+
+
+/**
+ * corpus_random_range:
+ * @rand: a #CorpusRandom
+ * @min: the lower bound
+ * @max: the upper bound (inclusive)
+ *
+ * Returns: a pseudo-random value between @min and @max.
+ **/
+guint32
+corpus_random_range (CorpusRandom *rand, guint32 min, guint32 max)
+{
+	return min + corpus_random_next (rand) % (max - min + 1);
+}
+
+
+/**
+ * corpus_kind_name:
+ * @kind: a #CorpusKind
+ *
+ * Returns: a short name for @kind, suitable for a file or benchmark name.
+ **/
+const char *
+corpus_kind_name (CorpusKind kind)
+{
+	g_return_val_if_fail (kind < CORPUS_N_KINDS, NULL);
+	
+	return kind_names[kind];
+}
+
+static void
+append_sentence (GString *str, CorpusRandom *rand)
+{
+	guint n = corpus_random_range (rand, 5, 16);
+	const char *word;
+	guint i;
+	
+	for (i = 0; i < n; i++) {
+		word = PICK (rand, words);
+		
+		if (i == 0) {
+			g_string_append_c (str, g_ascii_toupper (word[0]));
+			g_string_append (str, word + 1);
+		} else {
+			g_string_append_c (str, ' ');
+			g_string_append (str, word);
+		}
+	}
+	
+	g_string_append (str, ". ");
+}
+
+static void
+append_url (GString *str, CorpusRandom *rand)
+{
+	switch (corpus_random_next (rand) % 4) {
+	case 0:
+		g_string_append_printf (str, "http://www.%s/", PICK (rand, domains));
+		g_string_append_printf (str, "%s/", PICK (rand, words));
+		g_string_append_printf (str, "%u.html ", corpus_random_range (rand, 1, 9999));
+		break;
+	case 1:
+		g_string_append_printf (str, "https://%s.", PICK (rand, words));
+		g_string_append_printf (str, "%s/?id=", PICK (rand, tlds));
+		g_string_append_printf (str, "%u&ref=", corpus_random_next (rand));
+		g_string_append_printf (str, "%s ", PICK (rand, words));
+		break;
+	case 2:
+		g_string_append_printf (str, "www.%s.", PICK (rand, words));
+		g_string_append_printf (str, "%s ", PICK (rand, tlds));
+		break;
+	default:
+		g_string_append_printf (str, "%s@", PICK (rand, words));
+		g_string_append_printf (str, "%s ", PICK (rand, domains));
+		break;
+	}
+}
+
+/* appends a paragraph wrapped at @width columns (or not at all when @width is 0) */
+static void
+append_paragraph (GString *str, CorpusRandom *rand, guint width)
+{
+	guint n = corpus_random_range (rand, 2, 8);
+	GString *para;
+	size_t i, linestart;
+	size_t lastspace;
+	
+	para = g_string_new ("");
+	for (i = 0; i < n; i++) {
+		append_sentence (para, rand);
+		
+		if (corpus_random_next (rand) % 4 == 0)
+			append_url (para, rand);
+	}
+	
+	/* drop the trailing space */
+	g_string_truncate (para, para->len - 1);
+	
+	if (width > 0) {
+		linestart = 0;
+		lastspace = 0;
+		
+		for (i = 0; i < para->len; i++) {
+			if (para->str[i] == ' ')
+				lastspace = i;
+			
+			if (i - linestart >= width && lastspace > linestart) {
+				para->str[lastspace] = '\n';
+				linestart = lastspace + 1;
+			}
+		}
+	}
+	
+	g_string_append_len (str, para->str, para->len);
+	g_string_append_c (str, '\n');
+	g_string_free (para, TRUE);
+}
+
+static void
+append_text_body (GString *str, CorpusRandom *rand, guint min, guint max, guint width)
+{
+	guint n = corpus_random_range (rand, min, max);
+	guint i;
+	
+	for (i = 0; i < n; i++) {
+		if (i > 0)
+			g_string_append_c (str, '\n');
+		
+		append_paragraph (str, rand, width);
+	}
+}
+
+static void
+append_date (GString *str, CorpusRandom *rand)
+{
+	/* somewhere between 2000 and 2030 */
+	gint64 t = 946684800 + (gint64) (corpus_random_next (rand) % 946080000);
+	GDateTime *date;
+	
+	date = g_date_time_new_from_unix_utc (t);
+	
+	/* avoid g_date_time_format() because %a and %b are locale dependent */
+	g_string_append_printf (str, "%s, %d %s %d %02d:%02d:%02d %s",
+				wdays[g_date_time_get_day_of_week (date) - 1],
+				g_date_time_get_day_of_month (date),
+				months[g_date_time_get_month (date) - 1],
+				g_date_time_get_year (date),
+				g_date_time_get_hour (date),
+				g_date_time_get_minute (date),
+				g_date_time_get_second (date),
+				PICK (rand, tz_offsets));
+	
+	g_date_time_unref (date);
+}
+
+static void
+append_encoded_word (GString *str, const char *charset, const char *text, size_t len)
+{
+	char *base64;
+	size_t i;
+	
+	if (!g_ascii_strncasecmp (charset, "iso-8859-", 9) || !g_ascii_strncasecmp (charset, "windows-", 8)) {
+		g_string_append_printf (str, "=?%s?q?", charset);
+		
+		for (i = 0; i < len; i++) {
+			unsigned char c = (unsigned char) text[i];
+			
+			if (c == ' ')
+				g_string_append_c (str, '_');
+			else if (c < 128 && g_ascii_isalnum (c))
+				g_string_append_c (str, c);
+			else
+				g_string_append_printf (str, "=%02X", c);
+		}
+	} else {
+		base64 = g_base64_encode ((const unsigned char *) text, len);
+		g_string_append_printf (str, "=?%s?b?%s", charset, base64);
+		g_free (base64);
+	}
+	
+	g_string_append (str, "?=");
+}
+
+/* converts a utf-8 string to @charset, falling back to utf-8 if the
+ * local iconv does not know about it */
+static char *
+convert_text (const char *text, const char *charset, size_t *outlen, const char **used)
+{
+	gsize nwritten;
+	char *out;
+	
+	if ((out = g_convert (text, -1, charset, "UTF-8", NULL, &nwritten, NULL))) {
+		*outlen = nwritten;
+		*used = charset;
+		return out;
+	}
+	
+	*outlen = strlen (text);
+	*used = "utf-8";
+	
+	return g_strdup (text);
+}
+
+static void
+append_international_phrase (GString *str, CorpusRandom *rand)
+{
+	guint n = corpus_random_range (rand, 1, 4);
+	const char *charset, *used;
+	GString *phrase;
+	size_t len;
+	char *text;
+	guint i, c;
+	
+	c = corpus_random_next (rand) % G_N_ELEMENTS (charsets);
+	charset = charsets[c].charset;
+	
+	phrase = g_string_new ("");
+	for (i = 0; i < n; i++) {
+		if (i > 0)
+			g_string_append_c (phrase, ' ');
+		
+		g_string_append (phrase, PICK (rand, scripts[charsets[c].script].words));
+	}
+	
+	text = convert_text (phrase->str, charset, &len, &used);
+	append_encoded_word (str, used, text, len);
+	g_string_free (phrase, TRUE);
+	g_free (text);
+}
+
+static void
+append_address (GString *str, CorpusRandom *rand)
+{
+	const char *first = PICK (rand, first_names);
+	const char *last = PICK (rand, last_names);
+	const char *domain = PICK (rand, domains);
+	guint n = corpus_random_range (rand, 1, 99);
+	
+	switch (corpus_random_next (rand) % 5) {
+	case 0:
+		g_string_append_printf (str, "%c%s%u@%s", g_ascii_tolower (first[0]), last, n, domain);
+		break;
+	case 1:
+		g_string_append_printf (str, "\"%s, %s\" <%s.%s@%s>", last, first, first, last, domain);
+		break;
+	case 2:
+		append_international_phrase (str, rand);
+		g_string_append_printf (str, " <%c%u@%s>", g_ascii_tolower (first[0]), n, domain);
+		break;
+	default:
+		if (strchr (last, '\''))
+			g_string_append_printf (str, "\"%s %s\" <%s%u@%s>", first, last, first, n, domain);
+		else
+			g_string_append_printf (str, "%s %s <%s.%s@%s>", first, last, first, last, domain);
+		break;
+	}
+}
+
+static void
+append_address_list (GString *str, CorpusRandom *rand, guint count)
+{
+	guint i;
+	
+	for (i = 0; i < count; i++) {
+		if (i > 0)
+			g_string_append (str, ",\n\t");
+		
+		append_address (str, rand);
+	}
+}
+
+static void
+append_message_id (GString *str, CorpusRandom *rand, guint index)
+{
+	g_string_append_printf (str, "\nMessage-Id: <%u.%08x@", index, corpus_random_next (rand));
+	g_string_append_printf (str, "%s>\n", PICK (rand, domains));
+}
+
+static void
+append_headers (GString *str, CorpusRandom *rand, guint index)
+{
+	g_string_append (str, "From: ");
+	append_address (str, rand);
+	g_string_append (str, "\nTo: ");
+	append_address_list (str, rand, corpus_random_range (rand, 1, 3));
+	g_string_append (str, "\nSubject: ");
+	append_sentence (str, rand);
+	g_string_truncate (str, str->len - 2);
+	g_string_append (str, "\nDate: ");
+	append_date (str, rand);
+	append_message_id (str, rand, index);
+	g_string_append (str, "MIME-Version: 1.0\n");
+}
+
+static void
+append_encoded (GString *str, GMimeContentEncoding encoding, const char *text, size_t len)
+{
+	GMimeEncoding state;
+	size_t outlen;
+	char *outbuf;
+	
+	if (encoding != GMIME_CONTENT_ENCODING_BASE64 && encoding != GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE &&
+	    encoding != GMIME_CONTENT_ENCODING_UUENCODE) {
+		g_string_append_len (str, text, len);
+		return;
+	}
+	
+	g_mime_encoding_init_encode (&state, encoding);
+	outbuf = g_malloc (g_mime_encoding_outlen (&state, len));
+	outlen = g_mime_encoding_flush (&state, text, len, outbuf);
+	g_string_append_len (str, outbuf, outlen);
+	g_free (outbuf);
+}
+
+static char *
+make_boundary (CorpusRandom *rand, const char *prefix)
+{
+	guint32 hi = corpus_random_next (rand);
+	guint32 lo = corpus_random_next (rand);
+	
+	return g_strdup_printf ("=-%s-%08x%08x", prefix, hi, lo);
+}
+
+static void
+generate_plain_text (GString *str, CorpusRandom *rand, guint index)
+{
+	append_headers (str, rand, index);
+	g_string_append (str, "Content-Type: text/plain; charset=us-ascii\n");
+	g_string_append (str, "Content-Transfer-Encoding: 7bit\n\n");
+	append_text_body (str, rand, 5, 40, 72);
+}
+
+static void
+generate_html_newsletter (GString *str, CorpusRandom *rand, guint index)
+{
+	char *boundary = make_boundary (rand, "newsletter");
+	guint n = corpus_random_range (rand, 4, 12);
+	GString *text, *html;
+	guint i;
+	
+	append_headers (str, rand, index);
+	g_string_append_printf (str, "List-Unsubscribe: <https://%s", PICK (rand, domains));
+	g_string_append_printf (str, "/unsubscribe?u=%08x>\n", corpus_random_next (rand));
+	g_string_append_printf (str, "Content-Type: multipart/alternative; boundary=\"%s\"\n\n", boundary);
+	
+	text = g_string_new ("");
+	html = g_string_new ("<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n"
+			     "<style type=\"text/css\">body { font-family: Arial, sans-serif; } "
+			     "td.content { padding: 12px 24px; color: #333333; }</style>\n"
+			     "</head>\n<body>\n<table width=\"100%\" cellpadding=\"0\" cellspacing=\"0\" border=\"0\">\n");
+	
+	for (i = 0; i < n; i++) {
+		/* newsletters rarely wrap their text, which is what forces quoted-printable */
+		append_paragraph (text, rand, 0);
+		g_string_append (text, "Read more at ");
+		append_url (text, rand);
+		g_string_append (text, "\xe2\x80\x94 caf\xc3\xa9\n\n");
+		
+		g_string_append (html, "<tr><td class=\"content\" style=\"font-size: 14px; line-height: 20px;\"><p>");
+		append_paragraph (html, rand, 0);
+		g_string_append_printf (html, "</p><a href=\"https://www.%s", PICK (rand, domains));
+		g_string_append_printf (html, "/article/%u?utm_source=newsletter&amp;utm_medium=email\" "
+					"style=\"color: #0066cc; text-decoration: none;\">Read more &rarr;</a></td></tr>\n",
+					corpus_random_next (rand));
+	}
+	
+	g_string_append (html, "</table>\n</body>\n</html>\n");
+	
+	g_string_append_printf (str, "--%s\nContent-Type: text/plain; charset=utf-8\n"
+				"Content-Transfer-Encoding: quoted-printable\n\n", boundary);
+	append_encoded (str, GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, text->str, text->len);
+	g_string_append_printf (str, "\n--%s\nContent-Type: text/html; charset=utf-8\n"
+				"Content-Transfer-Encoding: quoted-printable\n\n", boundary);
+	append_encoded (str, GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, html->str, html->len);
+	g_string_append_printf (str, "\n--%s--\n", boundary);
+	
+	g_string_free (text, TRUE);
+	g_string_free (html, TRUE);
+	g_free (boundary);
+}
+
+static void
+generate_attachments (GString *str, CorpusRandom *rand, guint index)
+{
+	static const char *types[][2] = {
+		{ "application/pdf", "pdf" },
+		{ "application/octet-stream", "bin" },
+		{ "image/jpeg", "jpg" },
+		{ "application/zip", "zip" }
+	};
+	char *boundary = make_boundary (rand, "attachments");
+	guint n = corpus_random_range (rand, 3, 6);
+	const char *name;
+	GByteArray *data;
+	guint32 seed;
+	size_t size;
+	guint i, t;
+	
+	append_headers (str, rand, index);
+	g_string_append_printf (str, "Content-Type: multipart/mixed; boundary=\"%s\"\n\n", boundary);
+	g_string_append (str, "This is a multi-part message in MIME format.\n");
+	
+	g_string_append_printf (str, "--%s\nContent-Type: text/plain; charset=us-ascii\n\n", boundary);
+	append_text_body (str, rand, 1, 3, 72);
+	
+	for (i = 0; i < n; i++) {
+		t = corpus_random_next (rand) % G_N_ELEMENTS (types);
+		name = PICK (rand, words);
+		seed = corpus_random_next (rand);
+		size = corpus_random_range (rand, 16 * 1024, 256 * 1024);
+		data = corpus_generate_binary (seed, size);
+		
+		g_string_append_printf (str, "\n--%s\nContent-Type: %s; name=\"%s-%u.%s\"\n"
+					"Content-Disposition: attachment; filename=\"%s-%u.%s\"\n"
+					"Content-Transfer-Encoding: base64\n\n", boundary, types[t][0],
+					name, i, types[t][1], name, i, types[t][1]);
+		append_encoded (str, GMIME_CONTENT_ENCODING_BASE64, (const char *) data->data, data->len);
+		g_byte_array_unref (data);
+	}
+	
+	g_string_append_printf (str, "\n--%s--\n", boundary);
+	g_free (boundary);
+}
+
+static void
+generate_nested_multipart (GString *str, CorpusRandom *rand, guint index)
+{
+	guint depth = corpus_random_range (rand, 20, 50);
+	guint i;
+	
+	append_headers (str, rand, index);
+	g_string_append (str, "Content-Type: multipart/mixed; boundary=\"nested-0\"\n\n");
+	
+	for (i = 0; i <= depth; i++) {
+		g_string_append_printf (str, "--nested-%u\nContent-Type: text/plain; charset=us-ascii\n\n", i);
+		append_paragraph (str, rand, 72);
+		
+		if (i < depth)
+			g_string_append_printf (str, "--nested-%u\nContent-Type: multipart/%s; boundary=\"nested-%u\"\n\n",
+						i, (i & 1) ? "alternative" : "mixed", i + 1);
+	}
+	
+	for (i = depth + 1; i > 0; i--)
+		g_string_append_printf (str, "--nested-%u--\n", i - 1);
+}
+
+static void
+generate_huge_cc (GString *str, CorpusRandom *rand, guint index)
+{
+	append_headers (str, rand, index);
+	g_string_append (str, "Cc: ");
+	append_address_list (str, rand, corpus_random_range (rand, 500, 2000));
+	g_string_append (str, "\nContent-Type: text/plain; charset=us-ascii\n\n");
+	append_text_body (str, rand, 1, 3, 72);
+}
+
+static void
+generate_many_received (GString *str, CorpusRandom *rand, guint index)
+{
+	guint n = corpus_random_range (rand, 100, 300);
+	const char *domain;
+	guint32 addr;
+	guint i;
+	
+	for (i = 0; i < n; i++) {
+		domain = PICK (rand, domains);
+		addr = corpus_random_next (rand);
+		g_string_append_printf (str, "Received: from mx%u.%s (mx%u.%s [10.%u.%u.%u])\n", i, domain,
+					i, domain, (addr >> 16) & 0xff, (addr >> 8) & 0xff, addr & 0xff);
+		g_string_append_printf (str, "\tby relay%u.", corpus_random_range (rand, 1, 9));
+		g_string_append_printf (str, "%s (Postfix) with ESMTPS id ", PICK (rand, domains));
+		g_string_append_printf (str, "%08X\n", corpus_random_next (rand));
+		g_string_append_printf (str, "\tfor <%s@", PICK (rand, words));
+		g_string_append_printf (str, "%s>; ", PICK (rand, domains));
+		append_date (str, rand);
+		g_string_append_c (str, '\n');
+	}
+	
+	append_headers (str, rand, index);
+	g_string_append (str, "Content-Type: text/plain; charset=us-ascii\n\n");
+	append_text_body (str, rand, 1, 5, 72);
+}
+
+static void
+generate_mixed_charsets (GString *str, CorpusRandom *rand, guint index)
+{
+	char *boundary = make_boundary (rand, "charsets");
+	guint n = corpus_random_range (rand, 3, 8);
+	const char *charset, *used;
+	GString *text;
+	size_t len;
+	char *buf;
+	guint i, j, c;
+	
+	g_string_append (str, "From: ");
+	append_international_phrase (str, rand);
+	g_string_append_printf (str, " <%s@", PICK (rand, words));
+	g_string_append_printf (str, "%s>\nTo: ", PICK (rand, domains));
+	append_address_list (str, rand, corpus_random_range (rand, 2, 8));
+	g_string_append (str, "\nSubject: ");
+	for (i = 0; i < 3; i++) {
+		if (i > 0)
+			g_string_append (str, "\n ");
+		append_international_phrase (str, rand);
+	}
+	g_string_append (str, "\nDate: ");
+	append_date (str, rand);
+	append_message_id (str, rand, index);
+	g_string_append (str, "MIME-Version: 1.0\n");
+	g_string_append_printf (str, "Content-Type: multipart/mixed; boundary=\"%s\"\n\n", boundary);
+	
+	for (i = 0; i < n; i++) {
+		c = corpus_random_next (rand) % G_N_ELEMENTS (charsets);
+		charset = charsets[c].charset;
+		
+		text = g_string_new ("");
+		for (j = 0; j < 20; j++) {
+			g_string_append (text, PICK (rand, scripts[charsets[c].script].words));
+			g_string_append_c (text, (j % 8) == 7 ? '\n' : ' ');
+		}
+		g_string_append_c (text, '\n');
+		
+		buf = convert_text (text->str, charset, &len, &used);
+		
+		g_string_append_printf (str, "--%s\nContent-Type: text/plain; charset=%s\n"
+					"Content-Transfer-Encoding: %s\n\n", boundary, used,
+					g_mime_content_encoding_to_string (charsets[c].encoding));
+		append_encoded (str, charsets[c].encoding, buf, len);
+		g_string_append_c (str, '\n');
+		
+		g_string_free (text, TRUE);
+		g_free (buf);
+	}
+	
+	g_string_append_printf (str, "--%s--\n", boundary);
+	g_free (boundary);
+}
+
+
+/**
+ * corpus_generate_message:
+ * @kind: a #CorpusKind
+ * @seed: the corpus seed
+ * @index: the index of the message within the corpus
+ *
+ * Generates a synthetic message of the given kind. The output depends
+ * only on the arguments.
+ *
+ * Returns: the raw message.
+ **/
+GByteArray *
+corpus_generate_message (CorpusKind kind, guint32 seed, guint index)
+{
+	CorpusRandom rand;
+	GByteArray *array;
+	GString *str;
+	size_t len;
+	
+	g_return_val_if_fail (kind < CORPUS_N_KINDS, NULL);
+	
+	corpus_random_init (&rand, seed * 31 + kind * 65599 + index * 2654435761U);
+	str = g_string_sized_new (4096);
+	
+	switch (kind) {
+	case CORPUS_PLAIN_TEXT:
+		generate_plain_text (str, &rand, index);
+		break;
+	case CORPUS_HTML_NEWSLETTER:
+		generate_html_newsletter (str, &rand, index);
+		break;
+	case CORPUS_ATTACHMENTS:
+		generate_attachments (str, &rand, index);
+		break;
+	case CORPUS_NESTED_MULTIPART:
+		generate_nested_multipart (str, &rand, index);
+		break;
+	case CORPUS_HUGE_CC:
+		generate_huge_cc (str, &rand, index);
+		break;
+	case CORPUS_MANY_RECEIVED:
+		generate_many_received (str, &rand, index);
+		break;
+	default:
+		generate_mixed_charsets (str, &rand, index);
+		break;
+	}
+	
+	len = str->len;
+	array = g_byte_array_new_take ((guint8 *) g_string_free (str, FALSE), len);
+	
+	return array;
+}
+
+
+/**
+ * corpus_generate_mbox:
+ * @seed: the corpus seed
+ * @count: the number of messages
+ *
+ * Generates an mbox archive that cycles through every #CorpusKind,
+ * escaping body lines that begin with "From ".
+ *
+ * Returns: the raw mbox.
+ **/
+GByteArray *
+corpus_generate_mbox (guint32 seed, guint count)
+{
+	const char *inptr, *inend, *eoln;
+	CorpusRandom rand;
+	GByteArray *message;
+	GString *str;
+	size_t len;
+	guint i;
+	
+	corpus_random_init (&rand, seed);
+	str = g_string_sized_new (count * 8192);
+	
+	for (i = 0; i < count; i++) {
+		message = corpus_generate_message (i % CORPUS_N_KINDS, seed, i);
+		
+		/* the From_ line uses asctime() format: "Wed Jun 30 21:49:08 1993" */
+		g_string_append_printf (str, "From %s@", PICK (&rand, words));
+		g_string_append_printf (str, "%s ", PICK (&rand, domains));
+		g_string_append_printf (str, "%s ", PICK (&rand, wdays));
+		g_string_append_printf (str, "%s ", PICK (&rand, months));
+		g_string_append_printf (str, "%2u ", corpus_random_range (&rand, 1, 28));
+		g_string_append_printf (str, "%02u:", corpus_random_range (&rand, 0, 23));
+		g_string_append_printf (str, "%02u:", corpus_random_range (&rand, 0, 59));
+		g_string_append_printf (str, "%02u ", corpus_random_range (&rand, 0, 59));
+		g_string_append_printf (str, "%u\n", corpus_random_range (&rand, 2000, 2030));
+		
+		inptr = (const char *) message->data;
+		inend = inptr + message->len;
+		
+		while (inptr < inend) {
+			if (!(eoln = memchr (inptr, '\n', inend - inptr)))
+				eoln = inend;
+			else
+				eoln++;
+			
+			if ((size_t) (eoln - inptr) >= 5 && !strncmp (inptr, "From ", 5))
+				g_string_append_c (str, '>');
+			
+			g_string_append_len (str, inptr, eoln - inptr);
+			inptr = eoln;
+		}
+		
+		if (str->str[str->len - 1] != '\n')
+			g_string_append_c (str, '\n');
+		g_string_append_c (str, '\n');
+		
+		g_byte_array_unref (message);
+	}
+	
+	len = str->len;
+	
+	return g_byte_array_new_take ((guint8 *) g_string_free (str, FALSE), len);
+}
+
+
+/**
+ * corpus_generate_text:
+ * @seed: the seed
+ * @size: the number of bytes to generate
+ *
+ * Generates @size bytes of wrapped us-ascii prose, sprinkled with urls
+ * and addresses.
+ *
+ * Returns: the text.
+ **/
+GByteArray *
+corpus_generate_text (guint32 seed, size_t size)
+{
+	CorpusRandom rand;
+	GString *str;
+	
+	corpus_random_init (&rand, seed);
+	str = g_string_sized_new (size + 1024);
+	
+	while (str->len < size) {
+		append_paragraph (str, &rand, 72);
+		g_string_append_c (str, '\n');
+	}
+	
+	g_string_truncate (str, size);
+	
+	return g_byte_array_new_take ((guint8 *) g_string_free (str, FALSE), size);
+}
+
+
+/**
+ * corpus_generate_binary:
+ * @seed: the seed
+ * @size: the number of bytes to generate
+ *
+ * Generates @size bytes of pseudo-random binary data.
+ *
+ * Returns: the data.
+ **/
+GByteArray *
+corpus_generate_binary (guint32 seed, size_t size)
+{
+	CorpusRandom rand;
+	GByteArray *array;
+	guint32 value;
+	size_t i;
+	
+	corpus_random_init (&rand, seed);
+	array = g_byte_array_sized_new (size);
+	g_byte_array_set_size (array, size);
+	
+	/* store the bytes explicitly so the output does not depend on endianness */
+	for (i = 0; i + 4 <= size; i += 4) {
+		value = corpus_random_next (&rand);
+		array->data[i] = value & 0xff;
+		array->data[i + 1] = (value >> 8) & 0xff;
+		array->data[i + 2] = (value >> 16) & 0xff;
+		array->data[i + 3] = value >> 24;
+	}
+	
+	for ( ; i < size; i++)
+		array->data[i] = corpus_random_next (&rand) & 0xff;
+	
+	return array;
+}
+
+
+/**
+ * corpus_generate_charset_text:
+ * @seed: the seed
+ * @charset: the charset to generate text in
+ * @size: the approximate number of bytes to generate
+ *
+ * Generates wrapped text in a script that @charset can represent and
+ * converts it to @charset.
+ *
+ * Returns: the converted text or %NULL if @charset is unknown or the
+ * local iconv cannot convert to it.
+ **/
+GByteArray *
+corpus_generate_charset_text (guint32 seed, const char *charset, size_t size)
+{
+	CorpusRandom rand;
+	GString *text;
+	gsize nwritten;
+	char *out;
+	guint i, c;
+	
+	for (c = 0; c < G_N_ELEMENTS (charsets); c++) {
+		if (!g_ascii_strcasecmp (charsets[c].charset, charset))
+			break;
+	}
+	
+	if (c == G_N_ELEMENTS (charsets))
+		return NULL;
+	
+	corpus_random_init (&rand, seed);
+	text = g_string_sized_new (size + 64);
+	
+	for (i = 0; text->len < size; i++) {
+		g_string_append (text, PICK (&rand, scripts[charsets[c].script].words));
+		g_string_append_c (text, (i % 8) == 7 ? '\n' : ' ');
+	}
+	
+	out = g_convert (text->str, text->len, charset, "UTF-8", NULL, &nwritten, NULL);
+	g_string_free (text, TRUE);
+	
+	if (out == NULL)
+		return NULL;
+	
+	return g_byte_array_new_take ((guint8 *) out, nwritten);
+}
+
+
+/**
+ * corpus_generate_address_list:
+ * @seed: the seed
+ * @count: the number of addresses
+ *
+ * Generates a folded address list value like the one used by the
+ * huge-cc messages.
+ *
+ * Returns: the address list.
+ **/
+char *
+corpus_generate_address_list (guint32 seed, guint count)
+{
+	CorpusRandom rand;
+	GString *str;
+	
+	corpus_random_init (&rand, seed);
+	str = g_string_new ("");
+	append_address_list (str, &rand, count);
+	
+	return g_string_free (str, FALSE);
+}
@@ -0,0 +1,79 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2022 Jeffrey Stedfast
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __CORPUS_H__
+#define __CORPUS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * CorpusKind:
+ * @CORPUS_PLAIN_TEXT: A single text/plain message with a few urls in it.
+ * @CORPUS_HTML_NEWSLETTER: A multipart/alternative newsletter with quoted-printable text and html.
+ * @CORPUS_ATTACHMENTS: A multipart/mixed message with several large base64 attachments.
+ * @CORPUS_NESTED_MULTIPART: A deeply nested tree of multiparts.
+ * @CORPUS_HUGE_CC: A short message with thousands of Cc recipients.
+ * @CORPUS_MANY_RECEIVED: A short message with hundreds of Received headers.
+ * @CORPUS_MIXED_CHARSETS: rfc2047 headers and body parts in a variety of charsets.
+ * @CORPUS_N_KINDS: The number of message kinds.
+ *
+ * The kinds of synthetic messages that the corpus generator produces.
+ **/
+typedef enum {
+	CORPUS_PLAIN_TEXT,
+	CORPUS_HTML_NEWSLETTER,
+	CORPUS_ATTACHMENTS,
+	CORPUS_NESTED_MULTIPART,
+	CORPUS_HUGE_CC,
+	CORPUS_MANY_RECEIVED,
+	CORPUS_MIXED_CHARSETS,
+	CORPUS_N_KINDS
+} CorpusKind;
+
+/**
+ * CorpusRandom:
+ * @state: The generator state.
+ *
+ * A small, portable pseudo-random number generator so that the corpus
+ * is identical on every platform for a given seed.
+ **/
+typedef struct {
+	guint64 state;
+} CorpusRandom;
+
+void corpus_random_init (CorpusRandom *rand, guint32 seed);
+guint32 corpus_random_next (CorpusRandom *rand);
+guint32 corpus_random_range (CorpusRandom *rand, guint32 min, guint32 max);
+
+const char *corpus_kind_name (CorpusKind kind);
+
+GByteArray *corpus_generate_message (CorpusKind kind, guint32 seed, guint index);
+GByteArray *corpus_generate_mbox (guint32 seed, guint count);
+
+GByteArray *corpus_generate_text (guint32 seed, size_t size);
+GByteArray *corpus_generate_binary (guint32 seed, size_t size);
+GByteArray *corpus_generate_charset_text (guint32 seed, const char *charset, size_t size);
+char *corpus_generate_address_list (guint32 seed, guint count);
+
+G_END_DECLS
+
+#endif /* __CORPUS_H__ */
@@ -0,0 +1,121 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2022 Jeffrey Stedfast
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gmime/gmime.h>
+
+#include "corpus.h"
+
+static int seed = 1;
+static int count = 4;
+static int mbox_count = 1000;
+
+static GOptionEntry entries[] = {
+	{ "seed", 's', 0, G_OPTION_ARG_INT, &seed, "Corpus seed (default: 1)", "SEED" },
+	{ "count", 'n', 0, G_OPTION_ARG_INT, &count, "Messages of each kind to generate (default: 4)", "N" },
+	{ "mbox-count", 'm', 0, G_OPTION_ARG_INT, &mbox_count, "Messages in the mbox archive, 0 to skip it (default: 1000)", "N" },
+	{ NULL }
+};
+
+static gboolean
+write_file (const char *dir, const char *name, GByteArray *data)
+{
+	GError *err = NULL;
+	char *path;
+	
+	path = g_build_filename (dir, name, NULL);
+	
+	if (!g_file_set_contents (path, (const char *) data->data, data->len, &err)) {
+		fprintf (stderr, "gen-corpus: %s\n", err->message);
+		g_error_free (err);
+		g_free (path);
+		return FALSE;
+	}
+	
+	fprintf (stdout, "%s\t%u\n", path, data->len);
+	g_free (path);
+	
+	return TRUE;
+}
+
+int main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GError *err = NULL;
+	GByteArray *data;
+	gboolean ok = TRUE;
+	CorpusKind kind;
+	const char *dir;
+	char *name;
+	int i;
+	
+	context = g_option_context_new ("DIRECTORY");
+	g_option_context_set_summary (context, "Generate a deterministic corpus of synthetic messages.");
+	g_option_context_add_main_entries (context, entries, NULL);
+	
+	if (!g_option_context_parse (context, &argc, &argv, &err)) {
+		fprintf (stderr, "gen-corpus: %s\n", err->message);
+		g_option_context_free (context);
+		g_error_free (err);
+		return EXIT_FAILURE;
+	}
+	
+	g_option_context_free (context);
+	
+	if (argc != 2) {
+		fprintf (stderr, "Usage: gen-corpus [OPTION...] DIRECTORY\n");
+		return EXIT_FAILURE;
+	}
+	
+	dir = argv[1];
+	
+	if (g_mkdir_with_parents (dir, 0777) == -1) {
+		fprintf (stderr, "gen-corpus: cannot create %s\n", dir);
+		return EXIT_FAILURE;
+	}
+	
+	g_mime_init ();
+	
+	for (kind = 0; kind < CORPUS_N_KINDS && ok; kind++) {
+		for (i = 0; i < count && ok; i++) {
+			data = corpus_generate_message (kind, (guint32) seed, i);
+			name = g_strdup_printf ("%s-%03d.eml", corpus_kind_name (kind), i);
+			ok = write_file (dir, name, data);
+			g_byte_array_unref (data);
+			g_free (name);
+		}
+	}
+	
+	if (ok && mbox_count > 0) {
+		data = corpus_generate_mbox ((guint32) seed, mbox_count);
+		ok = write_file (dir, "corpus.mbox", data);
+		g_byte_array_unref (data);
+	}
+	
+	g_mime_shutdown ();
+	
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,1142 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2022 Jeffrey Stedfast
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gmime/gmime.h>
+
+#include "url-scanner.h"
+#include "corpus.h"
+
+/* Each benchmark is run once to warm up and then repeatedly until
+ * --min-time has elapsed. A run returns the number of input bytes it
+ * processed so that throughput can be reported for every benchmark. */
+typedef size_t (* BenchFunc) (gpointer data);
+
+typedef struct {
+	char *name;
+	BenchFunc run;
+	gpointer data;
+	GDestroyNotify free;
+} Benchmark;
+
+static int seed = 1;
+static int min_time = 500;
+static char *format = NULL;
+static gboolean list = FALSE;
+
+static GOptionEntry entries[] = {
+	{ "seed", 's', 0, G_OPTION_ARG_INT, &seed, "Corpus seed (default: 1)", "SEED" },
+	{ "min-time", 't', 0, G_OPTION_ARG_INT, &min_time, "Minimum milliseconds to run each benchmark (default: 500)", "MSEC" },
+	{ "format", 'f', 0, G_OPTION_ARG_STRING, &format, "Output format: tsv or json (default: tsv)", "FORMAT" },
+	{ "list", 'l', 0, G_OPTION_ARG_NONE, &list, "List the benchmarks and exit", NULL },
+	{ NULL }
+};
+
+#define BENCH_BUFFER_SIZE (1024 * 1024)
+
+
+static void
+bench_add (GPtrArray *benchmarks, const char *name, BenchFunc run, gpointer data, GDestroyNotify free)
+{
+	Benchmark *bench = g_new (Benchmark, 1);
+	
+	bench->name = g_strdup (name);
+	bench->run = run;
+	bench->data = data;
+	bench->free = free;
+	
+	g_ptr_array_add (benchmarks, bench);
+}
+
+static void
+bench_free (Benchmark *bench)
+{
+	if (bench->free)
+		bench->free (bench->data);
+	
+	g_free (bench->name);
+	g_free (bench);
+}
+
+static void
+byte_array_free (gpointer data)
+{
+	g_byte_array_unref (data);
+}
+
+static void
+string_array_free (gpointer data)
+{
+	g_ptr_array_free (data, TRUE);
+}
+
+
+/* parsing */
+
+static size_t
+run_parse_message (gpointer data)
+{
+	GByteArray *array = data;
+	GMimeMessage *message;
+	GMimeParser *parser;
+	GMimeStream *stream;
+	
+	stream = g_mime_stream_mem_new_with_byte_array (array);
+	g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+	parser = g_mime_parser_new_with_stream (stream);
+	g_object_unref (stream);
+	
+	if ((message = g_mime_parser_construct_message (parser, NULL)))
+		g_object_unref (message);
+	
+	g_object_unref (parser);
+	
+	return array->len;
+}
+
+static size_t
+run_parse_mbox (gpointer data)
+{
+	GByteArray *array = data;
+	GMimeMessage *message;
+	GMimeParser *parser;
+	GMimeStream *stream;
+	
+	stream = g_mime_stream_mem_new_with_byte_array (array);
+	g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+	parser = g_mime_parser_new_with_stream (stream);
+	g_mime_parser_set_format (parser, GMIME_FORMAT_MBOX);
+	g_object_unref (stream);
+	
+	while (!g_mime_parser_eos (parser)) {
+		if (!(message = g_mime_parser_construct_message (parser, NULL)))
+			break;
+		
+		g_object_unref (message);
+	}
+	
+	g_object_unref (parser);
+	
+	return array->len;
+}
+
+
+/* serialization */
+
+/* the message's stream takes ownership of @array */
+static GMimeMessage *
+parse_message (GByteArray *array)
+{
+	GMimeMessage *message;
+	GMimeParser *parser;
+	GMimeStream *stream;
+	
+	stream = g_mime_stream_mem_new_with_byte_array (array);
+	parser = g_mime_parser_new_with_stream (stream);
+	message = g_mime_parser_construct_message (parser, NULL);
+	g_object_unref (parser);
+	g_object_unref (stream);
+	
+	return message;
+}
+
+static size_t
+run_write_message (gpointer data)
+{
+	GMimeObject *object = data;
+	GMimeStream *stream;
+	ssize_t nwritten;
+	
+	stream = g_mime_stream_null_new ();
+	nwritten = g_mime_object_write_to_stream (object, NULL, stream);
+	g_object_unref (stream);
+	
+	return nwritten > 0 ? (size_t) nwritten : 0;
+}
+
+typedef struct {
+	GMimeFormatOptions *options;
+	GMimeObject *part;
+	size_t size;
+} WritePart;
+
+static void
+write_part_free (gpointer data)
+{
+	WritePart *write = data;
+	
+	g_mime_format_options_free (write->options);
+	g_object_unref (write->part);
+	g_free (write);
+}
+
+static size_t
+run_write_part (gpointer data)
+{
+	WritePart *write = data;
+	GMimeStream *stream;
+	
+	stream = g_mime_stream_null_new ();
+	g_mime_object_write_content_to_stream (write->part, write->options, stream);
+	g_object_unref (stream);
+	
+	return write->size;
+}
+
+/* writes the content of a part that has to be encoded on the way out,
+ * which is what happens when sending a message that was just built */
+static void
+add_write_part_benchmark (GPtrArray *benchmarks, const char *name, GMimeContentEncoding encoding,
+			  GMimeNewLineFormat newline, GByteArray *input)
+{
+	GMimeDataWrapper *content;
+	GMimeStream *stream;
+	WritePart *write;
+	
+	write = g_new (WritePart, 1);
+	write->options = g_mime_format_options_new ();
+	g_mime_format_options_set_newline_format (write->options, newline);
+	write->size = input->len;
+	
+	stream = g_mime_stream_mem_new_with_byte_array (input);
+	content = g_mime_data_wrapper_new_with_stream (stream, GMIME_CONTENT_ENCODING_DEFAULT);
+	g_object_unref (stream);
+	
+	write->part = (GMimeObject *) g_mime_part_new ();
+	g_mime_part_set_content ((GMimePart *) write->part, content);
+	g_mime_part_set_content_encoding ((GMimePart *) write->part, encoding);
+	g_object_unref (content);
+	
+	bench_add (benchmarks, name, run_write_part, write, write_part_free);
+}
+
+
+/* memory streams */
+
+typedef struct {
+	GMimeStream * (* new_stream) (void);
+	GByteArray *input;
+} StreamAppend;
+
+static void
+stream_append_free (gpointer data)
+{
+	StreamAppend *append = data;
+	
+	g_byte_array_unref (append->input);
+	g_free (append);
+}
+
+static size_t
+run_stream_append (gpointer data)
+{
+	StreamAppend *append = data;
+	GMimeStream *stream;
+	guint i, n;
+	
+	stream = append->new_stream ();
+	
+	for (i = 0; i < append->input->len; i += n) {
+		n = MIN (4096, append->input->len - i);
+		g_mime_stream_write (stream, (const char *) append->input->data + i, n);
+	}
+	
+	g_object_unref (stream);
+	
+	return append->input->len;
+}
+
+static void
+add_stream_append_benchmark (GPtrArray *benchmarks, const char *name, GMimeStream * (* new_stream) (void))
+{
+	StreamAppend *append;
+	
+	append = g_new (StreamAppend, 1);
+	append->input = corpus_generate_binary ((guint32) seed, 16 * BENCH_BUFFER_SIZE);
+	append->new_stream = new_stream;
+	
+	bench_add (benchmarks, name, run_stream_append, append, stream_append_free);
+}
+
+static GMimeStream *
+make_cat_stream (guint32 seed, guint count)
+{
+	GMimeStream *mem, *cat, *part;
+	CorpusRandom rand;
+	GByteArray *data;
+	gint64 offset = 0;
+	guint32 len;
+	guint i;
+	
+	corpus_random_init (&rand, seed);
+	data = corpus_generate_text (seed, count * 1024);
+	mem = g_mime_stream_mem_new_with_byte_array (data);
+	cat = g_mime_stream_cat_new ();
+	
+	for (i = 0; i < count && offset < data->len; i++) {
+		len = corpus_random_range (&rand, 1, 2047);
+		len = MIN (len, data->len - offset);
+		part = g_mime_stream_substream (mem, offset, offset + len);
+		g_mime_stream_cat_add_source ((GMimeStreamCat *) cat, part);
+		g_object_unref (part);
+		offset += len;
+	}
+	
+	g_object_unref (mem);
+	
+	return cat;
+}
+
+static size_t
+run_cat_seek (gpointer data)
+{
+	GMimeStream *cat = data;
+	CorpusRandom rand;
+	size_t total = 0;
+	gint64 length;
+	char buf[256];
+	ssize_t n;
+	int i;
+	
+	corpus_random_init (&rand, 1);
+	length = g_mime_stream_length (cat);
+	
+	for (i = 0; i < 1000; i++) {
+		g_mime_stream_seek (cat, corpus_random_range (&rand, 0, (guint32) length - 1), GMIME_STREAM_SEEK_SET);
+		
+		if ((n = g_mime_stream_read (cat, buf, sizeof (buf))) > 0)
+			total += n;
+	}
+	
+	return total;
+}
+
+
+/* content transfer encodings */
+
+typedef struct {
+	GMimeContentEncoding encoding;
+	gboolean encode;
+	GByteArray *input;
+	char *output;
+} Codec;
+
+static Codec *
+codec_new (GMimeContentEncoding encoding, gboolean encode, GByteArray *input)
+{
+	Codec *codec = g_new (Codec, 1);
+	GMimeEncoding state;
+	
+	codec->encoding = encoding;
+	codec->encode = encode;
+	codec->input = input;
+	
+	if (encode)
+		g_mime_encoding_init_encode (&state, encoding);
+	else
+		g_mime_encoding_init_decode (&state, encoding);
+	
+	codec->output = g_malloc (g_mime_encoding_outlen (&state, input->len));
+	
+	return codec;
+}
+
+/* creates a decoder for the result of encoding @input */
+static Codec *
+codec_new_decoder (GMimeContentEncoding encoding, GByteArray *input)
+{
+	GMimeEncoding state;
+	GByteArray *encoded;
+	size_t n;
+	
+	g_mime_encoding_init_encode (&state, encoding);
+	encoded = g_byte_array_sized_new (g_mime_encoding_outlen (&state, input->len));
+	g_byte_array_set_size (encoded, g_mime_encoding_outlen (&state, input->len));
+	n = g_mime_encoding_flush (&state, (const char *) input->data, input->len, (char *) encoded->data);
+	g_byte_array_set_size (encoded, n);
+	g_byte_array_unref (input);
+	
+	return codec_new (encoding, FALSE, encoded);
+}
+
+static void
+codec_free (gpointer data)
+{
+	Codec *codec = data;
+	
+	g_byte_array_unref (codec->input);
+	g_free (codec->output);
+	g_free (codec);
+}
+
+static size_t
+run_codec (gpointer data)
+{
+	Codec *codec = data;
+	GMimeEncoding state;
+	
+	if (codec->encode)
+		g_mime_encoding_init_encode (&state, codec->encoding);
+	else
+		g_mime_encoding_init_decode (&state, codec->encoding);
+	
+	g_mime_encoding_flush (&state, (const char *) codec->input->data, codec->input->len, codec->output);
+	
+	return codec->input->len;
+}
+
+
+/* filters */
+
+typedef struct {
+	GByteArray *input;
+	GPtrArray *filters;
+	size_t read_size;
+	char *output;
+} Filtered;
+
+static void
+filtered_free (gpointer data)
+{
+	Filtered *filtered = data;
+	
+	g_ptr_array_free (filtered->filters, TRUE);
+	g_byte_array_unref (filtered->input);
+	g_free (filtered->output);
+	g_free (filtered);
+}
+
+static size_t
+run_filtered (gpointer data)
+{
+	Filtered *filtered = data;
+	GMimeStream *stream, *source;
+	size_t total = 0;
+	ssize_t n;
+	guint i;
+	
+	source = g_mime_stream_mem_new_with_buffer ((const char *) filtered->input->data, filtered->input->len);
+	stream = g_mime_stream_filter_new (source);
+	g_object_unref (source);
+	
+	if (filtered->read_size > 0)
+		g_mime_stream_filter_set_read_size ((GMimeStreamFilter *) stream, filtered->read_size);
+	
+	for (i = 0; i < filtered->filters->len; i++) {
+		g_mime_filter_reset (filtered->filters->pdata[i]);
+		g_mime_stream_filter_add ((GMimeStreamFilter *) stream, filtered->filters->pdata[i]);
+	}
+	
+	while ((n = g_mime_stream_read (stream, filtered->output, BENCH_BUFFER_SIZE)) > 0)
+		total += n;
+	
+	g_object_unref (stream);
+	
+	return filtered->input->len;
+}
+
+static GByteArray *
+text_to_crlf (GByteArray *text)
+{
+	GByteArray *crlf = g_byte_array_sized_new (text->len + text->len / 16);
+	guint i;
+	
+	for (i = 0; i < text->len; i++) {
+		if (text->data[i] == '\n')
+			g_byte_array_append (crlf, (const guint8 *) "\r", 1);
+		g_byte_array_append (crlf, text->data + i, 1);
+	}
+	
+	g_byte_array_unref (text);
+	
+	return crlf;
+}
+
+/* wraps @binary in an =ybegin/=yend block */
+static GByteArray *
+binary_to_yenc (GByteArray *binary)
+{
+	GByteArray *yenc = g_byte_array_new ();
+	guint32 pcrc, crc;
+	size_t outlen;
+	char *line;
+	int state;
+	
+	line = g_strdup_printf ("=ybegin line=128 size=%u name=bench.bin\n", binary->len);
+	g_byte_array_append (yenc, (const guint8 *) line, strlen (line));
+	g_free (line);
+	
+	outlen = yenc->len;
+	g_byte_array_set_size (yenc, outlen + (binary->len + 2) * 2 + binary->len / 64 + 62);
+	state = GMIME_YENCODE_STATE_INIT;
+	pcrc = crc = GMIME_YENCODE_CRC_INIT;
+	outlen += g_mime_yencode_close (binary->data, binary->len, yenc->data + outlen, &state, &pcrc, &crc);
+	g_byte_array_set_size (yenc, outlen);
+	
+	line = g_strdup_printf ("=yend size=%u crc32=%08x\n", binary->len, GMIME_YENCODE_CRC_FINAL (crc));
+	g_byte_array_append (yenc, (const guint8 *) line, strlen (line));
+	g_byte_array_unref (binary);
+	g_free (line);
+	
+	return yenc;
+}
+
+static void
+add_filter_benchmark (GPtrArray *benchmarks, const char *name, GByteArray *input, GMimeFilter *filter)
+{
+	Filtered *filtered;
+	
+	filtered = g_new (Filtered, 1);
+	filtered->filters = g_ptr_array_new_with_free_func (g_object_unref);
+	g_ptr_array_add (filtered->filters, filter);
+	filtered->output = g_malloc (BENCH_BUFFER_SIZE);
+	filtered->input = input;
+	filtered->read_size = 0;
+	
+	bench_add (benchmarks, name, run_filtered, filtered, filtered_free);
+}
+
+/* a chain of cheap filters (all of which pass LF utf-8 text through),
+ * read in chunks of @read_size bytes */
+static void
+add_filter_chain_benchmark (GPtrArray *benchmarks, const char *name, size_t read_size)
+{
+	Filtered *filtered;
+	
+	filtered = g_new (Filtered, 1);
+	filtered->filters = g_ptr_array_new_with_free_func (g_object_unref);
+	g_ptr_array_add (filtered->filters, g_mime_filter_dos2unix_new (FALSE));
+	g_ptr_array_add (filtered->filters, g_mime_filter_charset_new ("utf-8", "utf-8"));
+	g_ptr_array_add (filtered->filters, g_mime_filter_dos2unix_new (FALSE));
+	filtered->input = corpus_generate_charset_text ((guint32) seed, "utf-8", BENCH_BUFFER_SIZE);
+	filtered->output = g_malloc (BENCH_BUFFER_SIZE);
+	filtered->read_size = read_size;
+	
+	bench_add (benchmarks, name, run_filtered, filtered, filtered_free);
+}
+
+/* MD5, SHA-1 and SHA-256 digests of binary data, either computed by a
+ * chain of single-digest filters or by a single multi-digest filter */
+static void
+add_checksum_benchmark (GPtrArray *benchmarks, const char *name, gboolean multi)
+{
+	GMimeFilterChecksum *checksum;
+	Filtered *filtered;
+	
+	filtered = g_new (Filtered, 1);
+	filtered->filters = g_ptr_array_new_with_free_func (g_object_unref);
+	
+	if (multi) {
+		checksum = (GMimeFilterChecksum *) g_mime_filter_checksum_new_multi ();
+		g_mime_filter_checksum_add (checksum, G_CHECKSUM_MD5);
+		g_mime_filter_checksum_add (checksum, G_CHECKSUM_SHA1);
+		g_mime_filter_checksum_add (checksum, G_CHECKSUM_SHA256);
+		g_ptr_array_add (filtered->filters, checksum);
+	} else {
+		g_ptr_array_add (filtered->filters, g_mime_filter_checksum_new (G_CHECKSUM_MD5));
+		g_ptr_array_add (filtered->filters, g_mime_filter_checksum_new (G_CHECKSUM_SHA1));
+		g_ptr_array_add (filtered->filters, g_mime_filter_checksum_new (G_CHECKSUM_SHA256));
+	}
+	
+	filtered->input = corpus_generate_binary ((guint32) seed, BENCH_BUFFER_SIZE);
+	filtered->output = g_malloc (BENCH_BUFFER_SIZE);
+	filtered->read_size = 0;
+	
+	bench_add (benchmarks, name, run_filtered, filtered, filtered_free);
+}
+
+static void
+add_zstd_benchmark (GPtrArray *benchmarks, const char *name, guint threads)
+{
+	GMimeFilter *zstd;
+	
+	zstd = g_mime_filter_gzip_new_with_format (GMIME_FILTER_GZIP_MODE_ZIP, GMIME_FILTER_GZIP_FORMAT_ZSTD, 3);
+	if (zstd == NULL)
+		return;
+	
+	g_mime_filter_gzip_set_threads ((GMimeFilterGZip *) zstd, threads);
+	add_filter_benchmark (benchmarks, name, corpus_generate_text ((guint32) seed, BENCH_BUFFER_SIZE * 8), zstd);
+}
+
+static GMimeFilter *
+checksum_sha256_new (void)
+{
+	GMimeFilter *checksum;
+	
+	checksum = g_mime_filter_checksum_new_multi ();
+	g_mime_filter_checksum_add ((GMimeFilterChecksum *) checksum, G_CHECKSUM_SHA256);
+	
+	return checksum;
+}
+
+
+/* headers */
+
+static const char *phrases[] = {
+	"caf\xc3\xa9 cr\xc3\xa8me br\xc3\xbbl\xc3\xa9\x65",
+	"\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82 \xd0\xbc\xd0\xb8\xd1\x80",
+	"\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e\xe3\x81\xae\xe3\x83\xa1\xe3\x83\xbc\xe3\x83\xab",
+	"Stra\xc3\x9f\x65 \xc3\xbc\x62\x65r alles",
+	"plain ascii only"
+};
+
+static GPtrArray *
+make_header_texts (guint32 seed, guint count)
+{
+	GPtrArray *texts = g_ptr_array_new_with_free_func (g_free);
+	CorpusRandom rand;
+	GByteArray *text;
+	guint32 tseed;
+	guint i, len;
+	
+	corpus_random_init (&rand, seed);
+	
+	for (i = 0; i < count; i++) {
+		tseed = corpus_random_next (&rand);
+		len = corpus_random_range (&rand, 20, 120);
+		text = corpus_generate_text (tseed, len);
+		g_byte_array_append (text, (const guint8 *) " ", 1);
+		g_byte_array_append (text, (const guint8 *) phrases[i % G_N_ELEMENTS (phrases)],
+				     strlen (phrases[i % G_N_ELEMENTS (phrases)]));
+		g_byte_array_append (text, (const guint8 *) "", 1);
+		
+		/* header values do not contain raw newlines */
+		g_strdelimit ((char *) text->data, "\n", ' ');
+		g_ptr_array_add (texts, g_byte_array_free (text, FALSE));
+	}
+	
+	return texts;
+}
+
+static GPtrArray *
+make_encoded_header_texts (guint32 seed, guint count)
+{
+	GPtrArray *texts = make_header_texts (seed, count);
+	char *encoded;
+	guint i;
+	
+	for (i = 0; i < texts->len; i++) {
+		encoded = g_mime_utils_header_encode_text (NULL, texts->pdata[i], NULL);
+		g_free (texts->pdata[i]);
+		texts->pdata[i] = encoded;
+	}
+	
+	return texts;
+}
+
+static size_t
+run_rfc2047_encode (gpointer data)
+{
+	GPtrArray *texts = data;
+	size_t nbytes = 0;
+	char *encoded;
+	guint i;
+	
+	for (i = 0; i < texts->len; i++) {
+		encoded = g_mime_utils_header_encode_text (NULL, texts->pdata[i], NULL);
+		nbytes += strlen (texts->pdata[i]);
+		g_free (encoded);
+	}
+	
+	return nbytes;
+}
+
+static size_t
+run_rfc2047_decode (gpointer data)
+{
+	GPtrArray *texts = data;
+	size_t nbytes = 0;
+	char *decoded;
+	guint i;
+	
+	for (i = 0; i < texts->len; i++) {
+		decoded = g_mime_utils_header_decode_text (NULL, texts->pdata[i]);
+		nbytes += strlen (texts->pdata[i]);
+		g_free (decoded);
+	}
+	
+	return nbytes;
+}
+
+static size_t
+run_address_parse (gpointer data)
+{
+	InternetAddressList *list;
+	const char *text = data;
+	
+	if ((list = internet_address_list_parse (NULL, text)))
+		g_object_unref (list);
+	
+	return strlen (text);
+}
+
+static GPtrArray *
+make_dates (guint32 seed, guint count)
+{
+	static const char *wdays[] = { "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun" };
+	static const char *months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+	static const char *zones[] = { "+0000", "-0500", "+0100", "GMT", "EST", "PDT", "+0530", "UT" };
+	GPtrArray *dates = g_ptr_array_new_with_free_func (g_free);
+	const char *wday, *month, *zone;
+	CorpusRandom rand;
+	guint day, year, hour, min, sec;
+	guint i;
+	
+	corpus_random_init (&rand, seed);
+	
+	for (i = 0; i < count; i++) {
+		wday = wdays[corpus_random_next (&rand) % G_N_ELEMENTS (wdays)];
+		month = months[corpus_random_next (&rand) % G_N_ELEMENTS (months)];
+		zone = zones[corpus_random_next (&rand) % G_N_ELEMENTS (zones)];
+		day = corpus_random_range (&rand, 1, 28);
+		year = corpus_random_range (&rand, 1990, 2030);
+		hour = corpus_random_range (&rand, 0, 23);
+		min = corpus_random_range (&rand, 0, 59);
+		sec = corpus_random_range (&rand, 0, 59);
+		
+		/* a mix of the well-formed and the merely common */
+		switch (i % 4) {
+		case 0:
+			g_ptr_array_add (dates, g_strdup_printf ("%s, %u %s %u %02u:%02u:%02u %s", wday, day, month, year, hour, min, sec, zone));
+			break;
+		case 1:
+			g_ptr_array_add (dates, g_strdup_printf ("%u %s %u %02u:%02u:%02u %s (%s)", day, month, year, hour, min, sec, zone, zone));
+			break;
+		case 2:
+			g_ptr_array_add (dates, g_strdup_printf ("%s %s %2u %02u:%02u:%02u %u", wday, month, day, hour, min, sec, year));
+			break;
+		default:
+			g_ptr_array_add (dates, g_strdup_printf ("%s, %u %s %02u %02u:%02u %s", wday, day, month, year % 100, hour, min, zone));
+			break;
+		}
+	}
+	
+	return dates;
+}
+
+static size_t
+run_date_parse (gpointer data)
+{
+	GPtrArray *dates = data;
+	size_t nbytes = 0;
+	GDateTime *date;
+	guint i;
+	
+	for (i = 0; i < dates->len; i++) {
+		if ((date = g_mime_utils_header_decode_date (dates->pdata[i])))
+			g_date_time_unref (date);
+		
+		nbytes += strlen (dates->pdata[i]);
+	}
+	
+	return nbytes;
+}
+
+
+/* charset conversion */
+
+typedef struct {
+	GByteArray *input;
+	iconv_t cd;
+} Converter;
+
+static void
+converter_free (gpointer data)
+{
+	Converter *converter = data;
+	
+	g_mime_iconv_close (converter->cd);
+	g_byte_array_unref (converter->input);
+	g_free (converter);
+}
+
+static size_t
+run_iconv (gpointer data)
+{
+	Converter *converter = data;
+	char *out;
+	
+	out = g_mime_iconv_strndup (converter->cd, (const char *) converter->input->data, converter->input->len);
+	g_free (out);
+	
+	return converter->input->len;
+}
+
+static void
+add_iconv_benchmark (GPtrArray *benchmarks, const char *from, const char *to)
+{
+	Converter *converter;
+	GByteArray *input;
+	char *name;
+	iconv_t cd;
+	
+	if (!(input = corpus_generate_charset_text ((guint32) seed, from, 256 * 1024)))
+		return;
+	
+	if ((cd = g_mime_iconv_open (to, from)) == (iconv_t) -1) {
+		g_byte_array_unref (input);
+		return;
+	}
+	
+	converter = g_new (Converter, 1);
+	converter->input = input;
+	converter->cd = cd;
+	
+	name = g_strdup_printf ("iconv/%s-to-%s", from, to);
+	bench_add (benchmarks, name, run_iconv, converter, converter_free);
+	g_free (name);
+}
+
+typedef struct {
+	GMimeParserOptions *options;
+	GByteArray *input;
+} Decoder;
+
+static void
+decoder_free (gpointer data)
+{
+	Decoder *decoder = data;
+	
+	g_mime_parser_options_free (decoder->options);
+	g_byte_array_unref (decoder->input);
+	g_free (decoder);
+}
+
+static size_t
+run_decode_8bit (gpointer data)
+{
+	Decoder *decoder = data;
+	char *out;
+	
+	out = g_mime_utils_decode_8bit (decoder->options, (const char *) decoder->input->data, decoder->input->len);
+	g_free (out);
+	
+	return decoder->input->len;
+}
+
+/* undeclared 8bit text, guessed from a typical list of fallback charsets */
+static void
+add_decode_8bit_benchmark (GPtrArray *benchmarks, const char *charset)
+{
+	static const char *fallbacks[] = { "utf-8", "iso-8859-7", "windows-1251", "windows-1252", NULL };
+	Decoder *decoder;
+	GByteArray *input;
+	char *name;
+	
+	if (!(input = corpus_generate_charset_text ((guint32) seed, charset, 256 * 1024)))
+		return;
+	
+	decoder = g_new (Decoder, 1);
+	decoder->options = g_mime_parser_options_new ();
+	g_mime_parser_options_set_fallback_charsets (decoder->options, fallbacks);
+	decoder->input = input;
+	
+	name = g_strdup_printf ("decode-8bit/%s", charset);
+	bench_add (benchmarks, name, run_decode_8bit, decoder, decoder_free);
+	g_free (name);
+}
+
+
+/* url scanning */
+
+static urlpattern_t patterns[] = {
+	{ "file://",   "",        url_file_start,     url_file_end     },
+	{ "ftp://",    "",        url_web_start,      url_web_end      },
+	{ "http://",   "",        url_web_start,      url_web_end      },
+	{ "https://",  "",        url_web_start,      url_web_end      },
+	{ "news://",   "",        url_web_start,      url_web_end      },
+	{ "mailto:",   "",        url_web_start,      url_web_end      },
+	{ "www.",      "http://", url_web_start,      url_web_end      },
+	{ "ftp.",      "ftp://",  url_web_start,      url_web_end      },
+	{ "@",         "mailto:", url_addrspec_start, url_addrspec_end }
+};
+
+typedef struct {
+	UrlScanner *scanner;
+	GByteArray *input;
+} Scanner;
+
+static void
+scanner_free (gpointer data)
+{
+	Scanner *scanner = data;
+	
+	url_scanner_free (scanner->scanner);
+	g_byte_array_unref (scanner->input);
+	g_free (scanner);
+}
+
+static size_t
+run_url_scan (gpointer data)
+{
+	Scanner *scanner = data;
+	const char *inptr = (const char *) scanner->input->data;
+	const char *inend = inptr + scanner->input->len;
+	const char *eoln;
+	urlmatch_t match;
+	
+	/* scan a line at a time, the same way GMimeFilterHTML does */
+	while (inptr < inend) {
+		if (!(eoln = memchr (inptr, '\n', inend - inptr)))
+			eoln = inend;
+		
+		while (inptr < eoln && url_scanner_scan (scanner->scanner, inptr, eoln - inptr, &match))
+			inptr += MAX (match.um_eo, 1);
+		
+		inptr = eoln + 1;
+	}
+	
+	return scanner->input->len;
+}
+
+
+static GPtrArray *
+create_benchmarks (void)
+{
+	GPtrArray *benchmarks = g_ptr_array_new_with_free_func ((GDestroyNotify) bench_free);
+	GMimeMessage *message;
+	Scanner *scanner;
+	GByteArray *data;
+	CorpusKind kind;
+	char *name;
+	guint i;
+	
+	for (kind = 0; kind < CORPUS_N_KINDS; kind++) {
+		data = corpus_generate_message (kind, (guint32) seed, 0);
+		name = g_strdup_printf ("parse/%s", corpus_kind_name (kind));
+		bench_add (benchmarks, name, run_parse_message, data, byte_array_free);
+		g_free (name);
+	}
+	
+	data = corpus_generate_mbox ((guint32) seed, 100);
+	bench_add (benchmarks, "parse/mbox", run_parse_mbox, data, byte_array_free);
+	
+	for (kind = 0; kind < CORPUS_N_KINDS; kind++) {
+		data = corpus_generate_message (kind, (guint32) seed, 0);
+		message = parse_message (data);
+		
+		if (message == NULL)
+			continue;
+		
+		name = g_strdup_printf ("write/%s", corpus_kind_name (kind));
+		bench_add (benchmarks, name, run_write_message, message, g_object_unref);
+		g_free (name);
+	}
+	
+	add_write_part_benchmark (benchmarks, "write/base64-dos", GMIME_CONTENT_ENCODING_BASE64, GMIME_NEWLINE_FORMAT_DOS,
+				  corpus_generate_binary ((guint32) seed, BENCH_BUFFER_SIZE));
+	add_write_part_benchmark (benchmarks, "write/base64-unix", GMIME_CONTENT_ENCODING_BASE64, GMIME_NEWLINE_FORMAT_UNIX,
+				  corpus_generate_binary ((guint32) seed, BENCH_BUFFER_SIZE));
+	add_write_part_benchmark (benchmarks, "write/quoted-printable-dos", GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, GMIME_NEWLINE_FORMAT_DOS,
+				  corpus_generate_charset_text ((guint32) seed, "utf-8", BENCH_BUFFER_SIZE));
+	add_write_part_benchmark (benchmarks, "write/quoted-printable-unix", GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, GMIME_NEWLINE_FORMAT_UNIX,
+				  corpus_generate_charset_text ((guint32) seed, "utf-8", BENCH_BUFFER_SIZE));
+	add_write_part_benchmark (benchmarks, "write/base64-dos-small", GMIME_CONTENT_ENCODING_BASE64, GMIME_NEWLINE_FORMAT_DOS,
+				  corpus_generate_binary ((guint32) seed, 2048));
+	
+	add_stream_append_benchmark (benchmarks, "stream/mem-append", g_mime_stream_mem_new);
+	add_stream_append_benchmark (benchmarks, "stream/rope-append", g_mime_stream_rope_new);
+	bench_add (benchmarks, "stream/cat-seek", run_cat_seek, make_cat_stream ((guint32) seed, 2000), g_object_unref);
+	
+	bench_add (benchmarks, "encode/base64", run_codec,
+		   codec_new (GMIME_CONTENT_ENCODING_BASE64, TRUE, corpus_generate_binary ((guint32) seed, BENCH_BUFFER_SIZE)), codec_free);
+	bench_add (benchmarks, "decode/base64", run_codec,
+		   codec_new_decoder (GMIME_CONTENT_ENCODING_BASE64, corpus_generate_binary ((guint32) seed, BENCH_BUFFER_SIZE)), codec_free);
+	bench_add (benchmarks, "encode/quoted-printable", run_codec,
+		   codec_new (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, TRUE, corpus_generate_charset_text ((guint32) seed, "utf-8", BENCH_BUFFER_SIZE)), codec_free);
+	bench_add (benchmarks, "decode/quoted-printable", run_codec,
+		   codec_new_decoder (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, corpus_generate_charset_text ((guint32) seed, "utf-8", BENCH_BUFFER_SIZE)), codec_free);
+	bench_add (benchmarks, "encode/uuencode", run_codec,
+		   codec_new (GMIME_CONTENT_ENCODING_UUENCODE, TRUE, corpus_generate_binary ((guint32) seed, BENCH_BUFFER_SIZE)), codec_free);
+	bench_add (benchmarks, "decode/uuencode", run_codec,
+		   codec_new_decoder (GMIME_CONTENT_ENCODING_UUENCODE, corpus_generate_binary ((guint32) seed, BENCH_BUFFER_SIZE)), codec_free);
+	
+	add_filter_benchmark (benchmarks, "filter/dos2unix", text_to_crlf (corpus_generate_text ((guint32) seed, BENCH_BUFFER_SIZE)),
+			      g_mime_filter_dos2unix_new (FALSE));
+	add_filter_benchmark (benchmarks, "filter/dos2unix-lf", corpus_generate_text ((guint32) seed, BENCH_BUFFER_SIZE),
+			      g_mime_filter_dos2unix_new (FALSE));
+	add_filter_benchmark (benchmarks, "filter/unix2dos", corpus_generate_text ((guint32) seed, BENCH_BUFFER_SIZE),
+			      g_mime_filter_unix2dos_new (FALSE));
+	add_filter_benchmark (benchmarks, "filter/unix2dos-crlf", text_to_crlf (corpus_generate_text ((guint32) seed, BENCH_BUFFER_SIZE)),
+			      g_mime_filter_unix2dos_new (FALSE));
+	add_filter_benchmark (benchmarks, "filter/smtp-data", text_to_crlf (corpus_generate_text ((guint32) seed, BENCH_BUFFER_SIZE)),
+			      g_mime_filter_smtp_data_new ());
+	add_filter_benchmark (benchmarks, "filter/yencode", corpus_generate_binary ((guint32) seed, BENCH_BUFFER_SIZE),
+			      g_mime_filter_yenc_new (TRUE));
+	add_filter_benchmark (benchmarks, "filter/ydecode", binary_to_yenc (corpus_generate_binary ((guint32) seed, BENCH_BUFFER_SIZE)),
+			      g_mime_filter_yenc_new (FALSE));
+	add_filter_benchmark (benchmarks, "filter/charset-utf-8", corpus_generate_charset_text ((guint32) seed, "utf-8", BENCH_BUFFER_SIZE),
+			      g_mime_filter_charset_new ("utf-8", "utf-8"));
+	add_filter_benchmark (benchmarks, "filter/charset-ascii-latin1", corpus_generate_text ((guint32) seed, BENCH_BUFFER_SIZE),
+			      g_mime_filter_charset_new ("iso-8859-1", "utf-8"));
+	add_filter_chain_benchmark (benchmarks, "filter/chain-4k", 4096);
+	add_filter_chain_benchmark (benchmarks, "filter/chain-64k", 65536);
+	add_filter_benchmark (benchmarks, "filter/checksum-sha256", corpus_generate_binary ((guint32) seed, BENCH_BUFFER_SIZE),
+			      checksum_sha256_new ());
+	add_filter_benchmark (benchmarks, "filter/checksum-sha256-gchecksum", corpus_generate_binary ((guint32) seed, BENCH_BUFFER_SIZE),
+			      g_mime_filter_checksum_new (G_CHECKSUM_SHA256));
+	add_checksum_benchmark (benchmarks, "filter/checksum-chain", FALSE);
+	add_checksum_benchmark (benchmarks, "filter/checksum-multi", TRUE);
+	add_filter_benchmark (benchmarks, "filter/gzip", corpus_generate_text ((guint32) seed, BENCH_BUFFER_SIZE * 8),
+			      g_mime_filter_gzip_new (GMIME_FILTER_GZIP_MODE_ZIP, 6));
+	add_zstd_benchmark (benchmarks, "filter/zstd", 0);
+	add_zstd_benchmark (benchmarks, "filter/zstd-mt", 4);
+	
+	bench_add (benchmarks, "rfc2047/encode", run_rfc2047_encode, make_header_texts ((guint32) seed, 256), string_array_free);
+	
+	bench_add (benchmarks, "rfc2047/decode", run_rfc2047_decode, make_encoded_header_texts ((guint32) seed, 256), string_array_free);
+	
+	bench_add (benchmarks, "address/parse", run_address_parse,
+		   corpus_generate_address_list ((guint32) seed, 1000), g_free);
+	
+	bench_add (benchmarks, "date/parse", run_date_parse, make_dates ((guint32) seed, 1024), string_array_free);
+	
+	add_iconv_benchmark (benchmarks, "iso-8859-1", "UTF-8");
+	add_iconv_benchmark (benchmarks, "iso-8859-15", "UTF-8");
+	add_iconv_benchmark (benchmarks, "windows-1252", "UTF-8");
+	add_iconv_benchmark (benchmarks, "koi8-r", "UTF-8");
+	add_iconv_benchmark (benchmarks, "shift_jis", "UTF-8");
+	add_iconv_benchmark (benchmarks, "utf-8", "iso-2022-jp");
+	
+	add_decode_8bit_benchmark (benchmarks, "utf-8");
+	add_decode_8bit_benchmark (benchmarks, "windows-1252");
+	add_decode_8bit_benchmark (benchmarks, "koi8-r");
+	
+	scanner = g_new (Scanner, 1);
+	scanner->scanner = url_scanner_new ();
+	for (i = 0; i < G_N_ELEMENTS (patterns); i++)
+		url_scanner_add (scanner->scanner, &patterns[i]);
+	scanner->input = corpus_generate_text ((guint32) seed, BENCH_BUFFER_SIZE);
+	bench_add (benchmarks, "urlscan/text", run_url_scan, scanner, scanner_free);
+	
+	return benchmarks;
+}
+
+static gboolean
+bench_selected (Benchmark *bench, int argc, char **argv)
+{
+	int i;
+	
+	if (argc < 2)
+		return TRUE;
+	
+	for (i = 1; i < argc; i++) {
+		if (strstr (bench->name, argv[i]))
+			return TRUE;
+	}
+	
+	return FALSE;
+}
+
+static void
+bench_run (Benchmark *bench, gboolean json)
+{
+	gint64 start, elapsed, usec = (gint64) min_time * 1000;
+	guint64 nbytes = 0, iterations = 0;
+	double ns_per_op, mb_per_sec;
+	
+	/* warm up caches and any lazily initialized tables */
+	bench->run (bench->data);
+	
+	start = g_get_monotonic_time ();
+	do {
+		nbytes += bench->run (bench->data);
+		iterations++;
+		elapsed = g_get_monotonic_time () - start;
+	} while (elapsed < usec);
+	
+	ns_per_op = (elapsed * 1000.0) / iterations;
+	mb_per_sec = elapsed > 0 ? (nbytes / (1024.0 * 1024.0)) / (elapsed / 1000000.0) : 0.0;
+	
+	if (json) {
+		fprintf (stdout, "{\"benchmark\": \"%s\", \"iterations\": %" G_GUINT64_FORMAT ", \"bytes\": %" G_GUINT64_FORMAT
+			 ", \"usec\": %" G_GINT64_FORMAT ", \"ns_per_op\": %.1f, \"mb_per_sec\": %.2f}\n",
+			 bench->name, iterations, nbytes, elapsed, ns_per_op, mb_per_sec);
+	} else {
+		fprintf (stdout, "%s\t%" G_GUINT64_FORMAT "\t%" G_GUINT64_FORMAT "\t%" G_GINT64_FORMAT "\t%.1f\t%.2f\n",
+			 bench->name, iterations, nbytes, elapsed, ns_per_op, mb_per_sec);
+	}
+	
+	fflush (stdout);
+}
+
+int main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GPtrArray *benchmarks;
+	GError *err = NULL;
+	Benchmark *bench;
+	gboolean json;
+	guint i;
+	
+	context = g_option_context_new ("[BENCHMARK...]");
+	g_option_context_set_summary (context, "Run the GMime microbenchmarks. Only the benchmarks whose\n"
+				      "names contain one of the given strings are run.");
+	g_option_context_add_main_entries (context, entries, NULL);
+	
+	if (!g_option_context_parse (context, &argc, &argv, &err)) {
+		fprintf (stderr, "gmime-bench: %s\n", err->message);
+		g_option_context_free (context);
+		g_error_free (err);
+		return EXIT_FAILURE;
+	}
+	
+	g_option_context_free (context);
+	
+	if (format != NULL && strcmp (format, "tsv") != 0 && strcmp (format, "json") != 0) {
+		fprintf (stderr, "gmime-bench: unknown output format: %s\n", format);
+		return EXIT_FAILURE;
+	}
+	
+	json = format != NULL && !strcmp (format, "json");
+	
+	g_mime_init ();
+	
+	benchmarks = create_benchmarks ();
+	
+	if (!list && !json)
+		fprintf (stdout, "benchmark\titerations\tbytes\tusec\tns_per_op\tmb_per_sec\n");
+	
+	for (i = 0; i < benchmarks->len; i++) {
+		bench = benchmarks->pdata[i];
+		
+		if (!bench_selected (bench, argc, argv))
+			continue;
+		
+		if (list)
+			fprintf (stdout, "%s\n", bench->name);
+		else
+			bench_run (bench, json);
+	}
+	
+	g_ptr_array_free (benchmarks, TRUE);
+	g_free (format);
+	
+	g_mime_shutdown ();
+	
+	return EXIT_SUCCESS;
+}
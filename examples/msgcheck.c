@@ -62,6 +62,16 @@ errcode2str(GMimeParserWarning errcode)
 		return "MIME part without content encountered";
 	case GMIME_CRIT_PART_WITHOUT_HEADERS_OR_CONTENT:
 		return "MIME part without headers or content encountered";
+	case GMIME_CRIT_TOO_MANY_HEADERS:
+		return "too many headers, the remaining headers were ignored";
+	case GMIME_CRIT_HEADER_TOO_LONG:
+		return "header too long, truncated";
+	case GMIME_CRIT_TOO_MANY_PARTS:
+		return "too many MIME parts, the remaining parts were skipped";
+	case GMIME_CRIT_CONTENT_TOO_LARGE:
+		return "content too large, parser stopped";
+	case GMIME_CRIT_TIME_LIMIT_EXCEEDED:
+		return "time limit exceeded, parser stopped";
 	default:
 		return "unknown";
 	}
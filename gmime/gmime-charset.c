@@ -44,6 +44,17 @@
 #include "gmime-table-private.h"
 #include "gmime-charset.h"
 #include "gmime-iconv.h"
+#include "gmime-internal.h"
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define HAVE_UTF8_SSSE3 1
+#include <cpuid.h>
+#include <tmmintrin.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #ifdef HAVE_ICONV_DETECT_H
 #include "iconv-detect.h"
@@ -930,3 +941,321 @@ g_mime_charset_can_encode (GMimeCharset *mask, const char *charset, const char *
 	
 	return rc != (size_t) -1;
 }
+
+
+/**
+ * _g_mime_ascii_span:
+ * @text: the text to scan
+ * @len: the length of @text
+ *
+ * Scans @text for the first byte with the high bit set.
+ *
+ * Returns: the number of leading 7-bit bytes in @text.
+ **/
+size_t
+_g_mime_ascii_span (const char *text, size_t len)
+{
+	register const unsigned char *inptr = (const unsigned char *) text;
+	const unsigned char *inend = inptr + len;
+	guint64 word;
+	
+#ifdef __SSE2__
+	while (inend - inptr >= 32) {
+		__m128i lo = _mm_loadu_si128 ((const __m128i *) inptr);
+		__m128i hi = _mm_loadu_si128 ((const __m128i *) (inptr + 16));
+		
+		if (_mm_movemask_epi8 (_mm_or_si128 (lo, hi)) != 0)
+			break;
+		
+		inptr += 32;
+	}
+	
+	while (inend - inptr >= 16) {
+		int mask = _mm_movemask_epi8 (_mm_loadu_si128 ((const __m128i *) inptr));
+		
+		if (mask != 0)
+			return (inptr - (const unsigned char *) text) + g_bit_nth_lsf ((gulong) mask, -1);
+		
+		inptr += 16;
+	}
+#endif
+	
+	while (inend - inptr >= 8) {
+		memcpy (&word, inptr, sizeof (word));
+		if (word & G_GUINT64_CONSTANT (0x8080808080808080))
+			break;
+		
+		inptr += 8;
+	}
+	
+	while (inptr < inend && *inptr < 0x80)
+		inptr++;
+	
+	return inptr - (const unsigned char *) text;
+}
+
+static gboolean
+utf8_validate_scalar (const unsigned char *inptr, const unsigned char *inend)
+{
+	unsigned char c, min, max;
+	size_t n, i;
+	
+	while (inptr < inend) {
+		inptr += _g_mime_ascii_span ((const char *) inptr, inend - inptr);
+		
+		while (inptr < inend && *inptr >= 0x80) {
+			c = *inptr++;
+			
+			if (c < 0xc2 || c > 0xf4)
+				return FALSE;
+			
+			n = c >= 0xf0 ? 3 : c >= 0xe0 ? 2 : 1;
+			if ((size_t) (inend - inptr) < n)
+				return FALSE;
+			
+			/* rule out overlong forms, surrogates and code points above U+10FFFF */
+			min = c == 0xe0 ? 0xa0 : c == 0xf0 ? 0x90 : 0x80;
+			max = c == 0xed ? 0x9f : c == 0xf4 ? 0x8f : 0xbf;
+			
+			if (inptr[0] < min || inptr[0] > max)
+				return FALSE;
+			
+			for (i = 1; i < n; i++) {
+				if ((inptr[i] & 0xc0) != 0x80)
+					return FALSE;
+			}
+			
+			inptr += n;
+		}
+	}
+	
+	return TRUE;
+}
+
+#ifdef HAVE_UTF8_SSSE3
+/* Error classes for the lookup-table validator described by Keiser and
+ * Lemire in "Validating UTF-8 In Less Than One Instruction Per Byte":
+ * each byte is classified by the high and low nibbles of the byte before
+ * it and the high nibble of the byte itself, and a block is valid iff
+ * the AND of the three classifications is 0 (or just the 0x80 bit for
+ * the continuation bytes of 3 and 4 byte sequences). */
+#define TOO_SHORT      0x01
+#define TOO_LONG       0x02
+#define OVERLONG_3     0x04
+#define TOO_LARGE      0x08
+#define SURROGATE      0x10
+#define OVERLONG_2     0x20
+#define TOO_LARGE_1000 0x40
+#define OVERLONG_4     0x40
+#define TWO_CONTS      0x80
+#define CARRY          (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+__attribute__ ((target ("ssse3")))
+static inline __m128i
+utf8_check_block (__m128i input, __m128i prev)
+{
+	const __m128i byte_1_high_table = _mm_setr_epi8 (
+		TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+		TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+		(char) TWO_CONTS, (char) TWO_CONTS, (char) TWO_CONTS, (char) TWO_CONTS,
+		TOO_SHORT | OVERLONG_2,
+		TOO_SHORT,
+		TOO_SHORT | OVERLONG_3 | SURROGATE,
+		TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+	const __m128i byte_1_low_table = _mm_setr_epi8 (
+		(char) (CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4),
+		(char) (CARRY | OVERLONG_2),
+		(char) CARRY,
+		(char) CARRY,
+		(char) (CARRY | TOO_LARGE),
+		(char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		(char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		(char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		(char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		(char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		(char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		(char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		(char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		(char) (CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE),
+		(char) (CARRY | TOO_LARGE | TOO_LARGE_1000),
+		(char) (CARRY | TOO_LARGE | TOO_LARGE_1000));
+	const __m128i byte_2_high_table = _mm_setr_epi8 (
+		TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+		TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+		(char) (TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4),
+		(char) (TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE),
+		(char) (TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+		(char) (TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+		TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+	const __m128i nibble = _mm_set1_epi8 (0x0f);
+	__m128i prev1, prev2, prev3, special, must_be_cont;
+	
+	prev1 = _mm_alignr_epi8 (input, prev, 15);
+	
+	special = _mm_and_si128 (
+		_mm_and_si128 (
+			_mm_shuffle_epi8 (byte_1_high_table, _mm_and_si128 (_mm_srli_epi16 (prev1, 4), nibble)),
+			_mm_shuffle_epi8 (byte_1_low_table, _mm_and_si128 (prev1, nibble))),
+		_mm_shuffle_epi8 (byte_2_high_table, _mm_and_si128 (_mm_srli_epi16 (input, 4), nibble)));
+	
+	/* the 2nd continuation byte of a 3 or 4 byte sequence and the 3rd of a 4 byte sequence */
+	prev2 = _mm_alignr_epi8 (input, prev, 14);
+	prev3 = _mm_alignr_epi8 (input, prev, 13);
+	must_be_cont = _mm_or_si128 (_mm_subs_epu8 (prev2, _mm_set1_epi8 ((char) (0xe0 - 0x80))),
+				     _mm_subs_epu8 (prev3, _mm_set1_epi8 ((char) (0xf0 - 0x80))));
+	must_be_cont = _mm_and_si128 (must_be_cont, _mm_set1_epi8 ((char) 0x80));
+	
+	return _mm_xor_si128 (must_be_cont, special);
+}
+
+__attribute__ ((target ("ssse3")))
+static gboolean
+utf8_validate_ssse3 (const unsigned char *inptr, size_t len)
+{
+	/* a lead byte in one of the last 3 positions of a block that still expects more bytes */
+	const __m128i max_incomplete = _mm_setr_epi8 (-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+						      (char) 0xef, (char) 0xdf, (char) 0xbf);
+	__m128i prev = _mm_setzero_si128 ();
+	__m128i incomplete = _mm_setzero_si128 ();
+	__m128i error = _mm_setzero_si128 ();
+	unsigned char tail[16];
+	__m128i input;
+	
+	while (len > 0) {
+		if (len >= 16) {
+			input = _mm_loadu_si128 ((const __m128i *) inptr);
+			inptr += 16;
+			len -= 16;
+		} else {
+			/* pad the last block with NULs, which also catches
+			 * a sequence that is cut off at the end */
+			memset (tail, 0, sizeof (tail));
+			memcpy (tail, inptr, len);
+			input = _mm_loadu_si128 ((const __m128i *) tail);
+			len = 0;
+		}
+		
+		if (_mm_movemask_epi8 (input) == 0) {
+			/* all ASCII, so only a sequence left open by the previous block can be wrong */
+			error = _mm_or_si128 (error, incomplete);
+			incomplete = _mm_setzero_si128 ();
+		} else {
+			error = _mm_or_si128 (error, utf8_check_block (input, prev));
+			incomplete = _mm_subs_epu8 (input, max_incomplete);
+		}
+		
+		prev = input;
+	}
+	
+	error = _mm_or_si128 (error, incomplete);
+	
+	return _mm_movemask_epi8 (_mm_cmpeq_epi8 (error, _mm_setzero_si128 ())) == 0xffff;
+}
+
+#undef TOO_SHORT
+#undef TOO_LONG
+#undef OVERLONG_3
+#undef TOO_LARGE
+#undef SURROGATE
+#undef OVERLONG_2
+#undef TOO_LARGE_1000
+#undef OVERLONG_4
+#undef TWO_CONTS
+#undef CARRY
+
+static gboolean
+utf8_ssse3_supported (void)
+{
+	static gsize supported = 0;
+	unsigned int eax, ebx, ecx, edx;
+	
+	if (g_once_init_enter (&supported)) {
+		gsize value = 1;
+		
+		if (__get_cpuid (1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSSE3))
+			value = 2;
+		
+		g_once_init_leave (&supported, value);
+	}
+	
+	return supported == 2;
+}
+#else
+#define utf8_ssse3_supported() FALSE
+#define utf8_validate_ssse3(inptr, len) FALSE
+#endif /* HAVE_UTF8_SSSE3 */
+
+
+/**
+ * _g_mime_utf8_validate:
+ * @text: the text to validate
+ * @len: the length of @text
+ *
+ * Checks whether @text is valid UTF-8. Unlike g_utf8_validate(), NUL
+ * bytes are considered valid.
+ *
+ * Returns: %TRUE if @text is valid UTF-8 or %FALSE otherwise.
+ **/
+gboolean
+_g_mime_utf8_validate (const char *text, size_t len)
+{
+	size_t n;
+	
+	/* most text is pure ASCII, or at least starts out that way */
+	n = _g_mime_ascii_span (text, len);
+	text += n;
+	len -= n;
+	
+	if (len == 0)
+		return TRUE;
+	
+	if (len >= 16 && utf8_ssse3_supported ())
+		return utf8_validate_ssse3 ((const unsigned char *) text, len);
+	
+	return utf8_validate_scalar ((const unsigned char *) text, (const unsigned char *) text + len);
+}
+
+
+/**
+ * _g_mime_charset_is_ascii_superset:
+ * @charset: charset name
+ *
+ * Checks whether @charset is a stateless superset of US-ASCII, in which
+ * case text that only contains 7-bit bytes means the same thing in
+ * @charset as it does in US-ASCII (or UTF-8).
+ *
+ * Returns: %TRUE if @charset is a superset of US-ASCII or %FALSE
+ * otherwise.
+ **/
+gboolean
+_g_mime_charset_is_ascii_superset (const char *charset)
+{
+	static const char *supersets[] = {
+		"utf-8", "us-ascii", "ascii", "ansi_x3.4-1968", "euc-jp", "euc-kr",
+		"euc-cn", "euc-tw", "gbk", "gb2312", "gb18030", "big5", "tis-620"
+	};
+	/* families without stateful members; "big5" and "euc-" are not
+	 * among them since iconv holds back characters that may combine
+	 * with the next one when converting to big5-hkscs or euc-jisx0213 */
+	static const char *families[] = {
+		"iso-8859-", "iso8859", "latin", "windows-cp125", "windows-125",
+		"cp125", "koi8-"
+	};
+	const char *name;
+	guint i;
+	
+	if (charset == NULL || !(name = g_mime_charset_canon_name (charset)))
+		return FALSE;
+	
+	for (i = 0; i < G_N_ELEMENTS (supersets); i++) {
+		if (!g_ascii_strcasecmp (name, supersets[i]))
+			return TRUE;
+	}
+	
+	for (i = 0; i < G_N_ELEMENTS (families); i++) {
+		if (!g_ascii_strncasecmp (name, families[i], strlen (families[i])))
+			return TRUE;
+	}
+	
+	return FALSE;
+}
@@ -29,6 +29,7 @@
 
 #include "gmime-table-private.h"
 #include "gmime-encodings.h"
+#include "gmime-internal.h"
 
 
 #ifdef ENABLE_WARNINGS
@@ -99,6 +100,13 @@ static unsigned char tohex[16] = {
 	'8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
 };
 
+static size_t base64_encode_close (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save, gboolean crlf);
+static size_t uuencode_close (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, unsigned char *uubuf, int *state, guint32 *save, gboolean crlf);
+static size_t quoted_encode_close (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save, gboolean crlf);
+static size_t base64_encode_step (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save, gboolean crlf);
+static size_t uuencode_step (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, unsigned char *uubuf, int *state, guint32 *save, gboolean crlf);
+static size_t quoted_encode_step (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save, gboolean crlf);
+
 
 static gboolean
 is (const char *str, const char *value, size_t n)
@@ -243,33 +251,29 @@ g_mime_encoding_reset (GMimeEncoding *state)
 }
 
 
-/**
- * g_mime_encoding_outlen:
- * @state: a #GMimeEncoding
- * @inlen: an input length
- *
- * Given the input length, @inlen, calculate the needed output length
- * to perform an encoding or decoding step.
- *
- * Returns: the maximum number of bytes needed to encode or decode a
- * buffer of @inlen bytes.
- **/
+/* like g_mime_encoding_outlen(), but @crlf is whether encoded lines end with CRLF */
 size_t
-g_mime_encoding_outlen (GMimeEncoding *state, size_t inlen)
+_g_mime_encoding_outlen (GMimeEncoding *state, size_t inlen, gboolean crlf)
 {
 	switch (state->encoding) {
 	case GMIME_CONTENT_ENCODING_BASE64:
-		if (state->encode)
+		if (state->encode && crlf)
+			return GMIME_BASE64_ENCODE_CRLF_LEN (inlen);
+		else if (state->encode)
 			return GMIME_BASE64_ENCODE_LEN (inlen);
 		else
 			return inlen + 3;
 	case GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE:
-		if (state->encode)
+		if (state->encode && crlf)
+			return GMIME_QP_ENCODE_CRLF_LEN (inlen);
+		else if (state->encode)
 			return GMIME_QP_ENCODE_LEN (inlen);
 		else
 			return inlen + 2;
 	case GMIME_CONTENT_ENCODING_UUENCODE:
-		if (state->encode)
+		if (state->encode && crlf)
+			return GMIME_UUENCODE_CRLF_LEN (inlen);
+		else if (state->encode)
 			return GMIME_UUENCODE_LEN (inlen);
 		else
 			return inlen + 3;
@@ -280,23 +284,26 @@ g_mime_encoding_outlen (GMimeEncoding *state, size_t inlen)
 
 
 /**
- * g_mime_encoding_step:
+ * g_mime_encoding_outlen:
  * @state: a #GMimeEncoding
- * @inbuf: an input buffer to encode or decode
- * @inlen: input buffer length
- * @outbuf: an output buffer
- *
- * Incrementally encodes or decodes (depending on @state) an input
- * stream by 'stepping' through a block of input at a time.
+ * @inlen: an input length
  *
- * You should make sure @outbuf is large enough by calling
- * g_mime_encoding_outlen() to find out how large @outbuf might need
- * to be.
+ * Given the input length, @inlen, calculate the needed output length
+ * to perform an encoding or decoding step.
  *
- * Returns: the number of bytes written to @outbuf.
+ * Returns: the maximum number of bytes needed to encode or decode a
+ * buffer of @inlen bytes.
  **/
 size_t
-g_mime_encoding_step (GMimeEncoding *state, const char *inbuf, size_t inlen, char *outbuf)
+g_mime_encoding_outlen (GMimeEncoding *state, size_t inlen)
+{
+	return _g_mime_encoding_outlen (state, inlen, FALSE);
+}
+
+
+/* like g_mime_encoding_step(), but @crlf is whether encoded lines end with CRLF */
+size_t
+_g_mime_encoding_step (GMimeEncoding *state, const char *inbuf, size_t inlen, char *outbuf, gboolean crlf)
 {
 	const unsigned char *inptr = (const unsigned char *) inbuf;
 	unsigned char *outptr = (unsigned char *) outbuf;
@@ -304,17 +311,17 @@ g_mime_encoding_step (GMimeEncoding *state, const char *inbuf, size_t inlen, cha
 	switch (state->encoding) {
 	case GMIME_CONTENT_ENCODING_BASE64:
 		if (state->encode)
-			return g_mime_encoding_base64_encode_step (inptr, inlen, outptr, &state->state, &state->save);
+			return base64_encode_step (inptr, inlen, outptr, &state->state, &state->save, crlf);
 		else
 			return g_mime_encoding_base64_decode_step (inptr, inlen, outptr, &state->state, &state->save);
 	case GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE:
 		if (state->encode)
-			return g_mime_encoding_quoted_encode_step (inptr, inlen, outptr, &state->state, &state->save);
+			return quoted_encode_step (inptr, inlen, outptr, &state->state, &state->save, crlf);
 		else
 			return g_mime_encoding_quoted_decode_step (inptr, inlen, outptr, &state->state, &state->save);
 	case GMIME_CONTENT_ENCODING_UUENCODE:
 		if (state->encode)
-			return g_mime_encoding_uuencode_step (inptr, inlen, outptr, state->uubuf, &state->state, &state->save);
+			return uuencode_step (inptr, inlen, outptr, state->uubuf, &state->state, &state->save, crlf);
 		else
 			return g_mime_encoding_uudecode_step (inptr, inlen, outptr, &state->state, &state->save);
 	default:
@@ -325,19 +332,31 @@ g_mime_encoding_step (GMimeEncoding *state, const char *inbuf, size_t inlen, cha
 
 
 /**
- * g_mime_encoding_flush:
+ * g_mime_encoding_step:
  * @state: a #GMimeEncoding
  * @inbuf: an input buffer to encode or decode
  * @inlen: input buffer length
  * @outbuf: an output buffer
  *
- * Completes the incremental encode or decode of the input stream (see
- * g_mime_encoding_step() for details).
+ * Incrementally encodes or decodes (depending on @state) an input
+ * stream by 'stepping' through a block of input at a time.
+ *
+ * You should make sure @outbuf is large enough by calling
+ * g_mime_encoding_outlen() to find out how large @outbuf might need
+ * to be.
  *
  * Returns: the number of bytes written to @outbuf.
  **/
 size_t
-g_mime_encoding_flush (GMimeEncoding *state, const char *inbuf, size_t inlen, char *outbuf)
+g_mime_encoding_step (GMimeEncoding *state, const char *inbuf, size_t inlen, char *outbuf)
+{
+	return _g_mime_encoding_step (state, inbuf, inlen, outbuf, FALSE);
+}
+
+
+/* like g_mime_encoding_flush(), but @crlf is whether encoded lines end with CRLF */
+size_t
+_g_mime_encoding_flush (GMimeEncoding *state, const char *inbuf, size_t inlen, char *outbuf, gboolean crlf)
 {
 	const unsigned char *inptr = (const unsigned char *) inbuf;
 	unsigned char *outptr = (unsigned char *) outbuf;
@@ -345,17 +364,17 @@ g_mime_encoding_flush (GMimeEncoding *state, const char *inbuf, size_t inlen, ch
 	switch (state->encoding) {
 	case GMIME_CONTENT_ENCODING_BASE64:
 		if (state->encode)
-			return g_mime_encoding_base64_encode_close (inptr, inlen, outptr, &state->state, &state->save);
+			return base64_encode_close (inptr, inlen, outptr, &state->state, &state->save, crlf);
 		else
 			return g_mime_encoding_base64_decode_step (inptr, inlen, outptr, &state->state, &state->save);
 	case GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE:
 		if (state->encode)
-			return g_mime_encoding_quoted_encode_close (inptr, inlen, outptr, &state->state, &state->save);
+			return quoted_encode_close (inptr, inlen, outptr, &state->state, &state->save, crlf);
 		else
 			return g_mime_encoding_quoted_decode_step (inptr, inlen, outptr, &state->state, &state->save);
 	case GMIME_CONTENT_ENCODING_UUENCODE:
 		if (state->encode)
-			return g_mime_encoding_uuencode_close (inptr, inlen, outptr, state->uubuf, &state->state, &state->save);
+			return uuencode_close (inptr, inlen, outptr, state->uubuf, &state->state, &state->save, crlf);
 		else
 			return g_mime_encoding_uudecode_step (inptr, inlen, outptr, &state->state, &state->save);
 	default:
@@ -366,28 +385,33 @@ g_mime_encoding_flush (GMimeEncoding *state, const char *inbuf, size_t inlen, ch
 
 
 /**
- * g_mime_encoding_base64_encode_close:
- * @inbuf: input buffer
+ * g_mime_encoding_flush:
+ * @state: a #GMimeEncoding
+ * @inbuf: an input buffer to encode or decode
  * @inlen: input buffer length
- * @outbuf: output buffer
- * @state: holds the number of bits that are stored in @save
- * @save: leftover bits that have not yet been encoded
+ * @outbuf: an output buffer
  *
- * Base64 encodes the input stream to the output stream. Call this
- * when finished encoding data with g_mime_encoding_base64_encode_step()
- * to flush off the last little bit.
+ * Completes the incremental encode or decode of the input stream (see
+ * g_mime_encoding_step() for details).
  *
- * Returns: the number of bytes encoded.
+ * Returns: the number of bytes written to @outbuf.
  **/
 size_t
-g_mime_encoding_base64_encode_close (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save)
+g_mime_encoding_flush (GMimeEncoding *state, const char *inbuf, size_t inlen, char *outbuf)
+{
+	return _g_mime_encoding_flush (state, inbuf, inlen, outbuf, FALSE);
+}
+
+
+static size_t
+base64_encode_close (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save, gboolean crlf)
 {
 	register unsigned char *outptr = outbuf;
 	register int quartets;
 	unsigned char *saved;
 
 	if (inlen > 0)
-		outptr += g_mime_encoding_base64_encode_step (inbuf, inlen, outbuf, state, save);
+		outptr += base64_encode_step (inbuf, inlen, outbuf, state, save, crlf);
 
 	saved = (unsigned char *) save;
 	quartets = *state;
@@ -406,8 +430,11 @@ g_mime_encoding_base64_encode_close (const unsigned char *inbuf, size_t inlen, u
 		quartets++;
 	}
 
-	if (quartets > 0)
+	if (quartets > 0) {
+		if (crlf)
+			*outptr++ = '\r';
 		*outptr++ = '\n';
+	}
 
 	*state = 0;
 	*save = 0;
@@ -417,22 +444,28 @@ g_mime_encoding_base64_encode_close (const unsigned char *inbuf, size_t inlen, u
 
 
 /**
- * g_mime_encoding_base64_encode_step:
+ * g_mime_encoding_base64_encode_close:
  * @inbuf: input buffer
  * @inlen: input buffer length
  * @outbuf: output buffer
  * @state: holds the number of bits that are stored in @save
  * @save: leftover bits that have not yet been encoded
  *
- * Base64 encodes a chunk of data. Performs an 'encode step', only
- * encodes blocks of 3 characters to the output at a time, saves
- * left-over state in state and save (initialise to 0 on first
- * invocation).
+ * Base64 encodes the input stream to the output stream. Call this
+ * when finished encoding data with g_mime_encoding_base64_encode_step()
+ * to flush off the last little bit.
  *
  * Returns: the number of bytes encoded.
  **/
 size_t
-g_mime_encoding_base64_encode_step (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save)
+g_mime_encoding_base64_encode_close (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save)
+{
+	return base64_encode_close (inbuf, inlen, outbuf, state, save, FALSE);
+}
+
+
+static size_t
+base64_encode_step (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save, gboolean crlf)
 {
 	register const unsigned char *inptr;
 	register unsigned char *outptr;
@@ -465,6 +498,8 @@ g_mime_encoding_base64_encode_step (const unsigned char *inbuf, size_t inlen, un
 
 		/* encode 19 quartets per line */
 		if ((++quartets) >= 19) {
+			if (crlf)
+				*outptr++ = '\r';
 			*outptr++ = '\n';
 			quartets = 0;
 		}
@@ -507,6 +542,28 @@ g_mime_encoding_base64_encode_step (const unsigned char *inbuf, size_t inlen, un
 }
 
 
+/**
+ * g_mime_encoding_base64_encode_step:
+ * @inbuf: input buffer
+ * @inlen: input buffer length
+ * @outbuf: output buffer
+ * @state: holds the number of bits that are stored in @save
+ * @save: leftover bits that have not yet been encoded
+ *
+ * Base64 encodes a chunk of data. Performs an 'encode step', only
+ * encodes blocks of 3 characters to the output at a time, saves
+ * left-over state in state and save (initialise to 0 on first
+ * invocation).
+ *
+ * Returns: the number of bytes encoded.
+ **/
+size_t
+g_mime_encoding_base64_encode_step (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save)
+{
+	return base64_encode_step (inbuf, inlen, outbuf, state, save, FALSE);
+}
+
+
 /**
  * g_mime_encoding_base64_decode_step:
  * @inbuf: input buffer
@@ -573,22 +630,8 @@ g_mime_encoding_base64_decode_step (const unsigned char *inbuf, size_t inlen, un
 }
 
 
-/**
- * g_mime_encoding_uuencode_close:
- * @inbuf: input buffer
- * @inlen: input buffer length
- * @outbuf: output buffer
- * @uubuf: temporary buffer of 60 bytes
- * @state: holds the number of bits that are stored in @save
- * @save: leftover bits that have not yet been encoded
- *
- * Uuencodes a chunk of data. Call this when finished encoding data
- * with g_mime_encoding_uuencode_step() to flush off the last little bit.
- *
- * Returns: the number of bytes encoded.
- **/
-size_t
-g_mime_encoding_uuencode_close (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, unsigned char *uubuf, int *state, guint32 *save)
+static size_t
+uuencode_close (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, unsigned char *uubuf, int *state, guint32 *save, gboolean crlf)
 {
 	register unsigned char *outptr, *bufptr;
 	register guint32 saved;
@@ -597,7 +640,7 @@ g_mime_encoding_uuencode_close (const unsigned char *inbuf, size_t inlen, unsign
 	outptr = outbuf;
 	
 	if (inlen > 0)
-		outptr += g_mime_encoding_uuencode_step (inbuf, inlen, outbuf, uubuf, state, save);
+		outptr += uuencode_step (inbuf, inlen, outbuf, uubuf, state, save, crlf);
 	
 	uufill = 0;
 	
@@ -637,11 +680,15 @@ g_mime_encoding_uuencode_close (const unsigned char *inbuf, size_t inlen, unsign
 		*outptr++ = GMIME_UUENCODE_CHAR ((uulen - uufill) & 0xff);
 		memcpy (outptr, uubuf, cplen);
 		outptr += cplen;
+		if (crlf)
+			*outptr++ = '\r';
 		*outptr++ = '\n';
 		uulen = 0;
 	}
 	
 	*outptr++ = GMIME_UUENCODE_CHAR (uulen & 0xff);
+	if (crlf)
+		*outptr++ = '\r';
 	*outptr++ = '\n';
 	
 	*save = 0;
@@ -652,23 +699,28 @@ g_mime_encoding_uuencode_close (const unsigned char *inbuf, size_t inlen, unsign
 
 
 /**
- * g_mime_encoding_uuencode_step:
+ * g_mime_encoding_uuencode_close:
  * @inbuf: input buffer
  * @inlen: input buffer length
- * @outbuf: output stream
+ * @outbuf: output buffer
  * @uubuf: temporary buffer of 60 bytes
  * @state: holds the number of bits that are stored in @save
  * @save: leftover bits that have not yet been encoded
  *
- * Uuencodes a chunk of data. Performs an 'encode step', only encodes
- * blocks of 45 characters to the output at a time, saves left-over
- * state in @uubuf, @state and @save (initialize to 0 on first
- * invocation).
+ * Uuencodes a chunk of data. Call this when finished encoding data
+ * with g_mime_encoding_uuencode_step() to flush off the last little bit.
  *
  * Returns: the number of bytes encoded.
  **/
 size_t
-g_mime_encoding_uuencode_step (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, unsigned char *uubuf, int *state, guint32 *save)
+g_mime_encoding_uuencode_close (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, unsigned char *uubuf, int *state, guint32 *save)
+{
+	return uuencode_close (inbuf, inlen, outbuf, uubuf, state, save, FALSE);
+}
+
+
+static size_t
+uuencode_step (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, unsigned char *uubuf, int *state, guint32 *save, gboolean crlf)
 {
 	register unsigned char *outptr, *bufptr;
 	register const unsigned char *inptr;
@@ -745,6 +797,8 @@ g_mime_encoding_uuencode_step (const unsigned char *inbuf, size_t inlen, unsigne
 			*outptr = GMIME_UUENCODE_CHAR (uulen & 0xff);
 			outptr += ((45 / 3) * 4) + 1;
 			
+			if (crlf)
+				*outptr++ = '\r';
 			*outptr++ = '\n';
 			uulen = 0;
 			
@@ -768,6 +822,29 @@ g_mime_encoding_uuencode_step (const unsigned char *inbuf, size_t inlen, unsigne
 }
 
 
+/**
+ * g_mime_encoding_uuencode_step:
+ * @inbuf: input buffer
+ * @inlen: input buffer length
+ * @outbuf: output stream
+ * @uubuf: temporary buffer of 60 bytes
+ * @state: holds the number of bits that are stored in @save
+ * @save: leftover bits that have not yet been encoded
+ *
+ * Uuencodes a chunk of data. Performs an 'encode step', only encodes
+ * blocks of 45 characters to the output at a time, saves left-over
+ * state in @uubuf, @state and @save (initialize to 0 on first
+ * invocation).
+ *
+ * Returns: the number of bytes encoded.
+ **/
+size_t
+g_mime_encoding_uuencode_step (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, unsigned char *uubuf, int *state, guint32 *save)
+{
+	return uuencode_step (inbuf, inlen, outbuf, uubuf, state, save, FALSE);
+}
+
+
 /**
  * g_mime_encoding_uudecode_step:
  * @inbuf: input buffer
@@ -872,28 +949,14 @@ g_mime_encoding_uudecode_step (const unsigned char *inbuf, size_t inlen, unsigne
 }
 
 
-/**
- * g_mime_encoding_quoted_encode_close:
- * @inbuf: input buffer
- * @inlen: input buffer length
- * @outbuf: output buffer
- * @state: holds the number of bits that are stored in @save
- * @save: leftover bits that have not yet been encoded
- *
- * Quoted-printable encodes a block of text. Call this when finished
- * encoding data with g_mime_encoding_quoted_encode_step() to flush off
- * the last little bit.
- *
- * Returns: the number of bytes encoded.
- **/
-size_t
-g_mime_encoding_quoted_encode_close (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save)
+static size_t
+quoted_encode_close (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save, gboolean crlf)
 {
 	register unsigned char *outptr = outbuf;
 	int last;
 	
 	if (inlen > 0)
-		outptr += g_mime_encoding_quoted_encode_step (inbuf, inlen, outptr, state, save);
+		outptr += quoted_encode_step (inbuf, inlen, outptr, state, save, crlf);
 	
 	last = *state;
 	if (last != -1) {
@@ -909,6 +972,8 @@ g_mime_encoding_quoted_encode_close (const unsigned char *inbuf, size_t inlen, u
 		/* we end with =\n so that the \n isn't interpreted as a real
 		   \n when it gets decoded later */
 		*outptr++ = '=';
+		if (crlf)
+			*outptr++ = '\r';
 		*outptr++ = '\n';
 		*state = -1;
 	}
@@ -920,21 +985,28 @@ g_mime_encoding_quoted_encode_close (const unsigned char *inbuf, size_t inlen, u
 
 
 /**
- * g_mime_encoding_quoted_encode_step:
+ * g_mime_encoding_quoted_encode_close:
  * @inbuf: input buffer
  * @inlen: input buffer length
  * @outbuf: output buffer
  * @state: holds the number of bits that are stored in @save
  * @save: leftover bits that have not yet been encoded
  *
- * Quoted-printable encodes a block of text. Performs an 'encode
- * step', saves left-over state in state and save (initialise to -1 on
- * first invocation).
+ * Quoted-printable encodes a block of text. Call this when finished
+ * encoding data with g_mime_encoding_quoted_encode_step() to flush off
+ * the last little bit.
  *
  * Returns: the number of bytes encoded.
  **/
 size_t
-g_mime_encoding_quoted_encode_step (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save)
+g_mime_encoding_quoted_encode_close (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save)
+{
+	return quoted_encode_close (inbuf, inlen, outbuf, state, save, FALSE);
+}
+
+
+static size_t
+quoted_encode_step (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save, gboolean crlf)
 {
 	register const unsigned char *inptr = inbuf;
 	const unsigned char *inend = inbuf + inlen;
@@ -959,6 +1031,8 @@ g_mime_encoding_quoted_encode_step (const unsigned char *inbuf, size_t inlen, un
 				*outptr++ = tohex[(last >> 4) & 0xf];
 				*outptr++ = tohex[last & 0xf];
 			}
+			if (crlf)
+				*outptr++ = '\r';
 			*outptr++ = '\n';
 			sofar = 0;
 			last = -1;
@@ -978,6 +1052,8 @@ g_mime_encoding_quoted_encode_step (const unsigned char *inbuf, size_t inlen, un
 			if (is_qpsafe (c)) {
 				if (sofar > 74) {
 					*outptr++ = '=';
+					if (crlf)
+						*outptr++ = '\r';
 					*outptr++ = '\n';
 					sofar = 0;
 				}
@@ -993,6 +1069,8 @@ g_mime_encoding_quoted_encode_step (const unsigned char *inbuf, size_t inlen, un
 			} else {
 				if (sofar > 72) {
 					*outptr++ = '=';
+					if (crlf)
+						*outptr++ = '\r';
 					*outptr++ = '\n';
 					sofar = 3;
 				} else
@@ -1013,6 +1091,27 @@ g_mime_encoding_quoted_encode_step (const unsigned char *inbuf, size_t inlen, un
 }
 
 
+/**
+ * g_mime_encoding_quoted_encode_step:
+ * @inbuf: input buffer
+ * @inlen: input buffer length
+ * @outbuf: output buffer
+ * @state: holds the number of bits that are stored in @save
+ * @save: leftover bits that have not yet been encoded
+ *
+ * Quoted-printable encodes a block of text. Performs an 'encode
+ * step', saves left-over state in state and save (initialise to -1 on
+ * first invocation).
+ *
+ * Returns: the number of bytes encoded.
+ **/
+size_t
+g_mime_encoding_quoted_encode_step (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save)
+{
+	return quoted_encode_step (inbuf, inlen, outbuf, state, save, FALSE);
+}
+
+
 /**
  * g_mime_encoding_quoted_decode_step:
  * @inbuf: input buffer
@@ -86,6 +86,19 @@ const char *g_mime_content_encoding_to_string (GMimeContentEncoding encoding);
 #define GMIME_BASE64_ENCODE_LEN(x) ((size_t) (((((x) + 2) / 57) * 77) + 77))
 
 
+/**
+ * GMIME_BASE64_ENCODE_CRLF_LEN:
+ * @x: Length of the input data to encode
+ *
+ * Calculates the maximum number of bytes needed to base64 encode the
+ * full input buffer of length @x when lines end with CRLF.
+ *
+ * Returns: the number of output bytes needed to base64 encode an input
+ * buffer of size @x with CRLF line endings.
+ **/
+#define GMIME_BASE64_ENCODE_CRLF_LEN(x) ((size_t) (((((x) + 2) / 57) * 78) + 78))
+
+
 /**
  * GMIME_QP_ENCODE_LEN:
  * @x: Length of the input data to encode
@@ -99,6 +112,20 @@ const char *g_mime_content_encoding_to_string (GMimeContentEncoding encoding);
 #define GMIME_QP_ENCODE_LEN(x)     ((size_t) ((((x) / 24) * 74) + 74))
 
 
+/**
+ * GMIME_QP_ENCODE_CRLF_LEN:
+ * @x: Length of the input data to encode
+ *
+ * Calculates the maximum number of bytes needed to encode the full
+ * input buffer of length @x using the quoted-printable encoding when
+ * lines end with CRLF.
+ *
+ * Returns: the number of output bytes needed to encode an input buffer
+ * of size @x using the quoted-printable encoding with CRLF line endings.
+ **/
+#define GMIME_QP_ENCODE_CRLF_LEN(x) ((size_t) ((((x) / 24) * 76) + 80))
+
+
 /**
  * GMIME_UUENCODE_LEN:
  * @x: Length of the input data to encode
@@ -112,6 +139,19 @@ const char *g_mime_content_encoding_to_string (GMimeContentEncoding encoding);
 #define GMIME_UUENCODE_LEN(x)      ((size_t) (((((x) + 2) / 45) * 62) + 64))
 
 
+/**
+ * GMIME_UUENCODE_CRLF_LEN:
+ * @x: Length of the input data to encode
+ *
+ * Calculates the maximum number of bytes needed to uuencode the full
+ * input buffer of length @x when lines end with CRLF.
+ *
+ * Returns: the number of output bytes needed to uuencode an input
+ * buffer of size @x with CRLF line endings.
+ **/
+#define GMIME_UUENCODE_CRLF_LEN(x) ((size_t) (((((x) + 2) / 45) * 63) + 66))
+
+
 /**
  * GMIME_UUDECODE_STATE_INIT:
  *
@@ -27,6 +27,7 @@
 
 #include "gmime-filter-basic.h"
 #include "gmime-utils.h"
+#include "gmime-internal.h"
 
 
 /**
@@ -37,9 +38,23 @@
  *
  * A #GMimeFilter which can encode or decode basic MIME encodings such
  * as Quoted-Printable, Base64 and UUEncode.
+ *
+ * When encoding, the filter can also write the encoded lines with the
+ * new-line format of the destination directly (see
+ * g_mime_filter_basic_new_with_newline()), which avoids stacking a
+ * #GMimeFilterUnix2Dos or #GMimeFilterDos2Unix on top of it and making
+ * a second pass over the encoded output.
  **/
 
 
+typedef struct {
+	gboolean ensure_newline;
+	gboolean crlf;
+	char pc;
+} GMimeFilterBasicPrivate;
+
+#define GET_PRIVATE(basic) ((GMimeFilterBasicPrivate *) G_STRUCT_MEMBER_P (basic, private_offset))
+
 static void g_mime_filter_basic_class_init (GMimeFilterBasicClass *klass);
 static void g_mime_filter_basic_init (GMimeFilterBasic *filter, GMimeFilterBasicClass *klass);
 static void g_mime_filter_basic_finalize (GObject *object);
@@ -53,6 +68,7 @@ static void filter_reset (GMimeFilter *filter);
 
 
 static GMimeFilterClass *parent_class = NULL;
+static gint private_offset = 0;
 
 
 GType
@@ -74,6 +90,7 @@ g_mime_filter_basic_get_type (void)
 		};
 		
 		type = g_type_register_static (GMIME_TYPE_FILTER, "GMimeFilterBasic", &info, 0);
+		private_offset = g_type_add_instance_private (type, sizeof (GMimeFilterBasicPrivate));
 	}
 	
 	return type;
@@ -87,6 +104,7 @@ g_mime_filter_basic_class_init (GMimeFilterBasicClass *klass)
 	GMimeFilterClass *filter_class = GMIME_FILTER_CLASS (klass);
 	
 	parent_class = g_type_class_ref (GMIME_TYPE_FILTER);
+	g_type_class_adjust_private_offset (klass, &private_offset);
 	
 	object_class->finalize = g_mime_filter_basic_finalize;
 	
@@ -99,7 +117,11 @@ g_mime_filter_basic_class_init (GMimeFilterBasicClass *klass)
 static void
 g_mime_filter_basic_init (GMimeFilterBasic *filter, GMimeFilterBasicClass *klass)
 {
+	GMimeFilterBasicPrivate *priv = GET_PRIVATE (filter);
 	
+	priv->ensure_newline = FALSE;
+	priv->crlf = FALSE;
+	priv->pc = '\0';
 }
 
 static void
@@ -113,9 +135,17 @@ static GMimeFilter *
 filter_copy (GMimeFilter *filter)
 {
 	GMimeFilterBasic *basic = (GMimeFilterBasic *) filter;
+	GMimeFilterBasicPrivate *priv = GET_PRIVATE (basic);
 	GMimeEncoding *encoder = &basic->encoder;
+	GMimeFilterBasicPrivate *copy_priv;
+	GMimeFilterBasic *copy;
+	
+	copy = (GMimeFilterBasic *) g_mime_filter_basic_new (encoder->encoding, encoder->encode);
+	copy_priv = GET_PRIVATE (copy);
+	copy_priv->ensure_newline = priv->ensure_newline;
+	copy_priv->crlf = priv->crlf;
 	
-	return g_mime_filter_basic_new (encoder->encoding, encoder->encode);
+	return (GMimeFilter *) copy;
 }
 
 /* here we do all of the basic mime filtering */
@@ -124,6 +154,7 @@ filter_filter (GMimeFilter *filter, char *inbuf, size_t inlen, size_t prespace,
 	       char **outbuf, size_t *outlen, size_t *outprespace)
 {
 	GMimeFilterBasic *basic = (GMimeFilterBasic *) filter;
+	GMimeFilterBasicPrivate *priv = GET_PRIVATE (basic);
 	GMimeEncoding *encoder = &basic->encoder;
 	size_t nwritten = 0;
 	size_t len;
@@ -181,11 +212,14 @@ filter_filter (GMimeFilter *filter, char *inbuf, size_t inlen, size_t prespace,
 		}
 	}
 	
-	len = g_mime_encoding_outlen (encoder, inlen);
+	len = _g_mime_encoding_outlen (encoder, inlen, priv->crlf);
 	g_mime_filter_set_size (filter, len, FALSE);
-	nwritten = g_mime_encoding_step (encoder, inbuf, inlen, filter->outbuf);
+	nwritten = _g_mime_encoding_step (encoder, inbuf, inlen, filter->outbuf, priv->crlf);
 	g_assert (nwritten <= len);
 	
+	if (nwritten > 0)
+		priv->pc = filter->outbuf[nwritten - 1];
+	
 	*outprespace = filter->outpre;
 	*outbuf = filter->outbuf;
 	*outlen = nwritten;
@@ -196,6 +230,7 @@ filter_complete (GMimeFilter *filter, char *inbuf, size_t inlen, size_t prespace
 		 char **outbuf, size_t *outlen, size_t *outprespace)
 {
 	GMimeFilterBasic *basic = (GMimeFilterBasic *) filter;
+	GMimeFilterBasicPrivate *priv = GET_PRIVATE (basic);
 	GMimeEncoding *encoder = &basic->encoder;
 	size_t nwritten = 0;
 	size_t len;
@@ -211,9 +246,20 @@ filter_complete (GMimeFilter *filter, char *inbuf, size_t inlen, size_t prespace
 		}
 	}
 	
-	len = g_mime_encoding_outlen (encoder, inlen);
+	/* leave room for the new-line that ensure_newline may need */
+	len = _g_mime_encoding_outlen (encoder, inlen, priv->crlf) + 2;
 	g_mime_filter_set_size (filter, len, FALSE);
-	nwritten = g_mime_encoding_flush (encoder, inbuf, inlen, filter->outbuf);
+	nwritten = _g_mime_encoding_flush (encoder, inbuf, inlen, filter->outbuf, priv->crlf);
+	
+	if (nwritten > 0)
+		priv->pc = filter->outbuf[nwritten - 1];
+	
+	if (priv->ensure_newline && priv->pc != '\n') {
+		if (priv->crlf)
+			filter->outbuf[nwritten++] = '\r';
+		filter->outbuf[nwritten++] = '\n';
+	}
+	
 	g_assert (nwritten <= len);
 	
  done:
@@ -230,6 +276,7 @@ filter_reset (GMimeFilter *filter)
 	GMimeFilterBasic *basic = (GMimeFilterBasic *) filter;
 	
 	g_mime_encoding_reset (&basic->encoder);
+	GET_PRIVATE (basic)->pc = '\0';
 }
 
 
@@ -256,3 +303,36 @@ g_mime_filter_basic_new (GMimeContentEncoding encoding, gboolean encode)
 	
 	return (GMimeFilter *) basic;
 }
+
+
+/**
+ * g_mime_filter_basic_new_with_newline:
+ * @encoding: a #GMimeContentEncoding
+ * @newline: the #GMimeNewLineFormat of the encoded output
+ * @ensure_newline: %TRUE if the output must *always* end with a new line
+ *
+ * Creates a new basic filter that encodes to @encoding (one of
+ * %GMIME_CONTENT_ENCODING_BASE64, %GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE
+ * or %GMIME_CONTENT_ENCODING_UUENCODE) and ends each encoded line using
+ * the @newline format.
+ *
+ * The output is identical to that of a g_mime_filter_basic_new()
+ * encoder followed by the filter returned by
+ * g_mime_format_options_create_newline_filter(), but is produced in a
+ * single pass.
+ *
+ * Returns: a new basic encoder filter.
+ **/
+GMimeFilter *
+g_mime_filter_basic_new_with_newline (GMimeContentEncoding encoding, GMimeNewLineFormat newline, gboolean ensure_newline)
+{
+	GMimeFilterBasicPrivate *priv;
+	GMimeFilterBasic *basic;
+	
+	basic = (GMimeFilterBasic *) g_mime_filter_basic_new (encoding, TRUE);
+	priv = GET_PRIVATE (basic);
+	priv->crlf = newline == GMIME_NEWLINE_FORMAT_DOS;
+	priv->ensure_newline = ensure_newline;
+	
+	return (GMimeFilter *) basic;
+}
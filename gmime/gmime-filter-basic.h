@@ -22,6 +22,7 @@
 #ifndef __GMIME_FILTER_BASIC_H__
 #define __GMIME_FILTER_BASIC_H__
 
+#include <gmime/gmime-format-options.h>
 #include <gmime/gmime-encodings.h>
 #include <gmime/gmime-filter.h>
 
@@ -58,6 +59,8 @@ struct _GMimeFilterBasicClass {
 GType g_mime_filter_basic_get_type (void);
 
 GMimeFilter *g_mime_filter_basic_new (GMimeContentEncoding encoding, gboolean encode);
+GMimeFilter *g_mime_filter_basic_new_with_newline (GMimeContentEncoding encoding, GMimeNewLineFormat newline,
+						   gboolean ensure_newline);
 
 G_END_DECLS
 
@@ -28,6 +28,7 @@
 #include "gmime-filter-charset.h"
 #include "gmime-charset.h"
 #include "gmime-iconv.h"
+#include "gmime-internal.h"
 
 
 /**
@@ -53,7 +54,16 @@ static void filter_complete (GMimeFilter *filter, char *in, size_t len, size_t p
 static void filter_reset (GMimeFilter *filter);
 
 
+typedef struct {
+	gboolean passthrough;       /* UTF-8 to UTF-8, so valid input can be passed through as-is */
+	gboolean ascii_passthrough; /* both charsets are ASCII supersets, so pure ASCII can be passed through */
+	gconstpointer native;       /* the built-in converter used in place of cd, if any */
+} GMimeFilterCharsetPrivate;
+
+#define GET_PRIVATE(charset) ((GMimeFilterCharsetPrivate *) G_STRUCT_MEMBER_P (charset, private_offset))
+
 static GMimeFilterClass *parent_class = NULL;
+static gint private_offset = 0;
 
 
 GType
@@ -75,6 +85,7 @@ g_mime_filter_charset_get_type (void)
 		};
 		
 		type = g_type_register_static (GMIME_TYPE_FILTER, "GMimeFilterCharset", &info, 0);
+		private_offset = g_type_add_instance_private (type, sizeof (GMimeFilterCharsetPrivate));
 	}
 	
 	return type;
@@ -88,6 +99,7 @@ g_mime_filter_charset_class_init (GMimeFilterCharsetClass *klass)
 	GMimeFilterClass *filter_class = GMIME_FILTER_CLASS (klass);
 	
 	parent_class = g_type_class_ref (GMIME_TYPE_FILTER);
+	g_type_class_adjust_private_offset (klass, &private_offset);
 	
 	object_class->finalize = g_mime_filter_charset_finalize;
 	
@@ -100,9 +112,14 @@ g_mime_filter_charset_class_init (GMimeFilterCharsetClass *klass)
 static void
 g_mime_filter_charset_init (GMimeFilterCharset *filter, GMimeFilterCharsetClass *klass)
 {
+	GMimeFilterCharsetPrivate *priv = GET_PRIVATE (filter);
+	
 	filter->from_charset = NULL;
 	filter->to_charset = NULL;
 	filter->cd = (iconv_t) -1;
+	priv->passthrough = FALSE;
+	priv->ascii_passthrough = FALSE;
+	priv->native = NULL;
 }
 
 static void
@@ -127,18 +144,67 @@ filter_copy (GMimeFilter *filter)
 	return g_mime_filter_charset_new (charset->from_charset, charset->to_charset);
 }
 
+/* checks whether @in is valid UTF-8, apart from (possibly) a
+ * multibyte sequence that is cut off at the end of the buffer, the
+ * length of which gets stored in @partial */
+static gboolean
+utf8_validate_chunk (const char *in, size_t len, size_t *partial)
+{
+	const unsigned char *start = (const unsigned char *) in;
+	const unsigned char *inend = start + len;
+	const unsigned char *inptr = inend;
+	unsigned char c;
+	size_t n;
+	
+	*partial = 0;
+	
+	/* a cut-off sequence has its lead byte within the last 3 bytes */
+	while (inptr > start && inend - inptr < 2 && (inptr[-1] & 0xc0) == 0x80)
+		inptr--;
+	
+	if (inptr > start) {
+		c = inptr[-1];
+		n = (inend - inptr) + 1;
+		
+		/* the lead byte must promise more bytes than we have */
+		if (c >= 0xc2 && c <= 0xf4 && n < (c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : 2))
+			*partial = n;
+	}
+	
+	return _g_mime_utf8_validate (in, len - *partial);
+}
+
 static void
 filter_filter (GMimeFilter *filter, char *in, size_t len, size_t prespace,
 	       char **out, size_t *outlen, size_t *outprespace)
 {
 	GMimeFilterCharset *charset = (GMimeFilterCharset *) filter;
+	GMimeFilterCharsetPrivate *priv = GET_PRIVATE (charset);
 	size_t inleft, outleft, converted = 0;
+	size_t partial, n;
 	char *inbuf;
 	char *outbuf;
 	
 	if (charset->cd == (iconv_t) -1)
 		goto noop;
 	
+	if (priv->passthrough || priv->ascii_passthrough) {
+		/* pure ASCII reads the same in both charsets */
+		if ((n = _g_mime_ascii_span (in, len)) == len)
+			goto noop;
+		
+		/* converting valid UTF-8 to UTF-8 would just copy it */
+		if (priv->passthrough && utf8_validate_chunk (in + n, len - n, &partial)) {
+			if (partial > 0) {
+				/* save the incomplete sequence for next time, like iconv would */
+				g_mime_filter_backup (filter, in + len - partial, partial);
+				len -= partial;
+			}
+			
+			goto noop;
+		}
+	}
+	
 	g_mime_filter_set_size (filter, len * 5 + 16, FALSE);
 	outbuf = filter->outbuf;
 	outleft = filter->outsize;
@@ -147,7 +213,7 @@ filter_filter (GMimeFilter *filter, char *in, size_t len, size_t prespace,
 	inleft = len;
 	
 	do {
-		converted = iconv (charset->cd, &inbuf, &inleft, &outbuf, &outleft);
+		converted = _g_mime_iconv (charset->cd, priv->native, &inbuf, &inleft, &outbuf, &outleft);
 		if (converted == (size_t) -1) {
 			if (errno == E2BIG || errno == EINVAL)
 				break;
@@ -199,6 +265,7 @@ filter_complete (GMimeFilter *filter, char *in, size_t len, size_t prespace,
 		 char **out, size_t *outlen, size_t *outprespace)
 {
 	GMimeFilterCharset *charset = (GMimeFilterCharset *) filter;
+	GMimeFilterCharsetPrivate *priv = GET_PRIVATE (charset);
 	size_t inleft, outleft, converted = 0;
 	char *inbuf;
 	char *outbuf;
@@ -206,6 +273,13 @@ filter_complete (GMimeFilter *filter, char *in, size_t len, size_t prespace,
 	if (charset->cd == (iconv_t) -1)
 		goto noop;
 	
+	/* neither charset is stateful, so there is nothing for iconv to flush either */
+	if (priv->passthrough && _g_mime_utf8_validate (in, len))
+		goto noop;
+	
+	if (priv->ascii_passthrough && _g_mime_ascii_span (in, len) == len)
+		goto noop;
+	
 	g_mime_filter_set_size (filter, len * 5 + 16, FALSE);
 	outbuf = filter->outbuf;
 	outleft = filter->outsize;
@@ -215,7 +289,7 @@ filter_complete (GMimeFilter *filter, char *in, size_t len, size_t prespace,
 	
 	if (inleft > 0) {
 		do {
-			converted = iconv (charset->cd, &inbuf, &inleft, &outbuf, &outleft);
+			converted = _g_mime_iconv (charset->cd, priv->native, &inbuf, &inleft, &outbuf, &outleft);
 			if (converted != (size_t) -1)
 				continue;
 			
@@ -304,6 +378,7 @@ filter_reset (GMimeFilter *filter)
 GMimeFilter *
 g_mime_filter_charset_new (const char *from_charset, const char *to_charset)
 {
+	GMimeFilterCharsetPrivate *priv;
 	GMimeFilterCharset *charset;
 	iconv_t cd;
 	
@@ -312,9 +387,19 @@ g_mime_filter_charset_new (const char *from_charset, const char *to_charset)
 		return NULL;
 	
 	charset = g_object_new (GMIME_TYPE_FILTER_CHARSET, NULL);
+	priv = GET_PRIVATE (charset);
 	charset->from_charset = g_strdup (from_charset);
 	charset->to_charset = g_strdup (to_charset);
+	priv->native = _g_mime_iconv_native_lookup (to_charset, from_charset);
 	charset->cd = cd;
 	
+	if (!g_ascii_strcasecmp (g_mime_charset_canon_name (from_charset), "utf-8") &&
+	    !g_ascii_strcasecmp (g_mime_charset_canon_name (to_charset), "utf-8"))
+		priv->passthrough = TRUE;
+	
+	if (_g_mime_charset_is_ascii_superset (from_charset) &&
+	    _g_mime_charset_is_ascii_superset (to_charset))
+		priv->ascii_passthrough = TRUE;
+	
 	return (GMimeFilter *) charset;
 }
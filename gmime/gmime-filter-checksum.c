@@ -23,7 +23,17 @@
 #include <config.h>
 #endif
 
+#include <string.h>
+
 #include "gmime-filter-checksum.h"
+#include "gmime-filter-yenc.h"
+#include "gmime-internal.h"
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define HAVE_SHA256_SHANI 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
 
 
 /**
@@ -33,8 +43,37 @@
  * @see_also: #GMimeFilter
  *
  * Calculate a checksum for a stream.
+ *
+ * A single #GMimeFilterChecksum can compute several digests (and a
+ * crc32) in one pass over the data: see g_mime_filter_checksum_add()
+ * and g_mime_filter_checksum_add_crc32(). SHA-256 digests added this
+ * way are computed using the CPU's SHA extensions when available.
  **/
 
+/* SHA-256 using the x86 SHA extensions */
+typedef struct {
+	guint32 state[8];
+	guint64 length;
+	unsigned char block[64];
+	size_t blocklen;
+} Sha256;
+
+/* a digest computed in addition to (or instead of) the @checksum field */
+typedef struct {
+	GChecksumType type;
+	GChecksum *checksum;
+	Sha256 *sha256;
+} Digest;
+
+typedef struct {
+	GChecksumType type;
+	GArray *digests;
+	gboolean crc32;
+	guint32 crc;
+} GMimeFilterChecksumPrivate;
+
+#define GET_PRIVATE(checksum) ((GMimeFilterChecksumPrivate *) G_STRUCT_MEMBER_P (checksum, private_offset))
+
 static void g_mime_filter_checksum_class_init (GMimeFilterChecksumClass *klass);
 static void g_mime_filter_checksum_init (GMimeFilterChecksum *filter, GMimeFilterChecksumClass *klass);
 static void g_mime_filter_checksum_finalize (GObject *object);
@@ -48,6 +87,7 @@ static void filter_reset (GMimeFilter *filter);
 
 
 static GMimeFilterClass *parent_class = NULL;
+static gint private_offset = 0;
 
 
 GType
@@ -69,6 +109,7 @@ g_mime_filter_checksum_get_type (void)
 		};
 		
 		type = g_type_register_static (GMIME_TYPE_FILTER, "GMimeFilterChecksum", &info, 0);
+		private_offset = g_type_add_instance_private (type, sizeof (GMimeFilterChecksumPrivate));
 	}
 	
 	return type;
@@ -82,6 +123,7 @@ g_mime_filter_checksum_class_init (GMimeFilterChecksumClass *klass)
 	GMimeFilterClass *filter_class = GMIME_FILTER_CLASS (klass);
 	
 	parent_class = g_type_class_ref (GMIME_TYPE_FILTER);
+	g_type_class_adjust_private_offset (klass, &private_offset);
 	
 	object_class->finalize = g_mime_filter_checksum_finalize;
 	
@@ -94,6 +136,12 @@ g_mime_filter_checksum_class_init (GMimeFilterChecksumClass *klass)
 static void
 g_mime_filter_checksum_init (GMimeFilterChecksum *filter, GMimeFilterChecksumClass *klass)
 {
+	GMimeFilterChecksumPrivate *priv = GET_PRIVATE (filter);
+	
+	priv->type = G_CHECKSUM_MD5;
+	priv->digests = g_array_new (FALSE, FALSE, sizeof (Digest));
+	priv->crc = GMIME_YENCODE_CRC_INIT;
+	priv->crc32 = FALSE;
 	filter->checksum = NULL;
 }
 
@@ -101,6 +149,20 @@ static void
 g_mime_filter_checksum_finalize (GObject *object)
 {
 	GMimeFilterChecksum *filter = (GMimeFilterChecksum *) object;
+	GArray *digests = GET_PRIVATE (filter)->digests;
+	Digest *digest;
+	guint i;
+	
+	for (i = 0; i < digests->len; i++) {
+		digest = &g_array_index (digests, Digest, i);
+		
+		if (digest->checksum)
+			g_checksum_free (digest->checksum);
+		
+		g_free (digest->sha256);
+	}
+	
+	g_array_free (digests, TRUE);
 	
 	if (filter->checksum)
 		g_checksum_free (filter->checksum);
@@ -109,26 +171,274 @@ g_mime_filter_checksum_finalize (GObject *object)
 }
 
 
+#ifdef HAVE_SHA256_SHANI
+static const guint32 sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/* 4 rounds using the (byte-swapped) message words in @msg */
+#define SHA256_ROUNDS(k, msg) \
+	tmp = _mm_add_epi32 (msg, _mm_loadu_si128 ((const __m128i *) (sha256_k + (k)))); \
+	state1 = _mm_sha256rnds2_epu32 (state1, state0, tmp); \
+	tmp = _mm_shuffle_epi32 (tmp, 0x0e); \
+	state0 = _mm_sha256rnds2_epu32 (state0, state1, tmp)
+
+/* extends the message schedule: @next gets the words 4 after @cur */
+#define SHA256_SCHEDULE(next, cur, prev) \
+	next = _mm_sha256msg2_epu32 (_mm_add_epi32 (next, _mm_alignr_epi8 (cur, prev, 4)), cur)
+
+__attribute__ ((target ("sha,sse4.1,ssse3")))
+static void
+sha256_compress (guint32 state[8], const unsigned char *inbuf, size_t nblocks)
+{
+	const __m128i mask = _mm_set_epi64x (0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i state0, state1, abef, cdgh, tmp;
+	__m128i msg0, msg1, msg2, msg3;
+	
+	/* shuffle the state into the ABEF/CDGH order the instructions want */
+	tmp = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i *) &state[0]), 0xb1);
+	state1 = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i *) &state[4]), 0x1b);
+	state0 = _mm_alignr_epi8 (tmp, state1, 8);
+	state1 = _mm_blend_epi16 (state1, tmp, 0xf0);
+	
+	while (nblocks-- > 0) {
+		abef = state0;
+		cdgh = state1;
+		
+		msg0 = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) (inbuf + 0)), mask);
+		msg1 = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) (inbuf + 16)), mask);
+		msg2 = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) (inbuf + 32)), mask);
+		msg3 = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) (inbuf + 48)), mask);
+		
+		SHA256_ROUNDS (0, msg0);
+		SHA256_ROUNDS (4, msg1);
+		msg0 = _mm_sha256msg1_epu32 (msg0, msg1);
+		SHA256_ROUNDS (8, msg2);
+		msg1 = _mm_sha256msg1_epu32 (msg1, msg2);
+		SHA256_ROUNDS (12, msg3);
+		SHA256_SCHEDULE (msg0, msg3, msg2);
+		msg2 = _mm_sha256msg1_epu32 (msg2, msg3);
+		SHA256_ROUNDS (16, msg0);
+		SHA256_SCHEDULE (msg1, msg0, msg3);
+		msg3 = _mm_sha256msg1_epu32 (msg3, msg0);
+		SHA256_ROUNDS (20, msg1);
+		SHA256_SCHEDULE (msg2, msg1, msg0);
+		msg0 = _mm_sha256msg1_epu32 (msg0, msg1);
+		SHA256_ROUNDS (24, msg2);
+		SHA256_SCHEDULE (msg3, msg2, msg1);
+		msg1 = _mm_sha256msg1_epu32 (msg1, msg2);
+		SHA256_ROUNDS (28, msg3);
+		SHA256_SCHEDULE (msg0, msg3, msg2);
+		msg2 = _mm_sha256msg1_epu32 (msg2, msg3);
+		SHA256_ROUNDS (32, msg0);
+		SHA256_SCHEDULE (msg1, msg0, msg3);
+		msg3 = _mm_sha256msg1_epu32 (msg3, msg0);
+		SHA256_ROUNDS (36, msg1);
+		SHA256_SCHEDULE (msg2, msg1, msg0);
+		msg0 = _mm_sha256msg1_epu32 (msg0, msg1);
+		SHA256_ROUNDS (40, msg2);
+		SHA256_SCHEDULE (msg3, msg2, msg1);
+		msg1 = _mm_sha256msg1_epu32 (msg1, msg2);
+		SHA256_ROUNDS (44, msg3);
+		SHA256_SCHEDULE (msg0, msg3, msg2);
+		msg2 = _mm_sha256msg1_epu32 (msg2, msg3);
+		SHA256_ROUNDS (48, msg0);
+		SHA256_SCHEDULE (msg1, msg0, msg3);
+		msg3 = _mm_sha256msg1_epu32 (msg3, msg0);
+		SHA256_ROUNDS (52, msg1);
+		SHA256_SCHEDULE (msg2, msg1, msg0);
+		SHA256_ROUNDS (56, msg2);
+		SHA256_SCHEDULE (msg3, msg2, msg1);
+		SHA256_ROUNDS (60, msg3);
+		
+		state0 = _mm_add_epi32 (state0, abef);
+		state1 = _mm_add_epi32 (state1, cdgh);
+		inbuf += 64;
+	}
+	
+	/* and back into ABCD/EFGH order */
+	tmp = _mm_shuffle_epi32 (state0, 0x1b);
+	state1 = _mm_shuffle_epi32 (state1, 0xb1);
+	_mm_storeu_si128 ((__m128i *) &state[0], _mm_blend_epi16 (tmp, state1, 0xf0));
+	_mm_storeu_si128 ((__m128i *) &state[4], _mm_alignr_epi8 (state1, tmp, 8));
+}
+
+static gboolean
+sha256_supported (void)
+{
+	static gsize supported = 0;
+	unsigned int eax, ebx, ecx, edx;
+	
+	if (g_once_init_enter (&supported)) {
+		gsize value = 1;
+		
+		if (__get_cpuid (1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_1) && (ecx & bit_SSSE3) &&
+		    __get_cpuid_max (0, NULL) >= 7) {
+			__cpuid_count (7, 0, eax, ebx, ecx, edx);
+			
+			if (ebx & bit_SHA)
+				value = 2;
+		}
+		
+		g_once_init_leave (&supported, value);
+	}
+	
+	return supported == 2;
+}
+#else
+#define sha256_supported() FALSE
+#define sha256_compress(state, inbuf, nblocks) g_assert_not_reached ()
+#endif /* HAVE_SHA256_SHANI */
+
+static void
+sha256_reset (Sha256 *sha256)
+{
+	static const guint32 init[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+	
+	memcpy (sha256->state, init, sizeof (init));
+	sha256->blocklen = 0;
+	sha256->length = 0;
+}
+
+static void
+sha256_update (Sha256 *sha256, const unsigned char *inbuf, size_t inlen)
+{
+	size_t n;
+	
+	sha256->length += inlen;
+	
+	if (sha256->blocklen > 0) {
+		n = MIN (inlen, 64 - sha256->blocklen);
+		memcpy (sha256->block + sha256->blocklen, inbuf, n);
+		sha256->blocklen += n;
+		inbuf += n;
+		inlen -= n;
+		
+		if (sha256->blocklen < 64)
+			return;
+		
+		sha256_compress (sha256->state, sha256->block, 1);
+		sha256->blocklen = 0;
+	}
+	
+	if (inlen >= 64) {
+		sha256_compress (sha256->state, inbuf, inlen / 64);
+		inbuf += inlen & ~((size_t) 63);
+		inlen &= 63;
+	}
+	
+	memcpy (sha256->block, inbuf, inlen);
+	sha256->blocklen = inlen;
+}
+
+static void
+sha256_get_digest (const Sha256 *sha256, unsigned char digest[32])
+{
+	Sha256 final = *sha256;
+	guint64 bits;
+	int i;
+	
+	final.block[final.blocklen++] = 0x80;
+	
+	if (final.blocklen > 56) {
+		memset (final.block + final.blocklen, 0, 64 - final.blocklen);
+		sha256_compress (final.state, final.block, 1);
+		final.blocklen = 0;
+	}
+	
+	memset (final.block + final.blocklen, 0, 56 - final.blocklen);
+	bits = sha256->length * 8;
+	
+	for (i = 0; i < 8; i++)
+		final.block[63 - i] = (bits >> (i * 8)) & 0xff;
+	
+	sha256_compress (final.state, final.block, 1);
+	
+	for (i = 0; i < 8; i++) {
+		digest[i * 4] = final.state[i] >> 24;
+		digest[i * 4 + 1] = (final.state[i] >> 16) & 0xff;
+		digest[i * 4 + 2] = (final.state[i] >> 8) & 0xff;
+		digest[i * 4 + 3] = final.state[i] & 0xff;
+	}
+}
+
+
 static GMimeFilter *
 filter_copy (GMimeFilter *filter)
 {
-	GChecksum *checksum = ((GMimeFilterChecksum *) filter)->checksum;
+	GMimeFilterChecksum *checksum = (GMimeFilterChecksum *) filter;
+	GMimeFilterChecksumPrivate *priv = GET_PRIVATE (checksum);
+	GMimeFilterChecksumPrivate *copy_priv;
 	GMimeFilterChecksum *copy;
+	Digest digest;
+	guint i;
 	
 	copy = g_object_new (GMIME_TYPE_FILTER_CHECKSUM, NULL);
-	copy->checksum = checksum ? g_checksum_copy (checksum) : NULL;
+	copy->checksum = checksum->checksum ? g_checksum_copy (checksum->checksum) : NULL;
+	copy_priv = GET_PRIVATE (copy);
+	copy_priv->type = priv->type;
+	copy_priv->crc32 = priv->crc32;
+	copy_priv->crc = priv->crc;
+	
+	for (i = 0; i < priv->digests->len; i++) {
+		digest = g_array_index (priv->digests, Digest, i);
+		
+		if (digest.checksum)
+			digest.checksum = g_checksum_copy (digest.checksum);
+		else
+			digest.sha256 = g_memdup2 (digest.sha256, sizeof (Sha256));
+		
+		g_array_append_val (copy_priv->digests, digest);
+	}
 	
 	return (GMimeFilter *) copy;
 }
 
+/**
+ * _g_mime_filter_checksum_update:
+ * @checksum: checksum filter object
+ * @inbuf: input buffer
+ * @inlen: input buffer length
+ *
+ * Updates each of the digests computed by @checksum with @inbuf.
+ **/
+void
+_g_mime_filter_checksum_update (GMimeFilterChecksum *checksum, const unsigned char *inbuf, size_t inlen)
+{
+	GMimeFilterChecksumPrivate *priv = GET_PRIVATE (checksum);
+	Digest *digest;
+	guint i;
+	
+	if (checksum->checksum)
+		g_checksum_update (checksum->checksum, inbuf, inlen);
+	
+	for (i = 0; i < priv->digests->len; i++) {
+		digest = &g_array_index (priv->digests, Digest, i);
+		
+		if (digest->checksum)
+			g_checksum_update (digest->checksum, inbuf, inlen);
+		else
+			sha256_update (digest->sha256, inbuf, inlen);
+	}
+	
+	if (priv->crc32)
+		priv->crc = _g_mime_crc32_update (priv->crc, inbuf, inlen);
+}
 
 static void
 filter_filter (GMimeFilter *filter, char *in, size_t len, size_t prespace,
 	       char **out, size_t *outlen, size_t *outprespace)
 {
-	GChecksum *checksum = ((GMimeFilterChecksum *) filter)->checksum;
-	
-	g_checksum_update (checksum, (unsigned char *) in, len);
+	_g_mime_filter_checksum_update ((GMimeFilterChecksum *) filter, (unsigned char *) in, len);
 	
 	*out = in;
 	*outlen = len;
@@ -145,9 +455,24 @@ filter_complete (GMimeFilter *filter, char *in, size_t len, size_t prespace,
 static void
 filter_reset (GMimeFilter *filter)
 {
-	GChecksum *checksum = ((GMimeFilterChecksum *) filter)->checksum;
+	GMimeFilterChecksum *checksum = (GMimeFilterChecksum *) filter;
+	GArray *digests = GET_PRIVATE (checksum)->digests;
+	Digest *digest;
+	guint i;
+	
+	if (checksum->checksum)
+		g_checksum_reset (checksum->checksum);
+	
+	for (i = 0; i < digests->len; i++) {
+		digest = &g_array_index (digests, Digest, i);
+		
+		if (digest->checksum)
+			g_checksum_reset (digest->checksum);
+		else
+			sha256_reset (digest->sha256);
+	}
 	
-	g_checksum_reset (checksum);
+	GET_PRIVATE (checksum)->crc = GMIME_YENCODE_CRC_INIT;
 }
 
 
@@ -166,11 +491,123 @@ g_mime_filter_checksum_new (GChecksumType type)
 	
 	checksum = g_object_new (GMIME_TYPE_FILTER_CHECKSUM, NULL);
 	checksum->checksum = g_checksum_new (type);
+	GET_PRIVATE (checksum)->type = type;
 	
 	return (GMimeFilter *) checksum;
 }
 
 
+/**
+ * g_mime_filter_checksum_new_multi:
+ *
+ * Creates a new checksum filter that computes no digests until some
+ * are added using g_mime_filter_checksum_add() and/or
+ * g_mime_filter_checksum_add_crc32().
+ *
+ * Unlike a filter created with g_mime_filter_checksum_new(), the
+ * @checksum field of the new filter is %NULL. Instead,
+ * g_mime_filter_checksum_get_digest() and
+ * g_mime_filter_checksum_get_string() get the first digest that was
+ * added.
+ *
+ * Returns: a new #GMimeFilterChecksum filter.
+ **/
+GMimeFilter *
+g_mime_filter_checksum_new_multi (void)
+{
+	return g_object_new (GMIME_TYPE_FILTER_CHECKSUM, NULL);
+}
+
+
+static Digest *
+checksum_get_digest (GMimeFilterChecksum *checksum, GChecksumType type)
+{
+	GArray *digests = GET_PRIVATE (checksum)->digests;
+	Digest *digest;
+	guint i;
+	
+	for (i = 0; i < digests->len; i++) {
+		digest = &g_array_index (digests, Digest, i);
+		
+		if (digest->type == type)
+			return digest;
+	}
+	
+	return NULL;
+}
+
+
+/**
+ * g_mime_filter_checksum_add:
+ * @checksum: checksum filter object
+ * @type: the type of checksum
+ *
+ * Makes @checksum also compute a @type digest in the same pass over
+ * the data as the digests it already computes. SHA-256 digests are
+ * computed using the CPU's SHA extensions when available.
+ *
+ * Digests should be added before any data is filtered.
+ **/
+void
+g_mime_filter_checksum_add (GMimeFilterChecksum *checksum, GChecksumType type)
+{
+	Digest digest;
+	
+	g_return_if_fail (GMIME_IS_FILTER_CHECKSUM (checksum));
+	
+	if ((checksum->checksum != NULL && type == GET_PRIVATE (checksum)->type) || checksum_get_digest (checksum, type) != NULL)
+		return;
+	
+	digest.type = type;
+	digest.checksum = NULL;
+	digest.sha256 = NULL;
+	
+	if (type == G_CHECKSUM_SHA256 && sha256_supported ()) {
+		digest.sha256 = g_new (Sha256, 1);
+		sha256_reset (digest.sha256);
+	} else {
+		digest.checksum = g_checksum_new (type);
+	}
+	
+	g_array_append_val (GET_PRIVATE (checksum)->digests, digest);
+}
+
+
+/**
+ * g_mime_filter_checksum_add_crc32:
+ * @checksum: checksum filter object
+ *
+ * Makes @checksum also compute the crc32 of the data (the same crc32
+ * as used by gzip and yEnc), which can be retrieved using
+ * g_mime_filter_checksum_get_crc32().
+ **/
+void
+g_mime_filter_checksum_add_crc32 (GMimeFilterChecksum *checksum)
+{
+	g_return_if_fail (GMIME_IS_FILTER_CHECKSUM (checksum));
+	
+	GET_PRIVATE (checksum)->crc32 = TRUE;
+}
+
+
+/**
+ * g_mime_filter_checksum_get_crc32:
+ * @checksum: checksum filter object
+ *
+ * Gets the crc32 of the data filtered so far. Only computed if
+ * g_mime_filter_checksum_add_crc32() was called.
+ *
+ * Returns: the crc32 of the data.
+ **/
+guint32
+g_mime_filter_checksum_get_crc32 (GMimeFilterChecksum *checksum)
+{
+	g_return_val_if_fail (GMIME_IS_FILTER_CHECKSUM (checksum), 0);
+	
+	return GMIME_YENCODE_CRC_FINAL (GET_PRIVATE (checksum)->crc);
+}
+
+
 /**
  * g_mime_filter_checksum_get_digest:
  * @checksum: checksum filter object
@@ -184,14 +621,70 @@ g_mime_filter_checksum_new (GChecksumType type)
 size_t
 g_mime_filter_checksum_get_digest (GMimeFilterChecksum *checksum, unsigned char *digest, size_t len)
 {
+	GArray *digests;
+	
 	g_return_val_if_fail (GMIME_IS_FILTER_CHECKSUM (checksum), 0);
 	
+	if (checksum->checksum == NULL) {
+		digests = GET_PRIVATE (checksum)->digests;
+		
+		if (digests->len == 0)
+			return 0;
+		
+		return g_mime_filter_checksum_get_digest_for_type (checksum, g_array_index (digests, Digest, 0).type, digest, len);
+	}
+	
 	g_checksum_get_digest (checksum->checksum, digest, &len);
 	
 	return len;
 }
 
 
+/**
+ * g_mime_filter_checksum_get_digest_for_type:
+ * @checksum: checksum filter object
+ * @type: the type of checksum
+ * @digest: (array length=len): the digest buffer
+ * @len: the length of the digest buffer
+ *
+ * Outputs the @type digest into @digest, @type being either the type
+ * that @checksum was created with or one that was added using
+ * g_mime_filter_checksum_add().
+ *
+ * Returns: the number of bytes used of the @digest buffer or %0 if
+ * @checksum does not compute a @type digest.
+ **/
+size_t
+g_mime_filter_checksum_get_digest_for_type (GMimeFilterChecksum *checksum, GChecksumType type,
+					    unsigned char *digest, size_t len)
+{
+	unsigned char sha256[32];
+	Digest *d;
+	
+	g_return_val_if_fail (GMIME_IS_FILTER_CHECKSUM (checksum), 0);
+	
+	if (!(d = checksum_get_digest (checksum, type))) {
+		if (checksum->checksum != NULL && type == GET_PRIVATE (checksum)->type)
+			return g_mime_filter_checksum_get_digest (checksum, digest, len);
+		
+		return 0;
+	}
+	
+	if (d->checksum) {
+		g_checksum_get_digest (d->checksum, digest, &len);
+		return len;
+	}
+	
+	if (len < sizeof (sha256))
+		return 0;
+	
+	sha256_get_digest (d->sha256, sha256);
+	memcpy (digest, sha256, sizeof (sha256));
+	
+	return sizeof (sha256);
+}
+
+
 /**
  * g_mime_filter_checksum_get_string:
  * @checksum: checksum filter object
@@ -203,7 +696,66 @@ g_mime_filter_checksum_get_digest (GMimeFilterChecksum *checksum, unsigned char
 gchar *
 g_mime_filter_checksum_get_string (GMimeFilterChecksum *checksum)
 {
+	GArray *digests;
+	
 	g_return_val_if_fail (GMIME_IS_FILTER_CHECKSUM (checksum), NULL);
-
+	
+	if (checksum->checksum == NULL) {
+		digests = GET_PRIVATE (checksum)->digests;
+		
+		if (digests->len == 0)
+			return NULL;
+		
+		return g_mime_filter_checksum_get_string_for_type (checksum, g_array_index (digests, Digest, 0).type);
+	}
+	
 	return g_strdup (g_checksum_get_string (checksum->checksum));
 }
+
+
+/**
+ * g_mime_filter_checksum_get_string_for_type:
+ * @checksum: checksum filter object
+ * @type: the type of checksum
+ *
+ * Outputs the @type digest as a newly allocated hexadecimal string,
+ * @type being either the type that @checksum was created with or one
+ * that was added using g_mime_filter_checksum_add().
+ *
+ * Returns: the hexadecimal representation of the checksum or %NULL if
+ * @checksum does not compute a @type digest. The returned string
+ * should be freed with g_free() when no longer needed.
+ **/
+gchar *
+g_mime_filter_checksum_get_string_for_type (GMimeFilterChecksum *checksum, GChecksumType type)
+{
+	static const char hex[] = "0123456789abcdef";
+	unsigned char digest[32];
+	char *str;
+	Digest *d;
+	int i;
+	
+	g_return_val_if_fail (GMIME_IS_FILTER_CHECKSUM (checksum), NULL);
+	
+	if (!(d = checksum_get_digest (checksum, type))) {
+		if (checksum->checksum != NULL && type == GET_PRIVATE (checksum)->type)
+			return g_mime_filter_checksum_get_string (checksum);
+		
+		return NULL;
+	}
+	
+	if (d->checksum)
+		return g_strdup (g_checksum_get_string (d->checksum));
+	
+	sha256_get_digest (d->sha256, digest);
+	str = g_malloc (sizeof (digest) * 2 + 1);
+	
+	for (i = 0; i < (int) sizeof (digest); i++) {
+		str[i * 2] = hex[digest[i] >> 4];
+		str[i * 2 + 1] = hex[digest[i] & 0xf];
+	}
+	
+	str[i * 2] = '\0';
+	
+	return str;
+}
@@ -39,7 +39,7 @@ typedef struct _GMimeFilterChecksumClass GMimeFilterChecksumClass;
 /**
  * GMimeFilterChecksum:
  * @parent_object: parent #GMimeFilter
- * @checksum: The checksum context
+ * @checksum: The checksum context (%NULL if created with g_mime_filter_checksum_new_multi())
  *
  * A filter for calculating the checksum of a stream.
  **/
@@ -58,10 +58,19 @@ struct _GMimeFilterChecksumClass {
 GType g_mime_filter_checksum_get_type (void);
 
 GMimeFilter *g_mime_filter_checksum_new (GChecksumType type);
+GMimeFilter *g_mime_filter_checksum_new_multi (void);
+
+void g_mime_filter_checksum_add (GMimeFilterChecksum *checksum, GChecksumType type);
+void g_mime_filter_checksum_add_crc32 (GMimeFilterChecksum *checksum);
 
 size_t g_mime_filter_checksum_get_digest (GMimeFilterChecksum *checksum, unsigned char *digest, size_t len);
 gchar *g_mime_filter_checksum_get_string (GMimeFilterChecksum *checksum);
 
+size_t g_mime_filter_checksum_get_digest_for_type (GMimeFilterChecksum *checksum, GChecksumType type,
+						   unsigned char *digest, size_t len);
+gchar *g_mime_filter_checksum_get_string_for_type (GMimeFilterChecksum *checksum, GChecksumType type);
+guint32 g_mime_filter_checksum_get_crc32 (GMimeFilterChecksum *checksum);
+
 G_END_DECLS
 
 #endif /* __GMIME_FILTER_CHECKSUM_H__ */
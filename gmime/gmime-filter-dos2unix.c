@@ -23,6 +23,8 @@
 #include <config.h>
 #endif
 
+#include <string.h>
+
 #include "gmime-filter-dos2unix.h"
 
 
@@ -108,40 +110,82 @@ convert (GMimeFilter *filter, char *inbuf, size_t inlen, size_t prespace,
 	 char **outbuf, size_t *outlen, size_t *outprespace, gboolean flush)
 {
 	GMimeFilterDos2Unix *dos2unix = (GMimeFilterDos2Unix *) filter;
+	gboolean append = flush && dos2unix->ensure_newline;
 	register const char *inptr = inbuf;
 	const char *inend = inbuf + inlen;
 	size_t expected = inlen;
-	char *outptr;
+	char *outstart, *outptr;
+	const char *cr;
+	size_t outpre;
+	size_t n;
+	char c;
 	
-	if (flush && dos2unix->ensure_newline)
-		expected++;
+	if (dos2unix->pc != '\r' && !memchr (inbuf, '\r', inlen)) {
+		c = inlen > 0 ? inbuf[inlen - 1] : dos2unix->pc;
+		
+		if (!append || c == '\n') {
+			/* nothing to convert, so pass the input through as-is */
+			dos2unix->pc = c;
+			
+			*outlen = inlen;
+			*outprespace = prespace;
+			*outbuf = inbuf;
+			return;
+		}
+	}
 	
-	if (dos2unix->pc == '\r')
-		expected++;
+	if (!append && g_mime_filter_get_in_place (filter) && (dos2unix->pc != '\r' || prespace > 0)) {
+		/* the output never gets ahead of the input, so write it over
+		 * the input (with a '\r' held over from last time going in the
+		 * prespace) */
+		outstart = dos2unix->pc == '\r' ? inbuf - 1 : inbuf;
+		outpre = prespace - (inbuf - outstart);
+	} else {
+		if (append)
+			expected++;
+		
+		if (dos2unix->pc == '\r')
+			expected++;
+		
+		g_mime_filter_set_size (filter, expected, FALSE);
+		outstart = filter->outbuf;
+		outpre = filter->outpre;
+	}
+	
+	outptr = outstart;
 	
-	g_mime_filter_set_size (filter, expected, FALSE);
+	/* a '\r' held over from last time is only dropped if it begins a CRLF */
+	if (dos2unix->pc == '\r' && inptr < inend && *inptr != '\n')
+		*outptr++ = '\r';
 	
-	outptr = filter->outbuf;
+	/* copy everything between the CRs in bulk (memmove since the output
+	 * may be the input); a CR at the very end is held over until we know
+	 * what follows it */
 	while (inptr < inend) {
-		if (*inptr == '\n') {
-			*outptr++ = *inptr;
-		} else {
-			if (dos2unix->pc == '\r')
-				*outptr++ = dos2unix->pc;
-			
-			if (*inptr != '\r')
-				*outptr++ = *inptr;
+		if (!(cr = memchr (inptr, '\r', inend - inptr)))
+			cr = inend;
+		
+		if ((n = cr - inptr) > 0) {
+			if (outptr != inptr)
+				memmove (outptr, inptr, n);
+			outptr += n;
 		}
 		
-		dos2unix->pc = *inptr++;
+		inptr = cr + 1;
+		
+		if (inptr < inend && *inptr != '\n')
+			*outptr++ = '\r';
 	}
 	
-	if (flush && dos2unix->ensure_newline && dos2unix->pc != '\n')
+	if (inlen > 0)
+		dos2unix->pc = inend[-1];
+	
+	if (append && dos2unix->pc != '\n')
 		dos2unix->pc = *outptr++ = '\n';
 	
-	*outlen = outptr - filter->outbuf;
-	*outprespace = filter->outpre;
-	*outbuf = filter->outbuf;
+	*outlen = outptr - outstart;
+	*outprespace = outpre;
+	*outbuf = outstart;
 }
 
 static void
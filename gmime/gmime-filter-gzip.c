@@ -26,7 +26,27 @@
 #include <stdio.h>
 #include <string.h>
 
+#ifdef HAVE_ZLIB_NG
+#include <zlib-ng.h>
+
+/* map the zlib API used below onto zlib-ng's native API */
+#define z_stream zng_stream
+#define deflateInit2(strm, level, method, bits, mem, strategy) zng_deflateInit2 (strm, level, method, bits, mem, strategy)
+#define deflateReset(strm) zng_deflateReset (strm)
+#define deflateEnd(strm) zng_deflateEnd (strm)
+#define deflate(strm, flush) zng_deflate (strm, flush)
+#define inflateInit2(strm, bits) zng_inflateInit2 (strm, bits)
+#define inflateReset(strm) zng_inflateReset (strm)
+#define inflateEnd(strm) zng_inflateEnd (strm)
+#define inflate(strm, flush) zng_inflate (strm, flush)
+#define crc32(crc, buf, len) zng_crc32 (crc, buf, len)
+#else
 #include <zlib.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "gmime-filter-gzip.h"
 
@@ -44,7 +64,7 @@
  * @see_also: #GMimeFilter
  *
  * A #GMimeFilter used for compressing or decompressing a stream using
- * GNU Zip.
+ * GNU Zip or, when GMime is built with zstd support, Zstandard.
  **/
 
 
@@ -115,7 +135,14 @@ typedef union {
 } gzip_state_t;
 
 struct _GMimeFilterGZipPrivate {
+	GMimeFilterGZipFormat format;
+	guint threads;
+	
 	z_stream *stream;
+#ifdef HAVE_ZSTD
+	ZSTD_CCtx *cctx;
+	ZSTD_DCtx *dctx;
+#endif
 	
 	gzip_state_t state;
 	gzip_hdr_t hdr;
@@ -197,10 +224,19 @@ g_mime_filter_gzip_finalize (GObject *object)
 	GMimeFilterGZip *gzip = (GMimeFilterGZip *) object;
 	struct _GMimeFilterGZipPrivate *priv = gzip->priv;
 	
-	if (gzip->mode == GMIME_FILTER_GZIP_MODE_ZIP)
-		deflateEnd (priv->stream);
-	else
-		inflateEnd (priv->stream);
+#ifdef HAVE_ZSTD
+	if (priv->cctx)
+		ZSTD_freeCCtx (priv->cctx);
+	if (priv->dctx)
+		ZSTD_freeDCtx (priv->dctx);
+#endif
+	
+	if (priv->format == GMIME_FILTER_GZIP_FORMAT_GZIP) {
+		if (gzip->mode == GMIME_FILTER_GZIP_MODE_ZIP)
+			deflateEnd (priv->stream);
+		else
+			inflateEnd (priv->stream);
+	}
 	
 	g_free (priv->filename);
 	g_free (priv->comment);
@@ -215,8 +251,12 @@ static GMimeFilter *
 filter_copy (GMimeFilter *filter)
 {
 	GMimeFilterGZip *gzip = (GMimeFilterGZip *) filter;
+	GMimeFilter *copy;
+	
+	copy = g_mime_filter_gzip_new_with_format (gzip->mode, gzip->priv->format, gzip->level);
+	g_mime_filter_gzip_set_threads ((GMimeFilterGZip *) copy, gzip->priv->threads);
 	
-	return g_mime_filter_gzip_new (gzip->mode, gzip->level);
+	return copy;
 }
 
 static inline size_t
@@ -463,7 +503,7 @@ gunzip_filter (GMimeFilter *filter, char *in, size_t len, size_t prespace,
 			g_mime_filter_backup (filter, start, left);
 			return;
 		}
-
+		
 		g_free (priv->comment);
 		priv->comment = g_strndup (start, inptr - start);
 		priv->state.unzip.got_fcomment = TRUE;
@@ -533,12 +573,125 @@ gunzip_filter (GMimeFilter *filter, char *in, size_t len, size_t prespace,
 	*outprespace = filter->outpre;
 }
 
+#ifdef HAVE_ZSTD
+static void
+zstd_filter (GMimeFilter *filter, char *in, size_t len, size_t prespace,
+	     char **out, size_t *outlen, size_t *outprespace, gboolean flush)
+{
+	GMimeFilterGZip *gzip = (GMimeFilterGZip *) filter;
+	struct _GMimeFilterGZipPrivate *priv = gzip->priv;
+	ZSTD_EndDirective directive = flush ? ZSTD_e_end : ZSTD_e_continue;
+	ZSTD_outBuffer output;
+	ZSTD_inBuffer input;
+	size_t retval;
+	
+	if (priv->state.zip.flushed) {
+		*outprespace = prespace;
+		*outlen = 0;
+		*out = in;
+		return;
+	}
+	
+	g_mime_filter_set_size (filter, next_alloc_size (ZSTD_compressBound (len)), FALSE);
+	
+	input.src = in;
+	input.size = len;
+	input.pos = 0;
+	
+	output.dst = filter->outbuf;
+	output.size = filter->outsize;
+	output.pos = 0;
+	
+	do {
+		/* Note: in multithreaded mode, this blocks on the oldest job
+		 * if it cannot make any progress with the input */
+		retval = ZSTD_compressStream2 (priv->cctx, &output, &input, directive);
+		
+		if (ZSTD_isError (retval)) {
+			w(fprintf (stderr, "zstd: %s\n", ZSTD_getErrorName (retval)));
+			break;
+		}
+		
+		/* when ending the frame, retval is the amount left to flush */
+		if (flush ? retval == 0 : input.pos == input.size)
+			break;
+		
+		if (output.pos == output.size) {
+			g_mime_filter_set_size (filter, next_alloc_size (output.size + ZSTD_CStreamOutSize ()), TRUE);
+			output.dst = filter->outbuf;
+			output.size = filter->outsize;
+		}
+	} while (1);
+	
+	if (flush)
+		priv->state.zip.flushed = TRUE;
+	
+	*out = filter->outbuf;
+	*outlen = output.pos;
+	*outprespace = filter->outpre;
+}
+
+static void
+unzstd_filter (GMimeFilter *filter, char *in, size_t len, size_t prespace,
+	       char **out, size_t *outlen, size_t *outprespace, gboolean flush)
+{
+	GMimeFilterGZip *gzip = (GMimeFilterGZip *) filter;
+	struct _GMimeFilterGZipPrivate *priv = gzip->priv;
+	ZSTD_outBuffer output;
+	ZSTD_inBuffer input;
+	size_t retval;
+	
+	g_mime_filter_set_size (filter, next_alloc_size ((len * 4) + 12), FALSE);
+	
+	input.src = in;
+	input.size = len;
+	input.pos = 0;
+	
+	output.dst = filter->outbuf;
+	output.size = filter->outsize;
+	output.pos = 0;
+	
+	do {
+		retval = ZSTD_decompressStream (priv->dctx, &output, &input);
+		
+		if (ZSTD_isError (retval)) {
+			w(fprintf (stderr, "unzstd: %s\n", ZSTD_getErrorName (retval)));
+			break;
+		}
+		
+		/* a full output buffer may mean that there is more to flush */
+		if (input.pos == input.size && output.pos < output.size)
+			break;
+		
+		if (output.pos == output.size) {
+			g_mime_filter_set_size (filter, next_alloc_size (output.size * 2), TRUE);
+			output.dst = filter->outbuf;
+			output.size = filter->outsize;
+		}
+	} while (1);
+	
+	*out = filter->outbuf;
+	*outlen = output.pos;
+	*outprespace = filter->outpre;
+}
+#endif /* HAVE_ZSTD */
+
 static void
 filter_filter (GMimeFilter *filter, char *in, size_t len, size_t prespace,
 	       char **out, size_t *outlen, size_t *outprespace)
 {
 	GMimeFilterGZip *gzip = (GMimeFilterGZip *) filter;
 	
+#ifdef HAVE_ZSTD
+	if (gzip->priv->format == GMIME_FILTER_GZIP_FORMAT_ZSTD) {
+		if (gzip->mode == GMIME_FILTER_GZIP_MODE_ZIP)
+			zstd_filter (filter, in, len, prespace, out, outlen, outprespace, FALSE);
+		else
+			unzstd_filter (filter, in, len, prespace, out, outlen, outprespace, FALSE);
+		return;
+	}
+#endif
+	
 	if (gzip->mode == GMIME_FILTER_GZIP_MODE_ZIP)
 		gzip_filter (filter, in, len, prespace, out, outlen, outprespace, FALSE);
 	else
@@ -551,6 +704,16 @@ filter_complete (GMimeFilter *filter, char *in, size_t len, size_t prespace,
 {
 	GMimeFilterGZip *gzip = (GMimeFilterGZip *) filter;
 	
+#ifdef HAVE_ZSTD
+	if (gzip->priv->format == GMIME_FILTER_GZIP_FORMAT_ZSTD) {
+		if (gzip->mode == GMIME_FILTER_GZIP_MODE_ZIP)
+			zstd_filter (filter, in, len, prespace, out, outlen, outprespace, TRUE);
+		else
+			unzstd_filter (filter, in, len, prespace, out, outlen, outprespace, TRUE);
+		return;
+	}
+#endif
+	
 	if (gzip->mode == GMIME_FILTER_GZIP_MODE_ZIP)
 		gzip_filter (filter, in, len, prespace, out, outlen, outprespace, TRUE);
 	else
@@ -565,6 +728,18 @@ filter_reset (GMimeFilter *filter)
 	
 	memset (&priv->state, 0, sizeof (priv->state));
 	
+#ifdef HAVE_ZSTD
+	if (priv->format == GMIME_FILTER_GZIP_FORMAT_ZSTD) {
+		if (gzip->mode == GMIME_FILTER_GZIP_MODE_ZIP) {
+			ZSTD_CCtx_reset (priv->cctx, ZSTD_reset_session_only);
+			ZSTD_CCtx_setParameter (priv->cctx, ZSTD_c_nbWorkers, (int) priv->threads);
+		} else {
+			ZSTD_DCtx_reset (priv->dctx, ZSTD_reset_session_only);
+		}
+		return;
+	}
+#endif
+	
 	if (gzip->mode == GMIME_FILTER_GZIP_MODE_ZIP) {
 		deflateReset (priv->stream);
 	} else {
@@ -591,14 +766,61 @@ filter_reset (GMimeFilter *filter)
  **/
 GMimeFilter *
 g_mime_filter_gzip_new (GMimeFilterGZipMode mode, int level)
+{
+	return g_mime_filter_gzip_new_with_format (mode, GMIME_FILTER_GZIP_FORMAT_GZIP, level);
+}
+
+
+/**
+ * g_mime_filter_gzip_new_with_format:
+ * @mode: zip or unzip
+ * @format: the compression format
+ * @level: compression level
+ *
+ * Creates a new filter for compressing (or decompressing) a stream in
+ * the given @format.
+ *
+ * For #GMIME_FILTER_GZIP_FORMAT_GZIP, @level is a zlib compression level
+ * (0-9). For #GMIME_FILTER_GZIP_FORMAT_ZSTD, @level is a zstd
+ * compression level where 0 selects zstd's default level.
+ *
+ * Returns: a new compression (or decompression) filter or %NULL if
+ * @format is not supported (see g_mime_filter_gzip_format_is_supported()).
+ **/
+GMimeFilter *
+g_mime_filter_gzip_new_with_format (GMimeFilterGZipMode mode, GMimeFilterGZipFormat format, int level)
 {
 	GMimeFilterGZip *gzip;
 	int retval;
 	
+	if (!g_mime_filter_gzip_format_is_supported (format))
+		return NULL;
+	
 	gzip = g_object_new (GMIME_TYPE_FILTER_GZIP, NULL);
+	gzip->priv->format = format;
 	gzip->mode = mode;
 	gzip->level = level;
 	
+#ifdef HAVE_ZSTD
+	if (format == GMIME_FILTER_GZIP_FORMAT_ZSTD) {
+		if (mode == GMIME_FILTER_GZIP_MODE_ZIP) {
+			if ((gzip->priv->cctx = ZSTD_createCCtx ())) {
+				ZSTD_CCtx_setParameter (gzip->priv->cctx, ZSTD_c_compressionLevel, level);
+				ZSTD_CCtx_setParameter (gzip->priv->cctx, ZSTD_c_checksumFlag, 1);
+			}
+		} else {
+			gzip->priv->dctx = ZSTD_createDCtx ();
+		}
+		
+		if (!gzip->priv->cctx && !gzip->priv->dctx) {
+			g_object_unref (gzip);
+			return NULL;
+		}
+		
+		return (GMimeFilter *) gzip;
+	}
+#endif
+	
 	if (mode == GMIME_FILTER_GZIP_MODE_ZIP)
 		retval = deflateInit2 (gzip->priv->stream, level, Z_DEFLATED, -MAX_WBITS, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY);
 	else
@@ -613,6 +835,96 @@ g_mime_filter_gzip_new (GMimeFilterGZipMode mode, int level)
 }
 
 
+/**
+ * g_mime_filter_gzip_format_is_supported:
+ * @format: the compression format
+ *
+ * Checks whether or not GMime was built with support for @format.
+ * #GMIME_FILTER_GZIP_FORMAT_GZIP is always supported.
+ *
+ * Returns: %TRUE if @format is supported or %FALSE otherwise.
+ **/
+gboolean
+g_mime_filter_gzip_format_is_supported (GMimeFilterGZipFormat format)
+{
+	switch (format) {
+	case GMIME_FILTER_GZIP_FORMAT_GZIP:
+		return TRUE;
+	case GMIME_FILTER_GZIP_FORMAT_ZSTD:
+#ifdef HAVE_ZSTD
+		return TRUE;
+#else
+		return FALSE;
+#endif
+	default:
+		return FALSE;
+	}
+}
+
+
+/**
+ * g_mime_filter_gzip_get_format:
+ * @gzip: A #GMimeFilterGZip filter
+ *
+ * Gets the compression format used by @gzip.
+ *
+ * Returns: the compression format.
+ **/
+GMimeFilterGZipFormat
+g_mime_filter_gzip_get_format (GMimeFilterGZip *gzip)
+{
+	g_return_val_if_fail (GMIME_IS_FILTER_GZIP (gzip), GMIME_FILTER_GZIP_FORMAT_GZIP);
+	
+	return gzip->priv->format;
+}
+
+
+/**
+ * g_mime_filter_gzip_get_threads:
+ * @gzip: A #GMimeFilterGZip filter
+ *
+ * Gets the number of worker threads used for compression.
+ *
+ * Returns: the number of worker threads or 0 if compression is done
+ * in the calling thread.
+ **/
+guint
+g_mime_filter_gzip_get_threads (GMimeFilterGZip *gzip)
+{
+	g_return_val_if_fail (GMIME_IS_FILTER_GZIP (gzip), 0);
+	
+	return gzip->priv->threads;
+}
+
+
+/**
+ * g_mime_filter_gzip_set_threads:
+ * @gzip: A #GMimeFilterGZip filter
+ * @threads: the number of worker threads or 0 to compress in the calling thread
+ *
+ * Sets the number of worker threads used for compressing a
+ * #GMIME_FILTER_GZIP_FORMAT_ZSTD stream. The output is identical to
+ * that of a single-threaded filter at the same level, but is written in
+ * larger bursts. It has no effect on gzip streams, on decompression or
+ * if the zstd library was built without multithreading support.
+ *
+ * This takes effect the next time @gzip starts a stream, so it should
+ * be called before any data is filtered (or right after a reset).
+ **/
+void
+g_mime_filter_gzip_set_threads (GMimeFilterGZip *gzip, guint threads)
+{
+	g_return_if_fail (GMIME_IS_FILTER_GZIP (gzip));
+	
+	gzip->priv->threads = threads;
+	
+#ifdef HAVE_ZSTD
+	if (gzip->priv->cctx)
+		ZSTD_CCtx_setParameter (gzip->priv->cctx, ZSTD_c_nbWorkers, (int) threads);
+#endif
+}
+
+
 /**
  * g_mime_filter_gzip_get_filename:
  * @gzip: A #GMimeFilterGZip filter
@@ -50,6 +50,19 @@ typedef enum {
 } GMimeFilterGZipMode;
 
 
+/**
+ * GMimeFilterGZipFormat:
+ * @GMIME_FILTER_GZIP_FORMAT_GZIP: The gzip format (rfc1952).
+ * @GMIME_FILTER_GZIP_FORMAT_ZSTD: The Zstandard format (rfc8878).
+ *
+ * The compression format for the #GMimeFilterGZip filter.
+ **/
+typedef enum {
+	GMIME_FILTER_GZIP_FORMAT_GZIP,
+	GMIME_FILTER_GZIP_FORMAT_ZSTD
+} GMimeFilterGZipFormat;
+
+
 /**
  * GMimeFilterGZip:
  * @parent_object: parent #GMimeFilter
@@ -57,7 +70,7 @@ typedef enum {
  * @mode: #GMimeFilterGZipMode
  * @level: compression level
  *
- * A filter for compresing or decompressing a gzip stream.
+ * A filter for compresing or decompressing a gzip (or zstd) stream.
  **/
 struct _GMimeFilterGZip {
 	GMimeFilter parent_object;
@@ -77,6 +90,13 @@ struct _GMimeFilterGZipClass {
 GType g_mime_filter_gzip_get_type (void);
 
 GMimeFilter *g_mime_filter_gzip_new (GMimeFilterGZipMode mode, int level);
+GMimeFilter *g_mime_filter_gzip_new_with_format (GMimeFilterGZipMode mode, GMimeFilterGZipFormat format, int level);
+
+gboolean g_mime_filter_gzip_format_is_supported (GMimeFilterGZipFormat format);
+GMimeFilterGZipFormat g_mime_filter_gzip_get_format (GMimeFilterGZip *gzip);
+
+guint g_mime_filter_gzip_get_threads (GMimeFilterGZip *gzip);
+void g_mime_filter_gzip_set_threads (GMimeFilterGZip *gzip, guint threads);
 
 const char *g_mime_filter_gzip_get_filename (GMimeFilterGZip *gzip);
 void g_mime_filter_gzip_set_filename (GMimeFilterGZip *gzip, const char *filename);
@@ -23,6 +23,8 @@
 #include <config.h>
 #endif
 
+#include <string.h>
+
 #include "gmime-filter-smtp-data.h"
 
 
@@ -105,37 +107,61 @@ filter_filter (GMimeFilter *filter, char *inbuf, size_t inlen, size_t prespace,
 	GMimeFilterSmtpData *smtp = (GMimeFilterSmtpData *) filter;
 	register const char *inptr = inbuf;
 	const char *inend = inbuf + inlen;
-	gboolean escape = smtp->bol;
-	int ndots = 0;
+	const char *start, *lf;
+	size_t ndots = 0;
 	char *outptr;
+	size_t n;
+	
+	/* count the lines that begin with a '.' */
+	if (smtp->bol && inptr < inend && *inptr == '.')
+		ndots++;
 	
-	while (inptr < inend) {
-		if (*inptr == '.' && escape) {
-			escape = FALSE;
+	while ((lf = memchr (inptr, '\n', inend - inptr))) {
+		inptr = lf + 1;
+		
+		if (inptr < inend && *inptr == '.')
 			ndots++;
-		} else {
-			escape = *inptr == '\n';
-		}
+	}
+	
+	if (ndots == 0) {
+		/* nothing to escape, so pass the input through as-is */
+		if (inlen > 0)
+			smtp->bol = inend[-1] == '\n';
 		
-		inptr++;
+		*outprespace = prespace;
+		*outbuf = inbuf;
+		*outlen = inlen;
+		return;
 	}
 	
 	g_mime_filter_set_size (filter, inlen + ndots, FALSE);
 	
+	/* copy the lines in bulk, doubling each leading '.' */
 	outptr = filter->outbuf;
-	inptr = inbuf;
+	start = inptr = inbuf;
 	
-	while (inptr < inend) {
-		if (*inptr == '.' && smtp->bol) {
-			smtp->bol = FALSE;
+	if (smtp->bol && *inptr == '.')
+		*outptr++ = '.';
+	
+	while ((lf = memchr (inptr, '\n', inend - inptr))) {
+		inptr = lf + 1;
+		
+		if (inptr < inend && *inptr == '.') {
+			n = inptr - start;
+			memcpy (outptr, start, n);
+			outptr += n;
+			start = inptr;
+			
 			*outptr++ = '.';
-		} else {
-			smtp->bol = *inptr == '\n';
 		}
-		
-		*outptr++ = *inptr++;
 	}
 	
+	n = inend - start;
+	memcpy (outptr, start, n);
+	outptr += n;
+	
+	smtp->bol = inend[-1] == '\n';
+	
 	*outlen = outptr - filter->outbuf;
 	*outprespace = filter->outpre;
 	*outbuf = filter->outbuf;
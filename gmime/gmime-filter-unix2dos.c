@@ -23,6 +23,8 @@
 #include <config.h>
 #endif
 
+#include <string.h>
+
 #include "gmime-filter-unix2dos.h"
 
 
@@ -103,6 +105,24 @@ filter_copy (GMimeFilter *filter)
 	return g_mime_filter_unix2dos_new (unix2dos->ensure_newline);
 }
 
+/* counts the LFs in @inbuf that are not already preceded by a CR */
+static size_t
+count_bare_lf (GMimeFilterUnix2Dos *unix2dos, const char *inbuf, size_t inlen)
+{
+	const char *inend = inbuf + inlen;
+	const char *inptr = inbuf;
+	size_t count = 0;
+	
+	while ((inptr = memchr (inptr, '\n', inend - inptr))) {
+		if ((inptr > inbuf ? inptr[-1] : unix2dos->pc) != '\r')
+			count++;
+		
+		inptr++;
+	}
+	
+	return count;
+}
+
 static void
 convert (GMimeFilter *filter, char *inbuf, size_t inlen, size_t prespace,
 	 char **outbuf, size_t *outlen, size_t *outprespace, gboolean flush)
@@ -110,29 +130,57 @@ convert (GMimeFilter *filter, char *inbuf, size_t inlen, size_t prespace,
 	GMimeFilterUnix2Dos *unix2dos = (GMimeFilterUnix2Dos *) filter;
 	register const char *inptr = inbuf;
 	const char *inend = inbuf + inlen;
-	size_t expected = inlen * 2;
+	size_t expected, nbare;
+	const char *lf;
 	char *outptr;
+	size_t n;
+	char c;
+	
+	if ((nbare = count_bare_lf (unix2dos, inbuf, inlen)) == 0) {
+		c = inlen > 0 ? inbuf[inlen - 1] : unix2dos->pc;
+		
+		if (!(flush && unix2dos->ensure_newline) || c == '\n') {
+			/* already CRLF, so pass the input through as-is */
+			unix2dos->pc = c;
+			
+			*outlen = inlen;
+			*outprespace = prespace;
+			*outbuf = inbuf;
+			return;
+		}
+	}
+	
+	/* each bare LF grows by one byte */
+	expected = inlen + nbare;
 	
 	if (flush && unix2dos->ensure_newline)
 		expected += 2;
 	
 	g_mime_filter_set_size (filter, expected, FALSE);
 	
+	/* copy the lines in bulk, inserting a CR before each bare LF */
 	outptr = filter->outbuf;
 	while (inptr < inend) {
-		if (*inptr == '\r') {
-			*outptr++ = *inptr;
-		} else if (*inptr == '\n') {
-			if (unix2dos->pc != '\r')
-				*outptr++ = '\r';
-			*outptr++ = *inptr;
-		} else {
-			*outptr++ = *inptr;
-		}
+		if (!(lf = memchr (inptr, '\n', inend - inptr)))
+			lf = inend;
+		
+		n = lf - inptr;
+		memcpy (outptr, inptr, n);
+		outptr += n;
 		
-		unix2dos->pc = *inptr++;
+		if (lf == inend)
+			break;
+		
+		if ((lf > inbuf ? lf[-1] : unix2dos->pc) != '\r')
+			*outptr++ = '\r';
+		*outptr++ = '\n';
+		
+		inptr = lf + 1;
 	}
 	
+	if (inlen > 0)
+		unix2dos->pc = inend[-1];
+	
 	if (flush && unix2dos->ensure_newline && unix2dos->pc != '\n') {
 		if (unix2dos->pc != '\r')
 			*outptr++ = '\r';
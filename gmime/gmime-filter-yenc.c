@@ -26,6 +26,22 @@
 #include <string.h>
 
 #include "gmime-filter-yenc.h"
+#include "gmime-internal.h"
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define HAVE_CRC32_PCLMUL 1
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#elif defined (__ARM_FEATURE_CRC32)
+#define HAVE_CRC32_ARM 1
+#include <arm_acle.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 
 /**
@@ -128,13 +144,13 @@ filter_filter (GMimeFilter *filter, char *in, size_t len, size_t prespace,
 	size_t newlen = 0;
 	
 	if (yenc->encode) {
-		/* won't go to more than 2 * (x + 2) + 62 */
-		g_mime_filter_set_size (filter, (len + 2) * 2 + 62, FALSE);
+		/* won't go to more than 2 * (x + 2) + x / 64 + 62 */
+		g_mime_filter_set_size (filter, (len + 2) * 2 + len / 64 + 62, FALSE);
 		outbuf = (unsigned char *) filter->outbuf;
 		inbuf = (const unsigned char *) in;
 		newlen = g_mime_yencode_step (inbuf, len, outbuf, &yenc->state,
 					      &yenc->pcrc, &yenc->crc);
-		g_assert (newlen <= (len + 2) * 2 + 62);
+		g_assert (newlen <= (len + 2) * 2 + len / 64 + 62);
 	} else {
 		if (!(yenc->state & GMIME_YDECODE_STATE_DECODE)) {
 			register char *inptr, *inend;
@@ -227,13 +243,13 @@ filter_complete (GMimeFilter *filter, char *in, size_t len, size_t prespace,
 	size_t newlen = 0;
 	
 	if (yenc->encode) {
-		/* won't go to more than 2 * (x + 2) + 62 */
-		g_mime_filter_set_size (filter, (len + 2) * 2 + 62, FALSE);
+		/* won't go to more than 2 * (x + 2) + x / 64 + 62 */
+		g_mime_filter_set_size (filter, (len + 2) * 2 + len / 64 + 62, FALSE);
 		outbuf = (unsigned char *) filter->outbuf;
 		inbuf = (const unsigned char *) in;
 		newlen = g_mime_yencode_close (inbuf, len, outbuf, &yenc->state,
 					       &yenc->pcrc, &yenc->crc);
-		g_assert (newlen <= (len + 2) * 2 + 62);
+		g_assert (newlen <= (len + 2) * 2 + len / 64 + 62);
 	} else {
 		if ((yenc->state & GMIME_YDECODE_STATE_DECODE) && !(yenc->state & GMIME_YDECODE_STATE_END)) {
 			/* all yEnc headers have been found so we can now start decoding */
@@ -383,7 +399,7 @@ g_mime_filter_yenc_get_crc (GMimeFilterYenc *yenc)
 }
 
 
-static const int yenc_crc_table[256] = {
+static const guint32 yenc_crc_table[256] = {
 	0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f, 0xe963a535, 0x9e6495a3,
 	0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988, 0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91,
 	0x1db71064, 0x6ab020f2, 0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
@@ -418,7 +434,250 @@ static const int yenc_crc_table[256] = {
 	0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94, 0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
-#define yenc_crc_add(crc, c) (yenc_crc_table[(((int) (crc)) ^ ((unsigned char) (c))) & 0xff] ^ ((((int) (crc)) >> 8) & 0x00ffffff))
+#define yenc_crc_add(crc, c) (yenc_crc_table[((crc) ^ ((unsigned char) (c))) & 0xff] ^ ((crc) >> 8))
+
+typedef guint32 (* Crc32Func) (guint32 crc, const unsigned char *inbuf, size_t inlen);
+
+/* yenc_crc_table extended for slicing-by-8 (crc_slice_table[0] is yenc_crc_table) */
+static guint32 crc_slice_table[8][256];
+static Crc32Func crc32_update = NULL;
+
+static guint32
+crc32_slice8 (guint32 crc, const unsigned char *inbuf, size_t inlen)
+{
+	const unsigned char *inend = inbuf + inlen;
+	register const unsigned char *inptr = inbuf;
+	guint32 lo, hi;
+	
+	while (inend - inptr >= 8) {
+		memcpy (&lo, inptr, 4);
+		memcpy (&hi, inptr + 4, 4);
+		lo = GUINT32_FROM_LE (lo) ^ crc;
+		hi = GUINT32_FROM_LE (hi);
+		
+		crc = crc_slice_table[7][lo & 0xff] ^ crc_slice_table[6][(lo >> 8) & 0xff] ^
+			crc_slice_table[5][(lo >> 16) & 0xff] ^ crc_slice_table[4][lo >> 24] ^
+			crc_slice_table[3][hi & 0xff] ^ crc_slice_table[2][(hi >> 8) & 0xff] ^
+			crc_slice_table[1][(hi >> 16) & 0xff] ^ crc_slice_table[0][hi >> 24];
+		
+		inptr += 8;
+	}
+	
+	while (inptr < inend)
+		crc = yenc_crc_add (crc, *inptr++);
+	
+	return crc;
+}
+
+#ifdef HAVE_CRC32_PCLMUL
+/* folds 64 bytes at a time using carry-less multiplication, see Intel's
+ * "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ" */
+__attribute__ ((target ("pclmul,sse4.1")))
+static guint32
+crc32_pclmul (guint32 crc, const unsigned char *inbuf, size_t inlen)
+{
+	static const guint64 k1k2[2] __attribute__ ((aligned (16))) = { 0x0154442bd4, 0x01c6e41596 };
+	static const guint64 k3k4[2] __attribute__ ((aligned (16))) = { 0x01751997d0, 0x00ccaa009e };
+	static const guint64 k5k0[2] __attribute__ ((aligned (16))) = { 0x0163cd6124, 0x0000000000 };
+	static const guint64 poly[2] __attribute__ ((aligned (16))) = { 0x01db710641, 0x01f7011641 };
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+	register const unsigned char *inptr = inbuf;
+	size_t len;
+	
+	if (inlen < 64)
+		return crc32_slice8 (crc, inbuf, inlen);
+	
+	len = inlen & ~((size_t) 15);
+	
+	x1 = _mm_loadu_si128 ((const __m128i *) (inptr + 0x00));
+	x2 = _mm_loadu_si128 ((const __m128i *) (inptr + 0x10));
+	x3 = _mm_loadu_si128 ((const __m128i *) (inptr + 0x20));
+	x4 = _mm_loadu_si128 ((const __m128i *) (inptr + 0x30));
+	x1 = _mm_xor_si128 (x1, _mm_cvtsi32_si128 ((int) crc));
+	x0 = _mm_load_si128 ((const __m128i *) k1k2);
+	inptr += 64;
+	len -= 64;
+	
+	while (len >= 64) {
+		x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128 (x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128 (x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128 (x4, x0, 0x00);
+		x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128 (x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128 (x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128 (x4, x0, 0x11);
+		y5 = _mm_loadu_si128 ((const __m128i *) (inptr + 0x00));
+		y6 = _mm_loadu_si128 ((const __m128i *) (inptr + 0x10));
+		y7 = _mm_loadu_si128 ((const __m128i *) (inptr + 0x20));
+		y8 = _mm_loadu_si128 ((const __m128i *) (inptr + 0x30));
+		x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x5), y5);
+		x2 = _mm_xor_si128 (_mm_xor_si128 (x2, x6), y6);
+		x3 = _mm_xor_si128 (_mm_xor_si128 (x3, x7), y7);
+		x4 = _mm_xor_si128 (_mm_xor_si128 (x4, x8), y8);
+		inptr += 64;
+		len -= 64;
+	}
+	
+	/* fold the 4 lanes into one */
+	x0 = _mm_load_si128 ((const __m128i *) k3k4);
+	x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+	x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x2), x5);
+	x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+	x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x3), x5);
+	x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+	x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x4), x5);
+	
+	while (len >= 16) {
+		x2 = _mm_loadu_si128 ((const __m128i *) inptr);
+		x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+		x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x2), x5);
+		inptr += 16;
+		len -= 16;
+	}
+	
+	/* fold 128 bits down to 64 */
+	x2 = _mm_clmulepi64_si128 (x1, x0, 0x10);
+	x3 = _mm_setr_epi32 (~0, 0, ~0, 0);
+	x1 = _mm_srli_si128 (x1, 8);
+	x1 = _mm_xor_si128 (x1, x2);
+	x0 = _mm_loadl_epi64 ((const __m128i *) k5k0);
+	x2 = _mm_srli_si128 (x1, 4);
+	x1 = _mm_and_si128 (x1, x3);
+	x1 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+	x1 = _mm_xor_si128 (x1, x2);
+	
+	/* Barrett reduction down to 32 bits */
+	x0 = _mm_load_si128 ((const __m128i *) poly);
+	x2 = _mm_and_si128 (x1, x3);
+	x2 = _mm_clmulepi64_si128 (x2, x0, 0x10);
+	x2 = _mm_and_si128 (x2, x3);
+	x2 = _mm_clmulepi64_si128 (x2, x0, 0x00);
+	x1 = _mm_xor_si128 (x1, x2);
+	
+	crc = (guint32) _mm_extract_epi32 (x1, 1);
+	
+	return crc32_slice8 (crc, inptr, (inbuf + inlen) - inptr);
+}
+#endif /* HAVE_CRC32_PCLMUL */
+
+#ifdef HAVE_CRC32_ARM
+static guint32
+crc32_arm (guint32 crc, const unsigned char *inbuf, size_t inlen)
+{
+	const unsigned char *inend = inbuf + inlen;
+	register const unsigned char *inptr = inbuf;
+	guint64 v;
+	
+	while (inend - inptr >= 8) {
+		memcpy (&v, inptr, 8);
+		crc = __crc32d (crc, GUINT64_FROM_LE (v));
+		inptr += 8;
+	}
+	
+	while (inptr < inend)
+		crc = __crc32b (crc, *inptr++);
+	
+	return crc;
+}
+#endif /* HAVE_CRC32_ARM */
+
+static void
+crc32_init (void)
+{
+	static gsize initialized = 0;
+	Crc32Func func = crc32_slice8;
+	guint32 crc;
+	int i, j;
+	
+	if (!g_once_init_enter (&initialized))
+		return;
+	
+	for (i = 0; i < 256; i++) {
+		crc_slice_table[0][i] = crc = yenc_crc_table[i];
+		
+		for (j = 1; j < 8; j++)
+			crc_slice_table[j][i] = crc = yenc_crc_table[crc & 0xff] ^ (crc >> 8);
+	}
+	
+#if defined (HAVE_CRC32_PCLMUL)
+	{
+		unsigned int eax, ebx, ecx, edx;
+		
+		if (__get_cpuid (1, &eax, &ebx, &ecx, &edx) && (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1))
+			func = crc32_pclmul;
+	}
+#elif defined (HAVE_CRC32_ARM)
+	func = crc32_arm;
+#endif
+	
+	crc32_update = func;
+	
+	g_once_init_leave (&initialized, 1);
+}
+
+/**
+ * _g_mime_crc32_update:
+ * @crc: crc state
+ * @inbuf: input buffer
+ * @inlen: input buffer length
+ *
+ * Updates the (un-finalized) crc32 state @crc with @inlen bytes of
+ * @inbuf, using the CPU's crc32 support where available.
+ *
+ * Returns: the new crc32 state.
+ **/
+guint32
+_g_mime_crc32_update (guint32 crc, const unsigned char *inbuf, size_t inlen)
+{
+	crc32_init ();
+	
+	return crc32_update (crc, inbuf, inlen);
+}
+
+#ifdef __SSE2__
+/* a mask of the bytes in the 16 at @inptr that are one of the 2 given chars */
+static inline int
+ydecode_special_mask (const unsigned char *inptr, __m128i *out)
+{
+	__m128i v = _mm_loadu_si128 ((const __m128i *) inptr);
+	__m128i m;
+	
+	m = _mm_or_si128 (_mm_cmpeq_epi8 (v, _mm_set1_epi8 ('\n')), _mm_cmpeq_epi8 (v, _mm_set1_epi8 ('=')));
+	*out = _mm_sub_epi8 (v, _mm_set1_epi8 (42));
+	
+	return _mm_movemask_epi8 (m);
+}
+
+/* a mask of the bytes in the 16 at @inptr that need escaping once encoded */
+static inline int
+yencode_escape_mask (const unsigned char *inptr, __m128i *out)
+{
+	__m128i v = _mm_add_epi8 (_mm_loadu_si128 ((const __m128i *) inptr), _mm_set1_epi8 (42));
+	__m128i m;
+	
+	m = _mm_or_si128 (_mm_cmpeq_epi8 (v, _mm_setzero_si128 ()), _mm_cmpeq_epi8 (v, _mm_set1_epi8 ('\t')));
+	m = _mm_or_si128 (m, _mm_or_si128 (_mm_cmpeq_epi8 (v, _mm_set1_epi8 ('\r')), _mm_cmpeq_epi8 (v, _mm_set1_epi8 ('\n'))));
+	m = _mm_or_si128 (m, _mm_cmpeq_epi8 (v, _mm_set1_epi8 ('=')));
+	*out = v;
+	
+	return _mm_movemask_epi8 (m);
+}
+
+/* writes the first @n of the 16 bytes in @v to @outptr */
+static inline void
+store_prefix (unsigned char *outptr, __m128i v, size_t n)
+{
+	unsigned char buf[16];
+	
+	_mm_storeu_si128 ((__m128i *) buf, v);
+	memcpy (outptr, buf, n);
+}
+#endif /* __SSE2__ */
 
 #define YENC_NEWLINE_ESCAPE (GMIME_YDECODE_STATE_EOLN | GMIME_YDECODE_STATE_ESCAPE)
 
@@ -453,6 +712,11 @@ g_mime_ydecode_step (const unsigned char *inbuf, size_t inlen, unsigned char *ou
 	const unsigned char *inend;
 	unsigned char c;
 	int ystate;
+#ifdef __SSE2__
+	__m128i v;
+	int mask;
+	int n;
+#endif
 	
 	if (*state & GMIME_YDECODE_STATE_END)
 		return 0;
@@ -464,6 +728,23 @@ g_mime_ydecode_step (const unsigned char *inbuf, size_t inlen, unsigned char *ou
 	
 	inptr = inbuf;
 	while (inptr < inend) {
+#ifdef __SSE2__
+		/* decode the plain runs between newlines and escapes 16 bytes at a time */
+		if (inend - inptr >= 16 && !(ystate & YENC_NEWLINE_ESCAPE)) {
+			if ((mask = ydecode_special_mask (inptr, &v)) == 0) {
+				_mm_storeu_si128 ((__m128i *) outptr, v);
+				outptr += 16;
+				inptr += 16;
+				continue;
+			}
+			
+			if ((n = g_bit_nth_lsf ((gulong) mask, -1)) > 0) {
+				store_prefix (outptr, v, n);
+				outptr += n;
+				inptr += n;
+			}
+		}
+#endif
 		c = *inptr++;
 		
 		if ((ystate & YENC_NEWLINE_ESCAPE) == YENC_NEWLINE_ESCAPE) {
@@ -491,12 +772,12 @@ g_mime_ydecode_step (const unsigned char *inbuf, size_t inlen, unsigned char *ou
 		
 		ystate &= ~GMIME_YDECODE_STATE_EOLN;
 		
-		*outptr++ = c -= 42;
-		
-		*pcrc = yenc_crc_add (*pcrc, c);
-		*crc = yenc_crc_add (*crc, c);
+		*outptr++ = c - 42;
 	}
 	
+	*pcrc = _g_mime_crc32_update (*pcrc, outbuf, outptr - outbuf);
+	*crc = _g_mime_crc32_update (*crc, outbuf, outptr - outbuf);
+	
 	*state = ystate;
 	
 	return outptr - outbuf;
@@ -533,6 +814,14 @@ g_mime_yencode_step (const unsigned char *inbuf, size_t inlen, unsigned char *ou
 	const unsigned char *inend;
 	register int already;
 	unsigned char c;
+#ifdef __SSE2__
+	__m128i v;
+	int mask;
+	int n;
+#endif
+	
+	*pcrc = _g_mime_crc32_update (*pcrc, inbuf, inlen);
+	*crc = _g_mime_crc32_update (*crc, inbuf, inlen);
 	
 	inend = inbuf + inlen;
 	outptr = outbuf;
@@ -541,12 +830,32 @@ g_mime_yencode_step (const unsigned char *inbuf, size_t inlen, unsigned char *ou
 	
 	inptr = inbuf;
 	while (inptr < inend) {
-		c = *inptr++;
-		
-		*pcrc = yenc_crc_add (*pcrc, c);
-		*crc = yenc_crc_add (*crc, c);
-		
-		c += 42;
+#ifdef __SSE2__
+		/* encode 16 bytes at a time as long as none of them need
+		 * escaping and they all fit on the current line */
+		if (inend - inptr >= 16 && already <= 128 - 16) {
+			if ((mask = yencode_escape_mask (inptr, &v)) == 0) {
+				_mm_storeu_si128 ((__m128i *) outptr, v);
+				outptr += 16;
+				inptr += 16;
+				
+				if ((already += 16) >= 128) {
+					*outptr++ = '\n';
+					already = 0;
+				}
+				
+				continue;
+			}
+			
+			if ((n = g_bit_nth_lsf ((gulong) mask, -1)) > 0) {
+				store_prefix (outptr, v, n);
+				already += n;
+				outptr += n;
+				inptr += n;
+			}
+		}
+#endif
+		c = *inptr++ + 42;
 		
 		if (c == '\0' || c == '\t' || c == '\r' || c == '\n' || c == '=') {
 			*outptr++ = '=';
@@ -26,6 +26,7 @@
 #include <string.h> /* for memcpy */
 
 #include "gmime-filter.h"
+#include "gmime-internal.h"
 
 
 /**
@@ -36,18 +37,45 @@
  *
  * Stream filters are an efficient way of converting data from one
  * format to another.
+ *
+ * A filter normally writes its output into its own output buffer (see
+ * g_mime_filter_set_size()), but it does not have to: when it can pass
+ * a chunk of input through unchanged, it may simply return a pointer to
+ * the input buffer (and its prespace) as its output. Filters whose
+ * output never gets ahead of their input may also write their output
+ * over the input buffer itself when g_mime_filter_get_in_place()
+ * returns %TRUE, as long as it stays between the start of the prespace
+ * and the end of the input. Either way, chaining such filters avoids
+ * copying the data from one buffer to the next.
  **/
 
 
 struct _GMimeFilterPrivate {
 	char *inbuf;
 	size_t inlen;
+	gboolean in_place;
 };
 
 #define PRE_HEAD (64)
 #define BACK_HEAD (64)
 #define _PRIVATE(o) (((GMimeFilter *)(o))->priv)
 
+/* the buffer pool keeps a few free buffers of each power-of-two size
+ * from 4 KiB to 1 MiB around for each thread */
+#define POOL_MIN_SHIFT (12)
+#define POOL_MAX_SHIFT (20)
+#define POOL_CLASSES (POOL_MAX_SHIFT - POOL_MIN_SHIFT + 1)
+#define POOL_DEPTH (4)
+
+typedef struct {
+	char *buffers[POOL_CLASSES][POOL_DEPTH];
+	guint count[POOL_CLASSES];
+} BufferPool;
+
+static void buffer_pool_free (gpointer data);
+
+static GPrivate buffer_pool = G_PRIVATE_INIT (buffer_pool_free);
+
 static void g_mime_filter_class_init (GMimeFilterClass *klass);
 static void g_mime_filter_init (GMimeFilter *filter, GMimeFilterClass *klass);
 static void g_mime_filter_finalize (GObject *object);
@@ -63,6 +91,107 @@ static void filter_reset (GMimeFilter *filter);
 static GObjectClass *parent_class = NULL;
 
 
+static void
+buffer_pool_free (gpointer data)
+{
+	BufferPool *pool = data;
+	guint i, j;
+	
+	for (i = 0; i < POOL_CLASSES; i++) {
+		for (j = 0; j < pool->count[i]; j++)
+			g_free (pool->buffers[i][j]);
+	}
+	
+	g_free (pool);
+}
+
+static int
+buffer_pool_class (size_t size)
+{
+	int shift = POOL_MIN_SHIFT;
+	
+	while (shift <= POOL_MAX_SHIFT && ((size_t) 1 << shift) < size)
+		shift++;
+	
+	return shift <= POOL_MAX_SHIFT ? shift - POOL_MIN_SHIFT : -1;
+}
+
+/**
+ * _g_mime_buffer_pool_alloc:
+ * @size: the minimum number of bytes needed
+ * @allocated: the number of bytes actually allocated
+ *
+ * Borrows a buffer of at least @size bytes from the calling thread's
+ * buffer pool (or allocates one if the pool has none of that size).
+ *
+ * Returns: a buffer that must be returned using _g_mime_buffer_pool_free().
+ **/
+char *
+_g_mime_buffer_pool_alloc (size_t size, size_t *allocated)
+{
+	BufferPool *pool;
+	int i;
+	
+	if ((i = buffer_pool_class (size)) == -1) {
+		*allocated = size;
+		return g_malloc (size);
+	}
+	
+	*allocated = (size_t) 1 << (i + POOL_MIN_SHIFT);
+	
+	if ((pool = g_private_get (&buffer_pool)) && pool->count[i] > 0)
+		return pool->buffers[i][--pool->count[i]];
+	
+	return g_malloc (*allocated);
+}
+
+/**
+ * _g_mime_buffer_pool_free:
+ * @buffer: a buffer from _g_mime_buffer_pool_alloc() or %NULL
+ * @allocated: the allocated size of @buffer
+ *
+ * Returns @buffer to the calling thread's buffer pool, or frees it if
+ * the pool already holds enough buffers of that size.
+ **/
+void
+_g_mime_buffer_pool_free (char *buffer, size_t allocated)
+{
+	BufferPool *pool;
+	int i;
+	
+	if (buffer == NULL)
+		return;
+	
+	i = buffer_pool_class (allocated);
+	
+	if (i == -1 || ((size_t) 1 << (i + POOL_MIN_SHIFT)) != allocated) {
+		g_free (buffer);
+		return;
+	}
+	
+	if (!(pool = g_private_get (&buffer_pool))) {
+		pool = g_new0 (BufferPool, 1);
+		g_private_set (&buffer_pool, pool);
+	}
+	
+	if (pool->count[i] < POOL_DEPTH)
+		pool->buffers[i][pool->count[i]++] = buffer;
+	else
+		g_free (buffer);
+}
+
+/**
+ * _g_mime_buffer_pool_clear:
+ *
+ * Frees the buffers held by the calling thread's buffer pool.
+ **/
+void
+_g_mime_buffer_pool_clear (void)
+{
+	g_private_replace (&buffer_pool, NULL);
+}
+
+
 GType
 g_mime_filter_get_type (void)
 {
@@ -125,7 +254,7 @@ g_mime_filter_finalize (GObject *object)
 	
 	g_free (filter->priv->inbuf);
 	g_free (filter->priv);
-	g_free (filter->outreal);
+	_g_mime_buffer_pool_free (filter->outreal, filter->outsize + PRE_HEAD * 4);
 	g_free (filter->backbuf);
 	
 	G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -158,15 +287,16 @@ g_mime_filter_copy (GMimeFilter *filter)
 
 static void
 filter_run (GMimeFilter *filter, char *inbuf, size_t inlen, size_t prespace,
-	    char **outbuf, size_t *outlen, size_t *outprespace,
+	    char **outbuf, size_t *outlen, size_t *outprespace, gboolean in_place,
 	    void (*filterfunc) (GMimeFilter *filter,
 				char *inbuf, size_t inlen, size_t prespace,
 				char **outbuf, size_t *outlen, size_t *outprespace))
 {
+	struct _GMimeFilterPrivate *p = _PRIVATE (filter);
+	
 	/* here we take a performance hit, if the input buffer doesn't
 	   have the pre-space required.  We make a buffer that does... */
 	if (prespace < filter->backlen) {
-		struct _GMimeFilterPrivate *p = _PRIVATE (filter);
 		size_t newlen = inlen + prespace + filter->backlen;
 		
 		if (p->inlen < newlen) {
@@ -180,6 +310,9 @@ filter_run (GMimeFilter *filter, char *inbuf, size_t inlen, size_t prespace,
 		memcpy (p->inbuf + p->inlen - inlen, inbuf, inlen);
 		inbuf = p->inbuf + p->inlen - inlen;
 		prespace = p->inlen - inlen;
+		
+		/* the copy is ours to overwrite */
+		in_place = TRUE;
 	}
 	
 	/* preload any backed up data */
@@ -191,7 +324,9 @@ filter_run (GMimeFilter *filter, char *inbuf, size_t inlen, size_t prespace,
 		filter->backlen = 0;
 	}
 	
+	p->in_place = in_place;
 	filterfunc (filter, inbuf, inlen, prespace, outbuf, outlen, outprespace);
+	p->in_place = FALSE;
 }
 
 
@@ -222,7 +357,36 @@ g_mime_filter_filter (GMimeFilter *filter, char *inbuf, size_t inlen, size_t pre
 {
 	g_return_if_fail (GMIME_IS_FILTER (filter));
 	
-	filter_run (filter, inbuf, inlen, prespace, outbuf, outlen, outprespace,
+	filter_run (filter, inbuf, inlen, prespace, outbuf, outlen, outprespace, FALSE,
+		    GMIME_FILTER_GET_CLASS (filter)->filter);
+}
+
+
+/**
+ * g_mime_filter_filter_in_place:
+ * @filter: filter
+ * @inbuf: (array length=inlen) (element-type guint8): input buffer
+ * @inlen: input buffer length
+ * @prespace: prespace buffer length
+ * @outbuf: (out) (array length=outlen) (element-type guint8) (transfer none):
+ *   pointer to output buffer
+ * @outlen: (out): pointer to output length
+ * @outprespace: (out): pointer to output prespace buffer length
+ *
+ * Filters the input data like g_mime_filter_filter(), but allows
+ * @filter to write its output over @inbuf (and its prespace) rather
+ * than copying it into a buffer of its own.
+ *
+ * Only use this when the contents of @inbuf are no longer needed once
+ * they have been filtered.
+ **/
+void
+g_mime_filter_filter_in_place (GMimeFilter *filter, char *inbuf, size_t inlen, size_t prespace,
+			       char **outbuf, size_t *outlen, size_t *outprespace)
+{
+	g_return_if_fail (GMIME_IS_FILTER (filter));
+	
+	filter_run (filter, inbuf, inlen, prespace, outbuf, outlen, outprespace, TRUE,
 		    GMIME_FILTER_GET_CLASS (filter)->filter);
 }
 
@@ -255,11 +419,56 @@ g_mime_filter_complete (GMimeFilter *filter,
 {
 	g_return_if_fail (GMIME_IS_FILTER (filter));
 	
-	filter_run (filter, inbuf, inlen, prespace, outbuf, outlen, outprespace,
+	filter_run (filter, inbuf, inlen, prespace, outbuf, outlen, outprespace, FALSE,
+		    GMIME_FILTER_GET_CLASS (filter)->complete);
+}
+
+
+/**
+ * g_mime_filter_complete_in_place:
+ * @filter: filter
+ * @inbuf: (array length=inlen) (element-type guint8): input buffer
+ * @inlen: input buffer length
+ * @prespace: prespace buffer length
+ * @outbuf: (out) (array length=outlen) (element-type guint8) (transfer none):
+ *   pointer to output buffer
+ * @outlen: (out): pointer to output length
+ * @outprespace: (out): pointer to output prespace buffer length
+ *
+ * Completes the filtering like g_mime_filter_complete(), but allows
+ * @filter to write its output over @inbuf (and its prespace).
+ **/
+void
+g_mime_filter_complete_in_place (GMimeFilter *filter, char *inbuf, size_t inlen, size_t prespace,
+				 char **outbuf, size_t *outlen, size_t *outprespace)
+{
+	g_return_if_fail (GMIME_IS_FILTER (filter));
+	
+	filter_run (filter, inbuf, inlen, prespace, outbuf, outlen, outprespace, TRUE,
 		    GMIME_FILTER_GET_CLASS (filter)->complete);
 }
 
 
+/**
+ * g_mime_filter_get_in_place:
+ * @filter: filter
+ *
+ * Gets whether the filter or complete method of @filter that is
+ * currently running is allowed to write its output over its input
+ * buffer. This is meant to be used by #GMimeFilter implementations.
+ *
+ * Returns: %TRUE if the input buffer may be overwritten or %FALSE
+ * otherwise.
+ **/
+gboolean
+g_mime_filter_get_in_place (GMimeFilter *filter)
+{
+	g_return_val_if_fail (GMIME_IS_FILTER (filter), FALSE);
+	
+	return filter->priv->in_place;
+}
+
+
 static void
 filter_reset (GMimeFilter *filter)
 {
@@ -318,6 +527,9 @@ g_mime_filter_backup (GMimeFilter *filter, const char *data, size_t length)
  * @keep: %TRUE if existing data in the output buffer should be kept
  *
  * Ensure this much size is available for filter output (if required)
+ *
+ * The output buffer is borrowed from a per-thread pool of buffers, so
+ * it may be larger than @size; @filter->outsize holds its actual size.
  **/
 void
 g_mime_filter_set_size (GMimeFilter *filter, size_t size, gboolean keep)
@@ -326,17 +538,22 @@ g_mime_filter_set_size (GMimeFilter *filter, size_t size, gboolean keep)
 	
 	if (!filter->outreal || filter->outsize < size) {
 		size_t offset = filter->outptr - filter->outreal;
+		size_t allocated;
+		char *outreal;
+		
+		outreal = _g_mime_buffer_pool_alloc (size + PRE_HEAD * 4, &allocated);
 		
-		if (keep) {
-			filter->outreal = g_realloc (filter->outreal, size + PRE_HEAD * 4);
-		} else {
-			g_free (filter->outreal);
-			filter->outreal = g_malloc (size + PRE_HEAD * 4);
+		if (filter->outreal) {
+			if (keep)
+				memcpy (outreal, filter->outreal, filter->outsize + PRE_HEAD * 4);
+			
+			_g_mime_buffer_pool_free (filter->outreal, filter->outsize + PRE_HEAD * 4);
 		}
 		
+		filter->outreal = outreal;
 		filter->outptr = filter->outreal + offset;
 		filter->outbuf = filter->outreal + PRE_HEAD * 4;
-		filter->outsize = size;
+		filter->outsize = allocated - PRE_HEAD * 4;
 		
 		/* this could be offset from the end of the structure, but 
 		   this should be good enough */
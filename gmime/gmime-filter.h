@@ -93,6 +93,16 @@ void g_mime_filter_complete (GMimeFilter *filter,
 
 void g_mime_filter_reset (GMimeFilter *filter);
 
+void g_mime_filter_filter_in_place (GMimeFilter *filter,
+				    char *inbuf, size_t inlen, size_t prespace,
+				    char **outbuf, size_t *outlen, size_t *outprespace);
+
+void g_mime_filter_complete_in_place (GMimeFilter *filter,
+				      char *inbuf, size_t inlen, size_t prespace,
+				      char **outbuf, size_t *outlen, size_t *outprespace);
+
+gboolean g_mime_filter_get_in_place (GMimeFilter *filter);
+
 
 /* sets/returns number of bytes backed up on the input */
 void g_mime_filter_backup (GMimeFilter *filter, const char *data, size_t length);
@@ -28,6 +28,7 @@
 #include "gmime-format-options.h"
 #include "gmime-filter-dos2unix.h"
 #include "gmime-filter-unix2dos.h"
+#include "gmime-internal.h"
 
 
 /**
@@ -47,10 +48,17 @@ struct _GMimeFormatOptions {
 	gboolean international;
 	GPtrArray *hidden;
 	guint maxline;
+	
+	/* rfc2047 header encoder memo cache */
+	GHashTable *encode_cache;
+	guint encode_cache_size;
+	GMutex encode_lock;
 };
 
 static GMimeFormatOptions *default_options = NULL;
 
+static void encode_cache_free (GMimeFormatOptions *options);
+
 G_DEFINE_BOXED_TYPE (GMimeFormatOptions, g_mime_format_options, g_mime_format_options_clone, g_mime_format_options_free);
 
 void
@@ -72,6 +80,7 @@ g_mime_format_options_shutdown (void)
 		g_free (default_options->hidden->pdata[i]);
 	
 	g_ptr_array_free (default_options->hidden, TRUE);
+	encode_cache_free (default_options);
 	g_slice_free (GMimeFormatOptions, default_options);
 	default_options = NULL;
 }
@@ -111,6 +120,10 @@ g_mime_format_options_new (void)
 	options->international = FALSE;
 	options->maxline = 78;
 	
+	g_mutex_init (&options->encode_lock);
+	options->encode_cache_size = 0;
+	options->encode_cache = NULL;
+	
 	return options;
 }
 
@@ -140,6 +153,10 @@ _g_mime_format_options_clone (GMimeFormatOptions *options, gboolean hidden)
 	clone->international = options->international;
 	clone->maxline = options->newline;
 	
+	g_mutex_init (&clone->encode_lock);
+	clone->encode_cache_size = options->encode_cache_size;
+	clone->encode_cache = NULL;
+	
 	clone->hidden = g_ptr_array_new ();
 	
 	if (hidden) {
@@ -183,6 +200,7 @@ g_mime_format_options_free (GMimeFormatOptions *options)
 		for (i = 0; i < options->hidden->len; i++)
 			g_free (options->hidden->pdata[i]);
 		g_ptr_array_free (options->hidden, TRUE);
+		encode_cache_free (options);
 		
 		g_slice_free (GMimeFormatOptions, options);
 	}
@@ -485,3 +503,128 @@ g_mime_format_options_clear_hidden_headers (GMimeFormatOptions *options)
 	
 	g_ptr_array_set_size (options->hidden, 0);
 }
+
+
+static void
+encode_cache_free (GMimeFormatOptions *options)
+{
+	if (options->encode_cache != NULL)
+		g_hash_table_destroy (options->encode_cache);
+	
+	g_mutex_clear (&options->encode_lock);
+}
+
+
+/**
+ * g_mime_format_options_get_header_encode_cache_size:
+ * @options: (nullable): a #GMimeFormatOptions or %NULL
+ *
+ * Gets the maximum number of encoded header values that will be remembered
+ * by g_mime_utils_header_encode_text() and g_mime_utils_header_encode_phrase().
+ *
+ * Returns: the size of the header encoder cache or %0 if it is disabled.
+ **/
+guint
+g_mime_format_options_get_header_encode_cache_size (GMimeFormatOptions *options)
+{
+	return options ? options->encode_cache_size : default_options->encode_cache_size;
+}
+
+
+/**
+ * g_mime_format_options_set_header_encode_cache_size:
+ * @options: a #GMimeFormatOptions
+ * @size: the maximum number of encoded header values to remember or %0 to disable the cache
+ *
+ * Sets the maximum number of encoded header values that will be remembered
+ * by g_mime_utils_header_encode_text() and g_mime_utils_header_encode_phrase().
+ *
+ * When the same header values are encoded over and over again (such as when
+ * sending the same localized Subject to a large number of recipients), the
+ * cache allows the encoder to return the previous result instead of encoding
+ * the value again. The cache is disabled by default.
+ **/
+void
+g_mime_format_options_set_header_encode_cache_size (GMimeFormatOptions *options, guint size)
+{
+	g_return_if_fail (options != NULL);
+	
+	g_mutex_lock (&options->encode_lock);
+	if (options->encode_cache != NULL && (size == 0 || g_hash_table_size (options->encode_cache) > size)) {
+		g_hash_table_destroy (options->encode_cache);
+		options->encode_cache = NULL;
+	}
+	
+	options->encode_cache_size = size;
+	g_mutex_unlock (&options->encode_lock);
+}
+
+
+/**
+ * _g_mime_format_options_encode_cache_key:
+ * @options: (nullable): a #GMimeFormatOptions or %NULL
+ * @value: the header value to encode
+ * @phrase: %TRUE if @value is a phrase or %FALSE if it is unstructured text
+ * @charset: (nullable): the charset requested by the caller
+ *
+ * Creates the key used to lookup the encoded form of @value in the header
+ * encoder cache.
+ *
+ * Returns: a newly allocated key or %NULL if the header encoder cache is disabled.
+ **/
+char *
+_g_mime_format_options_encode_cache_key (GMimeFormatOptions *options, const char *value, gboolean phrase, const char *charset)
+{
+	if (options == NULL || options->encode_cache_size == 0)
+		return NULL;
+	
+	return g_strdup_printf ("%c%u:%s\n%s", phrase ? 'p' : 't', options->maxline, charset ? charset : "", value);
+}
+
+
+/**
+ * _g_mime_format_options_encode_cache_lookup:
+ * @options: a #GMimeFormatOptions
+ * @key: the cache key
+ *
+ * Looks up a previously encoded header value in the header encoder cache.
+ *
+ * Returns: a newly allocated copy of the encoded value or %NULL if it was not found.
+ **/
+char *
+_g_mime_format_options_encode_cache_lookup (GMimeFormatOptions *options, const char *key)
+{
+	char *encoded = NULL;
+	
+	g_mutex_lock (&options->encode_lock);
+	if (options->encode_cache != NULL)
+		encoded = g_strdup (g_hash_table_lookup (options->encode_cache, key));
+	g_mutex_unlock (&options->encode_lock);
+	
+	return encoded;
+}
+
+
+/**
+ * _g_mime_format_options_encode_cache_add:
+ * @options: a #GMimeFormatOptions
+ * @key: the cache key
+ * @encoded: the encoded header value
+ *
+ * Adds an encoded header value to the header encoder cache. Once the cache is
+ * full, all of the previously cached values are discarded.
+ **/
+void
+_g_mime_format_options_encode_cache_add (GMimeFormatOptions *options, const char *key, const char *encoded)
+{
+	g_mutex_lock (&options->encode_lock);
+	if (options->encode_cache_size > 0) {
+		if (options->encode_cache == NULL)
+			options->encode_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+		else if (g_hash_table_size (options->encode_cache) >= options->encode_cache_size)
+			g_hash_table_remove_all (options->encode_cache);
+		
+		g_hash_table_replace (options->encode_cache, g_strdup (key), g_strdup (encoded));
+	}
+	g_mutex_unlock (&options->encode_lock);
+}
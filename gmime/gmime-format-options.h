@@ -103,6 +103,9 @@ void g_mime_format_options_add_hidden_header (GMimeFormatOptions *options, const
 void g_mime_format_options_remove_hidden_header (GMimeFormatOptions *options, const char *header);
 void g_mime_format_options_clear_hidden_headers (GMimeFormatOptions *options);
 
+guint g_mime_format_options_get_header_encode_cache_size (GMimeFormatOptions *options);
+void g_mime_format_options_set_header_encode_cache_size (GMimeFormatOptions *options, guint size);
+
 G_END_DECLS
 
 #endif /* __GMIME_FORMAT_OPTIONS_H__ */
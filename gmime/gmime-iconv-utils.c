@@ -29,6 +29,7 @@
 
 #include "gmime-iconv-utils.h"
 #include "gmime-charset.h"
+#include "gmime-internal.h"
 
 #ifdef ENABLE_WARNINGS
 #define w(x) x
@@ -47,22 +48,11 @@
  **/
 
 
-/**
- * g_mime_iconv_strndup: (skip)
- * @cd: (type gpointer): conversion descriptor
- * @str: string in source charset
- * @n: number of bytes to convert
- *
- * Allocates a new string buffer containing the first @n bytes of @str
- * converted to the destination charset as described by the conversion
- * descriptor @cd.
- *
- * Returns: a new string buffer containing the first @n bytes of
- * @str converted to the destination charset as described by the
- * conversion descriptor @cd.
- **/
+/* like g_mime_iconv_strndup(), but converts using @native (as returned
+ * by _g_mime_iconv_native_lookup() for the charsets of @cd) if it is
+ * non-%NULL */
 char *
-g_mime_iconv_strndup (iconv_t cd, const char *str, size_t n)
+_g_mime_iconv_strndup_native (iconv_t cd, const GMimeIconvNative *native, const char *str, size_t n)
 {
 	size_t inleft, outleft, converted = 0;
 	char *out, *outbuf;
@@ -84,7 +74,7 @@ g_mime_iconv_strndup (iconv_t cd, const char *str, size_t n)
 		outbuf = out + converted;
 		outleft = outlen - converted;
 		
-		converted = iconv (cd, (char **) &inbuf, &inleft, &outbuf, &outleft);
+		converted = _g_mime_iconv (cd, native, (char **) &inbuf, &inleft, &outbuf, &outleft);
 		if (converted != (size_t) -1 || errno == EINVAL) {
 			/*
 			 * EINVAL  An  incomplete  multibyte sequence has been encoun-
@@ -150,6 +140,27 @@ g_mime_iconv_strndup (iconv_t cd, const char *str, size_t n)
 }
 
 
+/**
+ * g_mime_iconv_strndup: (skip)
+ * @cd: (type gpointer): conversion descriptor
+ * @str: string in source charset
+ * @n: number of bytes to convert
+ *
+ * Allocates a new string buffer containing the first @n bytes of @str
+ * converted to the destination charset as described by the conversion
+ * descriptor @cd.
+ *
+ * Returns: a new string buffer containing the first @n bytes of
+ * @str converted to the destination charset as described by the
+ * conversion descriptor @cd.
+ **/
+char *
+g_mime_iconv_strndup (iconv_t cd, const char *str, size_t n)
+{
+	return _g_mime_iconv_strndup_native (cd, NULL, str, n);
+}
+
+
 /**
  * g_mime_iconv_strdup: (skip)
  * @cd: (type gpointer): conversion descriptor
@@ -28,6 +28,11 @@
 
 #include "gmime-charset.h"
 #include "gmime-iconv.h"
+#include "gmime-internal.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 
 /**
@@ -42,6 +47,294 @@
  **/
 
 
+/* The most common legacy charsets are converted into UTF-8 by built-in
+ * converters rather than by iconv: GMime's own conversion loops look up
+ * the built-in converter for the charsets that they convert between
+ * with _g_mime_iconv_native_lookup() and then use it by way of
+ * _g_mime_iconv() in place of the descriptor opened by
+ * g_mime_iconv_open(). The converters behave exactly like glibc's iconv
+ * would, including the errors. */
+
+typedef size_t (* NativeConvertFunc) (const GMimeIconvNative *native, const unsigned char **inbuf, size_t *inleft,
+				      unsigned char **outbuf, size_t *outleft);
+
+struct _GMimeIconvNative {
+	const char *charset;
+	NativeConvertFunc convert;
+	const guint16 *table;
+};
+
+/* Unicode code points for bytes 0x80-0xff (0 if the byte is unmapped) */
+static const guint16 iso_8859_15_table[128] = {
+	0x0080, 0x0081, 0x0082, 0x0083, 0x0084, 0x0085, 0x0086, 0x0087,
+	0x0088, 0x0089, 0x008a, 0x008b, 0x008c, 0x008d, 0x008e, 0x008f,
+	0x0090, 0x0091, 0x0092, 0x0093, 0x0094, 0x0095, 0x0096, 0x0097,
+	0x0098, 0x0099, 0x009a, 0x009b, 0x009c, 0x009d, 0x009e, 0x009f,
+	0x00a0, 0x00a1, 0x00a2, 0x00a3, 0x20ac, 0x00a5, 0x0160, 0x00a7,
+	0x0161, 0x00a9, 0x00aa, 0x00ab, 0x00ac, 0x00ad, 0x00ae, 0x00af,
+	0x00b0, 0x00b1, 0x00b2, 0x00b3, 0x017d, 0x00b5, 0x00b6, 0x00b7,
+	0x017e, 0x00b9, 0x00ba, 0x00bb, 0x0152, 0x0153, 0x0178, 0x00bf,
+	0x00c0, 0x00c1, 0x00c2, 0x00c3, 0x00c4, 0x00c5, 0x00c6, 0x00c7,
+	0x00c8, 0x00c9, 0x00ca, 0x00cb, 0x00cc, 0x00cd, 0x00ce, 0x00cf,
+	0x00d0, 0x00d1, 0x00d2, 0x00d3, 0x00d4, 0x00d5, 0x00d6, 0x00d7,
+	0x00d8, 0x00d9, 0x00da, 0x00db, 0x00dc, 0x00dd, 0x00de, 0x00df,
+	0x00e0, 0x00e1, 0x00e2, 0x00e3, 0x00e4, 0x00e5, 0x00e6, 0x00e7,
+	0x00e8, 0x00e9, 0x00ea, 0x00eb, 0x00ec, 0x00ed, 0x00ee, 0x00ef,
+	0x00f0, 0x00f1, 0x00f2, 0x00f3, 0x00f4, 0x00f5, 0x00f6, 0x00f7,
+	0x00f8, 0x00f9, 0x00fa, 0x00fb, 0x00fc, 0x00fd, 0x00fe, 0x00ff
+};
+
+static const guint16 windows_1252_table[128] = {
+	0x20ac, 0x0000, 0x201a, 0x0192, 0x201e, 0x2026, 0x2020, 0x2021,
+	0x02c6, 0x2030, 0x0160, 0x2039, 0x0152, 0x0000, 0x017d, 0x0000,
+	0x0000, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
+	0x02dc, 0x2122, 0x0161, 0x203a, 0x0153, 0x0000, 0x017e, 0x0178,
+	0x00a0, 0x00a1, 0x00a2, 0x00a3, 0x00a4, 0x00a5, 0x00a6, 0x00a7,
+	0x00a8, 0x00a9, 0x00aa, 0x00ab, 0x00ac, 0x00ad, 0x00ae, 0x00af,
+	0x00b0, 0x00b1, 0x00b2, 0x00b3, 0x00b4, 0x00b5, 0x00b6, 0x00b7,
+	0x00b8, 0x00b9, 0x00ba, 0x00bb, 0x00bc, 0x00bd, 0x00be, 0x00bf,
+	0x00c0, 0x00c1, 0x00c2, 0x00c3, 0x00c4, 0x00c5, 0x00c6, 0x00c7,
+	0x00c8, 0x00c9, 0x00ca, 0x00cb, 0x00cc, 0x00cd, 0x00ce, 0x00cf,
+	0x00d0, 0x00d1, 0x00d2, 0x00d3, 0x00d4, 0x00d5, 0x00d6, 0x00d7,
+	0x00d8, 0x00d9, 0x00da, 0x00db, 0x00dc, 0x00dd, 0x00de, 0x00df,
+	0x00e0, 0x00e1, 0x00e2, 0x00e3, 0x00e4, 0x00e5, 0x00e6, 0x00e7,
+	0x00e8, 0x00e9, 0x00ea, 0x00eb, 0x00ec, 0x00ed, 0x00ee, 0x00ef,
+	0x00f0, 0x00f1, 0x00f2, 0x00f3, 0x00f4, 0x00f5, 0x00f6, 0x00f7,
+	0x00f8, 0x00f9, 0x00fa, 0x00fb, 0x00fc, 0x00fd, 0x00fe, 0x00ff
+};
+
+static const guint16 koi8_r_table[128] = {
+	0x2500, 0x2502, 0x250c, 0x2510, 0x2514, 0x2518, 0x251c, 0x2524,
+	0x252c, 0x2534, 0x253c, 0x2580, 0x2584, 0x2588, 0x258c, 0x2590,
+	0x2591, 0x2592, 0x2593, 0x2320, 0x25a0, 0x2219, 0x221a, 0x2248,
+	0x2264, 0x2265, 0x00a0, 0x2321, 0x00b0, 0x00b2, 0x00b7, 0x00f7,
+	0x2550, 0x2551, 0x2552, 0x0451, 0x2553, 0x2554, 0x2555, 0x2556,
+	0x2557, 0x2558, 0x2559, 0x255a, 0x255b, 0x255c, 0x255d, 0x255e,
+	0x255f, 0x2560, 0x2561, 0x0401, 0x2562, 0x2563, 0x2564, 0x2565,
+	0x2566, 0x2567, 0x2568, 0x2569, 0x256a, 0x256b, 0x256c, 0x00a9,
+	0x044e, 0x0430, 0x0431, 0x0446, 0x0434, 0x0435, 0x0444, 0x0433,
+	0x0445, 0x0438, 0x0439, 0x043a, 0x043b, 0x043c, 0x043d, 0x043e,
+	0x043f, 0x044f, 0x0440, 0x0441, 0x0442, 0x0443, 0x0436, 0x0432,
+	0x044c, 0x044b, 0x0437, 0x0448, 0x044d, 0x0449, 0x0447, 0x044a,
+	0x042e, 0x0410, 0x0411, 0x0426, 0x0414, 0x0415, 0x0424, 0x0413,
+	0x0425, 0x0418, 0x0419, 0x041a, 0x041b, 0x041c, 0x041d, 0x041e,
+	0x041f, 0x042f, 0x0420, 0x0421, 0x0422, 0x0423, 0x0416, 0x0412,
+	0x042c, 0x042b, 0x0417, 0x0428, 0x042d, 0x0429, 0x0427, 0x042a
+};
+
+static size_t
+convert_8bit (const GMimeIconvNative *native, const unsigned char **inbuf, size_t *inleft,
+	      unsigned char **outbuf, size_t *outleft)
+{
+	register const unsigned char *inptr = *inbuf;
+	const unsigned char *inend = inptr + *inleft;
+	register unsigned char *outptr = *outbuf;
+	unsigned char *outend = outptr + *outleft;
+	const guint16 *table = native->table;
+	size_t rc = 0;
+	gunichar c;
+#ifdef __SSE2__
+	__m128i chars;
+	int mask;
+#endif
+	
+	while (inptr < inend) {
+		if (*inptr < 0x80) {
+#ifdef __SSE2__
+			if (inend - inptr >= 16 && outend - outptr >= 16) {
+				/* copy all 16 bytes, but only keep the leading ASCII ones */
+				chars = _mm_loadu_si128 ((const __m128i *) inptr);
+				_mm_storeu_si128 ((__m128i *) outptr, chars);
+				
+				mask = _mm_movemask_epi8 (chars);
+				c = mask ? g_bit_nth_lsf ((gulong) mask, -1) : 16;
+				outptr += c;
+				inptr += c;
+				continue;
+			}
+#endif
+			
+			if (outptr == outend)
+				goto e2big;
+			
+			*outptr++ = *inptr++;
+			continue;
+		}
+		
+		/* a NULL table is ISO-8859-1 */
+		c = table ? table[*inptr - 0x80] : *inptr;
+		
+		if (c == 0) {
+			errno = EILSEQ;
+			rc = (size_t) -1;
+			goto done;
+		}
+		
+		if (c < 0x800) {
+			if (outend - outptr < 2)
+				goto e2big;
+			
+			*outptr++ = 0xc0 | (c >> 6);
+			*outptr++ = 0x80 | (c & 0x3f);
+		} else {
+			if (outend - outptr < 3)
+				goto e2big;
+			
+			*outptr++ = 0xe0 | (c >> 12);
+			*outptr++ = 0x80 | ((c >> 6) & 0x3f);
+			*outptr++ = 0x80 | (c & 0x3f);
+		}
+		
+		inptr++;
+	}
+	
+	goto done;
+	
+ e2big:
+	errno = E2BIG;
+	rc = (size_t) -1;
+	
+ done:
+	*inleft = inend - inptr;
+	*outleft = outend - outptr;
+	*outbuf = outptr;
+	*inbuf = inptr;
+	
+	return rc;
+}
+
+static inline size_t
+convert_utf16 (const unsigned char **inbuf, size_t *inleft, unsigned char **outbuf, size_t *outleft, gboolean be)
+{
+	register const unsigned char *inptr = *inbuf;
+	const unsigned char *inend = inptr + *inleft;
+	register unsigned char *outptr = *outbuf;
+	unsigned char *outend = outptr + *outleft;
+	gunichar c, c2;
+	size_t rc = 0;
+	
+	while (inend - inptr >= 2) {
+#ifdef __SSE2__
+		/* convert runs of ASCII 8 characters at a time */
+		while (inend - inptr >= 16 && outend - outptr >= 8) {
+			__m128i chars = _mm_loadu_si128 ((const __m128i *) inptr);
+			
+			if (be)
+				chars = _mm_or_si128 (_mm_srli_epi16 (chars, 8), _mm_slli_epi16 (chars, 8));
+			
+			if (_mm_movemask_epi8 (_mm_cmpeq_epi16 (_mm_and_si128 (chars, _mm_set1_epi16 ((short) 0xff80)),
+								_mm_setzero_si128 ())) != 0xffff)
+				break;
+			
+			_mm_storel_epi64 ((__m128i *) outptr, _mm_packus_epi16 (chars, chars));
+			outptr += 8;
+			inptr += 16;
+		}
+		
+		if (inend - inptr < 2)
+			break;
+#endif
+		
+		c = be ? (inptr[0] << 8) | inptr[1] : inptr[0] | (inptr[1] << 8);
+		
+		if (c >= 0xdc00 && c <= 0xdfff) {
+			/* a low surrogate without a high surrogate before it */
+			errno = EILSEQ;
+			rc = (size_t) -1;
+			break;
+		}
+		
+		if (c >= 0xd800 && c <= 0xdbff) {
+			if (inend - inptr < 4) {
+				errno = EINVAL;
+				rc = (size_t) -1;
+				break;
+			}
+			
+			c2 = be ? (inptr[2] << 8) | inptr[3] : inptr[2] | (inptr[3] << 8);
+			
+			if (c2 < 0xdc00 || c2 > 0xdfff) {
+				errno = EILSEQ;
+				rc = (size_t) -1;
+				break;
+			}
+			
+			if (outend - outptr < 4) {
+				errno = E2BIG;
+				rc = (size_t) -1;
+				break;
+			}
+			
+			c = 0x10000 + ((c - 0xd800) << 10) + (c2 - 0xdc00);
+			*outptr++ = 0xf0 | (c >> 18);
+			*outptr++ = 0x80 | ((c >> 12) & 0x3f);
+			*outptr++ = 0x80 | ((c >> 6) & 0x3f);
+			*outptr++ = 0x80 | (c & 0x3f);
+			inptr += 4;
+			continue;
+		}
+		
+		if (outend - outptr < (c < 0x80 ? 1 : c < 0x800 ? 2 : 3)) {
+			errno = E2BIG;
+			rc = (size_t) -1;
+			break;
+		}
+		
+		if (c < 0x80) {
+			*outptr++ = c;
+		} else if (c < 0x800) {
+			*outptr++ = 0xc0 | (c >> 6);
+			*outptr++ = 0x80 | (c & 0x3f);
+		} else {
+			*outptr++ = 0xe0 | (c >> 12);
+			*outptr++ = 0x80 | ((c >> 6) & 0x3f);
+			*outptr++ = 0x80 | (c & 0x3f);
+		}
+		
+		inptr += 2;
+	}
+	
+	if (rc == 0 && inptr < inend) {
+		/* half of a UTF-16 code unit */
+		errno = EINVAL;
+		rc = (size_t) -1;
+	}
+	
+	*inleft = inend - inptr;
+	*outleft = outend - outptr;
+	*outbuf = outptr;
+	*inbuf = inptr;
+	
+	return rc;
+}
+
+static size_t
+convert_utf16le (const GMimeIconvNative *native, const unsigned char **inbuf, size_t *inleft,
+		 unsigned char **outbuf, size_t *outleft)
+{
+	return convert_utf16 (inbuf, inleft, outbuf, outleft, FALSE);
+}
+
+static size_t
+convert_utf16be (const GMimeIconvNative *native, const unsigned char **inbuf, size_t *inleft,
+		 unsigned char **outbuf, size_t *outleft)
+{
+	return convert_utf16 (inbuf, inleft, outbuf, outleft, TRUE);
+}
+
+static const GMimeIconvNative natives[] = {
+	{ "iso-8859-1",     convert_8bit,    NULL               },
+	{ "latin1",         convert_8bit,    NULL               },
+	{ "iso-8859-15",    convert_8bit,    iso_8859_15_table  },
+	{ "latin9",         convert_8bit,    iso_8859_15_table  },
+	{ "windows-cp1252", convert_8bit,    windows_1252_table },
+	{ "cp1252",         convert_8bit,    windows_1252_table },
+	{ "koi8-r",         convert_8bit,    koi8_r_table       },
+	{ "utf-16le",       convert_utf16le, NULL               },
+	{ "utf-16be",       convert_utf16be, NULL               }
+};
+
+
 /**
  * g_mime_iconv_open: (skip)
  * @to: charset to convert to
@@ -92,3 +385,70 @@ g_mime_iconv_close (iconv_t cd)
 {
 	return iconv_close (cd);
 }
+
+
+/**
+ * _g_mime_iconv_native_lookup:
+ * @to: charset to convert to
+ * @from: charset to convert from
+ *
+ * Gets the built-in converter for converting from @from to @to, if
+ * there is one. The charsets are interpreted the same way as by
+ * g_mime_iconv_open().
+ *
+ * Returns: the built-in converter to pass to _g_mime_iconv() along
+ * with a descriptor opened by g_mime_iconv_open() for the same
+ * charsets or %NULL if there is none.
+ **/
+const GMimeIconvNative *
+_g_mime_iconv_native_lookup (const char *to, const char *from)
+{
+	const char *charset;
+	guint i;
+	
+	if (from == NULL || to == NULL)
+		return NULL;
+	
+	if (g_ascii_strcasecmp (g_mime_charset_canon_name (to), "utf-8") != 0)
+		return NULL;
+	
+	if (!g_ascii_strcasecmp (from, "x-unknown"))
+		from = g_mime_locale_charset ();
+	
+	charset = g_mime_charset_canon_name (from);
+	
+	for (i = 0; i < G_N_ELEMENTS (natives); i++) {
+		if (!g_ascii_strcasecmp (natives[i].charset, charset))
+			return &natives[i];
+	}
+	
+	return NULL;
+}
+
+
+/**
+ * _g_mime_iconv:
+ * @cd: iconv conversion descriptor
+ * @native: the built-in converter for @cd or %NULL
+ * @inbuf: input buffer
+ * @inleft: number of bytes left in @inbuf
+ * @outbuf: output buffer
+ * @outleft: number of bytes left in @outbuf
+ *
+ * Converts text just like iconv() would, but using @native (as
+ * returned by _g_mime_iconv_native_lookup()) if it is non-%NULL.
+ *
+ * Returns: the same as iconv().
+ **/
+size_t
+_g_mime_iconv (iconv_t cd, const GMimeIconvNative *native, char **inbuf, size_t *inleft, char **outbuf, size_t *outleft)
+{
+	if (native == NULL)
+		return iconv (cd, inbuf, inleft, outbuf, outleft);
+	
+	/* the built-in converters are stateless, so there is nothing to flush */
+	if (inbuf == NULL || *inbuf == NULL)
+		return 0;
+	
+	return native->convert (native, (const unsigned char **) inbuf, inleft, (unsigned char **) outbuf, outleft);
+}
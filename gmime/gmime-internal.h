@@ -27,6 +27,9 @@
 #include <gmime/gmime-object.h>
 #include <gmime/gmime-events.h>
 #include <gmime/gmime-utils.h>
+#include <gmime/gmime-filter-checksum.h>
+#include <gmime/gmime-iconv.h>
+#include <gmime/gmime-stream-rope.h>
 
 G_BEGIN_DECLS
 
@@ -47,6 +50,46 @@ typedef struct {
 G_GNUC_INTERNAL void g_mime_format_options_init (void);
 G_GNUC_INTERNAL void g_mime_format_options_shutdown (void);
 G_GNUC_INTERNAL GMimeFormatOptions *_g_mime_format_options_clone (GMimeFormatOptions *options, gboolean hidden);
+G_GNUC_INTERNAL char *_g_mime_format_options_encode_cache_key (GMimeFormatOptions *options, const char *value,
+							       gboolean phrase, const char *charset);
+G_GNUC_INTERNAL char *_g_mime_format_options_encode_cache_lookup (GMimeFormatOptions *options, const char *key);
+G_GNUC_INTERNAL void _g_mime_format_options_encode_cache_add (GMimeFormatOptions *options, const char *key,
+							      const char *encoded);
+
+/* GMimeFilter buffer pool */
+G_GNUC_INTERNAL char *_g_mime_buffer_pool_alloc (size_t size, size_t *allocated);
+G_GNUC_INTERNAL void _g_mime_buffer_pool_free (char *buffer, size_t allocated);
+G_GNUC_INTERNAL void _g_mime_buffer_pool_clear (void);
+
+/* charsets */
+G_GNUC_INTERNAL size_t _g_mime_ascii_span (const char *text, size_t len);
+G_GNUC_INTERNAL gboolean _g_mime_utf8_validate (const char *text, size_t len);
+G_GNUC_INTERNAL gboolean _g_mime_charset_is_ascii_superset (const char *charset);
+
+/* built-in charset converters */
+typedef struct _GMimeIconvNative GMimeIconvNative;
+
+G_GNUC_INTERNAL const GMimeIconvNative *_g_mime_iconv_native_lookup (const char *to, const char *from);
+G_GNUC_INTERNAL size_t _g_mime_iconv (iconv_t cd, const GMimeIconvNative *native, char **inbuf, size_t *inleft,
+				      char **outbuf, size_t *outleft);
+G_GNUC_INTERNAL char *_g_mime_iconv_strndup_native (iconv_t cd, const GMimeIconvNative *native, const char *str, size_t n);
+
+/* GMimeEncoding */
+G_GNUC_INTERNAL size_t _g_mime_encoding_outlen (GMimeEncoding *state, size_t inlen, gboolean crlf);
+G_GNUC_INTERNAL size_t _g_mime_encoding_step (GMimeEncoding *state, const char *inbuf, size_t inlen, char *outbuf,
+					      gboolean crlf);
+G_GNUC_INTERNAL size_t _g_mime_encoding_flush (GMimeEncoding *state, const char *inbuf, size_t inlen, char *outbuf,
+					       gboolean crlf);
+
+/* crc32 (as used by yEnc) */
+G_GNUC_INTERNAL guint32 _g_mime_crc32_update (guint32 crc, const unsigned char *inbuf, size_t inlen);
+
+/* GMimeStreamRope */
+G_GNUC_INTERNAL int _g_mime_stream_rope_byte_at (GMimeStreamRope *rope, gint64 offset);
+G_GNUC_INTERNAL int _g_mime_stream_rope_write_chunks (GMimeStreamRope *rope, gint64 length, GMimeStream *stream);
+
+/* GMimeFilterChecksum */
+G_GNUC_INTERNAL void _g_mime_filter_checksum_update (GMimeFilterChecksum *checksum, const unsigned char *inbuf, size_t inlen);
 
 /* GMimeParserOptions */
 G_GNUC_INTERNAL void g_mime_parser_options_init (void);
@@ -54,6 +97,10 @@ G_GNUC_INTERNAL void g_mime_parser_options_shutdown (void);
 G_GNUC_INTERNAL void _g_mime_parser_options_warn (GMimeParserOptions *options, gint64 offset, GMimeParserWarning errcode,
 						  const gchar *item);
 
+/* date parser */
+G_GNUC_INTERNAL void g_mime_utils_init (void);
+G_GNUC_INTERNAL void g_mime_utils_shutdown (void);
+
 /* GMimeHeader */
 //G_GNUC_INTERNAL void _g_mime_header_set_raw_value (GMimeHeader *header, const char *raw_value);
 G_GNUC_INTERNAL void _g_mime_header_set_offset (GMimeHeader *header, gint64 offset);
@@ -28,7 +28,7 @@
 
 #include "gmime-message-partial.h"
 #include "gmime-stream-cat.h"
-#include "gmime-stream-mem.h"
+#include "gmime-stream-rope.h"
 #include "gmime-internal.h"
 #include "gmime-parser.h"
 
@@ -347,7 +347,6 @@ message_partial_message_new (GMimeMessage *base)
 	return message;
 }
 
-
 /**
  * g_mime_message_partial_split_message:
  * @message: message object
@@ -370,7 +369,7 @@ g_mime_message_partial_split_message (GMimeMessage *message, size_t max_size, si
 	GMimeStream *stream, *substream;
 	GMimeFormatOptions *options;
 	GMimeDataWrapper *wrapper;
-	const unsigned char *buf;
+	GMimeStreamRope *rope;
 	GPtrArray *parts;
 	gint64 len, end;
 	const char *id;
@@ -382,7 +381,7 @@ g_mime_message_partial_split_message (GMimeMessage *message, size_t max_size, si
 	g_return_val_if_fail (GMIME_IS_MESSAGE (message), NULL);
 	
 	options = g_mime_format_options_get_default ();
-	stream = g_mime_stream_mem_new ();
+	stream = g_mime_stream_rope_new ();
 	
 	if (g_mime_object_write_to_stream ((GMimeObject *) message, options, stream) == -1) {
 		g_object_unref (stream);
@@ -407,7 +406,7 @@ g_mime_message_partial_split_message (GMimeMessage *message, size_t max_size, si
 	
 	start = 0;
 	parts = g_ptr_array_new ();
-	buf = ((GMimeStreamMem *) stream)->buffer->data;
+	rope = (GMimeStreamRope *) stream;
 	
 	while (start < len) {
 		/* Preferably, we'd split on whole-lines if we can,
@@ -416,10 +415,10 @@ g_mime_message_partial_split_message (GMimeMessage *message, size_t max_size, si
 			register gint64 ebx; /* end boundary */
 			
 			ebx = end;
-			while (ebx > (start + 1) && ebx[buf] != '\n')
+			while (ebx > (start + 1) && _g_mime_stream_rope_byte_at (rope, ebx) != '\n')
 				ebx--;
 			
-			if (ebx[buf] == '\n')
+			if (_g_mime_stream_rope_byte_at (rope, ebx) == '\n')
 				end = ebx + 1;
 		}
 		
@@ -33,6 +33,7 @@
 #include "gmime-filter-strip.h"
 #include "gmime-filter-from.h"
 #include "gmime-stream-mem.h"
+#include "gmime-stream-rope.h"
 #include "gmime-internal.h"
 #include "gmime-parser.h"
 #include "gmime-error.h"
@@ -235,7 +236,7 @@ g_mime_multipart_signed_sign (GMimeCryptoContext *ctx, GMimeObject *entity,
 	sign_prepare (entity);
 	
 	/* get the cleartext */
-	stream = g_mime_stream_mem_new ();
+	stream = g_mime_stream_rope_new ();
 	filtered = g_mime_stream_filter_new (stream);
 	
 	/* Note: see rfc3156, section 3 - second note */
@@ -430,7 +431,7 @@ g_mime_multipart_signed_verify (GMimeMultipartSigned *mps, GMimeVerifyFlags flag
 	content = g_mime_multipart_get_part ((GMimeMultipart *) mps, GMIME_MULTIPART_SIGNED_CONTENT);
 	
 	/* get the content stream */
-	stream = g_mime_stream_mem_new ();
+	stream = g_mime_stream_rope_new ();
 	
 	/* Note: see rfc2015 or rfc3156, section 5.1 */
 	options = _g_mime_format_options_clone (NULL, FALSE);
@@ -450,8 +451,7 @@ g_mime_multipart_signed_verify (GMimeMultipartSigned *mps, GMimeVerifyFlags flag
 	/* verify the signature */
 	signatures = g_mime_crypto_context_verify (ctx, flags, stream, sigstream, NULL, err);
 	
-	d(printf ("attempted to verify:\n----- BEGIN SIGNED PART -----\n%.*s----- END SIGNED PART -----\n",
-		  (int) GMIME_STREAM_MEM (stream)->buffer->len, GMIME_STREAM_MEM (stream)->buffer->data));
+	d(printf ("attempted to verify %" G_GINT64_FORMAT " bytes of signed content\n", g_mime_stream_length (stream)));
 	
 	g_object_unref (sigstream);
 	g_object_unref (stream);
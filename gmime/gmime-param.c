@@ -1209,6 +1209,7 @@ rfc2184_param_charset (const char **in, char **langp)
 static char *
 charset_convert (const char *charset, char *in, size_t inlen)
 {
+	const GMimeIconvNative *native;
 	gboolean locale = FALSE;
 	char *result = NULL;
 	iconv_t cd;
@@ -1230,7 +1231,8 @@ charset_convert (const char *charset, char *in, size_t inlen)
 	}
 	
 	if (cd != (iconv_t) -1) {
-		result = g_mime_iconv_strndup (cd, in, inlen);
+		native = _g_mime_iconv_native_lookup ("UTF-8", charset);
+		result = _g_mime_iconv_strndup_native (cd, native, in, inlen);
 		g_mime_iconv_close (cd);
 	}
 	
@@ -48,6 +48,12 @@ struct _GMimeParserOptions {
 	GMimeRfcComplianceMode rfc2047;
 	gboolean allow_no_domain;
 	char **charsets;
+	gint64 max_content_size;
+	size_t max_header_size;
+	guint max_parse_time;
+	guint max_headers;
+	guint max_parts;
+	guint max_depth;
 	GMimeParserWarningFunc warning_cb;
 	gpointer warning_user_data;
 	GDestroyNotify notify;
@@ -133,6 +139,13 @@ g_mime_parser_options_new (void)
 	options->charsets[1] = g_strdup ("iso-8859-1");
 	options->charsets[2] = NULL;
 	
+	options->max_content_size = 0;
+	options->max_header_size = 0;
+	options->max_parse_time = 0;
+	options->max_headers = 0;
+	options->max_parts = 0;
+	options->max_depth = 0;
+	
 	options->warning_cb = NULL;
 	options->warning_user_data = NULL;
 	options->notify = NULL;
@@ -172,6 +185,13 @@ g_mime_parser_options_clone (GMimeParserOptions *options)
 		clone->charsets[i] = g_strdup (options->charsets[i]);
 	clone->charsets[i] = NULL;
 	
+	clone->max_content_size = options->max_content_size;
+	clone->max_header_size = options->max_header_size;
+	clone->max_parse_time = options->max_parse_time;
+	clone->max_headers = options->max_headers;
+	clone->max_parts = options->max_parts;
+	clone->max_depth = options->max_depth;
+	
 	clone->warning_cb = options->warning_cb;
 	clone->warning_user_data = options->warning_user_data;
 	// We transfer the pointer not ownership. So we don't copy the notify
@@ -430,6 +450,216 @@ g_mime_parser_options_set_fallback_charsets (GMimeParserOptions *options, const
 }
 
 
+/**
+ * g_mime_parser_options_get_max_headers:
+ * @options: (nullable): a #GMimeParserOptions or %NULL
+ *
+ * Gets the maximum number of headers that the parser will accept for
+ * a single message or MIME part.
+ *
+ * Returns: the maximum number of headers per header block or %0 if
+ * there is no limit.
+ **/
+guint
+g_mime_parser_options_get_max_headers (GMimeParserOptions *options)
+{
+	return options ? options->max_headers : default_options->max_headers;
+}
+
+
+/**
+ * g_mime_parser_options_set_max_headers:
+ * @options: a #GMimeParserOptions
+ * @max_headers: the maximum number of headers or %0 for no limit
+ *
+ * Sets the maximum number of headers that the parser will accept for
+ * a single message or MIME part. Any additional headers are ignored
+ * and reported with #GMIME_CRIT_TOO_MANY_HEADERS.
+ **/
+void
+g_mime_parser_options_set_max_headers (GMimeParserOptions *options, guint max_headers)
+{
+	g_return_if_fail (options != NULL);
+	
+	options->max_headers = max_headers;
+}
+
+
+/**
+ * g_mime_parser_options_get_max_header_size:
+ * @options: (nullable): a #GMimeParserOptions or %NULL
+ *
+ * Gets the maximum size of a single (possibly folded) header field.
+ *
+ * Returns: the maximum header size in bytes or %0 if there is no limit.
+ **/
+size_t
+g_mime_parser_options_get_max_header_size (GMimeParserOptions *options)
+{
+	return options ? options->max_header_size : default_options->max_header_size;
+}
+
+
+/**
+ * g_mime_parser_options_set_max_header_size:
+ * @options: a #GMimeParserOptions
+ * @max_header_size: the maximum header size in bytes or %0 for no limit
+ *
+ * Sets the maximum size of a single (possibly folded) header field,
+ * including its name. Longer headers are truncated and reported with
+ * #GMIME_CRIT_HEADER_TOO_LONG.
+ **/
+void
+g_mime_parser_options_set_max_header_size (GMimeParserOptions *options, size_t max_header_size)
+{
+	g_return_if_fail (options != NULL);
+	
+	options->max_header_size = max_header_size;
+}
+
+
+/**
+ * g_mime_parser_options_get_max_parts:
+ * @options: (nullable): a #GMimeParserOptions or %NULL
+ *
+ * Gets the maximum number of MIME parts that the parser will construct
+ * for a single message.
+ *
+ * Returns: the maximum number of MIME parts or %0 if there is no limit.
+ **/
+guint
+g_mime_parser_options_get_max_parts (GMimeParserOptions *options)
+{
+	return options ? options->max_parts : default_options->max_parts;
+}
+
+
+/**
+ * g_mime_parser_options_set_max_parts:
+ * @options: a #GMimeParserOptions
+ * @max_parts: the maximum number of MIME parts or %0 for no limit
+ *
+ * Sets the maximum number of MIME parts (including multiparts) that the
+ * parser will construct for a single message. Once the limit has been
+ * reached, the remaining subparts of each multipart are skipped and
+ * reported with #GMIME_CRIT_TOO_MANY_PARTS.
+ **/
+void
+g_mime_parser_options_set_max_parts (GMimeParserOptions *options, guint max_parts)
+{
+	g_return_if_fail (options != NULL);
+	
+	options->max_parts = max_parts;
+}
+
+
+/**
+ * g_mime_parser_options_get_max_depth:
+ * @options: (nullable): a #GMimeParserOptions or %NULL
+ *
+ * Gets the maximum MIME nesting depth.
+ *
+ * Returns: the maximum MIME nesting depth or %0 for the built-in limit.
+ **/
+guint
+g_mime_parser_options_get_max_depth (GMimeParserOptions *options)
+{
+	return options ? options->max_depth : default_options->max_depth;
+}
+
+
+/**
+ * g_mime_parser_options_set_max_depth:
+ * @options: a #GMimeParserOptions
+ * @max_depth: the maximum MIME nesting depth or %0 for the built-in limit
+ *
+ * Sets the maximum MIME nesting depth. Multiparts and message/rfc822
+ * parts nested any deeper are not parsed recursively and are reported
+ * with #GMIME_CRIT_NESTING_OVERFLOW.
+ *
+ * Note: The parser never nests deeper than its built-in limit of 1024
+ * levels, regardless of this value.
+ **/
+void
+g_mime_parser_options_set_max_depth (GMimeParserOptions *options, guint max_depth)
+{
+	g_return_if_fail (options != NULL);
+	
+	options->max_depth = max_depth;
+}
+
+
+/**
+ * g_mime_parser_options_get_max_content_size:
+ * @options: (nullable): a #GMimeParserOptions or %NULL
+ *
+ * Gets the maximum total number of content bytes that the parser will
+ * scan for a single message.
+ *
+ * Returns: the maximum content size in bytes or %0 if there is no limit.
+ **/
+gint64
+g_mime_parser_options_get_max_content_size (GMimeParserOptions *options)
+{
+	return options ? options->max_content_size : default_options->max_content_size;
+}
+
+
+/**
+ * g_mime_parser_options_set_max_content_size:
+ * @options: a #GMimeParserOptions
+ * @max_content_size: the maximum content size in bytes or %0 for no limit
+ *
+ * Sets the maximum total number of content bytes (summed over all of
+ * the MIME parts, prologues and epilogues) that the parser will scan
+ * for a single message. Once exceeded, the parser stops reading its
+ * stream, treats the message as truncated and reports
+ * #GMIME_CRIT_CONTENT_TOO_LARGE.
+ **/
+void
+g_mime_parser_options_set_max_content_size (GMimeParserOptions *options, gint64 max_content_size)
+{
+	g_return_if_fail (options != NULL);
+	g_return_if_fail (max_content_size >= 0);
+	
+	options->max_content_size = max_content_size;
+}
+
+
+/**
+ * g_mime_parser_options_get_max_parse_time:
+ * @options: (nullable): a #GMimeParserOptions or %NULL
+ *
+ * Gets the wall-clock time budget for parsing a single message.
+ *
+ * Returns: the time budget in milliseconds or %0 if there is no limit.
+ **/
+guint
+g_mime_parser_options_get_max_parse_time (GMimeParserOptions *options)
+{
+	return options ? options->max_parse_time : default_options->max_parse_time;
+}
+
+
+/**
+ * g_mime_parser_options_set_max_parse_time:
+ * @options: a #GMimeParserOptions
+ * @msec: the time budget in milliseconds or %0 for no limit
+ *
+ * Sets the wall-clock time budget for parsing a single message. The
+ * budget is checked each time the parser refills its read buffer. Once
+ * exceeded, the parser stops reading its stream, treats the message as
+ * truncated and reports #GMIME_CRIT_TIME_LIMIT_EXCEEDED.
+ **/
+void
+g_mime_parser_options_set_max_parse_time (GMimeParserOptions *options, guint msec)
+{
+	g_return_if_fail (options != NULL);
+	
+	options->max_parse_time = msec;
+}
+
+
 /**
  * g_mime_parser_options_get_warning_callback: (skip)
  * @options: (nullable): a #GMimeParserOptions or %NULL
@@ -60,6 +60,11 @@ typedef enum {
  * @GMIME_CRIT_NESTING_OVERFLOW: The maximum MIME nesting level has been exceeded. This is very likely to be an attempt to exploit the MIME parser.
  * @GMIME_WARN_PART_WITHOUT_CONTENT: A MIME part's headers were terminated by a boundary marker.
  * @GMIME_CRIT_PART_WITHOUT_HEADERS_OR_CONTENT: A MIME part was encountered without any headers -or- content. This is very likely to be an attempt to exploit the MIME parser.
+ * @GMIME_CRIT_TOO_MANY_HEADERS: A header block exceeded the maximum number of headers. The remaining headers have been ignored.
+ * @GMIME_CRIT_HEADER_TOO_LONG: A header exceeded the maximum header size and has been truncated.
+ * @GMIME_CRIT_TOO_MANY_PARTS: The message exceeded the maximum number of MIME parts. The remaining parts have been skipped.
+ * @GMIME_CRIT_CONTENT_TOO_LARGE: The message exceeded the maximum content size. The parser stopped reading the stream.
+ * @GMIME_CRIT_TIME_LIMIT_EXCEEDED: Parsing the message exceeded the time budget. The parser stopped reading the stream.
  *
  * Issues the @GMimeParser detects. Note that the `GMIME_CRIT_*` issues indicate that some parts of the @GMimeParser input may
  * be ignored or will be interpreted differently by other software products.
@@ -82,6 +87,11 @@ typedef enum {
 	GMIME_CRIT_NESTING_OVERFLOW,
 	GMIME_WARN_PART_WITHOUT_CONTENT,
 	GMIME_CRIT_PART_WITHOUT_HEADERS_OR_CONTENT,
+	GMIME_CRIT_TOO_MANY_HEADERS,
+	GMIME_CRIT_HEADER_TOO_LONG,
+	GMIME_CRIT_TOO_MANY_PARTS,
+	GMIME_CRIT_CONTENT_TOO_LARGE,
+	GMIME_CRIT_TIME_LIMIT_EXCEEDED,
 } GMimeParserWarning;
 
 /**
@@ -127,6 +137,24 @@ void g_mime_parser_options_set_rfc2047_compliance_mode (GMimeParserOptions *opti
 const char **g_mime_parser_options_get_fallback_charsets (GMimeParserOptions *options);
 void g_mime_parser_options_set_fallback_charsets (GMimeParserOptions *options, const char **charsets);
 
+guint g_mime_parser_options_get_max_headers (GMimeParserOptions *options);
+void g_mime_parser_options_set_max_headers (GMimeParserOptions *options, guint max_headers);
+
+size_t g_mime_parser_options_get_max_header_size (GMimeParserOptions *options);
+void g_mime_parser_options_set_max_header_size (GMimeParserOptions *options, size_t max_header_size);
+
+guint g_mime_parser_options_get_max_parts (GMimeParserOptions *options);
+void g_mime_parser_options_set_max_parts (GMimeParserOptions *options, guint max_parts);
+
+guint g_mime_parser_options_get_max_depth (GMimeParserOptions *options);
+void g_mime_parser_options_set_max_depth (GMimeParserOptions *options, guint max_depth);
+
+gint64 g_mime_parser_options_get_max_content_size (GMimeParserOptions *options);
+void g_mime_parser_options_set_max_content_size (GMimeParserOptions *options, gint64 max_content_size);
+
+guint g_mime_parser_options_get_max_parse_time (GMimeParserOptions *options);
+void g_mime_parser_options_set_max_parse_time (GMimeParserOptions *options, guint msec);
+
 GMimeParserWarningFunc g_mime_parser_options_get_warning_callback (GMimeParserOptions *options);
 void g_mime_parser_options_set_warning_callback (GMimeParserOptions *options, GMimeParserWarningFunc warning_cb, gpointer user_data);
 void g_mime_parser_options_set_warning_callback_full (GMimeParserOptions *options, GMimeParserWarningFunc warning_cb, gpointer user_data, GDestroyNotify notify);
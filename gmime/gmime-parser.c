@@ -34,6 +34,7 @@
 #include "gmime-parse-utils.h"
 #include "gmime-stream-null.h"
 #include "gmime-stream-mem.h"
+#include "gmime-stream-spill.h"
 #include "gmime-multipart.h"
 #include "gmime-internal.h"
 #include "gmime-common.h"
@@ -73,12 +74,19 @@ typedef enum {
 
 typedef struct _boundary_stack {
 	struct _boundary_stack *parent;
+	struct _boundary_stack *next;   /* next boundary in the same hash bucket */
 	char *boundary;
 	size_t boundarylen;
 	size_t boundarylenfinal;
 	size_t boundarylenmax;
+	gboolean hashed;
+	guint hash;
+	int depth;
 } BoundaryStack;
 
+/* number of buckets in the boundary hash table (must be a power of 2) */
+#define BOUNDARY_TABLE_SIZE 256
+
 typedef struct {
 	char *raw_name, *name;
 	char *raw_value;
@@ -90,6 +98,19 @@ typedef struct _content_type {
 	gboolean exists;
 } ContentType;
 
+typedef enum {
+	HEADER_MATCH_EXACT,
+	HEADER_MATCH_PREFIX,
+	HEADER_MATCH_SUFFIX,
+	HEADER_MATCH_SUBSTRING
+} HeaderMatchType;
+
+typedef struct {
+	HeaderMatchType type;
+	size_t len;
+	char *name;
+} HeaderMatch;
+
 static void g_mime_parser_class_init (GMimeParserClass *klass);
 static void g_mime_parser_init (GMimeParser *parser, GMimeParserClass *klass);
 static void g_mime_parser_finalize (GObject *object);
@@ -97,6 +118,8 @@ static void g_mime_parser_finalize (GObject *object);
 static void parser_init (GMimeParser *parser, GMimeStream *stream);
 static void parser_close (GMimeParser *parser);
 
+static void header_matcher_clear (struct _GMimeParserPrivate *priv);
+
 static GMimeObject *parser_construct_leaf_part (GMimeParser *parser, GMimeParserOptions *options, ContentType *content_type,
 						gboolean toplevel, int depth);
 static GMimeObject *parser_construct_multipart (GMimeParser *parser, GMimeParserOptions *options, ContentType *content_type,
@@ -130,6 +153,7 @@ struct _GMimeParserPrivate {
 	GMimeStream *stream;
 	GMimeFormat format;
 	
+	gint64 content_length;
 	gint64 content_end;
 	gint64 offset;
 	
@@ -141,8 +165,16 @@ struct _GMimeParserPrivate {
 	
 	GMimeParserHeaderRegexFunc header_cb;
 	gpointer user_data;
+	GArray *matches;
 	GRegex *regex;
 	
+	/* content checksums (see g_mime_parser_set_content_checksum()) */
+	GMimeParserContentChecksumFunc checksum_cb;
+	GMimeFilterChecksum *checksum;
+	gpointer checksum_data;
+	char checksum_held[2];
+	size_t checksum_nheld;
+	
 	GByteArray *marker;
 	gint64 marker_offset;
 	
@@ -169,15 +201,54 @@ struct _GMimeParserPrivate {
 	BoundaryStack *bounds;
 	BoundaryType boundary;
 	
+	/* MIME boundaries hashed by their text (sans the leading "--") */
+	BoundaryStack **bounds_table;
+	guint bounds_unhashed;
+	
 	GMimeOpenPGPState openpgp;
 	short int state;
 	
+	/* buffered content larger than this spills to disk (0 = never) */
+	size_t spill_threshold;
+	
 	unsigned short int toplevel:1;
 	unsigned short int seekable:1;
 	unsigned short int have_regex:1;
 	unsigned short int persist_stream:1;
 	unsigned short int respect_content_length:1;
-	unsigned short int unused:11;
+	unsigned short int trust_content_length:1;
+	unsigned short int feed_finished:1;
+	unsigned short int feed:1;
+	unsigned short int header_truncated:1;
+	unsigned short int collect_stats:1;
+	unsigned short int checksumming:1;
+	unsigned short int message_body:1;
+	unsigned short int unused:4;
+	
+	/* buffered feed state (see g_mime_parser_feed()) */
+	gint64 feed_base;
+	gint64 feed_line;
+	guint feed_markers;
+	guint feed_constructed;
+	
+	/* resource limits for the message being parsed (see GMimeParserOptions) */
+	gint64 max_content_size;
+	gint64 content_size;
+	gint64 deadline;
+	size_t max_header_size;
+	guint headers_dropped;
+	guint max_headers;
+	guint max_parts;
+	guint nparts;
+	int max_depth;
+	
+	/* the GMimeParserWarning for the limit that stopped the parser */
+	guint exceeded;
+	
+	/* statistics for the most recent construct_*() call */
+	GMimeParserStats stats;
+	size_t stats_buffered;
+	gint64 stats_start;
 };
 
 static const char MBOX_BOUNDARY[6] = "From ";
@@ -186,17 +257,33 @@ static const char MBOX_BOUNDARY[6] = "From ";
 static const char MMDF_BOUNDARY[6] = "\1\1\1\1";
 #define MMDF_BOUNDARY_LEN 4
 
+static guint
+boundary_hash (const char *text, size_t len)
+{
+	const char *inend = text + len;
+	guint hash = 5381;
+	
+	while (text < inend)
+		hash = (hash << 5) + hash + (unsigned char) *text++;
+	
+	return hash;
+}
+
 static void
 parser_push_boundary (GMimeParser *parser, const char *boundary)
 {
 	struct _GMimeParserPrivate *priv = parser->priv;
-	BoundaryStack *s;
+	BoundaryStack *s, **bucket;
 	size_t max;
 	
 	max = priv->bounds ? priv->bounds->boundarylenmax : 0;
 	
 	s = g_slice_new (BoundaryStack);
+	s->depth = priv->bounds ? priv->bounds->depth + 1 : 0;
 	s->parent = priv->bounds;
+	s->hashed = FALSE;
+	s->next = NULL;
+	s->hash = 0;
 	priv->bounds = s;
 	
 	if (boundary == MBOX_BOUNDARY) {
@@ -211,6 +298,23 @@ parser_push_boundary (GMimeParser *parser, const char *boundary)
 		s->boundary = g_strdup_printf ("--%s--", boundary);
 		s->boundarylen = strlen (boundary) + 2;
 		s->boundarylenfinal = s->boundarylen + 2;
+		
+		if (s->boundarylen > 2 && is_lwsp (s->boundary[s->boundarylen - 1])) {
+			/* the hash lookup trims trailing lwsp from the candidate line, so
+			 * boundaries that end with lwsp have to be matched the slow way */
+			priv->bounds_unhashed++;
+		} else {
+			if (priv->bounds_table == NULL)
+				priv->bounds_table = g_new0 (BoundaryStack *, BOUNDARY_TABLE_SIZE);
+			
+			/* push onto the front of the bucket so that the innermost
+			 * multipart shadows any parent using the same boundary */
+			s->hash = boundary_hash (boundary, s->boundarylen - 2);
+			s->hashed = TRUE;
+			bucket = &priv->bounds_table[s->hash & (BOUNDARY_TABLE_SIZE - 1)];
+			s->next = *bucket;
+			*bucket = s;
+		}
 	}
 	
 	s->boundarylenmax = MAX (s->boundarylenfinal, max);
@@ -230,6 +334,13 @@ parser_pop_boundary (GMimeParser *parser)
 	s = priv->bounds;
 	priv->bounds = priv->bounds->parent;
 	
+	if (s->hashed) {
+		/* boundaries are popped in LIFO order, so @s is always at the front of its bucket */
+		priv->bounds_table[s->hash & (BOUNDARY_TABLE_SIZE - 1)] = s->next;
+	} else if (s->boundarylen != s->boundarylenfinal) {
+		priv->bounds_unhashed--;
+	}
+	
 	g_free (s->boundary);
 	
 	g_slice_free (BoundaryStack, s);
@@ -318,10 +429,18 @@ g_mime_parser_init (GMimeParser *parser, GMimeParserClass *klass)
 {
 	parser->priv = g_new (struct _GMimeParserPrivate, 1);
 	parser->priv->respect_content_length = FALSE;
+	parser->priv->trust_content_length = FALSE;
 	parser->priv->format = GMIME_FORMAT_MESSAGE;
 	parser->priv->persist_stream = TRUE;
+	parser->priv->collect_stats = FALSE;
+	parser->priv->spill_threshold = 0;
 	parser->priv->have_regex = FALSE;
+	parser->priv->matches = NULL;
 	parser->priv->regex = NULL;
+	parser->priv->checksum_cb = NULL;
+	parser->priv->checksum = NULL;
+	parser->priv->checksumming = FALSE;
+	parser->priv->bounds_table = NULL;
 	
 	parser_init (parser, NULL);
 }
@@ -333,9 +452,12 @@ g_mime_parser_finalize (GObject *object)
 	
 	parser_close (parser);
 	
-	if (parser->priv->regex)
-		g_regex_unref (parser->priv->regex);
+	header_matcher_clear (parser->priv);
 	
+	if (parser->priv->checksum)
+		g_object_unref (parser->priv->checksum);
+	
+	g_free (parser->priv->bounds_table);
 	g_free (parser->priv);
 	
 	G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -357,6 +479,7 @@ parser_init (GMimeParser *parser, GMimeStream *stream)
 	
 	priv->stream = stream;
 	
+	priv->content_length = -1;
 	priv->content_end = 0;
 	priv->offset = offset;
 	
@@ -387,9 +510,62 @@ parser_init (GMimeParser *parser, GMimeStream *stream)
 	priv->boundary = BOUNDARY_NONE;
 	
 	priv->toplevel = FALSE;
+	priv->message_body = FALSE;
 	priv->seekable = offset != -1;
 	
 	priv->bounds = NULL;
+	priv->bounds_unhashed = 0;
+	
+	priv->feed_finished = FALSE;
+	priv->feed = FALSE;
+	
+	priv->feed_base = 0;
+	priv->feed_line = 0;
+	priv->feed_markers = 0;
+	priv->feed_constructed = 0;
+	
+	priv->header_truncated = FALSE;
+	priv->headers_dropped = 0;
+	priv->max_depth = MAX_LEVEL;
+	priv->exceeded = 0;
+}
+
+static void
+parser_set_limits (struct _GMimeParserPrivate *priv, GMimeParserOptions *options)
+{
+	guint max_depth = g_mime_parser_options_get_max_depth (options);
+	guint msec = g_mime_parser_options_get_max_parse_time (options);
+	
+	priv->max_content_size = g_mime_parser_options_get_max_content_size (options);
+	priv->max_header_size = g_mime_parser_options_get_max_header_size (options);
+	priv->max_headers = g_mime_parser_options_get_max_headers (options);
+	priv->max_parts = g_mime_parser_options_get_max_parts (options);
+	priv->max_depth = max_depth > 0 && max_depth < MAX_LEVEL ? (int) max_depth : MAX_LEVEL;
+	priv->deadline = msec > 0 ? g_get_monotonic_time () + (gint64) msec * 1000 : 0;
+	priv->content_size = 0;
+	priv->exceeded = 0;
+	priv->nparts = 0;
+}
+
+static void
+parser_stats_begin (struct _GMimeParserPrivate *priv)
+{
+	memset (&priv->stats, 0, sizeof (priv->stats));
+	priv->stats_buffered = priv->inend - priv->inptr;
+	priv->stats_start = priv->collect_stats ? g_get_monotonic_time () : 0;
+}
+
+static void
+parser_stats_end (struct _GMimeParserPrivate *priv)
+{
+	/* bytes_scanned has accumulated the bytes read, so account for the read-ahead buffer */
+	priv->stats.bytes_scanned += (gint64) priv->stats_buffered - (priv->inend - priv->inptr);
+	priv->stats.parts = priv->nparts;
+	
+	if (priv->collect_stats) {
+		priv->stats.construct_usec = g_get_monotonic_time () - priv->stats_start;
+		priv->stats.construct_usec -= priv->stats.header_usec + priv->stats.content_usec;
+	}
 }
 
 static void
@@ -478,6 +654,154 @@ g_mime_parser_init_with_stream (GMimeParser *parser, GMimeStream *stream)
 }
 
 
+static gboolean
+parser_feed_ready (struct _GMimeParserPrivate *priv)
+{
+	guint complete;
+	
+	if (priv->feed_finished)
+		return TRUE;
+	
+	switch (priv->format) {
+	case GMIME_FORMAT_MBOX:
+		/* a message is complete once the next From-line has arrived */
+		complete = priv->feed_markers > 0 ? priv->feed_markers - 1 : 0;
+		break;
+	case GMIME_FORMAT_MMDF:
+		/* each message is both preceded and followed by a marker */
+		complete = priv->feed_markers / 2;
+		break;
+	default:
+		/* a lone message or part is only complete at the end of the input */
+		return FALSE;
+	}
+	
+	return complete > priv->feed_constructed;
+}
+
+static void
+parser_feed_scan (struct _GMimeParserPrivate *priv, GByteArray *buffer)
+{
+	const char *inptr = (const char *) buffer->data + priv->feed_line;
+	const char *inend = (const char *) buffer->data + buffer->len;
+	const char *marker;
+	const char *eoln;
+	size_t mlen;
+	
+	switch (priv->format) {
+	case GMIME_FORMAT_MBOX: marker = MBOX_BOUNDARY; mlen = MBOX_BOUNDARY_LEN; break;
+	case GMIME_FORMAT_MMDF: marker = MMDF_BOUNDARY; mlen = MMDF_BOUNDARY_LEN; break;
+	default: return;
+	}
+	
+	/* Content-Length may hide From-lines in the body, so only trust the end of the input */
+	if (priv->format == GMIME_FORMAT_MBOX && priv->respect_content_length)
+		return;
+	
+	/* only count markers on complete lines so that the parser never sees a partial one */
+	while ((eoln = memchr (inptr, '\n', inend - inptr))) {
+		if ((size_t) (eoln - inptr) >= mlen && !strncmp (inptr, marker, mlen))
+			priv->feed_markers++;
+		
+		inptr = eoln + 1;
+	}
+	
+	priv->feed_line = inptr - (const char *) buffer->data;
+}
+
+
+/**
+ * g_mime_parser_feed:
+ * @parser: a #GMimeParser context
+ * @buffer: (array length=length) (nullable): the next chunk of raw input
+ * @length: the number of bytes in @buffer
+ *
+ * Appends the next chunk of raw input to the buffer of @parser,
+ * switching @parser into buffered feed mode if this is the first
+ * chunk. This never blocks, so a single thread can accept input for
+ * many parsers as it arrives (e.g. from the DATA command of an SMTP or
+ * LMTP session).
+ *
+ * Note: this is a buffered interface, not an incremental parser.
+ * Feeding input does not parse any of it; it only keeps track of
+ * whether the buffer holds a complete message. The message is then
+ * parsed in one go by g_mime_parser_construct_message(), which returns
+ * %NULL until that is the case. In #GMIME_FORMAT_MBOX or
+ * #GMIME_FORMAT_MMDF mode, each message is complete as soon as the
+ * marker following it has been fed; otherwise, the lone message (or
+ * part) is only complete after g_mime_parser_finish(), so its input is
+ * buffered in full until then and callers should enforce their own
+ * size limit (e.g. the SMTP SIZE).
+ *
+ * The input of each message is dropped once it has been constructed,
+ * unless the stream is persistent, in which case it is kept for as
+ * long as the objects constructed from it reference it.
+ *
+ * Returns: %TRUE if a complete message is ready to be constructed or
+ * %FALSE if more input is needed.
+ **/
+gboolean
+g_mime_parser_feed (GMimeParser *parser, const char *buffer, size_t length)
+{
+	struct _GMimeParserPrivate *priv;
+	GByteArray *array;
+	GMimeStream *stream;
+	
+	g_return_val_if_fail (GMIME_IS_PARSER (parser), FALSE);
+	g_return_val_if_fail (buffer != NULL || length == 0, FALSE);
+	
+	priv = parser->priv;
+	
+	g_return_val_if_fail (priv->stream == NULL || priv->feed, FALSE);
+	g_return_val_if_fail (!priv->feed_finished, TRUE);
+	
+	if (!priv->feed) {
+		stream = g_mime_stream_mem_new ();
+		parser_close (parser);
+		parser_init (parser, stream);
+		g_object_unref (stream);
+		priv->feed = TRUE;
+	}
+	
+	/* append without moving the stream position that the parser reads from */
+	array = g_mime_stream_mem_get_byte_array ((GMimeStreamMem *) priv->stream);
+	g_byte_array_append (array, (const guint8 *) buffer, length);
+	
+	parser_feed_scan (priv, array);
+	
+	return parser_feed_ready (priv);
+}
+
+
+/**
+ * g_mime_parser_finish:
+ * @parser: a #GMimeParser context
+ *
+ * Signals the end of the input fed to @parser with g_mime_parser_feed().
+ * Any remaining messages can then be constructed until
+ * g_mime_parser_eos() returns %TRUE.
+ *
+ * Returns: %TRUE if a message is ready to be constructed or %FALSE if
+ * all of the input has already been consumed.
+ **/
+gboolean
+g_mime_parser_finish (GMimeParser *parser)
+{
+	struct _GMimeParserPrivate *priv;
+	
+	g_return_val_if_fail (GMIME_IS_PARSER (parser), FALSE);
+	
+	priv = parser->priv;
+	
+	if (!priv->feed)
+		return FALSE;
+	
+	priv->feed_finished = TRUE;
+	
+	return !g_mime_parser_eos (parser);
+}
+
+
 /**
  * g_mime_parser_get_persist_stream:
  * @parser: a #GMimeParser context
@@ -525,6 +849,51 @@ g_mime_parser_set_persist_stream (GMimeParser *parser, gboolean persist)
 }
 
 
+/**
+ * g_mime_parser_get_spill_threshold:
+ * @parser: a #GMimeParser context
+ *
+ * Gets the number of bytes of MIME part content that @parser will
+ * buffer in memory before spilling it to a temporary file.
+ *
+ * Returns: the spill threshold or %0 if content is always kept in
+ * memory.
+ **/
+size_t
+g_mime_parser_get_spill_threshold (GMimeParser *parser)
+{
+	g_return_val_if_fail (GMIME_IS_PARSER (parser), 0);
+	
+	return parser->priv->spill_threshold;
+}
+
+
+/**
+ * g_mime_parser_set_spill_threshold:
+ * @parser: a #GMimeParser context
+ * @threshold: the number of bytes to buffer in memory or %0 for no limit
+ *
+ * Sets the number of bytes of MIME part content that @parser will
+ * buffer in memory before spilling it to an anonymous temporary file.
+ *
+ * This only applies to content that the @parser has to load because
+ * the underlying stream is not persistent (see
+ * g_mime_parser_set_persist_stream()), such as when parsing from a
+ * pipe or a socket. When set, such content is loaded into a
+ * #GMimeStreamSpill instead of a #GMimeStreamMem so that the amount
+ * of memory used by a message with large attachments stays bounded.
+ *
+ * By default, the threshold is %0 and all content is kept in memory.
+ **/
+void
+g_mime_parser_set_spill_threshold (GMimeParser *parser, size_t threshold)
+{
+	g_return_if_fail (GMIME_IS_PARSER (parser));
+	
+	parser->priv->spill_threshold = threshold;
+}
+
+
 /**
  * g_mime_parser_get_format:
  * @parser: a #GMimeParser context
@@ -596,7 +965,333 @@ g_mime_parser_set_respect_content_length (GMimeParser *parser, gboolean respect_
 {
 	g_return_if_fail (GMIME_IS_PARSER (parser));
 	
-	parser->priv->respect_content_length = respect_content_length ? 1 : 0;
+	parser->priv->respect_content_length = respect_content_length ? 1 : 0;
+}
+
+
+/**
+ * g_mime_parser_get_trust_content_length:
+ * @parser: a #GMimeParser context
+ *
+ * Gets whether or not @parser trusts Content-Length headers enough to
+ * skip over message bodies without scanning them.
+ *
+ * Returns: %TRUE if @parser trusts Content-Length headers or %FALSE
+ * otherwise.
+ **/
+gboolean
+g_mime_parser_get_trust_content_length (GMimeParser *parser)
+{
+	g_return_val_if_fail (GMIME_IS_PARSER (parser), FALSE);
+	
+	return parser->priv->trust_content_length;
+}
+
+
+/**
+ * g_mime_parser_set_trust_content_length:
+ * @parser: a #GMimeParser context
+ * @trust_content_length: %TRUE if the parser should skip message bodies using their Content-Length or %FALSE otherwise.
+ *
+ * Sets whether or not @parser should trust Content-Length headers
+ * enough to take the body of a message without scanning it. Only
+ * used when the parser is set to scan for From-lines, is set to
+ * respect Content-Length headers and the stream is seekable.
+ *
+ * When enabled, the parser validates the Content-Length of each
+ * non-multipart message by seeking to the end of the body and checking
+ * that it is followed by the end of the stream or (optionally after a
+ * blank line) the From-line of the next message. If it is, the body is
+ * taken as a substream (or read in one go if the stream is not being
+ * persisted) without scanning any of it; if it is not, the parser
+ * falls back to scanning the body as usual. A body of 4 GiB or more is
+ * always taken as a substream unless a spill threshold is set, since it
+ * cannot be held in memory.
+ *
+ * Since the body is never scanned, the OpenPGP state of such parts is
+ * determined lazily by g_mime_part_get_openpgp_data().
+ *
+ * By default, this feature is disabled.
+ **/
+void
+g_mime_parser_set_trust_content_length (GMimeParser *parser, gboolean trust_content_length)
+{
+	g_return_if_fail (GMIME_IS_PARSER (parser));
+	
+	parser->priv->trust_content_length = trust_content_length ? 1 : 0;
+}
+
+
+/**
+ * g_mime_parser_get_collect_stats:
+ * @parser: a #GMimeParser context
+ *
+ * Gets whether or not @parser collects timing statistics.
+ *
+ * Returns: %TRUE if @parser collects statistics or %FALSE otherwise.
+ **/
+gboolean
+g_mime_parser_get_collect_stats (GMimeParser *parser)
+{
+	g_return_val_if_fail (GMIME_IS_PARSER (parser), FALSE);
+	
+	return parser->priv->collect_stats;
+}
+
+
+/**
+ * g_mime_parser_set_collect_stats:
+ * @parser: a #GMimeParser context
+ * @collect: %TRUE if the parser should collect statistics
+ *
+ * Sets whether or not @parser should collect statistics about each
+ * message or part that it constructs. The counters are cheap, but
+ * the per-phase timings require reading the monotonic clock several
+ * times per MIME part, so statistics are disabled by default.
+ **/
+void
+g_mime_parser_set_collect_stats (GMimeParser *parser, gboolean collect)
+{
+	g_return_if_fail (GMIME_IS_PARSER (parser));
+	
+	parser->priv->collect_stats = collect ? 1 : 0;
+}
+
+
+/**
+ * g_mime_parser_get_stats:
+ * @parser: a #GMimeParser context
+ *
+ * Gets the statistics for the most recent g_mime_parser_construct_message()
+ * or g_mime_parser_construct_part() call. This can be used to find out
+ * which messages are expensive to parse and why.
+ *
+ * Returns: (nullable): the statistics for the most recently constructed
+ * message or part or %NULL if @parser is not collecting statistics.
+ **/
+const GMimeParserStats *
+g_mime_parser_get_stats (GMimeParser *parser)
+{
+	g_return_val_if_fail (GMIME_IS_PARSER (parser), NULL);
+	
+	return parser->priv->collect_stats ? &parser->priv->stats : NULL;
+}
+
+
+/* Note: the header regex is compiled with G_REGEX_EXTENDED, so unescaped
+ * whitespace is insignificant and '#' begins a comment. */
+#define is_regex_space(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n' || (c) == '\f' || (c) == '\v')
+
+static const char *
+regex_skip_space (const char *inptr)
+{
+	while (is_regex_space (*inptr))
+		inptr++;
+	
+	return inptr;
+}
+
+static gboolean
+regex_parse_literal (const char **in, GString *literal)
+{
+	const char *inptr = *in;
+	
+	g_string_truncate (literal, 0);
+	
+	while (*inptr) {
+		if (is_regex_space (*inptr)) {
+			inptr++;
+		} else if (*inptr == '\\') {
+			/* a backslash followed by a non-alphanumeric character is always a literal */
+			if (inptr[1] <= 0x20 || inptr[1] >= 0x7f || g_ascii_isalnum (inptr[1]))
+				return FALSE;
+			
+			g_string_append_c (literal, inptr[1]);
+			inptr += 2;
+		} else if (*inptr > 0x20 && *inptr < 0x7f && !strchr ("^$.|?*+()[]{}#", *inptr)) {
+			g_string_append_c (literal, *inptr);
+			inptr++;
+		} else {
+			break;
+		}
+	}
+	
+	*in = inptr;
+	
+	return literal->len > 0;
+}
+
+static void
+header_matcher_add (GArray *matches, GString *literal, gboolean bol)
+{
+	HeaderMatch match;
+	
+	match.type = bol ? HEADER_MATCH_PREFIX : HEADER_MATCH_SUBSTRING;
+	
+	match.name = g_strndup (literal->str, literal->len);
+	match.len = literal->len;
+	
+	g_array_append_val (matches, match);
+}
+
+/* Attempts to convert @pattern into a list of literal header-name
+ * matches. Only alternations of (optionally anchored) literals are
+ * handled, e.g. "^(Subject|From)$", "^X-" or "^X-Foo.*|^Date$";
+ * anything else is left for GRegex to deal with. */
+static gboolean
+header_matcher_parse (const char *pattern, GArray *matches)
+{
+	const char *inptr = pattern;
+	GString *literal;
+	guint first, i;
+	
+	literal = g_string_new ("");
+	
+	do {
+		gboolean bol = FALSE, eol = FALSE;
+		
+		inptr = regex_skip_space (inptr);
+		if (*inptr == '^') {
+			inptr = regex_skip_space (inptr + 1);
+			bol = TRUE;
+		}
+		
+		if (inptr[0] == '.' && inptr[1] == '*') {
+			inptr = regex_skip_space (inptr + 2);
+			bol = FALSE;
+		}
+		
+		first = matches->len;
+		
+		if (*inptr == '(') {
+			inptr = regex_skip_space (inptr + 1);
+			if (inptr[0] == '?' && inptr[1] == ':')
+				inptr += 2;
+			
+			while (TRUE) {
+				if (!regex_parse_literal (&inptr, literal))
+					goto fail;
+				
+				header_matcher_add (matches, literal, bol);
+				
+				if (*inptr != '|')
+					break;
+				
+				inptr++;
+			}
+			
+			if (*inptr != ')')
+				goto fail;
+			
+			inptr = regex_skip_space (inptr + 1);
+		} else {
+			if (!regex_parse_literal (&inptr, literal))
+				goto fail;
+			
+			header_matcher_add (matches, literal, bol);
+		}
+		
+		if (inptr[0] == '.' && inptr[1] == '*') {
+			inptr = regex_skip_space (inptr + 2);
+			if (*inptr == '$')
+				inptr = regex_skip_space (inptr + 1);
+		} else if (*inptr == '$') {
+			inptr = regex_skip_space (inptr + 1);
+			eol = TRUE;
+		}
+		
+		if (eol) {
+			/* apply the end-of-line anchor to each of the literals in this branch */
+			for (i = first; i < matches->len; i++) {
+				HeaderMatch *match = &g_array_index (matches, HeaderMatch, i);
+				
+				match->type = match->type == HEADER_MATCH_PREFIX ? HEADER_MATCH_EXACT : HEADER_MATCH_SUFFIX;
+			}
+		}
+		
+		if (*inptr != '|')
+			break;
+		
+		inptr++;
+	} while (TRUE);
+	
+	if (*inptr != '\0')
+		goto fail;
+	
+	g_string_free (literal, TRUE);
+	
+	return TRUE;
+	
+ fail:
+	for (i = 0; i < matches->len; i++)
+		g_free (g_array_index (matches, HeaderMatch, i).name);
+	g_array_set_size (matches, 0);
+	g_string_free (literal, TRUE);
+	
+	return FALSE;
+}
+
+static gboolean
+header_match (const HeaderMatch *match, const char *name, size_t len)
+{
+	size_t i;
+	
+	if (len < match->len)
+		return FALSE;
+	
+	switch (match->type) {
+	case HEADER_MATCH_EXACT:
+		return len == match->len && !g_ascii_strncasecmp (name, match->name, len);
+	case HEADER_MATCH_PREFIX:
+		return !g_ascii_strncasecmp (name, match->name, match->len);
+	case HEADER_MATCH_SUFFIX:
+		return !g_ascii_strncasecmp (name + (len - match->len), match->name, match->len);
+	case HEADER_MATCH_SUBSTRING:
+		for (i = 0; i <= len - match->len; i++) {
+			if (!g_ascii_strncasecmp (name + i, match->name, match->len))
+				return TRUE;
+		}
+		break;
+	}
+	
+	return FALSE;
+}
+
+static gboolean
+header_matcher_match (struct _GMimeParserPrivate *priv, const char *name, size_t len)
+{
+	guint i;
+	
+	if (priv->regex)
+		return g_regex_match (priv->regex, name, 0, NULL);
+	
+	for (i = 0; i < priv->matches->len; i++) {
+		if (header_match (&g_array_index (priv->matches, HeaderMatch, i), name, len))
+			return TRUE;
+	}
+	
+	return FALSE;
+}
+
+static void
+header_matcher_clear (struct _GMimeParserPrivate *priv)
+{
+	guint i;
+	
+	if (priv->regex) {
+		g_regex_unref (priv->regex);
+		priv->regex = NULL;
+	}
+	
+	if (priv->matches) {
+		for (i = 0; i < priv->matches->len; i++)
+			g_free (g_array_index (priv->matches, HeaderMatch, i).name);
+		
+		g_array_free (priv->matches, TRUE);
+		priv->matches = NULL;
+	}
+	
+	priv->have_regex = FALSE;
 }
 
 
@@ -613,21 +1308,26 @@ g_mime_parser_set_respect_content_length (GMimeParser *parser, gboolean respect_
  *
  * If @regex is %NULL, then the previously registered regex callback
  * is unregistered and no new callback is set.
+ *
+ * Note: Patterns that consist only of literal header names, optionally
+ * anchored with '^' and/or '$' and combined using '|' (e.g.
+ * "^(Subject|From)$" or "^X-"), are matched directly without the
+ * overhead of the regular expression engine. All other patterns are
+ * compiled with #G_REGEX_OPTIMIZE which allows GLib to JIT-compile
+ * them when supported by PCRE.
  **/
 void
 g_mime_parser_set_header_regex (GMimeParser *parser, const char *regex,
 				GMimeParserHeaderRegexFunc header_cb, gpointer user_data)
 {
 	struct _GMimeParserPrivate *priv;
+	GArray *matches;
 	
 	g_return_if_fail (GMIME_IS_PARSER (parser));
 	
 	priv = parser->priv;
 	
-	if (priv->regex) {
-		g_regex_unref (priv->regex);
-		priv->regex = NULL;
-	}
+	header_matcher_clear (priv);
 	
 	if (!regex || !header_cb)
 		return;
@@ -635,7 +1335,17 @@ g_mime_parser_set_header_regex (GMimeParser *parser, const char *regex,
 	priv->header_cb = header_cb;
 	priv->user_data = user_data;
 	
-	priv->regex = g_regex_new (regex, G_REGEX_RAW | G_REGEX_EXTENDED | G_REGEX_CASELESS, 0, NULL);
+	matches = g_array_new (FALSE, FALSE, sizeof (HeaderMatch));
+	
+	if (header_matcher_parse (regex, matches)) {
+		priv->matches = matches;
+	} else {
+		g_array_free (matches, TRUE);
+		
+		priv->regex = g_regex_new (regex, G_REGEX_RAW | G_REGEX_EXTENDED | G_REGEX_CASELESS | G_REGEX_OPTIMIZE, 0, NULL);
+	}
+	
+	priv->have_regex = priv->matches != NULL || priv->regex != NULL;
 }
 
 
@@ -679,7 +1389,17 @@ parser_fill (GMimeParser *parser, size_t atleast)
 	priv->inend = inbuf;
 	inend = priv->realbuf + SCAN_HEAD + SCAN_BUF;
 	
+	if (priv->deadline > 0 && !priv->exceeded && g_get_monotonic_time () > priv->deadline)
+		priv->exceeded = GMIME_CRIT_TIME_LIMIT_EXCEEDED;
+	
+	/* once a limit has been exceeded, act as if we've reached the end of the stream */
+	if (priv->exceeded)
+		return (ssize_t) (priv->inend - priv->inptr);
+	
+	priv->stats.refills++;
+	
 	if ((nread = g_mime_stream_read (priv->stream, inbuf, inend - inbuf)) > 0) {
+		priv->stats.bytes_scanned += nread;
 		priv->offset += nread;
 		priv->inend += nread;
 	}
@@ -736,6 +1456,16 @@ g_mime_parser_eos (GMimeParser *parser)
 	g_return_val_if_fail (GMIME_IS_STREAM (parser->priv->stream), TRUE);
 	
 	priv = parser->priv;
+	
+	/* the parser will not read any further once a limit stopped it, but
+	 * the next message in an mbox (or MMDF spool) can still be parsed */
+	if (priv->exceeded && priv->format != GMIME_FORMAT_MBOX && priv->format != GMIME_FORMAT_MMDF)
+		return TRUE;
+	
+	/* more data may still be fed to the parser */
+	if (priv->feed && !priv->feed_finished)
+		return FALSE;
+	
 	return g_mime_stream_eos (priv->stream) && priv->inptr == priv->inend;
 }
 
@@ -863,6 +1593,74 @@ is_boundary (struct _GMimeParserPrivate *priv, const char *text, size_t len, con
 	return TRUE;
 }
 
+static BoundaryStack *
+lookup_boundary (struct _GMimeParserPrivate *priv, const char *token, size_t len)
+{
+	guint hash = boundary_hash (token, len);
+	BoundaryStack *s;
+	
+	s = priv->bounds_table[hash & (BOUNDARY_TABLE_SIZE - 1)];
+	while (s != NULL) {
+		if (s->hash == hash && s->boundarylen - 2 == len && !memcmp (s->boundary + 2, token, len))
+			return s;
+		
+		s = s->next;
+	}
+	
+	return NULL;
+}
+
+/* Looks up a "--" line in the boundary hash table instead of walking the
+ * whole boundary stack, which is O(depth) strncmp()s for every line. */
+static BoundaryType
+check_boundary_hashed (struct _GMimeParserPrivate *priv, const char *start, size_t len, gint64 offset)
+{
+	const char *inend = start + len;
+	BoundaryStack *bounds, *end;
+	const char *token;
+	
+	/* the boundary may be optionally followed by linear whitespace */
+	while (inend > start + 2 && is_lwsp (inend[-1]))
+		inend--;
+	
+	token = start + 2;
+	len = inend - token;
+	
+	bounds = lookup_boundary (priv, token, len);
+	
+	if (len >= 2 && inend[-1] == '-' && inend[-2] == '-')
+		end = lookup_boundary (priv, token, len - 2);
+	else
+		end = NULL;
+	
+	/* the innermost multipart wins if the line matches more than one level */
+	if (end != NULL && (bounds == NULL || end->depth > bounds->depth))
+		bounds = end;
+	else
+		end = NULL;
+	
+	if (bounds == NULL)
+		return BOUNDARY_NONE;
+	
+	if (priv->content_end > 0 && bounds->parent == NULL) {
+		/* the outermost boundary only matches past the end of the Content-Length */
+		if (end != NULL && offset >= priv->content_end) {
+			d(printf ("found end of content\n"));
+			return BOUNDARY_IMMEDIATE_END;
+		}
+		
+		return BOUNDARY_NONE;
+	}
+	
+	if (end != NULL) {
+		d(printf ("found end boundary\n"));
+		return bounds == priv->bounds ? BOUNDARY_IMMEDIATE_END : BOUNDARY_PARENT_END;
+	}
+	
+	d(printf ("found boundary\n"));
+	return bounds == priv->bounds ? BOUNDARY_IMMEDIATE : BOUNDARY_PARENT;
+}
+
 static BoundaryType
 check_boundary (struct _GMimeParserPrivate *priv, const char *start, size_t len)
 {
@@ -886,7 +1684,19 @@ check_boundary (struct _GMimeParserPrivate *priv, const char *start, size_t len)
 	
 	d(printf ("checking boundary '%.*s'\n", len, start));
 	
-	bounds = priv->bounds;
+	priv->stats.boundary_checks++;
+	
+	if (priv->bounds_table != NULL && priv->bounds_unhashed == 0 && start[0] == '-' && start[1] == '-') {
+		BoundaryType type;
+		
+		if ((type = check_boundary_hashed (priv, start, len, offset)) != BOUNDARY_NONE)
+			return type;
+		
+		bounds = NULL;
+	} else {
+		bounds = priv->bounds;
+	}
+	
 	while (bounds != NULL && (priv->content_end > 0 ? bounds->parent != NULL : TRUE)) {
 		if (is_boundary (priv, start, len, bounds->boundary, bounds->boundarylenfinal)) {
 			d(printf ("found end boundary\n"));
@@ -926,6 +1736,8 @@ check_boundary (struct _GMimeParserPrivate *priv, const char *start, size_t len)
 		}
 	}
 	
+	priv->stats.boundary_misses++;
+	
 	return BOUNDARY_NONE;
 }
 
@@ -956,11 +1768,22 @@ header_buffer_reset (struct _GMimeParserPrivate *priv)
 {
 	priv->headerleft += priv->headerptr - priv->headerbuf;
 	priv->headerptr = priv->headerbuf;
+	priv->header_truncated = FALSE;
 }
 
 static void
 header_buffer_append (struct _GMimeParserPrivate *priv, const char *start, size_t len)
 {
+	if (priv->max_header_size > 0) {
+		size_t hlen = priv->headerptr - priv->headerbuf;
+		
+		if (hlen + len > priv->max_header_size) {
+			/* truncate the header rather than growing the buffer without bound */
+			len = hlen < priv->max_header_size ? priv->max_header_size - hlen : 0;
+			priv->header_truncated = TRUE;
+		}
+	}
+	
 	if (priv->headerleft <= len) {
 		size_t hlen, hoff;
 		
@@ -982,9 +1805,11 @@ header_buffer_parse (GMimeParser *parser, GMimeParserOptions *options)
 {
 	gboolean can_warn = g_mime_parser_options_get_warning_callback (options) != NULL;
 	struct _GMimeParserPrivate *priv = parser->priv;
+	gboolean truncated = priv->header_truncated;
 	gboolean blank = FALSE;
 	register char *inptr;
 	Header *header;
+	size_t len;
 	
 	if (priv->headerptr == priv->headerbuf)
 		return;
@@ -1016,8 +1841,17 @@ header_buffer_parse (GMimeParser *parser, GMimeParserOptions *options)
 		return;
 	}
 	
+	if (priv->max_headers > 0 && priv->headers->len >= priv->max_headers) {
+		/* ignore any headers beyond the limit */
+		if (priv->headers_dropped++ == 0)
+			_g_mime_parser_options_warn (options, priv->header_offset, GMIME_CRIT_TOO_MANY_HEADERS, NULL);
+		header_buffer_reset (priv);
+		return;
+	}
+	
 	header = g_slice_new (Header);
 	g_ptr_array_add (priv->headers, header);
+	priv->stats.headers++;
 	
 	header->raw_name = g_strndup (priv->headerbuf, (size_t) (inptr - priv->headerbuf));
 	header->raw_value = g_strdup (inptr + 1);
@@ -1027,11 +1861,15 @@ header_buffer_parse (GMimeParser *parser, GMimeParserOptions *options)
 	while (inptr > priv->headerbuf && is_blank (inptr[-1]))
 		inptr--;
 	
-	header->name = g_strndup (priv->headerbuf, (size_t) (inptr - priv->headerbuf));
+	len = (size_t) (inptr - priv->headerbuf);
+	header->name = g_strndup (priv->headerbuf, len);
 	
 	header_buffer_reset (priv);
 	
-	if (priv->regex && g_regex_match (priv->regex, header->name, 0, NULL))
+	if (truncated)
+		_g_mime_parser_options_warn (options, header->offset, GMIME_CRIT_HEADER_TOO_LONG, header->name);
+	
+	if (priv->have_regex && header_matcher_match (priv, header->name, len))
 		priv->header_cb (parser, header->name, header->raw_value,
 				 header->offset, priv->user_data);
 	
@@ -1315,6 +2153,7 @@ parser_step_headers (GMimeParser *parser, GMimeParserOptions *options)
 	parser_free_headers (priv);
 	priv->headers_begin = parser_offset (priv, NULL);
 	priv->header_offset = priv->headers_begin;
+	priv->headers_dropped = 0;
 	priv->boundary = BOUNDARY_NONE;
 	
 	if (parser_fill (parser, SCAN_HEAD) <= 0) {
@@ -1475,7 +2314,14 @@ parser_step (GMimeParser *parser, GMimeParserOptions *options)
 		break;
 	case GMIME_PARSER_STATE_MESSAGE_HEADERS:
 	case GMIME_PARSER_STATE_HEADERS:
-		parser_step_headers (parser, options);
+		if (priv->collect_stats) {
+			gint64 start = g_get_monotonic_time ();
+			
+			parser_step_headers (parser, options);
+			priv->stats.header_usec += g_get_monotonic_time () - start;
+		} else {
+			parser_step_headers (parser, options);
+		}
 		priv->toplevel = FALSE;
 		
 		if (priv->message_headers_begin == -1) {
@@ -1518,6 +2364,32 @@ parser_step (GMimeParser *parser, GMimeParserOptions *options)
 /* we add 2 for \r\n */
 #define MAX_BOUNDARY_LEN(bounds) (bounds ? bounds->boundarylenmax + 2 : 0)
 
+/* Feeds the content to the content checksum, holding back the last 2
+ * bytes since the trailing newline may yet turn out to belong to the
+ * boundary. */
+static void
+parser_checksum_content (struct _GMimeParserPrivate *priv, const char *inbuf, size_t len)
+{
+	GMimeFilterChecksum *checksum = priv->checksum;
+	
+	if (len >= 2) {
+		if (priv->checksum_nheld > 0)
+			_g_mime_filter_checksum_update (checksum, (const unsigned char *) priv->checksum_held, priv->checksum_nheld);
+		
+		_g_mime_filter_checksum_update (checksum, (const unsigned char *) inbuf, len - 2);
+		memcpy (priv->checksum_held, inbuf + len - 2, 2);
+		priv->checksum_nheld = 2;
+	} else if (len == 1) {
+		if (priv->checksum_nheld == 2) {
+			_g_mime_filter_checksum_update (checksum, (const unsigned char *) priv->checksum_held, 1);
+			priv->checksum_held[0] = priv->checksum_held[1];
+			priv->checksum_nheld = 1;
+		}
+		
+		priv->checksum_held[priv->checksum_nheld++] = inbuf[0];
+	}
+}
+
 static void
 parser_scan_content (GMimeParser *parser, GMimeStream *content, gboolean *empty)
 {
@@ -1529,11 +2401,14 @@ parser_scan_content (GMimeParser *parser, GMimeStream *content, gboolean *empty)
 	unsigned int mask;
 	size_t nleft, len;
 	size_t atleast;
+	gint64 started;
 	gint64 pos;
 	char c;
 	
 	d(printf ("scan-content\n"));
 	
+	started = priv->collect_stats ? g_get_monotonic_time () : 0;
+	
 	priv->openpgp = GMIME_OPENPGP_NONE;
 	priv->boundary = BOUNDARY_NONE;
 	
@@ -1615,9 +2490,16 @@ parser_scan_content (GMimeParser *parser, GMimeStream *content, gboolean *empty)
 			}
 			
 			g_mime_stream_write (content, start, len);
+			priv->content_size += len;
+			
+			if (priv->checksumming)
+				parser_checksum_content (priv, start, len);
 		}
 		
 		priv->inptr = inptr;
+		
+		if (priv->max_content_size > 0 && priv->content_size > priv->max_content_size && !priv->exceeded)
+			priv->exceeded = GMIME_CRIT_CONTENT_TOO_LARGE;
 	} while (priv->boundary == BOUNDARY_NONE);
 	
  boundary:
@@ -1634,7 +2516,173 @@ parser_scan_content (GMimeParser *parser, GMimeStream *content, gboolean *empty)
 			g_mime_stream_seek (content, -2, GMIME_STREAM_SEEK_CUR);
 		else
 			g_mime_stream_seek (content, -1, GMIME_STREAM_SEEK_CUR);
+		
+		if (priv->checksumming) {
+			/* ...so leave it out of the content checksum as well */
+			len = inptr[-1] == '\r' ? 2 : 1;
+			priv->checksum_nheld -= MIN (len, priv->checksum_nheld);
+		}
+	}
+	
+	if (priv->checksumming && priv->checksum_nheld > 0) {
+		_g_mime_filter_checksum_update (priv->checksum, (const unsigned char *) priv->checksum_held, priv->checksum_nheld);
+		priv->checksum_nheld = 0;
+	}
+	
+	if (priv->collect_stats)
+		priv->stats.content_usec += g_get_monotonic_time () - started;
+}
+
+static gboolean
+parser_content_length_valid (struct _GMimeParserPrivate *priv, gint64 end, size_t *seplen, gboolean *eos)
+{
+	ssize_t nread = 0;
+	gint64 length;
+	size_t n = 0;
+	char buf[7];
+	
+	/* seeking past the end of a file succeeds, so make sure that the
+	 * content really extends all the way to @end */
+	if ((length = g_mime_stream_length (priv->stream)) != -1) {
+		if (end > priv->stream->bound_start + length)
+			return FALSE;
+	} else if (end > 0) {
+		if (g_mime_stream_seek (priv->stream, end - 1, GMIME_STREAM_SEEK_SET) != end - 1)
+			return FALSE;
+		
+		if (g_mime_stream_read (priv->stream, buf, 1) != 1)
+			return FALSE;
+	}
+	
+	if (g_mime_stream_seek (priv->stream, end, GMIME_STREAM_SEEK_SET) != end)
+		return FALSE;
+	
+	/* enough for "\r\nFrom " */
+	while (n < sizeof (buf) && (nread = g_mime_stream_read (priv->stream, buf + n, sizeof (buf) - n)) > 0)
+		n += nread;
+	
+	if (nread == -1)
+		return FALSE;
+	
+	if (n > 0 && buf[0] == '\n')
+		*seplen = 1;
+	else if (n > 1 && buf[0] == '\r' && buf[1] == '\n')
+		*seplen = 2;
+	else
+		*seplen = 0;
+	
+	if ((*eos = (n == *seplen)))
+		return TRUE;
+	
+	return n - *seplen >= 5 && !strncmp (buf + *seplen, "From ", 5);
+}
+
+/* Takes the body of an mbox message without scanning it if its
+ * Content-Length checks out (see g_mime_parser_set_trust_content_length()). */
+static gboolean
+parser_take_trusted_content (GMimeParser *parser, GMimeStream **content)
+{
+	struct _GMimeParserPrivate *priv = parser->priv;
+	gint64 start, end, length;
+	GByteArray *buffer;
+	size_t buffered;
+	gboolean eos;
+	size_t seplen;
+	ssize_t nread;
+	gint64 n;
+	
+	if (!priv->trust_content_length || priv->content_length < 0 || !priv->seekable || priv->feed)
+		return FALSE;
+	
+	/* the content checksum needs the content to be scanned */
+	if (priv->checksum != NULL)
+		return FALSE;
+	
+	/* only the body of the message itself, not a part within a multipart
+	 * or the body of an embedded message */
+	if (!priv->message_body || priv->bounds == NULL)
+		return FALSE;
+	
+	start = parser_offset (priv, NULL);
+	length = priv->content_length;
+	end = start + length;
+	
+	/* let the scanner enforce (and warn about) the content size limit */
+	if (priv->max_content_size > 0 && length > priv->max_content_size)
+		return FALSE;
+	
+	if (!parser_content_length_valid (priv, end, &seplen, &eos)) {
+		/* put the stream back where the parser left it and scan instead */
+		g_mime_stream_seek (priv->stream, priv->offset, GMIME_STREAM_SEEK_SET);
+		return FALSE;
+	}
+	
+	if (priv->persist_stream || (priv->spill_threshold == 0 && length > G_MAXUINT)) {
+		/* content too large for a GByteArray is left on the stream */
+		*content = g_mime_stream_substream (priv->stream, start, end);
+	} else if (priv->spill_threshold > 0) {
+		*content = g_mime_stream_spill_new_with_threshold (priv->spill_threshold);
+		
+		buffered = (size_t) MIN ((gint64) (priv->inend - priv->inptr), length);
+		n = g_mime_stream_write (*content, priv->inptr, buffered);
+		
+		if (n == (gint64) buffered && n < length) {
+			char buf[4096];
+			
+			g_mime_stream_seek (priv->stream, priv->offset, GMIME_STREAM_SEEK_SET);
+			
+			while (n < length && (nread = g_mime_stream_read (priv->stream, buf, MIN (sizeof (buf), (size_t) (length - n)))) > 0) {
+				if (g_mime_stream_write (*content, buf, nread) != nread)
+					break;
+				
+				n += nread;
+			}
+		}
+		
+		if (n < length) {
+			g_mime_stream_seek (priv->stream, priv->offset, GMIME_STREAM_SEEK_SET);
+			g_object_unref (*content);
+			*content = NULL;
+			return FALSE;
+		}
+		
+		g_mime_stream_reset (*content);
+		priv->stats.bytes_buffered += length;
+	} else {
+		buffer = g_byte_array_sized_new ((guint) length);
+		g_byte_array_set_size (buffer, (guint) length);
+		
+		buffered = (size_t) MIN ((gint64) (priv->inend - priv->inptr), length);
+		memcpy (buffer->data, priv->inptr, buffered);
+		n = buffered;
+		
+		if (n < length) {
+			g_mime_stream_seek (priv->stream, priv->offset, GMIME_STREAM_SEEK_SET);
+			
+			while (n < length && (nread = g_mime_stream_read (priv->stream, (char *) buffer->data + n, length - n)) > 0)
+				n += nread;
+			
+			if (n < length) {
+				g_mime_stream_seek (priv->stream, priv->offset, GMIME_STREAM_SEEK_SET);
+				g_byte_array_unref (buffer);
+				return FALSE;
+			}
+		}
+		
+		*content = g_mime_stream_mem_new_with_byte_array (buffer);
+		priv->stats.bytes_buffered += length;
 	}
+	
+	/* resume at the From-line of the next message (or the end of the stream) */
+	g_mime_stream_seek (priv->stream, end + seplen, GMIME_STREAM_SEEK_SET);
+	priv->offset = end + seplen;
+	priv->inptr = priv->inend = priv->inbuf;
+	
+	priv->boundary = eos ? BOUNDARY_EOS : BOUNDARY_IMMEDIATE_END;
+	priv->openpgp = GMIME_OPENPGP_NONE;
+	priv->content_size += length;
+	
+	return TRUE;
 }
 
 static void
@@ -1650,25 +2698,57 @@ parser_scan_mime_part_content (GMimeParser *parser, GMimePart *mime_part)
 	
 	g_assert (priv->state >= GMIME_PARSER_STATE_HEADERS_END);
 	
+	if (parser_take_trusted_content (parser, &stream)) {
+		encoding = g_mime_part_get_content_encoding (mime_part);
+		content = g_mime_data_wrapper_new_with_stream (stream, encoding);
+		g_object_unref (stream);
+		
+		/* the content was never scanned for OpenPGP markers, so leave
+		 * that to g_mime_part_get_openpgp_data() */
+		g_mime_part_set_content (mime_part, content);
+		g_object_unref (content);
+		return;
+	}
+	
 	if (priv->persist_stream && priv->seekable) {
 		stream = g_mime_stream_null_new ();
 		start = parser_offset (priv, NULL);
+	} else if (priv->spill_threshold > 0) {
+		stream = g_mime_stream_spill_new_with_threshold (priv->spill_threshold);
+		start = 0;
 	} else {
 		stream = g_mime_stream_mem_new ();
 		start = 0;
 	}
 	
+	if (priv->checksum) {
+		g_mime_filter_reset ((GMimeFilter *) priv->checksum);
+		priv->checksum_nheld = 0;
+		priv->checksumming = TRUE;
+	}
+	
 	parser_scan_content (parser, stream, &empty);
 	len = g_mime_stream_tell (stream);
+	priv->checksumming = FALSE;
 	
 	if (priv->persist_stream && priv->seekable) {
 		g_object_unref (stream);
 		
+		/* when fed, the stream only holds the input from feed_base on */
+		start -= priv->feed_base;
+		
 		stream = g_mime_stream_substream (priv->stream, start, start + len);
 	} else {
-		buffer = g_mime_stream_mem_get_byte_array ((GMimeStreamMem *) stream);
-		g_byte_array_set_size (buffer, (guint) len);
+		if (GMIME_IS_STREAM_MEM (stream)) {
+			buffer = g_mime_stream_mem_get_byte_array ((GMimeStreamMem *) stream);
+			g_byte_array_set_size (buffer, (guint) len);
+		} else {
+			/* drop the newline that belongs to the boundary */
+			g_mime_stream_set_bounds (stream, 0, len);
+		}
+		
 		g_mime_stream_reset (stream);
+		priv->stats.bytes_buffered += len;
 	}
 	
 	encoding = g_mime_part_get_content_encoding (mime_part);
@@ -1678,6 +2758,9 @@ parser_scan_mime_part_content (GMimeParser *parser, GMimePart *mime_part)
 	g_mime_part_set_content (mime_part, content);
 	g_object_unref (content);
 	
+	if (priv->checksum && priv->checksum_cb)
+		priv->checksum_cb (parser, mime_part, priv->checksum, priv->checksum_data);
+	
 	switch (priv->openpgp) {
 	case GMIME_OPENPGP_END_PGP_SIGNATURE:
 		g_mime_part_set_openpgp_data (mime_part, GMIME_OPENPGP_DATA_SIGNED);
@@ -1851,13 +2934,17 @@ parser_construct_leaf_part (GMimeParser *parser, GMimeParserOptions *options, Co
 	if (!g_ascii_strcasecmp (type, "message") && is_rfc822 (subtype)) {
 		gboolean is_encoded = FALSE;
 		
-		if (depth >= MAX_LEVEL) {
+		if (depth >= priv->max_depth) {
 			/* The maximum MIME nesting level has been exceeded. Treat this message/rfc822
 			 * part as if it was a leaf-node MIME part (i.e. don't recursively parse the
 			 * message content). */
 			_g_mime_parser_options_warn (options, priv->headers_begin, GMIME_CRIT_NESTING_OVERFLOW, NULL);
 			w(g_warning ("maximum nesting level exceeded"));
 			is_encoded = TRUE;
+		} else if (priv->max_parts > 0 && priv->nparts >= priv->max_parts) {
+			/* Likewise, don't parse the embedded message if we've already hit the part limit. */
+			_g_mime_parser_options_warn (options, priv->headers_begin, GMIME_CRIT_TOO_MANY_PARTS, NULL);
+			is_encoded = TRUE;
 		}
 		
 		for (i = 0; i < priv->headers->len && !is_encoded; i++) {
@@ -1886,6 +2973,7 @@ parser_construct_leaf_part (GMimeParser *parser, GMimeParserOptions *options, Co
 	}
 	
 	object = g_mime_object_new_type (options, type, subtype);
+	priv->nparts++;
 	
 	if (!content_type->exists) {
 		GMimeContentType *mime_type;
@@ -1916,10 +3004,14 @@ parser_construct_leaf_part (GMimeParser *parser, GMimeParserOptions *options, Co
 	}
 	
 	if (priv->state == GMIME_PARSER_STATE_CONTENT) {
-		if (GMIME_IS_MESSAGE_PART (object))
+		if (GMIME_IS_MESSAGE_PART (object)) {
 			parser_scan_message_part (parser, options, (GMimeMessagePart *) object, depth + 1);
-		else
+		} else {
+			/* the Content-Length of a message only delimits its own body */
+			priv->message_body = toplevel && depth == 0;
 			parser_scan_mime_part_content (parser, (GMimePart *) object);
+			priv->message_body = FALSE;
+		}
 	}
 
 	return object;
@@ -1965,6 +3057,7 @@ parser_scan_multipart_face (GMimeParser *parser, GMimeMultipart *multipart, gboo
 	if (!empty) {
 		buffer = g_mime_stream_mem_get_byte_array ((GMimeStreamMem *) stream);
 		len = g_mime_stream_tell (stream);
+		parser->priv->stats.bytes_buffered += len;
 		g_byte_array_set_size (buffer, len + 1);
 		buffer->data[buffer->len - 1] = '\0';
 		face = (char *) buffer->data;
@@ -1982,6 +3075,28 @@ parser_scan_multipart_face (GMimeParser *parser, GMimeMultipart *multipart, gboo
 #define parser_scan_multipart_prologue(parser, multipart) parser_scan_multipart_face (parser, multipart, TRUE)
 #define parser_scan_multipart_epilogue(parser, multipart) parser_scan_multipart_face (parser, multipart, FALSE)
 
+static void
+parser_skip_multipart_subparts (GMimeParser *parser)
+{
+	struct _GMimeParserPrivate *priv = parser->priv;
+	GMimeStream *stream;
+	gboolean empty;
+	
+	/* scan over the remaining subparts without constructing them */
+	stream = g_mime_stream_null_new ();
+	
+	while (priv->boundary == BOUNDARY_IMMEDIATE) {
+		if (parser_skip_line (parser) == -1) {
+			priv->boundary = BOUNDARY_EOS;
+			break;
+		}
+		
+		parser_scan_content (parser, stream, &empty);
+	}
+	
+	g_object_unref (stream);
+}
+
 static BoundaryType
 parser_scan_multipart_subparts (GMimeParser *parser, GMimeParserOptions *options, GMimeMultipart *multipart, int depth)
 {
@@ -1990,6 +3105,12 @@ parser_scan_multipart_subparts (GMimeParser *parser, GMimeParserOptions *options
 	GMimeObject *subpart;
 	
 	do {
+		if (priv->max_parts > 0 && priv->nparts >= priv->max_parts) {
+			_g_mime_parser_options_warn (options, parser_offset (priv, NULL), GMIME_CRIT_TOO_MANY_PARTS, NULL);
+			parser_skip_multipart_subparts (parser);
+			break;
+		}
+		
 		/* skip over the boundary marker */
 		if (parser_skip_line (parser) == -1) {
 			priv->boundary = BOUNDARY_EOS;
@@ -2047,6 +3168,7 @@ parser_construct_multipart (GMimeParser *parser, GMimeParserOptions *options, Co
 	g_assert (priv->state >= GMIME_PARSER_STATE_HEADERS_END);
 	
 	object = g_mime_object_new_type (options, content_type->type, content_type->subtype);
+	priv->nparts++;
 	
 	for (i = 0; i < priv->headers->len; i++) {
 		header = priv->headers->pdata[i];
@@ -2074,7 +3196,7 @@ parser_construct_multipart (GMimeParser *parser, GMimeParserOptions *options, Co
 		}
 	}
 	
-	if ((boundary = g_mime_object_get_content_type_parameter (object, "boundary")) && depth < MAX_LEVEL) {
+	if ((boundary = g_mime_object_get_content_type_parameter (object, "boundary")) && depth < priv->max_depth) {
 		parser_push_boundary (parser, boundary);
 		
 		parser_scan_multipart_prologue (parser, multipart);
@@ -2105,7 +3227,7 @@ parser_construct_multipart (GMimeParser *parser, GMimeParserOptions *options, Co
 		else if (priv->boundary == BOUNDARY_PARENT && found_immediate_boundary (priv, FALSE))
 			priv->boundary = BOUNDARY_IMMEDIATE;
 	} else {
-		if (depth >= MAX_LEVEL) {
+		if (depth >= priv->max_depth) {
 			_g_mime_parser_options_warn (options, priv->headers_begin, GMIME_CRIT_NESTING_OVERFLOW, NULL);
 			w(g_warning ("maximum nesting level exceeded @ boundary = %s", boundary));
 		} else {
@@ -2127,13 +3249,18 @@ parser_construct_part (GMimeParser *parser, GMimeParserOptions *options)
 	ContentType *content_type;
 	GMimeObject *object;
 	
+	parser_set_limits (priv, options);
+	parser_stats_begin (priv);
+	
 	/* get the headers */
 	priv->state = GMIME_PARSER_STATE_HEADERS;
 	priv->toplevel = TRUE;
 	
 	while (priv->state < GMIME_PARSER_STATE_HEADERS_END) {
-		if (parser_step (parser, options) == GMIME_PARSER_STATE_ERROR)
+		if (parser_step (parser, options) == GMIME_PARSER_STATE_ERROR) {
+			parser_stats_end (priv);
 			return NULL;
+		}
 	}
 	
 	content_type = parser_content_type (parser, NULL);
@@ -2144,10 +3271,63 @@ parser_construct_part (GMimeParser *parser, GMimeParserOptions *options)
 	
 	content_type_destroy (content_type);
 	
+	if (priv->exceeded)
+		_g_mime_parser_options_warn (options, -1, priv->exceeded, NULL);
+	
+	parser_stats_end (priv);
+	
 	return object;
 }
 
 
+/**
+ * g_mime_parser_set_content_checksum:
+ * @parser: a #GMimeParser context
+ * @checksum: (nullable): a #GMimeFilterChecksum
+ * @checksum_cb: (scope notified) (closure user_data): callback function
+ * @user_data: user data
+ *
+ * Has @parser compute the digests configured on @checksum over the
+ * content of each #GMimePart while the content is scanned, rather than
+ * in a separate pass over it afterwards. Once the content of a part has
+ * been scanned, @checksum_cb is called with the part and @checksum,
+ * whose digests can then be read with
+ * g_mime_filter_checksum_get_digest() and friends. @checksum is reset
+ * before the content of each part is scanned.
+ *
+ * The digests are of the raw content, before any Content-Transfer-Encoding
+ * is decoded (so they match the digests of the part's content stream).
+ *
+ * Since the content of a part must be scanned for the digests to be
+ * computed, the body of a message is never taken without scanning it
+ * (see g_mime_parser_set_trust_content_length()) while a content
+ * checksum is set.
+ *
+ * If @checksum is %NULL, content checksums are no longer computed.
+ **/
+void
+g_mime_parser_set_content_checksum (GMimeParser *parser, GMimeFilterChecksum *checksum,
+				    GMimeParserContentChecksumFunc checksum_cb, gpointer user_data)
+{
+	struct _GMimeParserPrivate *priv;
+	
+	g_return_if_fail (GMIME_IS_PARSER (parser));
+	g_return_if_fail (checksum == NULL || GMIME_IS_FILTER_CHECKSUM (checksum));
+	
+	priv = parser->priv;
+	
+	if (checksum)
+		g_object_ref (checksum);
+	
+	if (priv->checksum)
+		g_object_unref (priv->checksum);
+	
+	priv->checksum = checksum;
+	priv->checksum_cb = checksum ? checksum_cb : NULL;
+	priv->checksum_data = user_data;
+}
+
+
 /**
  * g_mime_parser_construct_part:
  * @parser: a #GMimeParser context
@@ -2163,6 +3343,9 @@ g_mime_parser_construct_part (GMimeParser *parser, GMimeParserOptions *options)
 {
 	g_return_val_if_fail (GMIME_IS_PARSER (parser), NULL);
 	
+	if (parser->priv->feed && !parser->priv->feed_finished)
+		return NULL;
+	
 	return parser_construct_part (parser, options);
 }
 
@@ -2181,17 +3364,24 @@ parser_construct_message (GMimeParser *parser, GMimeParserOptions *options)
 	char *endptr;
 	guint i;
 	
+	parser_set_limits (priv, options);
+	parser_stats_begin (priv);
+	
 	/* scan the from-line if we are parsing an mbox */
 	while (priv->state != GMIME_PARSER_STATE_MESSAGE_HEADERS) {
-		if (parser_step (parser, options) == GMIME_PARSER_STATE_ERROR)
+		if (parser_step (parser, options) == GMIME_PARSER_STATE_ERROR) {
+			parser_stats_end (priv);
 			return NULL;
+		}
 	}
 	
 	/* parse the headers */
 	priv->toplevel = TRUE;
 	while (priv->state < GMIME_PARSER_STATE_HEADERS_END) {
-		if (parser_step (parser, options) == GMIME_PARSER_STATE_ERROR)
+		if (parser_step (parser, options) == GMIME_PARSER_STATE_ERROR) {
+			parser_stats_end (priv);
 			return NULL;
+		}
 	}
 	
 	message = g_mime_message_new (FALSE);
@@ -2222,10 +3412,13 @@ parser_construct_message (GMimeParser *parser, GMimeParserOptions *options)
 	
 	if (priv->format == GMIME_FORMAT_MBOX) {
 		parser_push_boundary (parser, MBOX_BOUNDARY);
+		priv->content_length = -1;
 		priv->content_end = 0;
 		
-		if (priv->respect_content_length && content_length < ULONG_MAX)
+		if (priv->respect_content_length && content_length < ULONG_MAX) {
 			priv->content_end = parser_offset (priv, NULL) + content_length;
+			priv->content_length = (gint64) content_length;
+		}
 	} else if (priv->format == GMIME_FORMAT_MMDF) {
 		parser_push_boundary (parser, MMDF_BOUNDARY);
 	}
@@ -2242,15 +3435,47 @@ parser_construct_message (GMimeParser *parser, GMimeParserOptions *options)
 	if (priv->state == GMIME_PARSER_STATE_ERROR)
 		_g_mime_parser_options_warn (options, -1, GMIME_WARN_MALFORMED_MESSAGE, NULL);
 	
+	if (priv->exceeded)
+		_g_mime_parser_options_warn (options, -1, priv->exceeded, NULL);
+	
 	if (priv->format == GMIME_FORMAT_MBOX) {
 		priv->state = GMIME_PARSER_STATE_FROM;
 		parser_pop_boundary (parser);
 	}
 	
+	parser_stats_end (priv);
+	
 	return message;
 }
 
 
+/* Drops the input that the parser has consumed so that a feeding parser
+ * only holds on to what it has yet to parse. Constructed objects that
+ * reference the old stream keep it alive for as long as they need it. */
+static void
+parser_feed_trim (struct _GMimeParserPrivate *priv)
+{
+	GByteArray *array;
+	GMimeStream *stream;
+	gint64 cut;
+	
+	array = g_mime_stream_mem_get_byte_array ((GMimeStreamMem *) priv->stream);
+	
+	/* keep the partial line that parser_feed_scan() has yet to look at */
+	cut = MIN (parser_offset (priv, NULL), priv->feed_base + priv->feed_line) - priv->feed_base;
+	if (cut <= 0)
+		return;
+	
+	stream = g_mime_stream_mem_new_with_buffer ((const char *) array->data + cut, array->len - (size_t) cut);
+	g_mime_stream_seek (stream, priv->offset - priv->feed_base - cut, GMIME_STREAM_SEEK_SET);
+	g_object_unref (priv->stream);
+	priv->stream = stream;
+	
+	priv->feed_line -= cut;
+	priv->feed_base += cut;
+}
+
+
 /**
  * g_mime_parser_construct_message:
  * @parser: a #GMimeParser context
@@ -2263,8 +3488,25 @@ parser_construct_message (GMimeParser *parser, GMimeParserOptions *options)
 GMimeMessage *
 g_mime_parser_construct_message (GMimeParser *parser, GMimeParserOptions *options)
 {
+	struct _GMimeParserPrivate *priv;
+	GMimeMessage *message;
+	
 	g_return_val_if_fail (GMIME_IS_PARSER (parser), NULL);
 	
+	priv = parser->priv;
+	
+	if (priv->feed) {
+		if (!parser_feed_ready (priv))
+			return NULL;
+		
+		priv->feed_constructed++;
+		
+		message = parser_construct_message (parser, options);
+		parser_feed_trim (priv);
+		
+		return message;
+	}
+	
 	return parser_construct_message (parser, options);
 }
 
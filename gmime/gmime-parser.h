@@ -31,6 +31,8 @@
 #include <gmime/gmime-content-type.h>
 #include <gmime/gmime-parser-options.h>
 #include <gmime/gmime-stream.h>
+#include <gmime/gmime-part.h>
+#include <gmime/gmime-filter-checksum.h>
 
 G_BEGIN_DECLS
 
@@ -95,6 +97,51 @@ typedef void (* GMimeParserHeaderRegexFunc) (GMimeParser *parser, const char *he
 					     gpointer user_data);
 
 
+/**
+ * GMimeParserContentChecksumFunc:
+ * @parser: The #GMimeParser object.
+ * @part: The #GMimePart whose content has just been parsed.
+ * @checksum: The #GMimeFilterChecksum holding the digests of the content of @part.
+ * @user_data: The user-supplied callback data.
+ *
+ * Function signature for the callback to
+ * g_mime_parser_set_content_checksum().
+ **/
+typedef void (* GMimeParserContentChecksumFunc) (GMimeParser *parser, GMimePart *part,
+						 GMimeFilterChecksum *checksum,
+						 gpointer user_data);
+
+
+/**
+ * GMimeParserStats:
+ * @bytes_scanned: the number of bytes of the stream consumed by the parser
+ * @bytes_buffered: the number of content bytes copied into memory streams
+ * @headers: the number of header fields parsed
+ * @refills: the number of times the parser read from its stream
+ * @boundary_checks: the number of lines that were checked against the boundary stack
+ * @boundary_misses: the number of boundary checks that did not match a boundary
+ * @parts: the number of MIME parts constructed (including multiparts)
+ * @header_usec: the time spent parsing headers, in microseconds
+ * @content_usec: the time spent scanning content, in microseconds
+ * @construct_usec: the remaining time spent constructing objects, in microseconds
+ *
+ * Statistics for the most recent g_mime_parser_construct_message() or
+ * g_mime_parser_construct_part() call. See g_mime_parser_set_collect_stats().
+ **/
+typedef struct {
+	gint64 bytes_scanned;
+	gint64 bytes_buffered;
+	guint headers;
+	guint refills;
+	guint boundary_checks;
+	guint boundary_misses;
+	guint parts;
+	gint64 header_usec;
+	gint64 content_usec;
+	gint64 construct_usec;
+} GMimeParserStats;
+
+
 GType g_mime_parser_get_type (void);
 
 GMimeParser *g_mime_parser_new (void);
@@ -105,19 +152,36 @@ void g_mime_parser_init_with_stream (GMimeParser *parser, GMimeStream *stream);
 gboolean g_mime_parser_get_persist_stream (GMimeParser *parser);
 void g_mime_parser_set_persist_stream (GMimeParser *parser, gboolean persist);
 
+size_t g_mime_parser_get_spill_threshold (GMimeParser *parser);
+void g_mime_parser_set_spill_threshold (GMimeParser *parser, size_t threshold);
+
 GMimeFormat g_mime_parser_get_format (GMimeParser *parser);
 void g_mime_parser_set_format (GMimeParser *parser, GMimeFormat format);
 
 gboolean g_mime_parser_get_respect_content_length (GMimeParser *parser);
 void g_mime_parser_set_respect_content_length (GMimeParser *parser, gboolean respect_content_length);
 
+gboolean g_mime_parser_get_trust_content_length (GMimeParser *parser);
+void g_mime_parser_set_trust_content_length (GMimeParser *parser, gboolean trust_content_length);
+
+gboolean g_mime_parser_get_collect_stats (GMimeParser *parser);
+void g_mime_parser_set_collect_stats (GMimeParser *parser, gboolean collect);
+const GMimeParserStats *g_mime_parser_get_stats (GMimeParser *parser);
+
 void g_mime_parser_set_header_regex (GMimeParser *parser, const char *regex,
 				     GMimeParserHeaderRegexFunc header_cb,
 				     gpointer user_data);
 
+void g_mime_parser_set_content_checksum (GMimeParser *parser, GMimeFilterChecksum *checksum,
+					 GMimeParserContentChecksumFunc checksum_cb,
+					 gpointer user_data);
+
 GMimeObject *g_mime_parser_construct_part (GMimeParser *parser, GMimeParserOptions *options);
 GMimeMessage *g_mime_parser_construct_message (GMimeParser *parser, GMimeParserOptions *options);
 
+gboolean g_mime_parser_feed (GMimeParser *parser, const char *buffer, size_t length);
+gboolean g_mime_parser_finish (GMimeParser *parser);
+
 gint64 g_mime_parser_tell (GMimeParser *parser);
 
 gboolean g_mime_parser_eos (GMimeParser *parser);
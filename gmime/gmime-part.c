@@ -302,6 +302,7 @@ write_content (GMimePart *part, GMimeFormatOptions *options, GMimeStream *stream
 	
 	if (part->encoding != g_mime_data_wrapper_get_encoding (part->content)) {
 		const char *newline = g_mime_format_options_get_newline (options);
+		GMimeNewLineFormat format;
 		const char *filename;
 		
 		filtered = g_mime_stream_filter_new (stream);
@@ -319,18 +320,19 @@ write_content (GMimePart *part, GMimeFormatOptions *options, GMimeStream *stream
 			/* fall thru... */
 		case GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE:
 		case GMIME_CONTENT_ENCODING_BASE64:
-			filter = g_mime_filter_basic_new (part->encoding, TRUE);
+			/* the encoder writes the requested line endings itself */
+			format = g_mime_format_options_get_newline_format (options);
+			filter = g_mime_filter_basic_new_with_newline (part->encoding, format, object->ensure_newline);
 			g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
 			g_object_unref (filter);
 			break;
-		default:
+		case GMIME_CONTENT_ENCODING_BINARY:
 			break;
-		}
-		
-		if (part->encoding != GMIME_CONTENT_ENCODING_BINARY) {
+		default:
 			filter = g_mime_format_options_create_newline_filter (options, object->ensure_newline);
 			g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
 			g_object_unref (filter);
+			break;
 		}
 		
 		nwritten = g_mime_data_wrapper_write_to_stream (part->content, filtered);
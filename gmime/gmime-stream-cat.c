@@ -57,15 +57,25 @@ static GMimeStream *stream_substream (GMimeStream *stream, gint64 start, gint64
 
 
 static GMimeStreamClass *parent_class = NULL;
+static gint private_offset = 0;
 
 
 struct _cat_node {
 	struct _cat_node *next;
 	GMimeStream *stream;
 	gint64 position;
+	gint64 offset; /* offset of the source within the cat stream (if indexed) */
+	gint64 length; /* cached length of the source (if indexed) */
 	int id; /* for debugging */
 };
 
+typedef struct {
+	GPtrArray *nodes; /* the sources in order, for looking them up by offset */
+	guint indexed;    /* the number of leading sources with a cached offset and length */
+} GMimeStreamCatPrivate;
+
+#define GET_PRIVATE(cat) ((GMimeStreamCatPrivate *) G_STRUCT_MEMBER_P (cat, private_offset))
+
 GType
 g_mime_stream_cat_get_type (void)
 {
@@ -85,6 +95,7 @@ g_mime_stream_cat_get_type (void)
 		};
 		
 		type = g_type_register_static (GMIME_TYPE_STREAM, "GMimeStreamCat", &info, 0);
+		private_offset = g_type_add_instance_private (type, sizeof (GMimeStreamCatPrivate));
 	}
 	
 	return type;
@@ -98,6 +109,7 @@ g_mime_stream_cat_class_init (GMimeStreamCatClass *klass)
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 	
 	parent_class = g_type_class_ref (GMIME_TYPE_STREAM);
+	g_type_class_adjust_private_offset (klass, &private_offset);
 	
 	object_class->finalize = g_mime_stream_cat_finalize;
 	
@@ -116,8 +128,12 @@ g_mime_stream_cat_class_init (GMimeStreamCatClass *klass)
 static void
 g_mime_stream_cat_init (GMimeStreamCat *stream, GMimeStreamCatClass *klass)
 {
+	GMimeStreamCatPrivate *priv = GET_PRIVATE (stream);
+	
+	priv->nodes = g_ptr_array_new ();
 	stream->sources = NULL;
 	stream->current = NULL;
+	priv->indexed = 0;
 }
 
 static void
@@ -127,16 +143,85 @@ g_mime_stream_cat_finalize (GObject *object)
 	
 	stream_close (stream);
 	
+	g_ptr_array_free (GET_PRIVATE (stream)->nodes, TRUE);
+	
 	G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+/* caches the offset and length of as many of the sources as possible
+ * (stopping at the first source with an unknown length) */
+static void
+cat_index (GMimeStreamCat *cat)
+{
+	GMimeStreamCatPrivate *priv = GET_PRIVATE (cat);
+	struct _cat_node *node, *prev;
+	gint64 len;
+	
+	while (priv->indexed < priv->nodes->len) {
+		node = priv->nodes->pdata[priv->indexed];
+		
+		if (node->stream->bound_end != -1) {
+			len = node->stream->bound_end - node->stream->bound_start;
+		} else if ((len = g_mime_stream_length (node->stream)) == -1) {
+			break;
+		}
+		
+		if (priv->indexed > 0) {
+			prev = priv->nodes->pdata[priv->indexed - 1];
+			node->offset = prev->offset + prev->length;
+		} else {
+			node->offset = 0;
+		}
+		
+		node->length = len;
+		priv->indexed++;
+	}
+}
+
+/* binary searches for the source containing @offset; if @at_end is
+ * %TRUE, the end of the last source is also considered a match */
+static struct _cat_node *
+cat_find_node (GMimeStreamCat *cat, gint64 offset, gboolean at_end)
+{
+	GMimeStreamCatPrivate *priv = GET_PRIVATE (cat);
+	struct _cat_node *node;
+	guint lo = 0, hi, mid;
+	
+	cat_index (cat);
+	
+	if (priv->indexed == 0)
+		return NULL;
+	
+	/* find the first source that ends after @offset */
+	hi = priv->indexed;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		node = priv->nodes->pdata[mid];
+		
+		if (node->offset + node->length > offset)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	
+	if (lo < priv->indexed)
+		return priv->nodes->pdata[lo];
+	
+	node = priv->nodes->pdata[priv->indexed - 1];
+	if (at_end && priv->indexed == priv->nodes->len && offset == node->offset + node->length)
+		return node;
+	
+	return NULL;
+}
+
 static ssize_t
 stream_read (GMimeStream *stream, char *buf, size_t len)
 {
 	GMimeStreamCat *cat = (GMimeStreamCat *) stream;
 	struct _cat_node *current;
-	ssize_t nread = 0;
+	size_t nread = 0;
 	gint64 offset;
+	ssize_t n;
 	
 	/* check for end-of-stream */
 	if (stream->bound_end != -1 && stream->position >= stream->bound_end)
@@ -154,22 +239,27 @@ stream_read (GMimeStream *stream, char *buf, size_t len)
 	if (g_mime_stream_seek (current->stream, offset, GMIME_STREAM_SEEK_SET) == -1)
 		return -1;
 	
-	do {
-		if ((nread = g_mime_stream_read (current->stream, buf, len)) <= 0) {
+	/* fill as much of the buffer as we can, even if that means reading
+	 * from several sources */
+	while (nread < len && current != NULL) {
+		if ((n = g_mime_stream_read (current->stream, buf + nread, len - nread)) <= 0) {
 			cat->current = current = current->next;
 			if (current != NULL) {
-				if (g_mime_stream_reset (current->stream) == -1)
-					return -1;
+				if (g_mime_stream_reset (current->stream) == -1) {
+					if (nread == 0)
+						return -1;
+					break;
+				}
+				
 				current->position = 0;
 			}
-			nread = 0;
-		} else if (nread > 0) {
-			current->position += nread;
+		} else {
+			current->position += n;
+			nread += n;
 		}
-	} while (nread == 0 && current != NULL);
+	}
 	
-	if (nread > 0)
-		stream->position += nread;
+	stream->position += nread;
 	
 	return nread;
 }
@@ -178,6 +268,7 @@ static ssize_t
 stream_write (GMimeStream *stream, const char *buf, size_t len)
 {
 	GMimeStreamCat *cat = (GMimeStreamCat *) stream;
+	GMimeStreamCatPrivate *priv = GET_PRIVATE (cat);
 	struct _cat_node *current;
 	size_t nwritten = 0;
 	ssize_t n = -1;
@@ -227,6 +318,9 @@ stream_write (GMimeStream *stream, const char *buf, size_t len)
 	
 	cat->current = current;
 	
+	/* the sources may have grown */
+	priv->indexed = 0;
+	
 	if (n == -1 && nwritten == 0)
 		return -1;
 	
@@ -264,6 +358,7 @@ static int
 stream_close (GMimeStream *stream)
 {
 	GMimeStreamCat *cat = (GMimeStreamCat *) stream;
+	GMimeStreamCatPrivate *priv = GET_PRIVATE (cat);
 	struct _cat_node *n, *nn;
 	
 	cat->current = NULL;
@@ -275,7 +370,9 @@ stream_close (GMimeStream *stream)
 		n = nn;
 	}
 	
+	g_ptr_array_set_size (priv->nodes, 0);
 	cat->sources = NULL;
+	priv->indexed = 0;
 	
 	return 0;
 }
@@ -321,8 +418,8 @@ static gint64
 stream_seek (GMimeStream *stream, gint64 offset, GMimeSeekWhence whence)
 {
 	GMimeStreamCat *cat = (GMimeStreamCat *) stream;
-	struct _cat_node *current, *n;
-	gint64 real, off, len;
+	struct _cat_node *current;
+	gint64 real, off;
 	
 	d(fprintf (stderr, "GMimeStreamCat::stream_seek (%p, %ld, %d)\n",
 		   stream, offset, whence));
@@ -332,186 +429,68 @@ stream_seek (GMimeStream *stream, gint64 offset, GMimeSeekWhence whence)
 	
 	switch (whence) {
 	case GMIME_STREAM_SEEK_SET:
-	seek_set:
-		/* sanity check our seek - make sure we don't under/over-seek our bounds */
-		if (offset < 0) {
-			d(fprintf (stderr, "offset %ld < 0, fail\n", offset));
-			return -1;
-		}
-		
-		/* sanity check our seek */
-		if (stream->bound_end != -1 && offset > stream->bound_end) {
-			d(fprintf (stderr, "offset %ld > bound_end %ld, fail\n",
-				   offset, stream->bound_end));
-			return -1;
-		}
-		
-		/* short-cut if we are seeking to our current position */
-		if (offset == stream->position) {
-			d(fprintf (stderr, "offset %ld == stream->position %ld, no need to seek\n",
-				   offset, stream->position));
-			return offset;
-		}
-		
-		real = 0;
-		n = cat->sources;
-		current = cat->current;
-		
-		while (n != current) {
-			if (real + n->position > offset)
-				break;
-			real += n->position;
-			n = n->next;
-		}
-		
-		if (n == NULL) {
-			/* offset not within our grasp... */
-			return -1;
-		}
-		
-		if (n != current) {
-			/* seeking to a previous stream (n->stream) */
-			if ((offset - real) != n->position) {
-				/* FIXME: could probably skip these seek checks... */
-				off = n->stream->bound_start + (offset - real);
-				if (g_mime_stream_seek (n->stream, off, GMIME_STREAM_SEEK_SET) == -1)
-					return -1;
-			}
-			
-			d(fprintf (stderr, "setting current stream to %i and updating cur->position to %ld\n",
-				   n->id, offset - real));
-			
-			current = n;
-			current->position = offset - real;
-			
-			break;
-		} else {
-			/* seeking to someplace in our current (or next) stream */
-			d(fprintf (stderr, "seek offset %ld in current stream[%d] or after\n",
-				   offset, current->id));
-			if ((offset - real) == current->position) {
-				/* exactly at our current position */
-				d(fprintf (stderr, "seek offset at cur position of stream[%d]\n",
-					   current->id));
-				stream->position = offset;
-				return offset;
-			}
-			
-			if ((offset - real) < current->position) {
-				/* in current stream, but before current position */
-				d(fprintf (stderr, "seeking backwards in cur stream[%d]\n",
-					   current->id));
-				/* FIXME: again, could probably skip seek checks... */
-				off = current->stream->bound_start + (offset - real);
-				if (g_mime_stream_seek (current->stream, off, GMIME_STREAM_SEEK_SET) == -1)
-					return -1;
-				
-				d(fprintf (stderr, "setting cur stream[%d] position to %ld\n",
-					   current->id, offset - real));
-				current->position = offset - real;
-				
-				break;
-			}
-			
-			/* after our current position */
-			d(fprintf (stderr, "after cur position in stream[%d] or in a later stream\n",
-				   current->id));
-			do {
-				if (current->stream->bound_end != -1) {
-					len = current->stream->bound_end - current->stream->bound_start;
-				} else {
-					if ((len = g_mime_stream_length (current->stream)) == -1)
-						return -1;
-				}
-				
-				d(fprintf (stderr, "real = %lld, stream[%d] len = %lld\n",
-					   real, current->id, len));
-				
-				if ((real + len) > offset) {
-					/* within the bounds of the current stream */
-					d(fprintf (stderr, "offset within bounds of stream[%d]\n",
-						   current->id));
-					break;
-				} else {
-					d(fprintf (stderr, "not within bounds of stream[%d]\n",
-						   current->id));
-					current->position = len;
-					real += len;
-					
-					current = current->next;
-					if (current == NULL) {
-						d(fprintf (stderr, "ran out of streams, failed\n"));
-						return -1;
-					}
-					
-					d(fprintf (stderr, "advanced to stream[%d]...\n", current->id));
-					
-					if (g_mime_stream_reset (current->stream) == -1)
-						return -1;
-					
-					current->position = 0;
-				}
-			} while (1);
-			
-			/* FIXME: another seek check... probably can skip this */
-			off = current->stream->bound_start + (offset - real);
-			if (g_mime_stream_seek (current->stream, off, GMIME_STREAM_SEEK_SET) == -1)
-				return -1;
-			
-			d(fprintf (stderr, "setting cur position of stream[%d] to %ld\n",
-				   current->id, offset - real));
-			current->position = offset - real;
-		}
-		
+		real = offset;
 		break;
 	case GMIME_STREAM_SEEK_CUR:
 		if (offset == 0)
 			return stream->position;
 		
 		/* calculate offset relative to the beginning of the stream */
-		offset = stream->position + offset;
-		goto seek_set;
+		real = stream->position + offset;
 		break;
 	case GMIME_STREAM_SEEK_END:
 		if (offset > 0)
 			return -1;
 		
 		/* calculate the offset of the end of the stream */
-		n = cat->sources;
-		real = stream->bound_start;
-		while (n != NULL) {
-			if ((len = g_mime_stream_length (n->stream)) == -1)
-				return -1;
-			
-			real += len;
-			n = n->next;
-		}
+		if ((real = stream_length (stream)) == -1)
+			return -1;
 		
 		/* calculate offset relative to the beginning of the stream */
-		offset = real + offset;
-		goto seek_set;
+		real = stream->bound_start + real + offset;
 		break;
 	default:
 		g_assert_not_reached ();
 		return -1;
 	}
 	
-	d(fprintf (stderr, "setting stream->offset to %ld and current stream to %d\n",
-		   offset, current->id));
+	/* sanity check our seek - make sure we don't under/over-seek our bounds */
+	if (real < 0) {
+		d(fprintf (stderr, "offset %ld < 0, fail\n", real));
+		return -1;
+	}
 	
-	stream->position = offset;
-	cat->current = current;
+	if (stream->bound_end != -1 && real > stream->bound_end) {
+		d(fprintf (stderr, "offset %ld > bound_end %ld, fail\n",
+			   real, stream->bound_end));
+		return -1;
+	}
 	
-	/* reset all following streams */
-	n = current->next;
-	while (n != NULL) {
-		if (g_mime_stream_reset (n->stream) == -1)
-			return -1;
-		n->position = 0;
-		n = n->next;
+	/* short-cut if we are seeking to our current position */
+	if (real == stream->position) {
+		d(fprintf (stderr, "offset %ld == stream->position %ld, no need to seek\n",
+			   real, stream->position));
+		return real;
 	}
 	
-	return offset;
+	if (!(current = cat_find_node (cat, real, TRUE))) {
+		/* offset not within our grasp... */
+		return -1;
+	}
+	
+	off = current->stream->bound_start + (real - current->offset);
+	if (g_mime_stream_seek (current->stream, off, GMIME_STREAM_SEEK_SET) == -1)
+		return -1;
+	
+	d(fprintf (stderr, "setting stream->offset to %ld and current stream to %d\n",
+		   real, current->id));
+	
+	/* Note: the sources after this one get reset as the reads or writes reach them */
+	current->position = real - current->offset;
+	stream->position = real;
+	cat->current = current;
+	
+	return real;
 }
 
 static gint64
@@ -524,22 +503,23 @@ static gint64
 stream_length (GMimeStream *stream)
 {
 	GMimeStreamCat *cat = GMIME_STREAM_CAT (stream);
-	gint64 len, total = 0;
-	struct _cat_node *n;
+	GMimeStreamCatPrivate *priv = GET_PRIVATE (cat);
+	struct _cat_node *last;
 	
 	if (stream->bound_end != -1)
 		return stream->bound_end - stream->bound_start;
 	
-	n = cat->sources;
-	while (n != NULL) {
-		if ((len = g_mime_stream_length (n->stream)) == -1)
-			return -1;
-		
-		total += len;
-		n = n->next;
-	}
+	if (priv->nodes->len == 0)
+		return 0;
 	
-	return total;
+	cat_index (cat);
+	
+	if (priv->indexed < priv->nodes->len)
+		return -1;
+	
+	last = priv->nodes->pdata[priv->nodes->len - 1];
+	
+	return last->offset + last->length;
 }
 
 struct _sub_node {
@@ -561,29 +541,11 @@ stream_substream (GMimeStream *stream, gint64 start, gint64 end)
 	d(fprintf (stderr, "GMimeStreamCat::substream (%p, %ld, %ld)\n", stream, start, end));
 	
 	/* find the first source stream that contains data we're interested in... */
-	n = cat->sources;
-	while (offset < start && n != NULL) {
-		if (n->stream->bound_end == -1) {
-			if ((len = g_mime_stream_length (n->stream)) == -1)
-				return NULL;
-		} else {
-			len = n->stream->bound_end - n->stream->bound_start;
-		}
-		
-		if ((offset + len) > start)
-			break;
-		
-		if (end != -1 && (offset + len) >= end)
-			break;
-		
-		offset += len;
-		
-		n = n->next;
-	}
-	
-	if (n == NULL)
+	if (!(n = cat_find_node (cat, start, FALSE)))
 		return NULL;
 	
+	offset = n->offset;
+	
 	d(fprintf (stderr, "stream[%d] is the first stream containing data we want\n", n->id));
 	
 	streams = NULL;
@@ -607,11 +569,10 @@ stream_substream (GMimeStream *stream, gint64 start, gint64 end)
 		
 		d(fprintf (stderr, "added stream[%d] to our list\n", n->id));
 		
-		if (n->stream->bound_end == -1) {
-			if ((len = g_mime_stream_length (n->stream)) == -1)
-				goto error;
-		} else {
+		if (n->stream->bound_end != -1) {
 			len = n->stream->bound_end - n->stream->bound_start;
+		} else if ((len = g_mime_stream_length (n->stream)) == -1) {
+			goto error;
 		}
 		
 		d(fprintf (stderr, "stream[%d]: len = %ld, offset of beginning of stream is %ld\n",
@@ -694,25 +655,35 @@ g_mime_stream_cat_new (void)
  *
  * Adds the @source stream to the @cat.
  *
+ * Note: the length of @source is cached the first time that @cat
+ * needs it (e.g. to seek), so @source should not change size after
+ * it has been added unless it is written to through @cat.
+ *
  * Returns: %0 on success or %-1 on fail.
  **/
 int
 g_mime_stream_cat_add_source (GMimeStreamCat *cat, GMimeStream *source)
 {
-	struct _cat_node *node, *n;
+	GMimeStreamCatPrivate *priv;
+	struct _cat_node *node, *n = NULL;
 	
 	g_return_val_if_fail (GMIME_IS_STREAM_CAT (cat), -1);
 	g_return_val_if_fail (GMIME_IS_STREAM (source), -1);
 	
+	priv = GET_PRIVATE (cat);
+	
 	node = g_new (struct _cat_node, 1);
 	node->next = NULL;
 	node->stream = source;
 	g_object_ref (source);
 	node->position = 0;
+	node->offset = 0;
+	node->length = 0;
 	
-	n = cat->sources;
-	while (n && n->next)
-		n = n->next;
+	if (priv->nodes->len > 0)
+		n = priv->nodes->pdata[priv->nodes->len - 1];
+	
+	g_ptr_array_add (priv->nodes, node);
 	
 	if (n == NULL) {
 		cat->sources = node;
@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include "gmime-stream-filter.h"
+#include "gmime-internal.h"
 
 
 /**
@@ -41,11 +42,14 @@
  *
  * When data passes through a #GMimeStreamFilter, it will pass through
  * #GMimeFilter filters in the order they were added.
+ *
+ * When reading, data is pulled from the source stream in chunks of
+ * g_mime_stream_filter_get_read_size() bytes. Larger chunks mean fewer
+ * calls through the filter chain when large amounts of data are read.
  **/
 
 
 #define READ_PAD (64)		/* bytes padded before buffer */
-#define READ_SIZE (4096)
 
 #define _PRIVATE(o) (((GMimeStreamFilter *)(o))->priv)
 
@@ -60,7 +64,9 @@ struct _GMimeStreamFilterPrivate {
 	int filterid;		/* next filter id */
 	
 	char *realbuffer;	/* buffer - READ_PAD */
-	char *buffer;		/* READ_SIZE bytes */
+	char *buffer;		/* read_size bytes */
+	size_t allocated;	/* allocated size of realbuffer */
+	size_t read_size;
 	
 	char *filtered;		/* the filtered data */
 	size_t filteredlen;
@@ -88,6 +94,38 @@ static GMimeStream *stream_substream (GMimeStream *stream, gint64 start, gint64
 static GMimeStreamClass *parent_class = NULL;
 
 
+/* runs @buffer through each of the filters in turn, letting them
+ * filter it in place once it no longer belongs to our caller */
+static void
+filter_chain (struct _filter *f, gboolean complete, gboolean in_place,
+	      char **buffer, size_t *len, size_t *presize)
+{
+	size_t inlen, prespace;
+	char *inbuf;
+	
+	while (f != NULL) {
+		inbuf = *buffer;
+		inlen = *len;
+		prespace = *presize;
+		
+		if (complete && in_place)
+			g_mime_filter_complete_in_place (f->filter, inbuf, inlen, prespace, buffer, len, presize);
+		else if (complete)
+			g_mime_filter_complete (f->filter, inbuf, inlen, prespace, buffer, len, presize);
+		else if (in_place)
+			g_mime_filter_filter_in_place (f->filter, inbuf, inlen, prespace, buffer, len, presize);
+		else
+			g_mime_filter_filter (f->filter, inbuf, inlen, prespace, buffer, len, presize);
+		
+		/* output that isn't within the input must be in one of the filter's own buffers */
+		if (*buffer < inbuf - prespace || *buffer > inbuf + inlen)
+			in_place = TRUE;
+		
+		f = f->next;
+	}
+}
+
+
 GType
 g_mime_stream_filter_get_type (void)
 {
@@ -143,8 +181,10 @@ g_mime_stream_filter_init (GMimeStreamFilter *stream, GMimeStreamFilterClass *kl
 	stream->priv = g_new (struct _GMimeStreamFilterPrivate, 1);
 	stream->priv->filters = NULL;
 	stream->priv->filterid = 0;
-	stream->priv->realbuffer = g_malloc (READ_SIZE + READ_PAD);
-	stream->priv->buffer = stream->priv->realbuffer + READ_PAD;
+	stream->priv->read_size = GMIME_STREAM_FILTER_DEFAULT_READ_SIZE;
+	stream->priv->realbuffer = NULL;
+	stream->priv->buffer = NULL;
+	stream->priv->allocated = 0;
 	stream->priv->last_was_read = TRUE;
 	stream->priv->filteredlen = 0;
 	stream->priv->flushed = FALSE;
@@ -165,7 +205,7 @@ g_mime_stream_filter_finalize (GObject *object)
 		f = fn;
 	}
 	
-	g_free (p->realbuffer);
+	_g_mime_buffer_pool_free (p->realbuffer, p->allocated);
 	g_free (p);
 	
 	if (filter->source)
@@ -180,28 +220,32 @@ stream_read (GMimeStream *stream, char *buf, size_t n)
 {
 	GMimeStreamFilter *filter = (GMimeStreamFilter *) stream;
 	struct _GMimeStreamFilterPrivate *priv = filter->priv;
-	struct _filter *f;
 	ssize_t nread;
 	
 	priv->last_was_read = TRUE;
 	
-	if (priv->filteredlen <= 0) {
+	/* keep going until the filters have something for us: they may
+	 * hold back everything read so far (e.g. a trailing '\r') */
+	while (priv->filteredlen <= 0) {
 		size_t presize = READ_PAD;
 		
-		nread = g_mime_stream_read (filter->source, priv->buffer, READ_SIZE);
+		/* the read buffer is only needed once the stream is read from, and
+		 * nothing in it is still pending at this point */
+		if (priv->allocated < priv->read_size + READ_PAD) {
+			_g_mime_buffer_pool_free (priv->realbuffer, priv->allocated);
+			priv->realbuffer = _g_mime_buffer_pool_alloc (priv->read_size + READ_PAD, &priv->allocated);
+			priv->buffer = priv->realbuffer + READ_PAD;
+		}
+		
+		nread = g_mime_stream_read (filter->source, priv->buffer, priv->read_size);
 		if (nread <= 0) {
 			/* this is somewhat untested */
 			if (g_mime_stream_eos (filter->source) && !priv->flushed) {
 				priv->filtered = priv->buffer;
 				priv->filteredlen = 0;
-				f = priv->filters;
 				
-				while (f != NULL) {
-					g_mime_filter_complete (f->filter, priv->filtered, priv->filteredlen,
-								presize, &priv->filtered, &priv->filteredlen,
-								&presize);
-					f = f->next;
-				}
+				filter_chain (priv->filters, TRUE, TRUE, &priv->filtered,
+					      &priv->filteredlen, &presize);
 				
 				nread = priv->filteredlen;
 				priv->flushed = TRUE;
@@ -213,14 +257,10 @@ stream_read (GMimeStream *stream, char *buf, size_t n)
 			priv->filtered = priv->buffer;
 			priv->filteredlen = nread;
 			priv->flushed = FALSE;
-			f = priv->filters;
 			
-			while (f != NULL) {
-				g_mime_filter_filter (f->filter, priv->filtered, priv->filteredlen, presize,
-						      &priv->filtered, &priv->filteredlen, &presize);
-				
-				f = f->next;
-			}
+			/* the read buffer is ours, so the filters can work in place */
+			filter_chain (priv->filters, FALSE, TRUE, &priv->filtered,
+				      &priv->filteredlen, &presize);
 		}
 	}
 	
@@ -239,19 +279,14 @@ stream_write (GMimeStream *stream, const char *buf, size_t n)
 	struct _GMimeStreamFilterPrivate *priv = filter->priv;
 	char *buffer = (char *) buf;
 	ssize_t nwritten = n;
-	struct _filter *f;
 	size_t presize;
 	
 	priv->last_was_read = FALSE;
 	priv->flushed = FALSE;
 	
-	f = priv->filters;
+	/* @buf belongs to our caller, so it must not be filtered in place */
 	presize = 0;
-	while (f != NULL) {
-		g_mime_filter_filter (f->filter, buffer, n, presize, &buffer, &n, &presize);
-		
-		f = f->next;
-	}
+	filter_chain (priv->filters, FALSE, FALSE, &buffer, &n, &presize);
 	
 	if (g_mime_stream_write (filter->source, buffer, n) == -1)
 		return -1;
@@ -266,7 +301,6 @@ stream_flush (GMimeStream *stream)
 	GMimeStreamFilter *filter = (GMimeStreamFilter *) stream;
 	struct _GMimeStreamFilterPrivate *priv = filter->priv;
 	size_t presize, len;
-	struct _filter *f;
 	char *buffer;
 	
 	if (priv->last_was_read) {
@@ -277,13 +311,8 @@ stream_flush (GMimeStream *stream)
 	buffer = "";
 	len = 0;
 	presize = 0;
-	f = priv->filters;
 	
-	while (f != NULL) {
-		g_mime_filter_complete (f->filter, buffer, len, presize, &buffer, &len, &presize);
-		
-		f = f->next;
-	}
+	filter_chain (priv->filters, TRUE, FALSE, &buffer, &len, &presize);
 	
 	if (len > 0 && g_mime_stream_write (filter->source, buffer, len) == -1)
 		return -1;
@@ -538,3 +567,43 @@ g_mime_stream_filter_get_owner (GMimeStreamFilter *stream)
 	
 	return stream->owner;
 }
+
+
+/**
+ * g_mime_stream_filter_set_read_size:
+ * @stream: a #GMimeStreamFilter
+ * @size: the number of bytes to read from the source stream at a time
+ *
+ * Sets the size of the chunks that @stream reads from its source
+ * stream and passes through its filters. A larger size reduces the
+ * per-chunk overhead of the filter chain when large amounts of data
+ * are read at the cost of a larger read buffer.
+ *
+ * The default is %GMIME_STREAM_FILTER_DEFAULT_READ_SIZE.
+ **/
+void
+g_mime_stream_filter_set_read_size (GMimeStreamFilter *stream, size_t size)
+{
+	g_return_if_fail (GMIME_IS_STREAM_FILTER (stream));
+	g_return_if_fail (size > 0);
+	
+	stream->priv->read_size = size;
+}
+
+
+/**
+ * g_mime_stream_filter_get_read_size:
+ * @stream: a #GMimeStreamFilter
+ *
+ * Gets the size of the chunks that @stream reads from its source
+ * stream.
+ *
+ * Returns: the read size of @stream.
+ **/
+size_t
+g_mime_stream_filter_get_read_size (GMimeStreamFilter *stream)
+{
+	g_return_val_if_fail (GMIME_IS_STREAM_FILTER (stream), 0);
+	
+	return stream->priv->read_size;
+}
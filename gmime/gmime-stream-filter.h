@@ -34,6 +34,14 @@ G_BEGIN_DECLS
 #define GMIME_IS_STREAM_FILTER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GMIME_TYPE_STREAM_FILTER))
 #define GMIME_STREAM_FILTER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GMIME_TYPE_STREAM_FILTER, GMimeStreamFilterClass))
 
+/**
+ * GMIME_STREAM_FILTER_DEFAULT_READ_SIZE:
+ *
+ * The default number of bytes that a #GMimeStreamFilter reads from its
+ * source stream at a time.
+ **/
+#define GMIME_STREAM_FILTER_DEFAULT_READ_SIZE (4096)
+
 typedef struct _GMimeStreamFilter GMimeStreamFilter;
 typedef struct _GMimeStreamFilterClass GMimeStreamFilterClass;
 
@@ -70,6 +78,9 @@ void g_mime_stream_filter_remove (GMimeStreamFilter *stream, int id);
 void g_mime_stream_filter_set_owner (GMimeStreamFilter *stream, gboolean owner);
 gboolean g_mime_stream_filter_get_owner (GMimeStreamFilter *stream);
 
+void g_mime_stream_filter_set_read_size (GMimeStreamFilter *stream, size_t size);
+size_t g_mime_stream_filter_get_read_size (GMimeStreamFilter *stream);
+
 G_END_DECLS
 
 #endif /* __GMIME_STREAM_FILTER_H__ */
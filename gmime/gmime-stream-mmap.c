@@ -46,6 +46,11 @@
  * store. This may be faster than #GMimeStreamFs or #GMimeStreamFile
  * but you'll have to do your own performance checking to be sure for
  * your particular application/platform.
+ *
+ * By default, the whole file is mapped at once. For very large files
+ * (such as multi-gigabyte mbox archives) on systems with a constrained
+ * address space, g_mime_stream_mmap_new_full() can instead be used to
+ * map the file one fixed-size window at a time as it is read.
  **/
 
 
@@ -66,6 +71,37 @@ static GMimeStream *stream_substream (GMimeStream *stream, gint64 start, gint64
 
 
 static GMimeStreamClass *parent_class = NULL;
+static gint private_offset = 0;
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/* a window of the file that is mapped by one or more of the streams
+ * that share an #MmapWindows list */
+typedef struct {
+	size_t maplen;
+	gint64 mapoff;
+	int refcount;
+	char *map;
+} MmapWindow;
+
+/* shared by a windowed stream and all of its substreams so that they
+ * can share the windows that they map rather than each mapping its own */
+typedef struct {
+	GSList *list;
+	int refcount;
+} MmapWindows;
+
+typedef struct {
+	gint64 mapoff;             /* file offset of the memory map */
+	gint64 size;               /* length of the file (or of the part of it that may be mapped) */
+	size_t window;             /* size of each window or 0 if the whole file is mapped at once */
+	GMimeStreamMmapHints hints;
+	int prot;
+	int flags;
+	MmapWindows *windows;
+} GMimeStreamMmapPrivate;
+
+#define GET_PRIVATE(mm) ((GMimeStreamMmapPrivate *) G_STRUCT_MEMBER_P (mm, private_offset))
 
 
 GType
@@ -87,6 +123,7 @@ g_mime_stream_mmap_get_type (void)
 		};
 		
 		type = g_type_register_static (GMIME_TYPE_STREAM, "GMimeStreamMmap", &info, 0);
+		private_offset = g_type_add_instance_private (type, sizeof (GMimeStreamMmapPrivate));
 	}
 	
 	return type;
@@ -100,6 +137,7 @@ g_mime_stream_mmap_class_init (GMimeStreamMmapClass *klass)
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 	
 	parent_class = g_type_class_ref (GMIME_TYPE_STREAM);
+	g_type_class_adjust_private_offset (klass, &private_offset);
 	
 	object_class->finalize = g_mime_stream_mmap_finalize;
 	
@@ -118,11 +156,20 @@ g_mime_stream_mmap_class_init (GMimeStreamMmapClass *klass)
 static void
 g_mime_stream_mmap_init (GMimeStreamMmap *stream, GMimeStreamMmapClass *klass)
 {
+	GMimeStreamMmapPrivate *priv = GET_PRIVATE (stream);
+	
 	stream->owner = TRUE;
 	stream->eos = FALSE;
 	stream->fd = -1;
 	stream->map = NULL;
 	stream->maplen = 0;
+	priv->mapoff = 0;
+	priv->size = 0;
+	priv->window = 0;
+	priv->hints = GMIME_STREAM_MMAP_HINT_NONE;
+	priv->prot = 0;
+	priv->flags = 0;
+	priv->windows = NULL;
 }
 
 static void
@@ -136,12 +183,213 @@ g_mime_stream_mmap_finalize (GObject *object)
 }
 
 
+#ifdef HAVE_MMAP
+static size_t
+mmap_alignment (GMimeStreamMmapHints hints)
+{
+	static size_t page_size = 0;
+	long n;
+	
+	if (page_size == 0) {
+		if ((n = sysconf (_SC_PAGESIZE)) <= 0)
+			n = 4096;
+		
+		page_size = (size_t) n;
+	}
+	
+	if ((hints & GMIME_STREAM_MMAP_HINT_HUGE_PAGES) && page_size < HUGE_PAGE_SIZE)
+		return HUGE_PAGE_SIZE;
+	
+	return page_size;
+}
+
+static void
+mmap_advise (char *map, size_t len, GMimeStreamMmapHints hints)
+{
+#ifdef HAVE_MADVISE
+#ifdef MADV_HUGEPAGE
+	if (hints & GMIME_STREAM_MMAP_HINT_HUGE_PAGES)
+		madvise (map, len, MADV_HUGEPAGE);
+#endif
+#ifdef MADV_SEQUENTIAL
+	if (hints & GMIME_STREAM_MMAP_HINT_SEQUENTIAL)
+		madvise (map, len, MADV_SEQUENTIAL);
+#endif
+#ifdef MADV_WILLNEED
+	if (hints & GMIME_STREAM_MMAP_HINT_WILLNEED)
+		madvise (map, len, MADV_WILLNEED);
+#endif
+#endif /* HAVE_MADVISE */
+}
+
+static char *
+mmap_map (int fd, int prot, int flags, gint64 offset, size_t len, GMimeStreamMmapHints hints)
+{
+	char *map = MAP_FAILED;
+#if defined (MAP_FIXED) && defined (MAP_ANONYMOUS) && defined (HAVE_MUNMAP)
+	size_t page_size, pagelen, head;
+	char *reserve, *aligned, *tail;
+#endif
+	
+#ifdef MAP_POPULATE
+	if (hints & GMIME_STREAM_MMAP_HINT_POPULATE)
+		flags |= MAP_POPULATE;
+#endif
+	
+#if defined (MAP_FIXED) && defined (MAP_ANONYMOUS) && defined (HAVE_MUNMAP)
+	if ((hints & GMIME_STREAM_MMAP_HINT_HUGE_PAGES) && len >= HUGE_PAGE_SIZE) {
+		/* reserve enough address space to be able to place the map on
+		 * a huge page boundary, map the file over it and then give back
+		 * whatever is left over on either side */
+		page_size = mmap_alignment (GMIME_STREAM_MMAP_HINT_NONE);
+		pagelen = ((len + page_size - 1) / page_size) * page_size;
+		
+		reserve = mmap (NULL, pagelen + HUGE_PAGE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		
+		if (reserve != MAP_FAILED) {
+			aligned = (char *) (((size_t) reserve + HUGE_PAGE_SIZE - 1) & ~((size_t) HUGE_PAGE_SIZE - 1));
+			head = aligned - reserve;
+			
+			if ((map = mmap (aligned, len, prot, flags | MAP_FIXED, fd, (off_t) offset)) != MAP_FAILED) {
+				tail = aligned + pagelen;
+				
+				if (head > 0)
+					munmap (reserve, head);
+				
+				if (HUGE_PAGE_SIZE - head > 0)
+					munmap (tail, HUGE_PAGE_SIZE - head);
+			} else {
+				munmap (reserve, pagelen + HUGE_PAGE_SIZE);
+			}
+		}
+	}
+#endif
+	
+	if (map == MAP_FAILED && (map = mmap (NULL, len, prot, flags, fd, (off_t) offset)) == MAP_FAILED)
+		return NULL;
+	
+	mmap_advise (map, len, hints);
+	
+	return map;
+}
+#endif /* HAVE_MMAP */
+
+/* drops the window that @mm has mapped, unmapping it if no other
+ * stream is using it */
+static void
+mmap_window_release (GMimeStreamMmap *mm)
+{
+	GMimeStreamMmapPrivate *priv = GET_PRIVATE (mm);
+	MmapWindow *window;
+	GSList *node;
+	
+	if (priv->windows == NULL || mm->map == NULL)
+		return;
+	
+	for (node = priv->windows->list; node != NULL; node = node->next) {
+		window = node->data;
+		
+		if (window->map == mm->map)
+			break;
+	}
+	
+	if (node != NULL && --window->refcount == 0) {
+		priv->windows->list = g_slist_remove (priv->windows->list, window);
+#ifdef HAVE_MUNMAP
+		munmap (window->map, window->maplen);
+#endif
+		g_free (window);
+	}
+	
+	mm->map = NULL;
+	mm->maplen = 0;
+	priv->mapoff = 0;
+}
+
+/* makes sure that the file data at @offset is mapped, returning a
+ * pointer to it and the number of bytes that are mapped from there */
+static gboolean
+mmap_window (GMimeStreamMmap *mm, gint64 offset, char **mapptr, size_t *avail)
+{
+#ifdef HAVE_MMAP
+	GMimeStreamMmapPrivate *priv = GET_PRIVATE (mm);
+	MmapWindow *window = NULL;
+	size_t align, len;
+	GSList *node;
+	gint64 start;
+	char *map;
+	
+	if (offset >= priv->size) {
+		*mapptr = NULL;
+		*avail = 0;
+		return TRUE;
+	}
+	
+	if (mm->map == NULL || offset < priv->mapoff || offset >= priv->mapoff + (gint64) mm->maplen) {
+		/* use a window that another stream has already mapped if one covers @offset */
+		for (node = priv->windows->list; node != NULL; node = node->next) {
+			window = node->data;
+			
+			if (offset >= window->mapoff && offset < window->mapoff + (gint64) window->maplen)
+				break;
+		}
+		
+		if (node == NULL) {
+			/* slide the window over so that it covers @offset */
+			align = mmap_alignment (priv->hints);
+			start = offset - (offset % align);
+			len = (size_t) MIN ((gint64) priv->window, priv->size - start);
+			
+			if (!(map = mmap_map (mm->fd, priv->prot, priv->flags, start, len, priv->hints)))
+				return FALSE;
+			
+			window = g_new (MmapWindow, 1);
+			window->maplen = len;
+			window->mapoff = start;
+			window->refcount = 0;
+			window->map = map;
+			
+			priv->windows->list = g_slist_prepend (priv->windows->list, window);
+		}
+		
+		window->refcount++;
+		mmap_window_release (mm);
+		
+		priv->mapoff = window->mapoff;
+		mm->maplen = window->maplen;
+		mm->map = window->map;
+	}
+	
+	*avail = (size_t) ((priv->mapoff + (gint64) mm->maplen) - offset);
+	*mapptr = mm->map + (offset - priv->mapoff);
+	
+	return TRUE;
+#else
+	errno = ENOSYS;
+	return FALSE;
+#endif /* HAVE_MMAP */
+}
+
+static size_t
+mmap_remaining (GMimeStream *stream, size_t len)
+{
+	gint64 end = GET_PRIVATE (stream)->size;
+	
+	if (stream->bound_end != -1)
+		end = MIN (stream->bound_end, end);
+	
+	if (stream->position >= end)
+		return 0;
+	
+	return (size_t) MIN ((gint64) len, end - stream->position);
+}
+
 static ssize_t
 stream_read (GMimeStream *stream, char *buf, size_t len)
 {
 	GMimeStreamMmap *mm = (GMimeStreamMmap *) stream;
-	register char *mapptr;
-	ssize_t nread;
+	size_t nread = 0, avail, n;
+	char *mapptr;
 	
 	if (mm->fd == -1) {
 		errno = EBADF;
@@ -153,29 +401,34 @@ stream_read (GMimeStream *stream, char *buf, size_t len)
 		return -1;
 	}
 	
-	/* make sure we are at the right position */
-	mapptr = mm->map + stream->position;
+	len = mmap_remaining (stream, len);
 	
-	if (stream->bound_end == -1)
-		nread = MIN ((gint64) ((mm->map + mm->maplen) - mapptr), (gint64) len);
-	else
-		nread = MIN (stream->bound_end - stream->position, (gint64) len);
+	while (nread < len) {
+		if (!mmap_window (mm, stream->position, &mapptr, &avail))
+			return nread > 0 ? (ssize_t) nread : -1;
+		
+		n = MIN (avail, len - nread);
+		memcpy (buf + nread, mapptr, n);
+		stream->position += n;
+		nread += n;
+	}
 	
-	if (nread > 0) {
-		memcpy (buf, mapptr, nread);
-		stream->position += nread;
-	} else
+	/* don't hold on to a window that there is nothing more to read from */
+	if (GET_PRIVATE (mm)->window > 0 && mmap_remaining (stream, 1) == 0)
+		mmap_window_release (mm);
+	
+	if (nread == 0)
 		mm->eos = TRUE;
 	
-	return nread;
+	return (ssize_t) nread;
 }
 
 static ssize_t
 stream_write (GMimeStream *stream, const char *buf, size_t len)
 {
 	GMimeStreamMmap *mm = (GMimeStreamMmap *) stream;
-	register char *mapptr;
-	ssize_t nwritten;
+	size_t nwritten = 0, avail, n;
+	char *mapptr;
 	
 	if (mm->fd == -1) {
 		errno = EBADF;
@@ -187,20 +440,19 @@ stream_write (GMimeStream *stream, const char *buf, size_t len)
 		return -1;
 	}
 	
-	/* make sure we are at the right position */
-	mapptr = mm->map + stream->position;
+	len = mmap_remaining (stream, len);
 	
-	if (stream->bound_end == -1)
-		nwritten = MIN ((gint64) ((mm->map + mm->maplen) - mapptr), (gint64) len);
-	else
-		nwritten = MIN (stream->bound_end - stream->position, (gint64) len);
-	
-	if (nwritten > 0) {
-		memcpy (mapptr, buf, nwritten);
-		stream->position += nwritten;
+	while (nwritten < len) {
+		if (!mmap_window (mm, stream->position, &mapptr, &avail))
+			return nwritten > 0 ? (ssize_t) nwritten : -1;
+		
+		n = MIN (avail, len - nwritten);
+		memcpy (mapptr, buf + nwritten, n);
+		stream->position += n;
+		nwritten += n;
 	}
 	
-	return nwritten;
+	return (ssize_t) nwritten;
 }
 
 static int
@@ -213,6 +465,9 @@ stream_flush (GMimeStream *stream)
 		return -1;
 	}
 	
+	if (mm->map == NULL)
+		return 0;
+	
 #ifdef HAVE_MSYNC
 	return msync (mm->map, mm->maplen, MS_SYNC /* | MS_INVALIDATE */);
 #else
@@ -224,16 +479,26 @@ static int
 stream_close (GMimeStream *stream)
 {
 	GMimeStreamMmap *mm = (GMimeStreamMmap *) stream;
+	GMimeStreamMmapPrivate *priv = GET_PRIVATE (mm);
 	int rv = 0;
 	
 	if (mm->fd == -1)
 		return 0;
 	
-	if (mm->owner) {
+	if (priv->window > 0) {
+		mmap_window_release (mm);
+		
+		if (--priv->windows->refcount == 0)
+			g_free (priv->windows);
+		
+		priv->windows = NULL;
+	}
 #ifdef HAVE_MUNMAP
+	else if (mm->map != NULL && mm->owner)
 		munmap (mm->map, mm->maplen);
 #endif
-		
+	
+	if (mm->owner) {
 		do {
 			rv = close (mm->fd);
 		} while (rv == -1 && errno == EINTR);
@@ -291,7 +556,7 @@ stream_seek (GMimeStream *stream, gint64 offset, GMimeSeekWhence whence)
 		break;
 	case GMIME_STREAM_SEEK_END:
 		if (stream->bound_end == -1) {
-			real = offset <= 0 ? stream->bound_start + (gint64) mm->maplen + offset : -1;
+			real = offset <= 0 ? GET_PRIVATE (mm)->size + offset : -1;
 			if (real != -1) {
 				if (real < stream->bound_start)
 					real = stream->bound_start;
@@ -351,21 +616,38 @@ stream_length (GMimeStream *stream)
 	if (stream->bound_start != -1 && stream->bound_end != -1)
 		return stream->bound_end - stream->bound_start;
 	
-	return mm->maplen - stream->bound_start;
+	return GET_PRIVATE (mm)->size - stream->bound_start;
 }
 
 static GMimeStream *
 stream_substream (GMimeStream *stream, gint64 start, gint64 end)
 {
+	GMimeStreamMmap *parent = (GMimeStreamMmap *) stream;
+	GMimeStreamMmapPrivate *parent_priv = GET_PRIVATE (parent);
+	GMimeStreamMmapPrivate *priv;
 	GMimeStreamMmap *mm;
 	
 	mm = g_object_new (GMIME_TYPE_STREAM_MMAP, NULL);
 	g_mime_stream_construct ((GMimeStream *) mm, start, end);
-	mm->maplen = ((GMimeStreamMmap *) stream)->maplen;
-	mm->map = ((GMimeStreamMmap *) stream)->map;
-	mm->fd = ((GMimeStreamMmap *) stream)->fd;
+	priv = GET_PRIVATE (mm);
+	priv->size = parent_priv->size;
+	priv->window = parent_priv->window;
+	priv->hints = parent_priv->hints;
+	priv->prot = parent_priv->prot;
+	priv->flags = parent_priv->flags;
+	mm->fd = parent->fd;
 	mm->owner = FALSE;
 	
+	if (parent_priv->window > 0) {
+		/* windows are only mapped once they are read from and are
+		 * shared with the parent and its other substreams */
+		priv->windows = parent_priv->windows;
+		priv->windows->refcount++;
+	} else {
+		mm->maplen = parent->maplen;
+		mm->map = parent->map;
+	}
+	
 	return (GMimeStream *) mm;
 }
 
@@ -411,22 +693,67 @@ g_mime_stream_mmap_new (int fd, int prot, int flags)
  **/
 GMimeStream *
 g_mime_stream_mmap_new_with_bounds (int fd, int prot, int flags, gint64 start, gint64 end)
+{
+	return g_mime_stream_mmap_new_full (fd, prot, flags, start, end, GMIME_STREAM_MMAP_HINT_NONE, 0);
+}
+
+
+/**
+ * g_mime_stream_mmap_new_full:
+ * @fd: file descriptor
+ * @prot: protection flags
+ * @flags: map flags
+ * @start: start boundary
+ * @end: end boundary
+ * @hints: a bitwise-or of #GMimeStreamMmapHints
+ * @window_size: the size of each window to map or %0 to map the whole file
+ *
+ * Creates a new #GMimeStreamMmap object around @fd with bounds @start
+ * and @end, passing @hints on to the kernel.
+ *
+ * If @window_size is %0, the whole file (up to @end) is mapped at
+ * once, exactly like g_mime_stream_mmap_new_with_bounds(). Otherwise,
+ * only a window of @window_size bytes (rounded up to a whole number of
+ * pages, or huge pages when using %GMIME_STREAM_MMAP_HINT_HUGE_PAGES)
+ * is mapped at any given time, and it slides along the file as the
+ * stream is read, so that even files that are too large for the
+ * address space can be parsed. The substreams of a windowed stream
+ * share the windows that they map with it and with each other, and a
+ * window is unmapped as soon as none of them is reading from it any
+ * more.
+ *
+ * Returns: a stream using @fd with bounds @start and @end.
+ **/
+GMimeStream *
+g_mime_stream_mmap_new_full (int fd, int prot, int flags, gint64 start, gint64 end,
+			     GMimeStreamMmapHints hints, size_t window_size)
 {
 #ifdef HAVE_MMAP
+	GMimeStreamMmapPrivate *priv;
 	GMimeStreamMmap *mm;
+	char *map = NULL;
 	struct stat st;
-	size_t len;
-	char *map;
+	size_t align;
+	gint64 size;
 	
 	if (end == -1) {
 		if (fstat (fd, &st) == -1)
 			return NULL;
 		
-		len = st.st_size;
+		size = st.st_size;
 	} else
-		len = (size_t) end;
+		size = end;
 	
-	if ((map = mmap (NULL, len, prot, flags, fd, 0)) == MAP_FAILED)
+	if (window_size > 0) {
+		align = mmap_alignment (hints);
+		window_size = ((window_size + align - 1) / align) * align;
+		
+		/* no point in sliding a window over a file that fits in one */
+		if ((gint64) window_size >= size)
+			window_size = 0;
+	}
+	
+	if (window_size == 0 && !(map = mmap_map (fd, prot, flags, 0, (size_t) size, hints)))
 		return NULL;
 	
 	mm = g_object_new (GMIME_TYPE_STREAM_MMAP, NULL);
@@ -435,7 +762,21 @@ g_mime_stream_mmap_new_with_bounds (int fd, int prot, int flags, gint64 start, g
 	mm->eos = FALSE;
 	mm->fd = fd;
 	mm->map = map;
-	mm->maplen = len;
+	mm->maplen = map ? (size_t) size : 0;
+	
+	priv = GET_PRIVATE (mm);
+	priv->mapoff = 0;
+	priv->size = size;
+	priv->window = window_size;
+	priv->hints = hints;
+	priv->prot = prot;
+	priv->flags = flags;
+	
+	if (window_size > 0) {
+		priv->windows = g_new (MmapWindows, 1);
+		priv->windows->list = NULL;
+		priv->windows->refcount = 1;
+	}
 	
 	return (GMimeStream *) mm;
 #else
@@ -483,3 +824,37 @@ g_mime_stream_mmap_set_owner (GMimeStreamMmap *stream, gboolean owner)
 	
 	stream->owner = owner;
 }
+
+
+/**
+ * g_mime_stream_mmap_get_hints:
+ * @stream: a #GMimeStreamMmap
+ *
+ * Gets the access hints that @stream passes on to the kernel.
+ *
+ * Returns: a bitwise-or of #GMimeStreamMmapHints.
+ **/
+GMimeStreamMmapHints
+g_mime_stream_mmap_get_hints (GMimeStreamMmap *stream)
+{
+	g_return_val_if_fail (GMIME_IS_STREAM_MMAP (stream), GMIME_STREAM_MMAP_HINT_NONE);
+	
+	return GET_PRIVATE (stream)->hints;
+}
+
+
+/**
+ * g_mime_stream_mmap_get_window_size:
+ * @stream: a #GMimeStreamMmap
+ *
+ * Gets the size of the window that @stream maps at any given time.
+ *
+ * Returns: the window size or %0 if the whole file is mapped at once.
+ **/
+size_t
+g_mime_stream_mmap_get_window_size (GMimeStreamMmap *stream)
+{
+	g_return_val_if_fail (GMIME_IS_STREAM_MMAP (stream), 0);
+	
+	return GET_PRIVATE (stream)->window;
+}
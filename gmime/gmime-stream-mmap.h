@@ -36,6 +36,33 @@ G_BEGIN_DECLS
 typedef struct _GMimeStreamMmap GMimeStreamMmap;
 typedef struct _GMimeStreamMmapClass GMimeStreamMmapClass;
 
+/**
+ * GMIME_STREAM_MMAP_DEFAULT_WINDOW_SIZE:
+ *
+ * A reasonable window size for a #GMimeStreamMmap that maps its file
+ * in windows rather than all at once.
+ **/
+#define GMIME_STREAM_MMAP_DEFAULT_WINDOW_SIZE (16 * 1024 * 1024)
+
+/**
+ * GMimeStreamMmapHints:
+ * @GMIME_STREAM_MMAP_HINT_NONE: No hints.
+ * @GMIME_STREAM_MMAP_HINT_SEQUENTIAL: The stream will be read sequentially, so the kernel may read ahead aggressively and drop pages once they have been read (MADV_SEQUENTIAL).
+ * @GMIME_STREAM_MMAP_HINT_WILLNEED: The mapped data will be needed soon, so the kernel may start reading it in right away (MADV_WILLNEED).
+ * @GMIME_STREAM_MMAP_HINT_POPULATE: Fault in the whole map when it is created (MAP_POPULATE).
+ * @GMIME_STREAM_MMAP_HINT_HUGE_PAGES: Align the map to a huge page boundary and ask for it to be backed by transparent huge pages (MADV_HUGEPAGE).
+ *
+ * Hints describing how a #GMimeStreamMmap will be accessed. Hints that
+ * the platform does not support are ignored.
+ **/
+typedef enum {
+	GMIME_STREAM_MMAP_HINT_NONE       = 0,
+	GMIME_STREAM_MMAP_HINT_SEQUENTIAL = 1 << 0,
+	GMIME_STREAM_MMAP_HINT_WILLNEED   = 1 << 1,
+	GMIME_STREAM_MMAP_HINT_POPULATE   = 1 << 2,
+	GMIME_STREAM_MMAP_HINT_HUGE_PAGES = 1 << 3
+} GMimeStreamMmapHints;
+
 /**
  * GMimeStreamMmap:
  * @parent_object: parent #GMimeStream
@@ -68,10 +95,15 @@ GType g_mime_stream_mmap_get_type (void);
 
 GMimeStream *g_mime_stream_mmap_new (int fd, int prot, int flags);
 GMimeStream *g_mime_stream_mmap_new_with_bounds (int fd, int prot, int flags, gint64 start, gint64 end);
+GMimeStream *g_mime_stream_mmap_new_full (int fd, int prot, int flags, gint64 start, gint64 end,
+					  GMimeStreamMmapHints hints, size_t window_size);
 
 gboolean g_mime_stream_mmap_get_owner (GMimeStreamMmap *stream);
 void g_mime_stream_mmap_set_owner (GMimeStreamMmap *stream, gboolean owner);
 
+GMimeStreamMmapHints g_mime_stream_mmap_get_hints (GMimeStreamMmap *stream);
+size_t g_mime_stream_mmap_get_window_size (GMimeStreamMmap *stream);
+
 G_END_DECLS
 
 #endif /* __GMIME_STREAM_MMAP_H__ */
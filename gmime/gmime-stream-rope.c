@@ -0,0 +1,575 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2022 Jeffrey Stedfast
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <errno.h>
+
+#include "gmime-stream-rope.h"
+#include "gmime-internal.h"
+
+
+/**
+ * SECTION: gmime-stream-rope
+ * @title: GMimeStreamRope
+ * @short_description: A chunked memory stream
+ * @see_also: #GMimeStream, #GMimeStreamMem
+ *
+ * A #GMimeStream which keeps its content in memory, like a
+ * #GMimeStreamMem, but in a list of fixed-size chunks rather than a
+ * single contiguous buffer. Appending never has to reallocate and
+ * copy the content that has already been written and seeking to any
+ * offset is a constant-time operation.
+ *
+ * This makes a #GMimeStreamRope a good fit for accumulating large
+ * amounts of content that is only ever accessed through the
+ * #GMimeStream API. Use g_mime_stream_rope_flatten() to get the
+ * content as a single buffer when that is really needed.
+ *
+ * Substreams of a #GMimeStreamRope share the chunks of the stream that
+ * they were created from, including content that is written after the
+ * substream has been created.
+ **/
+
+
+struct _GMimeStreamRopePrivate {
+	GMimeStreamRope *source;
+	GPtrArray *chunks;
+	size_t chunk_size;
+	gint64 length;
+};
+
+static void g_mime_stream_rope_class_init (GMimeStreamRopeClass *klass);
+static void g_mime_stream_rope_init (GMimeStreamRope *stream, GMimeStreamRopeClass *klass);
+static void g_mime_stream_rope_finalize (GObject *object);
+
+static ssize_t stream_read (GMimeStream *stream, char *buf, size_t len);
+static ssize_t stream_write (GMimeStream *stream, const char *buf, size_t len);
+static int stream_flush (GMimeStream *stream);
+static int stream_close (GMimeStream *stream);
+static gboolean stream_eos (GMimeStream *stream);
+static int stream_reset (GMimeStream *stream);
+static gint64 stream_seek (GMimeStream *stream, gint64 offset, GMimeSeekWhence whence);
+static gint64 stream_tell (GMimeStream *stream);
+static gint64 stream_length (GMimeStream *stream);
+static GMimeStream *stream_substream (GMimeStream *stream, gint64 start, gint64 end);
+
+
+static GMimeStreamClass *parent_class = NULL;
+
+
+GType
+g_mime_stream_rope_get_type (void)
+{
+	static GType type = 0;
+	
+	if (!type) {
+		static const GTypeInfo info = {
+			sizeof (GMimeStreamRopeClass),
+			NULL, /* base_class_init */
+			NULL, /* base_class_finalize */
+			(GClassInitFunc) g_mime_stream_rope_class_init,
+			NULL, /* class_finalize */
+			NULL, /* class_data */
+			sizeof (GMimeStreamRope),
+			0,    /* n_preallocs */
+			(GInstanceInitFunc) g_mime_stream_rope_init,
+		};
+		
+		type = g_type_register_static (GMIME_TYPE_STREAM, "GMimeStreamRope", &info, 0);
+	}
+	
+	return type;
+}
+
+
+static void
+g_mime_stream_rope_class_init (GMimeStreamRopeClass *klass)
+{
+	GMimeStreamClass *stream_class = GMIME_STREAM_CLASS (klass);
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	
+	parent_class = g_type_class_ref (GMIME_TYPE_STREAM);
+	
+	object_class->finalize = g_mime_stream_rope_finalize;
+	
+	stream_class->read = stream_read;
+	stream_class->write = stream_write;
+	stream_class->flush = stream_flush;
+	stream_class->close = stream_close;
+	stream_class->eos = stream_eos;
+	stream_class->reset = stream_reset;
+	stream_class->seek = stream_seek;
+	stream_class->tell = stream_tell;
+	stream_class->length = stream_length;
+	stream_class->substream = stream_substream;
+}
+
+static void
+g_mime_stream_rope_init (GMimeStreamRope *stream, GMimeStreamRopeClass *klass)
+{
+	stream->priv = g_new (struct _GMimeStreamRopePrivate, 1);
+	stream->priv->chunk_size = GMIME_STREAM_ROPE_DEFAULT_CHUNK_SIZE;
+	stream->priv->source = NULL;
+	stream->priv->chunks = NULL;
+	stream->priv->length = 0;
+}
+
+static void
+g_mime_stream_rope_finalize (GObject *object)
+{
+	GMimeStream *stream = (GMimeStream *) object;
+	
+	GMimeStreamRope *rope = (GMimeStreamRope *) object;
+	
+	stream_close (stream);
+	g_free (rope->priv);
+	
+	G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+
+/* substreams do all of their I/O on the stream that owns the chunks */
+static GMimeStreamRope *
+rope_source (GMimeStreamRope *rope)
+{
+	return rope->priv->source ? rope->priv->source : rope;
+}
+
+/* makes sure that there are enough chunks to hold @size bytes and
+ * zero-fills anything between the current length and @size */
+static void
+rope_set_length (GMimeStreamRope *rope, gint64 size)
+{
+	size_t index, offset, n;
+	gint64 pos;
+	
+	while ((gint64) (rope->priv->chunks->len * rope->priv->chunk_size) < size)
+		g_ptr_array_add (rope->priv->chunks, g_malloc (rope->priv->chunk_size));
+	
+	for (pos = rope->priv->length; pos < size; pos += n) {
+		index = (size_t) (pos / rope->priv->chunk_size);
+		offset = (size_t) (pos % rope->priv->chunk_size);
+		n = (size_t) MIN ((gint64) (rope->priv->chunk_size - offset), size - pos);
+		memset (((char *) rope->priv->chunks->pdata[index]) + offset, 0, n);
+	}
+	
+	if (size > rope->priv->length)
+		rope->priv->length = size;
+}
+
+static void
+rope_copy_out (GMimeStreamRope *rope, gint64 pos, char *buf, size_t len)
+{
+	size_t index, offset, n;
+	
+	while (len > 0) {
+		index = (size_t) (pos / rope->priv->chunk_size);
+		offset = (size_t) (pos % rope->priv->chunk_size);
+		n = MIN (rope->priv->chunk_size - offset, len);
+		memcpy (buf, ((char *) rope->priv->chunks->pdata[index]) + offset, n);
+		pos += n;
+		buf += n;
+		len -= n;
+	}
+}
+
+static ssize_t
+stream_read (GMimeStream *stream, char *buf, size_t len)
+{
+	GMimeStreamRope *source = rope_source ((GMimeStreamRope *) stream);
+	gint64 bound_end;
+	ssize_t n;
+	
+	if (source->priv->chunks == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	bound_end = stream->bound_end != -1 ? MIN (stream->bound_end, source->priv->length) : source->priv->length;
+	
+	n = (ssize_t) MIN (bound_end - stream->position, (gint64) len);
+	if (n > 0) {
+		rope_copy_out (source, stream->position, buf, n);
+		stream->position += n;
+	} else if (n < 0) {
+		errno = EINVAL;
+		n = -1;
+	}
+	
+	return n;
+}
+
+static ssize_t
+stream_write (GMimeStream *stream, const char *buf, size_t len)
+{
+	GMimeStreamRope *source = rope_source ((GMimeStreamRope *) stream);
+	size_t index, offset, count, nwritten = 0;
+	ssize_t n;
+	
+	if (source->priv->chunks == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	if (stream->bound_end != -1)
+		n = (ssize_t) MIN (stream->bound_end - stream->position, (gint64) len);
+	else
+		n = (ssize_t) len;
+	
+	if (n <= 0) {
+		if (n < 0) {
+			errno = EINVAL;
+			n = -1;
+		}
+		
+		return n;
+	}
+	
+	if (stream->position > source->priv->length)
+		rope_set_length (source, stream->position);
+	
+	while (nwritten < (size_t) n) {
+		index = (size_t) (stream->position / source->priv->chunk_size);
+		offset = (size_t) (stream->position % source->priv->chunk_size);
+		
+		if (index == source->priv->chunks->len)
+			g_ptr_array_add (source->priv->chunks, g_malloc (source->priv->chunk_size));
+		
+		count = MIN (source->priv->chunk_size - offset, (size_t) n - nwritten);
+		memcpy (((char *) source->priv->chunks->pdata[index]) + offset, buf + nwritten, count);
+		stream->position += count;
+		nwritten += count;
+	}
+	
+	if (stream->position > source->priv->length)
+		source->priv->length = stream->position;
+	
+	return n;
+}
+
+static int
+stream_flush (GMimeStream *stream)
+{
+	GMimeStreamRope *source = rope_source ((GMimeStreamRope *) stream);
+	
+	if (source->priv->chunks == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	return 0;
+}
+
+static int
+stream_close (GMimeStream *stream)
+{
+	GMimeStreamRope *rope = (GMimeStreamRope *) stream;
+	
+	if (rope->priv->source) {
+		g_object_unref (rope->priv->source);
+		rope->priv->source = NULL;
+		return 0;
+	}
+	
+	if (rope->priv->chunks) {
+		g_ptr_array_free (rope->priv->chunks, TRUE);
+		rope->priv->chunks = NULL;
+	}
+	
+	return 0;
+}
+
+static gboolean
+stream_eos (GMimeStream *stream)
+{
+	GMimeStreamRope *source = rope_source ((GMimeStreamRope *) stream);
+	gint64 bound_end;
+	
+	if (source->priv->chunks == NULL)
+		return TRUE;
+	
+	bound_end = stream->bound_end != -1 ? MIN (stream->bound_end, source->priv->length) : source->priv->length;
+	
+	return stream->position >= bound_end;
+}
+
+static int
+stream_reset (GMimeStream *stream)
+{
+	GMimeStreamRope *source = rope_source ((GMimeStreamRope *) stream);
+	
+	if (source->priv->chunks == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	stream->position = stream->bound_start;
+	
+	return 0;
+}
+
+static gint64
+stream_seek (GMimeStream *stream, gint64 offset, GMimeSeekWhence whence)
+{
+	GMimeStreamRope *source = rope_source ((GMimeStreamRope *) stream);
+	gint64 bound_end, real = stream->position;
+	
+	if (source->priv->chunks == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	bound_end = stream->bound_end != -1 ? stream->bound_end : source->priv->length;
+	
+	switch (whence) {
+	case GMIME_STREAM_SEEK_SET:
+		real = offset;
+		break;
+	case GMIME_STREAM_SEEK_END:
+		real = offset + bound_end;
+		break;
+	case GMIME_STREAM_SEEK_CUR:
+		real = stream->position + offset;
+		break;
+	}
+	
+	if (real < stream->bound_start) {
+		errno = EINVAL;
+		return -1;
+	}
+	
+	if (stream->bound_end != -1 && real > bound_end) {
+		errno = EINVAL;
+		return -1;
+	}
+	
+	/* like GMimeStreamMem, seeking past the end grows the stream */
+	if (real > source->priv->length)
+		rope_set_length (source, real);
+	
+	stream->position = real;
+	
+	return stream->position;
+}
+
+static gint64
+stream_tell (GMimeStream *stream)
+{
+	return stream->position;
+}
+
+static gint64
+stream_length (GMimeStream *stream)
+{
+	GMimeStreamRope *source = rope_source ((GMimeStreamRope *) stream);
+	gint64 bound_end;
+	
+	if (source->priv->chunks == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	bound_end = stream->bound_end != -1 ? stream->bound_end : source->priv->length;
+	
+	return bound_end - stream->bound_start;
+}
+
+static GMimeStream *
+stream_substream (GMimeStream *stream, gint64 start, gint64 end)
+{
+	GMimeStreamRope *source = rope_source ((GMimeStreamRope *) stream);
+	GMimeStreamRope *rope;
+	
+	rope = g_object_new (GMIME_TYPE_STREAM_ROPE, NULL);
+	g_mime_stream_construct ((GMimeStream *) rope, start, end);
+	rope->priv->source = g_object_ref (source);
+	rope->priv->chunk_size = source->priv->chunk_size;
+	
+	return (GMimeStream *) rope;
+}
+
+
+/**
+ * g_mime_stream_rope_new:
+ *
+ * Creates a new #GMimeStreamRope object which allocates memory in
+ * chunks of #GMIME_STREAM_ROPE_DEFAULT_CHUNK_SIZE bytes.
+ *
+ * Returns: a new rope stream.
+ **/
+GMimeStream *
+g_mime_stream_rope_new (void)
+{
+	return g_mime_stream_rope_new_with_chunk_size (GMIME_STREAM_ROPE_DEFAULT_CHUNK_SIZE);
+}
+
+
+/**
+ * g_mime_stream_rope_new_with_chunk_size:
+ * @chunk_size: the size of each chunk of memory
+ *
+ * Creates a new #GMimeStreamRope object which allocates memory in
+ * chunks of @chunk_size bytes.
+ *
+ * Returns: a new rope stream.
+ **/
+GMimeStream *
+g_mime_stream_rope_new_with_chunk_size (size_t chunk_size)
+{
+	GMimeStreamRope *rope;
+	
+	g_return_val_if_fail (chunk_size > 0, NULL);
+	
+	rope = g_object_new (GMIME_TYPE_STREAM_ROPE, NULL);
+	g_mime_stream_construct ((GMimeStream *) rope, 0, -1);
+	rope->priv->chunks = g_ptr_array_new_with_free_func (g_free);
+	rope->priv->chunk_size = chunk_size;
+	
+	return (GMimeStream *) rope;
+}
+
+
+/**
+ * g_mime_stream_rope_get_chunk_size:
+ * @rope: a #GMimeStreamRope
+ *
+ * Gets the size of the chunks of memory used by @rope.
+ *
+ * Returns: the chunk size of @rope.
+ **/
+size_t
+g_mime_stream_rope_get_chunk_size (GMimeStreamRope *rope)
+{
+	g_return_val_if_fail (GMIME_IS_STREAM_ROPE (rope), 0);
+	
+	return rope_source (rope)->priv->chunk_size;
+}
+
+
+/**
+ * g_mime_stream_rope_flatten:
+ * @rope: a #GMimeStreamRope
+ *
+ * Copies the content of @rope (within its bounds) into a single
+ * contiguous buffer. The current position of @rope is not changed.
+ *
+ * Returns: (transfer full): a new #GByteArray containing the content
+ * of @rope or %NULL if @rope has been closed or its content is too
+ * large to fit in a #GByteArray.
+ **/
+GByteArray *
+g_mime_stream_rope_flatten (GMimeStreamRope *rope)
+{
+	GMimeStream *stream = (GMimeStream *) rope;
+	GMimeStreamRope *source;
+	gint64 bound_end, len;
+	GByteArray *array;
+	
+	g_return_val_if_fail (GMIME_IS_STREAM_ROPE (rope), NULL);
+	
+	source = rope_source (rope);
+	
+	if (source->priv->chunks == NULL)
+		return NULL;
+	
+	bound_end = stream->bound_end != -1 ? MIN (stream->bound_end, source->priv->length) : source->priv->length;
+	len = MAX (bound_end - stream->bound_start, 0);
+	
+	if (len > G_MAXUINT)
+		return NULL;
+	
+	array = g_byte_array_sized_new ((guint) len);
+	g_byte_array_set_size (array, (guint) len);
+	
+	if (len > 0)
+		rope_copy_out (source, stream->bound_start, (char *) array->data, (size_t) len);
+	
+	return array;
+}
+
+
+/**
+ * _g_mime_stream_rope_byte_at:
+ * @rope: a #GMimeStreamRope
+ * @offset: an offset relative to the start of @rope
+ *
+ * Gets the byte at @offset without changing the position of @rope.
+ *
+ * Returns: the byte at @offset or %-1 if @offset is outside of the
+ * bounds of @rope.
+ **/
+int
+_g_mime_stream_rope_byte_at (GMimeStreamRope *rope, gint64 offset)
+{
+	GMimeStream *stream = (GMimeStream *) rope;
+	GMimeStreamRope *source = rope_source (rope);
+	gint64 bound_end;
+	
+	if (source->priv->chunks == NULL || offset < 0)
+		return -1;
+	
+	bound_end = stream->bound_end != -1 ? MIN (stream->bound_end, source->priv->length) : source->priv->length;
+	offset += stream->bound_start;
+	
+	if (offset >= bound_end)
+		return -1;
+	
+	return ((unsigned char *) source->priv->chunks->pdata[offset / source->priv->chunk_size])[offset % source->priv->chunk_size];
+}
+
+
+/**
+ * _g_mime_stream_rope_write_chunks:
+ * @rope: a #GMimeStreamRope
+ * @length: the number of bytes to write
+ * @stream: the output stream
+ *
+ * Writes the first @length bytes of the stream that owns the chunks
+ * of @rope to @stream, one chunk at a time, without changing the
+ * position of @rope.
+ *
+ * Returns: %0 on success or %-1 on fail.
+ **/
+int
+_g_mime_stream_rope_write_chunks (GMimeStreamRope *rope, gint64 length, GMimeStream *stream)
+{
+	GMimeStreamRope *source = rope_source (rope);
+	size_t n;
+	guint i;
+	
+	if (source->priv->chunks == NULL || length > source->priv->length)
+		return -1;
+	
+	for (i = 0; length > 0; i++) {
+		n = (size_t) MIN ((gint64) source->priv->chunk_size, length);
+		
+		if (g_mime_stream_write (stream, source->priv->chunks->pdata[i], n) != (ssize_t) n)
+			return -1;
+		
+		length -= n;
+	}
+	
+	return 0;
+}
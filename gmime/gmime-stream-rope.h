@@ -0,0 +1,78 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2022 Jeffrey Stedfast
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+
+#ifndef __GMIME_STREAM_ROPE_H__
+#define __GMIME_STREAM_ROPE_H__
+
+#include <glib.h>
+#include <gmime/gmime-stream.h>
+
+G_BEGIN_DECLS
+
+#define GMIME_TYPE_STREAM_ROPE            (g_mime_stream_rope_get_type ())
+#define GMIME_STREAM_ROPE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GMIME_TYPE_STREAM_ROPE, GMimeStreamRope))
+#define GMIME_STREAM_ROPE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), GMIME_TYPE_STREAM_ROPE, GMimeStreamRopeClass))
+#define GMIME_IS_STREAM_ROPE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GMIME_TYPE_STREAM_ROPE))
+#define GMIME_IS_STREAM_ROPE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GMIME_TYPE_STREAM_ROPE))
+#define GMIME_STREAM_ROPE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GMIME_TYPE_STREAM_ROPE, GMimeStreamRopeClass))
+
+/**
+ * GMIME_STREAM_ROPE_DEFAULT_CHUNK_SIZE:
+ *
+ * The default size of each chunk of memory allocated by a
+ * #GMimeStreamRope.
+ **/
+#define GMIME_STREAM_ROPE_DEFAULT_CHUNK_SIZE 16384
+
+typedef struct _GMimeStreamRope GMimeStreamRope;
+typedef struct _GMimeStreamRopeClass GMimeStreamRopeClass;
+
+/**
+ * GMimeStreamRope:
+ * @parent_object: parent #GMimeStream
+ * @priv: private state data
+ *
+ * A memory-backed #GMimeStream made up of a list of fixed-size chunks.
+ **/
+struct _GMimeStreamRope {
+	GMimeStream parent_object;
+	
+	struct _GMimeStreamRopePrivate *priv;
+};
+
+struct _GMimeStreamRopeClass {
+	GMimeStreamClass parent_class;
+	
+};
+
+
+GType g_mime_stream_rope_get_type (void);
+
+GMimeStream *g_mime_stream_rope_new (void);
+GMimeStream *g_mime_stream_rope_new_with_chunk_size (size_t chunk_size);
+
+size_t g_mime_stream_rope_get_chunk_size (GMimeStreamRope *rope);
+
+GByteArray *g_mime_stream_rope_flatten (GMimeStreamRope *rope);
+
+G_END_DECLS
+
+#endif /* __GMIME_STREAM_ROPE_H__ */
@@ -0,0 +1,570 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2022 Jeffrey Stedfast
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib/gstdio.h>
+
+#include <string.h>
+#include <errno.h>
+
+#include "gmime-stream-spill.h"
+#include "gmime-stream-rope.h"
+#include "gmime-stream-fs.h"
+#include "gmime-internal.h"
+
+
+/**
+ * SECTION: gmime-stream-spill
+ * @title: GMimeStreamSpill
+ * @short_description: A memory stream that spills to disk
+ * @see_also: #GMimeStream, #GMimeStreamMem, #GMimeStreamFs
+ *
+ * A #GMimeStream which keeps its content in memory, like a
+ * #GMimeStreamMem, until the content grows beyond a threshold. At that
+ * point the content is moved into an anonymous temporary file and all
+ * further I/O is done on that file instead, which keeps the amount of
+ * memory used by very large content bounded.
+ *
+ * Substreams of a #GMimeStreamSpill share the content of the stream
+ * that they were created from, even if it is spilled to disk after
+ * the substream has been created.
+ *
+ * Once spilled, small sequential writes (such as the lines written by
+ * the parser) are gathered in a write-back buffer so that the file is
+ * written in large blocks.
+ **/
+
+/* the size of the write-back buffer used once the content has been spilled */
+#define SPILL_WRITE_SIZE (64 * 1024)
+
+struct _GMimeStreamSpillPrivate {
+	GMimeStreamSpill *source;  /* the stream that owns the backing store if this is a substream */
+	GMimeStream *backend;      /* the memory or file stream holding the content */
+	size_t threshold;
+	gint64 length;
+	gboolean spilled;
+	char *path;                /* the temporary file if it could not be unlinked while open */
+	
+	/* the write-back buffer */
+	char *wbuf;
+	size_t wlen;
+	gint64 wpos;
+};
+
+
+static void g_mime_stream_spill_class_init (GMimeStreamSpillClass *klass);
+static void g_mime_stream_spill_init (GMimeStreamSpill *stream, GMimeStreamSpillClass *klass);
+static void g_mime_stream_spill_finalize (GObject *object);
+
+static ssize_t stream_read (GMimeStream *stream, char *buf, size_t len);
+static ssize_t stream_write (GMimeStream *stream, const char *buf, size_t len);
+static int stream_flush (GMimeStream *stream);
+static int stream_close (GMimeStream *stream);
+static gboolean stream_eos (GMimeStream *stream);
+static int stream_reset (GMimeStream *stream);
+static gint64 stream_seek (GMimeStream *stream, gint64 offset, GMimeSeekWhence whence);
+static gint64 stream_tell (GMimeStream *stream);
+static gint64 stream_length (GMimeStream *stream);
+static GMimeStream *stream_substream (GMimeStream *stream, gint64 start, gint64 end);
+
+
+static GMimeStreamClass *parent_class = NULL;
+
+
+GType
+g_mime_stream_spill_get_type (void)
+{
+	static GType type = 0;
+	
+	if (!type) {
+		static const GTypeInfo info = {
+			sizeof (GMimeStreamSpillClass),
+			NULL, /* base_class_init */
+			NULL, /* base_class_finalize */
+			(GClassInitFunc) g_mime_stream_spill_class_init,
+			NULL, /* class_finalize */
+			NULL, /* class_data */
+			sizeof (GMimeStreamSpill),
+			0,    /* n_preallocs */
+			(GInstanceInitFunc) g_mime_stream_spill_init,
+		};
+		
+		type = g_type_register_static (GMIME_TYPE_STREAM, "GMimeStreamSpill", &info, 0);
+	}
+	
+	return type;
+}
+
+
+static void
+g_mime_stream_spill_class_init (GMimeStreamSpillClass *klass)
+{
+	GMimeStreamClass *stream_class = GMIME_STREAM_CLASS (klass);
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	
+	parent_class = g_type_class_ref (GMIME_TYPE_STREAM);
+	
+	object_class->finalize = g_mime_stream_spill_finalize;
+	
+	stream_class->read = stream_read;
+	stream_class->write = stream_write;
+	stream_class->flush = stream_flush;
+	stream_class->close = stream_close;
+	stream_class->eos = stream_eos;
+	stream_class->reset = stream_reset;
+	stream_class->seek = stream_seek;
+	stream_class->tell = stream_tell;
+	stream_class->length = stream_length;
+	stream_class->substream = stream_substream;
+}
+
+static void
+g_mime_stream_spill_init (GMimeStreamSpill *stream, GMimeStreamSpillClass *klass)
+{
+	stream->priv = g_new (struct _GMimeStreamSpillPrivate, 1);
+	stream->priv->threshold = GMIME_STREAM_SPILL_DEFAULT_THRESHOLD;
+	stream->priv->spilled = FALSE;
+	stream->priv->backend = NULL;
+	stream->priv->source = NULL;
+	stream->priv->path = NULL;
+	stream->priv->length = 0;
+	stream->priv->wbuf = NULL;
+	stream->priv->wlen = 0;
+	stream->priv->wpos = 0;
+}
+
+static void
+g_mime_stream_spill_finalize (GObject *object)
+{
+	GMimeStreamSpill *spill = (GMimeStreamSpill *) object;
+	
+	stream_close ((GMimeStream *) spill);
+	g_free (spill->priv);
+	
+	G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+
+/* substreams do all of their I/O on the stream that owns the content */
+static GMimeStreamSpill *
+spill_source (GMimeStreamSpill *spill)
+{
+	return spill->priv->source ? spill->priv->source : spill;
+}
+
+static int
+spill_to_disk (GMimeStreamSpill *spill)
+{
+	GMimeStreamRope *rope = (GMimeStreamRope *) spill->priv->backend;
+	GMimeStream *fs;
+	char *path;
+	int fd;
+	
+	if ((fd = g_file_open_tmp ("gmime-spill-XXXXXX", &path, NULL)) == -1)
+		return -1;
+	
+#ifndef G_OS_WIN32
+	/* nothing else ever needs to open the file by name */
+	g_unlink (path);
+	g_free (path);
+#else
+	/* an open file cannot be unlinked on Windows, so do it on close */
+	spill->priv->path = path;
+#endif
+	
+	fs = g_mime_stream_fs_new (fd);
+	
+	if (_g_mime_stream_rope_write_chunks (rope, spill->priv->length, fs) == -1) {
+		g_object_unref (fs);
+		
+		if (spill->priv->path) {
+			g_unlink (spill->priv->path);
+			g_free (spill->priv->path);
+			spill->priv->path = NULL;
+		}
+		
+		return -1;
+	}
+	
+	g_object_unref (spill->priv->backend);
+	spill->priv->backend = fs;
+	spill->priv->spilled = TRUE;
+	
+	return 0;
+}
+
+static int
+spill_seek_backend (GMimeStreamSpill *spill, gint64 position)
+{
+	if (g_mime_stream_tell (spill->priv->backend) == position)
+		return 0;
+	
+	return g_mime_stream_seek (spill->priv->backend, position, GMIME_STREAM_SEEK_SET) == -1 ? -1 : 0;
+}
+
+/* writes out whatever is pending in the write-back buffer */
+static int
+spill_flush_writes (GMimeStreamSpill *spill)
+{
+	if (spill->priv->wlen == 0)
+		return 0;
+	
+	if (spill_seek_backend (spill, spill->priv->wpos) == -1)
+		return -1;
+	
+	if (g_mime_stream_write (spill->priv->backend, spill->priv->wbuf, spill->priv->wlen) != (ssize_t) spill->priv->wlen)
+		return -1;
+	
+	spill->priv->wlen = 0;
+	
+	return 0;
+}
+
+static ssize_t
+spill_write_back (GMimeStreamSpill *spill, gint64 position, const char *buf, size_t len)
+{
+	/* gather writes that continue where the pending data ends */
+	if (spill->priv->wlen > 0 && (position != spill->priv->wpos + (gint64) spill->priv->wlen || spill->priv->wlen + len > SPILL_WRITE_SIZE)) {
+		if (spill_flush_writes (spill) == -1)
+			return -1;
+	}
+	
+	if (len >= SPILL_WRITE_SIZE) {
+		if (spill_seek_backend (spill, position) == -1)
+			return -1;
+		
+		return g_mime_stream_write (spill->priv->backend, buf, len);
+	}
+	
+	if (spill->priv->wbuf == NULL)
+		spill->priv->wbuf = g_malloc (SPILL_WRITE_SIZE);
+	
+	if (spill->priv->wlen == 0)
+		spill->priv->wpos = position;
+	
+	memcpy (spill->priv->wbuf + spill->priv->wlen, buf, len);
+	spill->priv->wlen += len;
+	
+	return (ssize_t) len;
+}
+
+static ssize_t
+stream_read (GMimeStream *stream, char *buf, size_t len)
+{
+	GMimeStreamSpill *source = spill_source ((GMimeStreamSpill *) stream);
+	gint64 bound_end;
+	ssize_t n;
+	
+	if (source->priv->backend == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	bound_end = stream->bound_end != -1 ? MIN (stream->bound_end, source->priv->length) : source->priv->length;
+	
+	n = (ssize_t) MIN (bound_end - stream->position, (gint64) len);
+	if (n > 0) {
+		if (spill_flush_writes (source) == -1)
+			return -1;
+		
+		if (spill_seek_backend (source, stream->position) == -1)
+			return -1;
+		
+		if ((n = g_mime_stream_read (source->priv->backend, buf, n)) > 0)
+			stream->position += n;
+	} else if (n < 0) {
+		errno = EINVAL;
+		n = -1;
+	}
+	
+	return n;
+}
+
+static ssize_t
+stream_write (GMimeStream *stream, const char *buf, size_t len)
+{
+	GMimeStreamSpill *source = spill_source ((GMimeStreamSpill *) stream);
+	ssize_t n;
+	
+	if (source->priv->backend == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	if (stream->bound_end != -1)
+		n = (ssize_t) MIN (stream->bound_end - stream->position, (gint64) len);
+	else
+		n = (ssize_t) len;
+	
+	if (n <= 0) {
+		if (n < 0) {
+			errno = EINVAL;
+			n = -1;
+		}
+		
+		return n;
+	}
+	
+	if (!source->priv->spilled && stream->position + n > (gint64) source->priv->threshold) {
+		if (spill_to_disk (source) == -1)
+			return -1;
+	}
+	
+	if (source->priv->spilled) {
+		n = spill_write_back (source, stream->position, buf, n);
+	} else {
+		if (spill_seek_backend (source, stream->position) == -1)
+			return -1;
+		
+		n = g_mime_stream_write (source->priv->backend, buf, n);
+	}
+	
+	if (n > 0) {
+		stream->position += n;
+		
+		if (stream->position > source->priv->length)
+			source->priv->length = stream->position;
+	}
+	
+	return n;
+}
+
+static int
+stream_flush (GMimeStream *stream)
+{
+	GMimeStreamSpill *source = spill_source ((GMimeStreamSpill *) stream);
+	
+	if (source->priv->backend == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	/* the temporary file itself never needs to be synced */
+	return spill_flush_writes (source);
+}
+
+static int
+stream_close (GMimeStream *stream)
+{
+	GMimeStreamSpill *spill = (GMimeStreamSpill *) stream;
+	
+	if (spill->priv->source) {
+		g_object_unref (spill->priv->source);
+		spill->priv->source = NULL;
+		return 0;
+	}
+	
+	if (spill->priv->backend) {
+		g_object_unref (spill->priv->backend);
+		spill->priv->backend = NULL;
+	}
+	
+	g_free (spill->priv->wbuf);
+	spill->priv->wbuf = NULL;
+	spill->priv->wlen = 0;
+	
+	if (spill->priv->path) {
+		g_unlink (spill->priv->path);
+		g_free (spill->priv->path);
+		spill->priv->path = NULL;
+	}
+	
+	return 0;
+}
+
+static gboolean
+stream_eos (GMimeStream *stream)
+{
+	GMimeStreamSpill *source = spill_source ((GMimeStreamSpill *) stream);
+	gint64 bound_end;
+	
+	if (source->priv->backend == NULL)
+		return TRUE;
+	
+	bound_end = stream->bound_end != -1 ? MIN (stream->bound_end, source->priv->length) : source->priv->length;
+	
+	return stream->position >= bound_end;
+}
+
+static int
+stream_reset (GMimeStream *stream)
+{
+	GMimeStreamSpill *source = spill_source ((GMimeStreamSpill *) stream);
+	
+	if (source->priv->backend == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	stream->position = stream->bound_start;
+	
+	return 0;
+}
+
+static gint64
+stream_seek (GMimeStream *stream, gint64 offset, GMimeSeekWhence whence)
+{
+	GMimeStreamSpill *source = spill_source ((GMimeStreamSpill *) stream);
+	gint64 bound_end, real = stream->position;
+	
+	if (source->priv->backend == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	bound_end = stream->bound_end != -1 ? stream->bound_end : source->priv->length;
+	
+	switch (whence) {
+	case GMIME_STREAM_SEEK_SET:
+		real = offset;
+		break;
+	case GMIME_STREAM_SEEK_END:
+		real = offset + bound_end;
+		break;
+	case GMIME_STREAM_SEEK_CUR:
+		real = stream->position + offset;
+		break;
+	}
+	
+	if (real < stream->bound_start || real > bound_end) {
+		errno = EINVAL;
+		return -1;
+	}
+	
+	stream->position = real;
+	
+	return stream->position;
+}
+
+static gint64
+stream_tell (GMimeStream *stream)
+{
+	return stream->position;
+}
+
+static gint64
+stream_length (GMimeStream *stream)
+{
+	GMimeStreamSpill *source = spill_source ((GMimeStreamSpill *) stream);
+	gint64 bound_end;
+	
+	if (source->priv->backend == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	bound_end = stream->bound_end != -1 ? stream->bound_end : source->priv->length;
+	
+	return bound_end - stream->bound_start;
+}
+
+static GMimeStream *
+stream_substream (GMimeStream *stream, gint64 start, gint64 end)
+{
+	GMimeStreamSpill *source = spill_source ((GMimeStreamSpill *) stream);
+	GMimeStreamSpill *spill;
+	
+	spill = g_object_new (GMIME_TYPE_STREAM_SPILL, NULL);
+	g_mime_stream_construct ((GMimeStream *) spill, start, end);
+	spill->priv->source = g_object_ref (source);
+	spill->priv->threshold = source->priv->threshold;
+	
+	return (GMimeStream *) spill;
+}
+
+
+/**
+ * g_mime_stream_spill_new:
+ *
+ * Creates a new #GMimeStreamSpill object which keeps up to
+ * #GMIME_STREAM_SPILL_DEFAULT_THRESHOLD bytes of content in memory.
+ *
+ * Returns: a new spill stream.
+ **/
+GMimeStream *
+g_mime_stream_spill_new (void)
+{
+	return g_mime_stream_spill_new_with_threshold (GMIME_STREAM_SPILL_DEFAULT_THRESHOLD);
+}
+
+
+/**
+ * g_mime_stream_spill_new_with_threshold:
+ * @threshold: the number of bytes to keep in memory
+ *
+ * Creates a new #GMimeStreamSpill object which keeps its content in
+ * memory until it grows larger than @threshold bytes, at which point
+ * the content is moved to an anonymous temporary file.
+ *
+ * Returns: a new spill stream.
+ **/
+GMimeStream *
+g_mime_stream_spill_new_with_threshold (size_t threshold)
+{
+	GMimeStreamSpill *spill;
+	
+	spill = g_object_new (GMIME_TYPE_STREAM_SPILL, NULL);
+	g_mime_stream_construct ((GMimeStream *) spill, 0, -1);
+	spill->priv->backend = g_mime_stream_rope_new ();
+	spill->priv->threshold = threshold;
+	
+	return (GMimeStream *) spill;
+}
+
+
+/**
+ * g_mime_stream_spill_get_threshold:
+ * @stream: a #GMimeStreamSpill
+ *
+ * Gets the number of bytes that @stream keeps in memory before
+ * spilling its content to disk.
+ *
+ * Returns: the threshold of @stream.
+ **/
+size_t
+g_mime_stream_spill_get_threshold (GMimeStreamSpill *stream)
+{
+	g_return_val_if_fail (GMIME_IS_STREAM_SPILL (stream), 0);
+	
+	return spill_source (stream)->priv->threshold;
+}
+
+
+/**
+ * g_mime_stream_spill_get_spilled:
+ * @stream: a #GMimeStreamSpill
+ *
+ * Gets whether or not the content of @stream has been moved to a
+ * temporary file.
+ *
+ * Returns: %TRUE if the content of @stream has been spilled to disk or
+ * %FALSE if it is still held in memory.
+ **/
+gboolean
+g_mime_stream_spill_get_spilled (GMimeStreamSpill *stream)
+{
+	g_return_val_if_fail (GMIME_IS_STREAM_SPILL (stream), FALSE);
+	
+	return spill_source (stream)->priv->spilled;
+}
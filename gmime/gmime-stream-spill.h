@@ -0,0 +1,78 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2022 Jeffrey Stedfast
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+
+#ifndef __GMIME_STREAM_SPILL_H__
+#define __GMIME_STREAM_SPILL_H__
+
+#include <glib.h>
+#include <gmime/gmime-stream.h>
+
+G_BEGIN_DECLS
+
+#define GMIME_TYPE_STREAM_SPILL            (g_mime_stream_spill_get_type ())
+#define GMIME_STREAM_SPILL(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GMIME_TYPE_STREAM_SPILL, GMimeStreamSpill))
+#define GMIME_STREAM_SPILL_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), GMIME_TYPE_STREAM_SPILL, GMimeStreamSpillClass))
+#define GMIME_IS_STREAM_SPILL(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GMIME_TYPE_STREAM_SPILL))
+#define GMIME_IS_STREAM_SPILL_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GMIME_TYPE_STREAM_SPILL))
+#define GMIME_STREAM_SPILL_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GMIME_TYPE_STREAM_SPILL, GMimeStreamSpillClass))
+
+/**
+ * GMIME_STREAM_SPILL_DEFAULT_THRESHOLD:
+ *
+ * The default number of bytes that a #GMimeStreamSpill will keep in
+ * memory before spilling its content to a temporary file.
+ **/
+#define GMIME_STREAM_SPILL_DEFAULT_THRESHOLD (1024 * 1024)
+
+typedef struct _GMimeStreamSpill GMimeStreamSpill;
+typedef struct _GMimeStreamSpillClass GMimeStreamSpillClass;
+
+/**
+ * GMimeStreamSpill:
+ * @parent_object: parent #GMimeStream
+ * @priv: private state data
+ *
+ * A #GMimeStream which keeps its content in memory until it grows
+ * beyond a threshold and then moves it to a temporary file.
+ **/
+struct _GMimeStreamSpill {
+	GMimeStream parent_object;
+	
+	struct _GMimeStreamSpillPrivate *priv;
+};
+
+struct _GMimeStreamSpillClass {
+	GMimeStreamClass parent_class;
+	
+};
+
+
+GType g_mime_stream_spill_get_type (void);
+
+GMimeStream *g_mime_stream_spill_new (void);
+GMimeStream *g_mime_stream_spill_new_with_threshold (size_t threshold);
+
+size_t g_mime_stream_spill_get_threshold (GMimeStreamSpill *stream);
+gboolean g_mime_stream_spill_get_spilled (GMimeStreamSpill *stream);
+
+G_END_DECLS
+
+#endif /* __GMIME_STREAM_SPILL_H__ */
@@ -476,11 +476,91 @@ format_timezone_identifier (char *identifier, int len, char sign, int tz_offset)
 	return snprintf (identifier, len, "%c%02d:%02d:00", sign, hours, minutes);
 }
 
+static GHashTable *tzone_cache = NULL;
+
+#ifdef G_THREADS_ENABLED
+static GMutex tzone_lock;
+#define TZONE_CACHE_UNLOCK() g_mutex_unlock (&tzone_lock);
+#define TZONE_CACHE_LOCK() g_mutex_lock (&tzone_lock);
+#else
+#define TZONE_CACHE_UNLOCK()
+#define TZONE_CACHE_LOCK()
+#endif /* G_THREADS_ENABLED */
+
+/* charset name -> CharsetProbe (see g_mime_utils_decode_8bit()) */
+static GHashTable *charset_probes = NULL;
+
+#ifdef G_THREADS_ENABLED
+static GMutex probe_lock;
+#define CHARSET_PROBES_UNLOCK() g_mutex_unlock (&probe_lock);
+#define CHARSET_PROBES_LOCK() g_mutex_lock (&probe_lock);
+#else
+#define CHARSET_PROBES_UNLOCK()
+#define CHARSET_PROBES_LOCK()
+#endif /* G_THREADS_ENABLED */
+
+void
+g_mime_utils_init (void)
+{
+	if (tzone_cache == NULL)
+		tzone_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_time_zone_unref);
+	
+	if (charset_probes == NULL)
+		charset_probes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+}
+
+void
+g_mime_utils_shutdown (void)
+{
+	TZONE_CACHE_LOCK ();
+	if (tzone_cache != NULL) {
+		g_hash_table_destroy (tzone_cache);
+		tzone_cache = NULL;
+	}
+	TZONE_CACHE_UNLOCK ();
+	
+	CHARSET_PROBES_LOCK ();
+	if (charset_probes != NULL) {
+		g_hash_table_destroy (charset_probes);
+		charset_probes = NULL;
+	}
+	CHARSET_PROBES_UNLOCK ();
+}
+
+/* Note: @tz_offset is in the rfc822 HHMM form (e.g. -0500 for EST) */
+static GTimeZone *
+get_tzone_for_offset (char sign, int tz_offset)
+{
+	gpointer key = GINT_TO_POINTER (sign == '-' ? -(tz_offset + 1) : tz_offset);
+	char identifier[10];
+	GTimeZone *tz;
+	
+	TZONE_CACHE_LOCK ();
+	if (tzone_cache != NULL && (tz = g_hash_table_lookup (tzone_cache, key))) {
+		g_time_zone_ref (tz);
+		TZONE_CACHE_UNLOCK ();
+		return tz;
+	}
+	TZONE_CACHE_UNLOCK ();
+	
+	if (format_timezone_identifier (identifier, sizeof (identifier), sign, tz_offset) < 0)
+		return NULL;
+	
+	if (!(tz = g_time_zone_new_identifier (identifier)))
+		return NULL;
+	
+	TZONE_CACHE_LOCK ();
+	if (tzone_cache != NULL)
+		g_hash_table_replace (tzone_cache, key, g_time_zone_ref (tz));
+	TZONE_CACHE_UNLOCK ();
+	
+	return tz;
+}
+
 static GTimeZone *
 get_tzone (date_token **token)
 {
 	const char *inptr, *inend;
-	char identifier[10];
 	int tz_offset, i;
 	size_t len, n;
 	guint t;
@@ -496,11 +576,8 @@ get_tzone (date_token **token)
 		if (len == 5 && (*inptr == '+' || *inptr == '-')) {
 			if ((tz_offset = decode_int (inptr + 1, len - 1)) == -1)
 				return NULL;
-
-			if (format_timezone_identifier (identifier, sizeof (identifier), *inptr, tz_offset) < 0)
-				return NULL;
 			
-			return g_time_zone_new_identifier (identifier);
+			return get_tzone_for_offset (*inptr, tz_offset);
 		}
 		
 		if (*inptr == '(') {
@@ -517,14 +594,7 @@ get_tzone (date_token **token)
 			if (n != len || strncmp (inptr, tz_offsets[t].name, n) != 0)
 				continue;
 			
-			// TODO: modify the struct to have an `identifier` field instead of `offset` that is a pre-formatted string?
-			char sign = tz_offsets[t].offset < 0 ? '-' : '+';
-			tz_offset = ABS(tz_offsets[t].offset);
-
-			if (format_timezone_identifier (identifier, sizeof (identifier), sign, tz_offset) < 0)
-				return NULL;
-			
-			return g_time_zone_new_identifier (identifier);
+			return get_tzone_for_offset (tz_offsets[t].offset < 0 ? '-' : '+', ABS (tz_offsets[t].offset));
 		}
 	}
 	
@@ -588,6 +658,147 @@ parse_rfc822_date (date_token *tokens)
 }
 
 
+#define is_date_lwsp(c) ((c) == ' ' || (c) == '\t')
+
+static gboolean
+decode_fixed_int (const char **in, int ndigits, int *val)
+{
+	register const char *inptr = *in;
+	int i;
+	
+	*val = 0;
+	
+	for (i = 0; i < ndigits; i++) {
+		if (!(inptr[i] >= '0' && inptr[i] <= '9'))
+			return FALSE;
+		
+		*val = (*val * 10) + (inptr[i] - '0');
+	}
+	
+	*in = inptr + ndigits;
+	
+	return TRUE;
+}
+
+static gboolean
+skip_date_lwsp (const char **in)
+{
+	register const char *inptr = *in;
+	
+	if (!is_date_lwsp (*inptr))
+		return FALSE;
+	
+	while (is_date_lwsp (*inptr))
+		inptr++;
+	
+	*in = inptr;
+	
+	return TRUE;
+}
+
+/* Parses dates in the canonical "[Day,] DD Mon YYYY HH:MM[:SS] +ZZZZ" form
+ * without tokenizing them first. Anything that deviates from this form
+ * (or that would not produce the exact same result as parse_rfc822_date)
+ * is rejected so that the caller can fall back to the tolerant parser. */
+static GDateTime *
+parse_canonical_date (const char *in)
+{
+	int year, month, day, hour, min, sec, tz_offset;
+	const char *inptr = in;
+	GDateTime *date;
+	GTimeZone *tz;
+	char sign;
+	
+	while (is_date_lwsp (*inptr))
+		inptr++;
+	
+	/* optional day-of-week */
+	if (!(*inptr >= '0' && *inptr <= '9')) {
+		if (inptr[0] == '\0' || inptr[1] == '\0' || inptr[2] == '\0')
+			return NULL;
+		
+		if (get_wday (inptr, 3) == -1)
+			return NULL;
+		
+		inptr += 3;
+		
+		if (*inptr == ',') {
+			inptr++;
+			while (is_date_lwsp (*inptr))
+				inptr++;
+		} else if (!skip_date_lwsp (&inptr)) {
+			return NULL;
+		}
+	}
+	
+	/* day-of-month: 1 or 2 digits */
+	if (!decode_fixed_int (&inptr, 1, &day))
+		return NULL;
+	
+	if (*inptr >= '0' && *inptr <= '9')
+		day = (day * 10) + (*inptr++ - '0');
+	
+	if (day < 1 || day > 31 || !skip_date_lwsp (&inptr))
+		return NULL;
+	
+	/* month */
+	if (inptr[0] == '\0' || inptr[1] == '\0' || inptr[2] == '\0')
+		return NULL;
+	
+	if ((month = get_month (inptr, 3)) == -1)
+		return NULL;
+	
+	inptr += 3;
+	
+	if (!skip_date_lwsp (&inptr))
+		return NULL;
+	
+	/* 4-digit year */
+	if (!decode_fixed_int (&inptr, 4, &year) || year < 1969 || !skip_date_lwsp (&inptr))
+		return NULL;
+	
+	/* HH:MM[:SS] */
+	if (!decode_fixed_int (&inptr, 2, &hour) || hour > 23 || *inptr++ != ':')
+		return NULL;
+	
+	if (!decode_fixed_int (&inptr, 2, &min) || min > 59)
+		return NULL;
+	
+	if (*inptr == ':') {
+		inptr++;
+		
+		if (!decode_fixed_int (&inptr, 2, &sec) || sec > 60)
+			return NULL;
+	} else {
+		sec = 0;
+	}
+	
+	if (!skip_date_lwsp (&inptr))
+		return NULL;
+	
+	/* +ZZZZ */
+	if (*inptr != '+' && *inptr != '-')
+		return NULL;
+	
+	sign = *inptr++;
+	
+	if (!decode_fixed_int (&inptr, 4, &tz_offset))
+		return NULL;
+	
+	/* anything after the timezone is ignored by parse_rfc822_date() */
+	if (*inptr != '\0' && !is_date_lwsp (*inptr) && *inptr != '\r' && *inptr != '\n')
+		return NULL;
+	
+	if (!(tz = get_tzone_for_offset (sign, tz_offset)))
+		tz = g_time_zone_new_utc ();
+	
+	date = g_date_time_new (tz, year, month, day, hour, min, (gdouble) sec);
+	g_time_zone_unref (tz);
+	
+	return date;
+}
+
+
 #define date_token_mask(t)  (((date_token *) t)->mask)
 #define is_numeric(t)       ((date_token_mask (t) & DATE_TOKEN_NON_NUMERIC) == 0)
 #define is_weekday(t)       ((date_token_mask (t) & DATE_TOKEN_NON_WEEKDAY) == 0)
@@ -774,6 +985,9 @@ g_mime_utils_header_decode_date (const char *str)
 	date_token *token, *tokens;
 	GDateTime *date;
 	
+	if ((date = parse_canonical_date (str)))
+		return date;
+	
 	if (!(tokens = datetok (str)))
 		return NULL;
 	
@@ -1094,11 +1308,13 @@ g_mime_utils_best_encoding (const unsigned char *text, size_t len)
 /**
  * charset_convert:
  * @cd: iconv converter
+ * @native: the built-in converter for the charsets of @cd or %NULL
  * @inbuf: input text buffer to convert
  * @inleft: length of the input buffer
  * @outp: pointer to output buffer
  * @outlenp: pointer to output buffer length
  * @ninval: the number of invalid bytes in @inbuf
+ * @ascii_superset: %TRUE if both charsets of @cd are supersets of US-ASCII
  *
  * Converts the input buffer from one charset to another using the
  * @cd. On completion, @outp will point to the output buffer
@@ -1114,10 +1330,14 @@ g_mime_utils_best_encoding (const unsigned char *text, size_t len)
  * pre-allocated buffer of length *@outlenp. This is done so that the
  * same output buffer can be reused multiple times.
  *
+ * If @ascii_superset is %TRUE and @inbuf is pure ASCII, then it is
+ * copied as-is without going through iconv at all.
+ *
  * Returns: the string length of the output buffer.
  **/
 static size_t
-charset_convert (iconv_t cd, const char *inbuf, size_t inleft, char **outp, size_t *outlenp, size_t *ninval)
+charset_convert (iconv_t cd, const GMimeIconvNative *native, const char *inbuf, size_t inleft, char **outp, size_t *outlenp,
+		 size_t *ninval, gboolean ascii_superset)
 {
 	size_t outlen, outleft, rc, n = 0;
 	char *outbuf, *out;
@@ -1130,8 +1350,20 @@ charset_convert (iconv_t cd, const char *inbuf, size_t inleft, char **outp, size
 		outbuf = out = *outp;
 	}
 	
+	if (ascii_superset && _g_mime_ascii_span (inbuf, inleft) == inleft) {
+		/* pure ASCII converts to itself */
+		if (outlen < inleft) {
+			outlen = inleft;
+			out = g_realloc (out, outlen + 1);
+		}
+		
+		memcpy (out, inbuf, inleft);
+		outbuf = out + inleft;
+		goto done;
+	}
+	
 	do {
-		rc = iconv (cd, (char **) &inbuf, &inleft, &outbuf, &outleft);
+		rc = _g_mime_iconv (cd, native, (char **) &inbuf, &inleft, &outbuf, &outleft);
 		if (rc == (size_t) -1) {
 			if (errno == EINVAL) {
 				/* incomplete sequence at the end of the input buffer */
@@ -1182,6 +1414,7 @@ charset_convert (iconv_t cd, const char *inbuf, size_t inleft, char **outp, size
 		outbuf = out + rc;
 	}
 	
+ done:
 	*outbuf = '\0';
 	
 	*outlenp = outlen;
@@ -1192,6 +1425,161 @@ charset_convert (iconv_t cd, const char *inbuf, size_t inleft, char **outp, size
 }
 
 
+/* How g_mime_utils_decode_8bit() can score a fallback charset
+ * without converting the text into it */
+typedef enum {
+	CHARSET_KIND_OTHER,        /* has to be converted to be scored */
+	CHARSET_KIND_UTF8,         /* scored by a UTF-8 state machine */
+	CHARSET_KIND_SINGLE_BYTE   /* scored by which bytes it cannot convert */
+} CharsetKind;
+
+typedef struct {
+	CharsetKind kind;
+	guint8 invalid[256];
+} CharsetProbe;
+
+/* finds out whether @charset is a single-byte charset (i.e. every byte
+ * either converts into a character on its own or is invalid) and, if
+ * so, which bytes iconv cannot convert */
+static void
+charset_probe_bytes (const char *charset, CharsetProbe *probe)
+{
+	size_t inleft, outleft, rc;
+	char *inbuf, *outbuf;
+	char out[16], c;
+	iconv_t cd;
+	guint i;
+	
+	probe->kind = CHARSET_KIND_OTHER;
+	
+	if ((cd = g_mime_iconv_open ("UTF-8", charset)) == (iconv_t) -1)
+		return;
+	
+	for (i = 0; i < 256; i++) {
+		c = (char) i;
+		inbuf = &c;
+		inleft = 1;
+		outbuf = out;
+		outleft = sizeof (out);
+		
+		rc = iconv (cd, &inbuf, &inleft, &outbuf, &outleft);
+		iconv (cd, NULL, NULL, NULL, NULL);
+		
+		if (rc == (size_t) -1 && errno == EILSEQ) {
+			probe->invalid[i] = 1;
+		} else if (rc == (size_t) -1 || outbuf == out) {
+			/* the start of a multibyte sequence or a shift sequence */
+			g_mime_iconv_close (cd);
+			return;
+		} else {
+			probe->invalid[i] = 0;
+		}
+	}
+	
+	g_mime_iconv_close (cd);
+	
+	probe->kind = CHARSET_KIND_SINGLE_BYTE;
+}
+
+static void
+charset_probe (const char *charset, CharsetProbe *probe)
+{
+	const char *name = g_mime_charset_canon_name (charset);
+	CharsetProbe *cached;
+	
+	if (!g_ascii_strcasecmp (name, "utf-8")) {
+		probe->kind = CHARSET_KIND_UTF8;
+		return;
+	}
+	
+	CHARSET_PROBES_LOCK ();
+	if (charset_probes != NULL && (cached = g_hash_table_lookup (charset_probes, name))) {
+		memcpy (probe, cached, sizeof (CharsetProbe));
+		CHARSET_PROBES_UNLOCK ();
+		return;
+	}
+	CHARSET_PROBES_UNLOCK ();
+	
+	charset_probe_bytes (charset, probe);
+	
+	CHARSET_PROBES_LOCK ();
+	if (charset_probes != NULL && !g_hash_table_lookup (charset_probes, name)) {
+		cached = g_new (CharsetProbe, 1);
+		memcpy (cached, probe, sizeof (CharsetProbe));
+		g_hash_table_insert (charset_probes, g_strdup (name), cached);
+	}
+	CHARSET_PROBES_UNLOCK ();
+}
+
+/* Makes a single pass over @text, counting how often each byte occurs
+ * (which scores all of the single-byte charsets) and, if @utf8_ninval
+ * is non-NULL, the number of bytes that charset_convert() would fail to
+ * convert from UTF-8. Runs of ASCII are skipped unless @count_ascii is
+ * set. */
+static void
+charset_scan (const unsigned char *text, size_t len, gboolean count_ascii, size_t counts[256], size_t *utf8_ninval)
+{
+	register const unsigned char *inptr = text;
+	const unsigned char *inend = inptr + len;
+	unsigned char c, min = 0x80, max = 0xbf;
+	size_t ninval = 0, seq = 0;
+	guint need = 0;
+	
+	memset (counts, 0, sizeof (size_t) * 256);
+	
+	while (inptr < inend) {
+		if (need == 0 && !count_ascii) {
+			inptr += _g_mime_ascii_span ((const char *) inptr, inend - inptr);
+			if (inptr == inend)
+				break;
+		}
+		
+		c = *inptr++;
+		counts[c]++;
+		
+		if (utf8_ninval == NULL)
+			continue;
+		
+		if (need > 0) {
+			if (c >= min && c <= max) {
+				min = 0x80;
+				max = 0xbf;
+				
+				if (--need == 0)
+					seq = 0;
+				else
+					seq++;
+				
+				continue;
+			}
+			
+			/* iconv rejects the lead byte and then each of the
+			 * continuation bytes after it, one at a time */
+			ninval += seq;
+			need = 0;
+			seq = 0;
+		}
+		
+		if (c < 0x80)
+			continue;
+		
+		if (c < 0xc2 || c > 0xf4) {
+			ninval++;
+			continue;
+		}
+		
+		need = c >= 0xf0 ? 3 : c >= 0xe0 ? 2 : 1;
+		min = c == 0xe0 ? 0xa0 : c == 0xf0 ? 0x90 : 0x80;
+		max = c == 0xed ? 0x9f : c == 0xf4 ? 0x8f : 0xbf;
+		seq = 1;
+	}
+	
+	/* an incomplete sequence at the end is not converted either */
+	if (utf8_ninval != NULL)
+		*utf8_ninval = ninval + seq;
+}
+
+
 /**
  * g_mime_utils_decode_8bit:
  * @options: (nullable): a #GMimeParserOptions or %NULL
@@ -1205,37 +1593,109 @@ charset_convert (iconv_t cd, const char *inbuf, size_t inleft, char **outp, size
  * it will choose the best match and convert invalid byte sequences
  * into question-marks (?) in the returned string buffer.
  *
+ * UTF-8 and single-byte charsets are all scored in a single pass over
+ * @text, so that the text only needs to be converted once; any other
+ * charsets get scored by converting the text into them.
+ *
  * Returns: a UTF-8 string representation of @text.
  **/
 char *
 g_mime_utils_decode_8bit (GMimeParserOptions *options, const char *text, size_t len)
 {
-	size_t outleft, outlen, min, ninval;
+	size_t outleft, outlen, min, ninval, utf8_ninval = 0;
+	const GMimeIconvNative *native;
+	gboolean ascii, count_ascii = FALSE;
+	gboolean scan = FALSE, utf8 = FALSE;
 	const char **charsets;
+	int utf8_valid = -1;
+	CharsetProbe *probes;
+	size_t counts[256];
 	const char *best;
+	char *out = NULL;
+	guint n, i, c;
 	iconv_t cd;
-	char *out;
-	int i;
 	
 	g_return_val_if_fail (text != NULL, NULL);
 	
 	charsets = g_mime_parser_options_get_fallback_charsets (options);
-	best = charsets[0];
-	min = len;
+	ascii = _g_mime_ascii_span (text, len) == len;
 	
-	outleft = (len * 2) + 16;
-	out = g_malloc (outleft + 1);
+	for (n = 0; charsets[n]; n++)
+		;
 	
-	for (i = 0; charsets[i]; i++) {
-		if ((cd = g_mime_iconv_open ("UTF-8", charsets[i])) == (iconv_t) -1)
-			continue;
+	probes = g_new (CharsetProbe, n);
+	
+	for (i = 0; i < n; i++) {
+		/* check whether iconv would just hand us back the text as-is */
+		if (ascii && _g_mime_charset_is_ascii_superset (charsets[i])) {
+			g_free (probes);
+			
+			return g_strndup (text, len);
+		}
 		
-		outlen = charset_convert (cd, text, len, &out, &outleft, &ninval);
+		charset_probe (charsets[i], &probes[i]);
 		
-		g_mime_iconv_close (cd);
+		if (probes[i].kind == CHARSET_KIND_SINGLE_BYTE) {
+			for (c = 0; c < 0x80 && !count_ascii; c++)
+				count_ascii = probes[i].invalid[c];
+			scan = TRUE;
+		} else if (probes[i].kind == CHARSET_KIND_UTF8) {
+			if (utf8_valid == -1)
+				utf8_valid = _g_mime_utf8_validate (text, len);
+			
+			if (utf8_valid) {
+				/* none of the charsets after this one can win */
+				n = i + 1;
+				break;
+			}
+			
+			utf8 = scan = TRUE;
+		}
+	}
+	
+	if (scan)
+		charset_scan ((const unsigned char *) text, len, count_ascii, counts, utf8 ? &utf8_ninval : NULL);
+	
+	best = charsets[0];
+	min = len;
+	
+	for (i = 0; i < n; i++) {
+		switch (probes[i].kind) {
+		case CHARSET_KIND_UTF8:
+			ninval = utf8_ninval;
+			break;
+		case CHARSET_KIND_SINGLE_BYTE:
+			for (ninval = 0, c = 0; c < 256; c++) {
+				if (probes[i].invalid[c])
+					ninval += counts[c];
+			}
+			break;
+		default:
+			if ((cd = g_mime_iconv_open ("UTF-8", charsets[i])) == (iconv_t) -1)
+				continue;
+			
+			if (out == NULL) {
+				outleft = (len * 2) + 16;
+				out = g_malloc (outleft + 1);
+			}
+			
+			native = _g_mime_iconv_native_lookup ("UTF-8", charsets[i]);
+			outlen = charset_convert (cd, native, text, len, &out, &outleft, &ninval, FALSE);
+			
+			g_mime_iconv_close (cd);
+			
+			if (ninval == 0) {
+				g_free (probes);
+				
+				return g_realloc (out, outlen + 1);
+			}
+			break;
+		}
 		
-		if (ninval == 0)
-			return g_realloc (out, outlen + 1);
+		if (ninval == 0) {
+			best = charsets[i];
+			break;
+		}
 		
 		if (ninval < min) {
 			best = charsets[i];
@@ -1243,9 +1703,26 @@ g_mime_utils_decode_8bit (GMimeParserOptions *options, const char *text, size_t
 		}
 	}
 	
-	/* if we get here, then none of the charsets fit the 8bit text flawlessly...
-	 * try to find the one that fit the best and use that to convert what we can,
-	 * replacing any byte we can't convert with a '?' */
+	/* valid UTF-8 needs no conversion at all */
+	if (i < n && probes[i].kind == CHARSET_KIND_UTF8) {
+		g_free (probes);
+		g_free (out);
+		
+		return g_strndup (text, len);
+	}
+	
+	g_free (probes);
+	
+	if (out == NULL) {
+		outleft = (len * 2) + 16;
+		out = g_malloc (outleft + 1);
+	}
+	
+	/* if we get here, then either the text fit one of the charsets that
+	 * we were able to score without converting the text, or none of the
+	 * charsets fit the 8bit text flawlessly... in which case, use the one
+	 * that fit the best to convert what we can, replacing any byte we
+	 * can't convert with a '?' */
 	
 	if ((cd = g_mime_iconv_open ("UTF-8", best)) == (iconv_t) -1) {
 		/* this shouldn't happen... but if we are here, then
@@ -1269,7 +1746,8 @@ g_mime_utils_decode_8bit (GMimeParserOptions *options, const char *text, size_t
 		return g_realloc (out, (size_t) (outbuf - out));
 	}
 	
-	outlen = charset_convert (cd, text, len, &out, &outleft, &ninval);
+	native = _g_mime_iconv_native_lookup ("UTF-8", best);
+	outlen = charset_convert (cd, native, text, len, &out, &outleft, &ninval, _g_mime_charset_is_ascii_superset (best));
 	
 	g_mime_iconv_close (cd);
 	
@@ -1406,7 +1884,6 @@ is_rfc2047_token (const char *inptr, size_t len)
 
 
 typedef struct _rfc2047_token {
-	struct _rfc2047_token *next;
 	const char *charset;
 	const char *text;
 	size_t length;
@@ -1414,25 +1891,58 @@ typedef struct _rfc2047_token {
 	char is_8bit;
 } rfc2047_token;
 
-#define rfc2047_token_list_free(tokens) g_slice_free_chain (rfc2047_token, tokens, next)
-#define rfc2047_token_free(token) g_slice_free (rfc2047_token, token)
+#define RFC2047_INLINE_TOKENS 32
+
+/* Most headers consist of only a handful of tokens, so they are stored in
+ * an array that only spills over to the heap for unusually long headers. */
+typedef struct {
+	rfc2047_token inline_tokens[RFC2047_INLINE_TOKENS];
+	rfc2047_token *tokens;
+	guint count, size;
+} rfc2047_token_list;
+
+static void
+rfc2047_token_list_init (rfc2047_token_list *list)
+{
+	list->tokens = list->inline_tokens;
+	list->size = RFC2047_INLINE_TOKENS;
+	list->count = 0;
+}
+
+static void
+rfc2047_token_list_clear (rfc2047_token_list *list)
+{
+	if (list->tokens != list->inline_tokens)
+		g_free (list->tokens);
+}
 
 static rfc2047_token *
-rfc2047_token_new (const char *text, size_t len)
+rfc2047_token_list_append (rfc2047_token_list *list, const char *text, size_t len)
 {
 	rfc2047_token *token;
 	
-	token = g_slice_new0 (rfc2047_token);
+	if (list->count == list->size) {
+		list->size *= 2;
+		
+		if (list->tokens == list->inline_tokens) {
+			list->tokens = g_new (rfc2047_token, list->size);
+			memcpy (list->tokens, list->inline_tokens, sizeof (list->inline_tokens));
+		} else {
+			list->tokens = g_renew (rfc2047_token, list->tokens, list->size);
+		}
+	}
+	
+	token = &list->tokens[list->count++];
+	memset (token, 0, sizeof (rfc2047_token));
 	token->length = len;
 	token->text = text;
 	
 	return token;
 }
 
-static rfc2047_token *
-rfc2047_token_new_encoded_word (const char *word, size_t len)
+static gboolean
+rfc2047_token_parse_encoded_word (rfc2047_token *token, const char *word, size_t len)
 {
-	rfc2047_token *token;
 	const char *payload;
 	const char *charset;
 	const char *inptr;
@@ -1442,7 +1952,7 @@ rfc2047_token_new_encoded_word (const char *word, size_t len)
 	
 	/* check that this could even be an encoded-word token */
 	if (len < 7 || strncmp (word, "=?", 2) != 0 || strncmp (word + len - 2, "?=", 2) != 0)
-		return NULL;
+		return FALSE;
 	
 	/* skip over '=?' */
 	inptr = word + 2;
@@ -1450,12 +1960,12 @@ rfc2047_token_new_encoded_word (const char *word, size_t len)
 	
 	if (*charset == '?' || *charset == '*') {
 		/* this would result in an empty charset */
-		return NULL;
+		return FALSE;
 	}
 	
 	/* skip to the end of the charset */
 	if (!(inptr = memchr (inptr, '?', len - 2)) || inptr[2] != '?')
-		return NULL;
+		return FALSE;
 	
 	/* copy the charset into a buffer */
 	n = (size_t) (inptr - charset);
@@ -1480,7 +1990,7 @@ rfc2047_token_new_encoded_word (const char *word, size_t len)
 	
 	/* make sure the first char after the encoding is another '?' */
 	if (inptr[1] != '?')
-		return NULL;
+		return FALSE;
 	
 	switch (*inptr++) {
 	case 'B': case 'b':
@@ -1490,7 +2000,7 @@ rfc2047_token_new_encoded_word (const char *word, size_t len)
 		encoding = 'Q';
 		break;
 	default:
-		return NULL;
+		return FALSE;
 	}
 	
 	/* the payload begins right after the '?' */
@@ -1501,21 +2011,25 @@ rfc2047_token_new_encoded_word (const char *word, size_t len)
 	
 	/* make sure that we don't have something like: =?iso-8859-1?Q?= */
 	if (payload > inptr)
-		return NULL;
+		return FALSE;
 	
-	token = rfc2047_token_new (payload, inptr - payload);
 	token->charset = g_mime_charset_iconv_name (charset);
+	token->length = inptr - payload;
 	token->encoding = encoding;
+	token->text = payload;
+	token->is_8bit = 0;
 	
-	return token;
+	return TRUE;
 }
 
-static rfc2047_token *
-tokenize_rfc2047_phrase (GMimeParserOptions *options, const char *in, size_t *len, gint64 offset)
+static void
+tokenize_rfc2047_phrase (GMimeParserOptions *options, const char *in, rfc2047_token_list *list, size_t *len, gint64 offset)
 {
 	gboolean can_warn = g_mime_parser_options_get_warning_callback (options) != NULL;
-	rfc2047_token list, *lwsp, *token, *tail;
 	register const char *inptr = in;
+	rfc2047_token *token, word_token;
+	const char *lwsp;
+	size_t lwsp_len;
 	gboolean has_specials = FALSE;
 	GMimeRfcComplianceMode mode;
 	gboolean encoded = FALSE;
@@ -1524,19 +2038,14 @@ tokenize_rfc2047_phrase (GMimeParserOptions *options, const char *in, size_t *le
 	size_t n;
 	
 	mode = g_mime_parser_options_get_rfc2047_compliance_mode (options);
-	tail = (rfc2047_token *) &list;
-	list.next = NULL;
-	lwsp = NULL;
 	
 	while (*inptr != '\0') {
 		text = inptr;
 		while (is_lwsp (*inptr))
 			inptr++;
 		
-		if (inptr > text)
-			lwsp = rfc2047_token_new (text, inptr - text);
-		else
-			lwsp = NULL;
+		lwsp_len = (size_t) (inptr - text);
+		lwsp = lwsp_len > 0 ? text : NULL;
 		
 		word = inptr;
 		ascii = TRUE;
@@ -1599,43 +2108,33 @@ tokenize_rfc2047_phrase (GMimeParserOptions *options, const char *in, size_t *le
 			}
 			
 			n = (size_t) (inptr - word);
-			if ((token = rfc2047_token_new_encoded_word (word, n))) {
+			if (rfc2047_token_parse_encoded_word (&word_token, word, n)) {
 				if (can_warn && has_specials)
 					_g_mime_parser_options_warn (options, offset, GMIME_WARN_INVALID_RFC2047_HEADER_VALUE, in);
 				
 				/* rfc2047 states that you must ignore all
 				 * whitespace between encoded words */
-				if (!encoded && lwsp != NULL) {
-					tail->next = lwsp;
-					tail = lwsp;
-				} else if (lwsp != NULL) {
-					rfc2047_token_free (lwsp);
-				}
+				if (!encoded && lwsp != NULL)
+					rfc2047_token_list_append (list, lwsp, lwsp_len);
 				
-				tail->next = token;
-				tail = token;
+				token = rfc2047_token_list_append (list, word, n);
+				*token = word_token;
 				
 				encoded = TRUE;
 			} else {
 				/* append the lwsp and atom tokens */
-				if (lwsp != NULL) {
-					tail->next = lwsp;
-					tail = lwsp;
-				}
+				if (lwsp != NULL)
+					rfc2047_token_list_append (list, lwsp, lwsp_len);
 				
-				token = rfc2047_token_new (word, n);
+				token = rfc2047_token_list_append (list, word, n);
 				token->is_8bit = ascii ? 0 : 1;
-				tail->next = token;
-				tail = token;
 				
 				encoded = FALSE;
 			}
 		} else {
 			/* append the lwsp token */
-			if (lwsp != NULL) {
-				tail->next = lwsp;
-				tail = lwsp;
-			}
+			if (lwsp != NULL)
+				rfc2047_token_list_append (list, lwsp, lwsp_len);
 			
 			ascii = TRUE;
 			while (*inptr && !is_lwsp (*inptr) && !is_atom (*inptr)) {
@@ -1644,27 +2143,24 @@ tokenize_rfc2047_phrase (GMimeParserOptions *options, const char *in, size_t *le
 			}
 			
 			n = (size_t) (inptr - word);
-			token = rfc2047_token_new (word, n);
+			token = rfc2047_token_list_append (list, word, n);
 			token->is_8bit = ascii ? 0 : 1;
 			
-			tail->next = token;
-			tail = token;
-			
 			encoded = FALSE;
 		}
 	}
 	
 	*len = (size_t) (inptr - in);
-	
-	return list.next;
 }
 
-static rfc2047_token *
-tokenize_rfc2047_text (GMimeParserOptions *options, const char *in, size_t *len, gint64 offset)
+static void
+tokenize_rfc2047_text (GMimeParserOptions *options, const char *in, rfc2047_token_list *list, size_t *len, gint64 offset)
 {
 	gboolean can_warn = g_mime_parser_options_get_warning_callback (options) != NULL;
-	rfc2047_token list, *lwsp, *token, *tail;
 	register const char *inptr = in;
+	rfc2047_token *token, word_token;
+	const char *lwsp;
+	size_t lwsp_len;
 	gboolean has_specials = FALSE;
 	GMimeRfcComplianceMode mode;
 	gboolean encoded = FALSE;
@@ -1673,19 +2169,14 @@ tokenize_rfc2047_text (GMimeParserOptions *options, const char *in, size_t *len,
 	size_t n;
 	
 	mode = g_mime_parser_options_get_rfc2047_compliance_mode (options);
-	tail = (rfc2047_token *) &list;
-	list.next = NULL;
-	lwsp = NULL;
 	
 	while (*inptr != '\0') {
 		text = inptr;
 		while (is_lwsp (*inptr))
 			inptr++;
 		
-		if (inptr > text)
-			lwsp = rfc2047_token_new (text, inptr - text);
-		else
-			lwsp = NULL;
+		lwsp_len = (size_t) (inptr - text);
+		lwsp = lwsp_len > 0 ? text : NULL;
 		
 		if (*inptr != '\0') {
 			word = inptr;
@@ -1746,42 +2237,33 @@ tokenize_rfc2047_text (GMimeParserOptions *options, const char *in, size_t *len,
 			}
 			
 			n = (size_t) (inptr - word);
-			if ((token = rfc2047_token_new_encoded_word (word, n))) {
+			if (rfc2047_token_parse_encoded_word (&word_token, word, n)) {
 				if (can_warn && has_specials)
 					_g_mime_parser_options_warn (options, offset, GMIME_WARN_INVALID_RFC2047_HEADER_VALUE, in);
 				
 				/* rfc2047 states that you must ignore all
 				 * whitespace between encoded words */
-				if (!encoded && lwsp != NULL) {
-					tail->next = lwsp;
-					tail = lwsp;
-				} else if (lwsp != NULL) {
-					rfc2047_token_free (lwsp);
-				}
+				if (!encoded && lwsp != NULL)
+					rfc2047_token_list_append (list, lwsp, lwsp_len);
 				
-				tail->next = token;
-				tail = token;
+				token = rfc2047_token_list_append (list, word, n);
+				*token = word_token;
 				
 				encoded = TRUE;
 			} else {
 				/* append the lwsp and atom tokens */
-				if (lwsp != NULL) {
-					tail->next = lwsp;
-					tail = lwsp;
-				}
+				if (lwsp != NULL)
+					rfc2047_token_list_append (list, lwsp, lwsp_len);
 				
-				token = rfc2047_token_new (word, n);
+				token = rfc2047_token_list_append (list, word, n);
 				token->is_8bit = ascii ? 0 : 1;
-				tail->next = token;
-				tail = token;
 				
 				encoded = FALSE;
 			}
 		} else {
 			if (lwsp != NULL) {
 				/* appending trailing lwsp */
-				tail->next = lwsp;
-				tail = lwsp;
+				rfc2047_token_list_append (list, lwsp, lwsp_len);
 			}
 			
 			break;
@@ -1789,8 +2271,6 @@ tokenize_rfc2047_text (GMimeParserOptions *options, const char *in, size_t *len,
 	}
 	
 	*len = (size_t) (inptr - in);
-	
-	return list.next;
 }
 
 static size_t
@@ -1805,30 +2285,34 @@ rfc2047_token_decode (rfc2047_token *token, unsigned char *outbuf, int *state, g
 		return quoted_decode (inbuf, len, outbuf, state, save);
 }
 
-static char *
-rfc2047_decode_tokens (GMimeParserOptions *options, rfc2047_token *tokens, size_t buflen, const char **charset_out)
+static void
+rfc2047_decode_tokens (GMimeParserOptions *options, rfc2047_token_list *list, GString *decoded, const char **charset_out)
 {
-	rfc2047_token *token, *next;
+	const GMimeIconvNative *cd_native = NULL;
+	rfc2047_token *token, *next, *inend;
+	const char *cd_charset = NULL;
+	gboolean cd_ascii = FALSE;
+	iconv_t cd = (iconv_t) -1;
 	size_t outlen, ninval, len;
 	unsigned char *outptr;
+	size_t convlen = 0;
+	char *convbuf = NULL;
 	const char *charset;
 	GByteArray *outbuf;
-	GString *decoded;
 	char encoding;
 	guint32 save;
-	iconv_t cd;
 	int state;
 	char *str;
 	
-	decoded = g_string_sized_new (buflen + 1);
 	outbuf = g_byte_array_sized_new (76);
-
+	
 	if (charset_out)
 		*charset_out = NULL;
 	
-	token = tokens;
-	while (token != NULL) {
-		next = token->next;
+	inend = list->tokens + list->count;
+	token = list->tokens;
+	while (token < inend) {
+		next = token + 1;
 		
 		if (token->encoding) {
 			/* In order to work around broken mailers, we need to combine
@@ -1846,9 +2330,9 @@ rfc2047_decode_tokens (GMimeParserOptions *options, rfc2047_token *tokens, size_
 				*charset_out = charset;
 			
 			/* find the end of the run (and measure the buffer length we'll need) */
-			while (next && next->encoding == encoding && !strcmp (next->charset, charset)) {
+			while (next < inend && next->encoding == encoding && !strcmp (next->charset, charset)) {
 				len += next->length;
-				next = next->next;
+				next++;
 			}
 			
 			/* make sure our temporary output buffer is large enough... */
@@ -1865,7 +2349,7 @@ rfc2047_decode_tokens (GMimeParserOptions *options, rfc2047_token *tokens, size_
 				 * quoted-printable encoded payload is split between 2 or more
 				 * encoded-word tokens. */
 				len = rfc2047_token_decode (token, outptr, &state, &save);
-				token = token->next;
+				token++;
 				outptr += len;
 				outlen += len;
 			} while (token != next);
@@ -1877,13 +2361,31 @@ rfc2047_decode_tokens (GMimeParserOptions *options, rfc2047_token *tokens, size_
 				str = (char *) outptr;
 				len = outlen;
 				
-				while (!g_utf8_validate (str, len, (const char **) &str)) {
-					len = outlen - (str - (char *) outptr);
-					*str = '?';
+				if (!_g_mime_utf8_validate (str, len) || memchr (str, '\0', len)) {
+					while (!g_utf8_validate (str, len, (const char **) &str)) {
+						len = outlen - (str - (char *) outptr);
+						*str = '?';
+					}
 				}
 				
 				g_string_append_len (decoded, (char *) outptr, outlen);
-			} else if ((cd = g_mime_iconv_open ("UTF-8", charset)) == (iconv_t) -1) {
+				token = next;
+				continue;
+			}
+			
+			/* runs in the same charset (e.g. a B-encoded run followed by a
+			 * Q-encoded run) can share the same converter */
+			if (cd_charset == NULL || strcmp (cd_charset, charset) != 0) {
+				if (cd != (iconv_t) -1)
+					g_mime_iconv_close (cd);
+				
+				cd = g_mime_iconv_open ("UTF-8", charset);
+				cd_native = _g_mime_iconv_native_lookup ("UTF-8", charset);
+				cd_ascii = _g_mime_charset_is_ascii_superset (charset);
+				cd_charset = charset;
+			}
+			
+			if (cd == (iconv_t) -1) {
 				w(g_warning ("Cannot convert from %s to UTF-8, header display may "
 					     "be corrupt: %s", charset[0] ? charset : "unspecified charset",
 					     g_strerror (errno)));
@@ -1892,14 +2394,8 @@ rfc2047_decode_tokens (GMimeParserOptions *options, rfc2047_token *tokens, size_
 				g_string_append (decoded, str);
 				g_free (str);
 			} else {
-				str = g_malloc (outlen + 1);
-				len = outlen;
-				
-				len = charset_convert (cd, (char *) outptr, outlen, &str, &len, &ninval);
-				g_mime_iconv_close (cd);
-				
-				g_string_append_len (decoded, str, len);
-				g_free (str);
+				len = charset_convert (cd, cd_native, (char *) outptr, outlen, &convbuf, &convlen, &ninval, cd_ascii);
+				g_string_append_len (decoded, convbuf, len);
 				
 #if w(!)0
 				if (ninval > 0) {
@@ -1920,9 +2416,55 @@ rfc2047_decode_tokens (GMimeParserOptions *options, rfc2047_token *tokens, size_
 		token = next;
 	}
 	
+	if (cd != (iconv_t) -1)
+		g_mime_iconv_close (cd);
+	
 	g_byte_array_free (outbuf, TRUE);
+	g_free (convbuf);
+}
+
+static gboolean
+rfc2047_is_plain_ascii (const char *text, size_t *len)
+{
+	register const char *inptr = text;
 	
-	return g_string_free (decoded, FALSE);
+	while (*inptr) {
+		if (!is_ascii (*inptr) || (*inptr == '=' && inptr[1] == '?'))
+			return FALSE;
+		
+		inptr++;
+	}
+	
+	*len = (size_t) (inptr - text);
+	
+	return TRUE;
+}
+
+static void
+rfc2047_header_decode (GMimeParserOptions *options, const char *text, gboolean phrase,
+		       GString *decoded, const char **charset, gint64 offset)
+{
+	rfc2047_token_list tokens;
+	size_t len;
+	
+	if (charset)
+		*charset = NULL;
+	
+	/* pure 7bit text without any encoded-words decodes to itself */
+	if (rfc2047_is_plain_ascii (text, &len)) {
+		g_string_append_len (decoded, text, len);
+		return;
+	}
+	
+	rfc2047_token_list_init (&tokens);
+	
+	if (phrase)
+		tokenize_rfc2047_phrase (options, text, &tokens, &len, offset);
+	else
+		tokenize_rfc2047_text (options, text, &tokens, &len, offset);
+	
+	rfc2047_decode_tokens (options, &tokens, decoded, charset);
+	rfc2047_token_list_clear (&tokens);
 }
 
 
@@ -1941,9 +2483,7 @@ rfc2047_decode_tokens (GMimeParserOptions *options, rfc2047_token *tokens, size_
 char *
 _g_mime_utils_header_decode_text (GMimeParserOptions *options, const char *text, const char **charset, gint64 offset)
 {
-	rfc2047_token *tokens;
-	char *decoded;
-	size_t len;
+	GString *decoded;
 	
 	if (text == NULL) {
 		if (charset)
@@ -1952,11 +2492,10 @@ _g_mime_utils_header_decode_text (GMimeParserOptions *options, const char *text,
 		return g_strdup ("");
 	}
 	
-	tokens = tokenize_rfc2047_text (options, text, &len, offset);
-	decoded = rfc2047_decode_tokens (options, tokens, len, charset);
-	rfc2047_token_list_free (tokens);
+	decoded = g_string_sized_new (strlen (text) + 1);
+	rfc2047_header_decode (options, text, FALSE, decoded, charset, offset);
 	
-	return decoded;
+	return g_string_free (decoded, FALSE);
 }
 
 
@@ -1992,9 +2531,7 @@ g_mime_utils_header_decode_text (GMimeParserOptions *options, const char *text)
 char *
 _g_mime_utils_header_decode_phrase (GMimeParserOptions *options, const char *phrase, const char **charset, gint64 offset)
 {
-	rfc2047_token *tokens;
-	char *decoded;
-	size_t len;
+	GString *decoded;
 	
 	if (phrase == NULL) {
 		if (charset)
@@ -2003,11 +2540,10 @@ _g_mime_utils_header_decode_phrase (GMimeParserOptions *options, const char *phr
 		return g_strdup ("");
 	}
 	
-	tokens = tokenize_rfc2047_phrase (options, phrase, &len, offset);
-	decoded = rfc2047_decode_tokens (options, tokens, len, charset);
-	rfc2047_token_list_free (tokens);
+	decoded = g_string_sized_new (strlen (phrase) + 1);
+	rfc2047_header_decode (options, phrase, TRUE, decoded, charset, offset);
 	
-	return decoded;
+	return g_string_free (decoded, FALSE);
 }
 
 
@@ -2102,6 +2638,7 @@ rfc2047_encode_word (GString *string, const char *word, size_t len,
 			}
 			
 			*outptr = '\0';
+			pos = (size_t) (outptr - (char *) encoded);
 		}
 		
 		break;
@@ -2118,12 +2655,19 @@ rfc2047_encode_word (GString *string, const char *word, size_t len,
 	default:
 		encoded = NULL;
 		encoding = '\0';
+		pos = 0;
 		g_assert_not_reached ();
 	}
 	
 	g_free (uword);
 	
-	g_string_append_printf (string, "=?%s?%c?%s?=", charset, encoding, encoded);
+	g_string_append_len (string, "=?", 2);
+	g_string_append (string, charset);
+	g_string_append_c (string, '?');
+	g_string_append_c (string, encoding);
+	g_string_append_c (string, '?');
+	g_string_append_len (string, (char *) encoded, pos);
+	g_string_append_len (string, "?=", 2);
 }
 
 
@@ -2140,13 +2684,55 @@ typedef struct _rfc822_word {
 	int encoding;
 } rfc822_word;
 
-#define rfc822_word_free(word) g_slice_free (rfc822_word, word)
-#define rfc822_word_new() g_slice_new (rfc822_word)
+#define RFC822_INLINE_WORDS 32
+
+/* Words are handed out from the inline block (on the stack for most
+ * headers) and then from heap blocks that double in size each time.
+ * Blocks are never moved, so the 'next' pointers remain valid while
+ * merging. */
+typedef struct {
+	rfc822_word inline_words[RFC822_INLINE_WORDS];
+	GPtrArray *blocks;
+	rfc822_word *words;
+	guint count, size;
+} rfc822_word_list;
+
+static void
+rfc822_word_list_init (rfc822_word_list *list)
+{
+	list->words = list->inline_words;
+	list->size = RFC822_INLINE_WORDS;
+	list->blocks = NULL;
+	list->count = 0;
+}
+
+static void
+rfc822_word_list_clear (rfc822_word_list *list)
+{
+	if (list->blocks != NULL)
+		g_ptr_array_free (list->blocks, TRUE);
+}
+
+static rfc822_word *
+rfc822_word_new (rfc822_word_list *list)
+{
+	if (list->count == list->size) {
+		if (list->blocks == NULL)
+			list->blocks = g_ptr_array_new_with_free_func (g_free);
+		
+		list->size *= 2;
+		list->words = g_new (rfc822_word, list->size);
+		g_ptr_array_add (list->blocks, list->words);
+		list->count = 0;
+	}
+	
+	return &list->words[list->count++];
+}
 
 /* okay, so 'unstructured text' fields don't actually contain 'word'
  * tokens, but we can group stuff similarly... */
 static rfc822_word *
-rfc2047_encode_get_rfc822_words (const char *in, gboolean phrase)
+rfc2047_encode_get_rfc822_words (rfc822_word_list *list, const char *in, gboolean phrase)
 {
 	rfc822_word words, *tail, *word;
 	rfc822_word_t type = WORD_ATOM;
@@ -2173,7 +2759,7 @@ rfc2047_encode_get_rfc822_words (const char *in, gboolean phrase)
 		
 		if (c < 256 && is_blank (c)) {
 			if (count > 0) {
-				word = rfc822_word_new ();
+				word = rfc822_word_new (list);
 				word->next = NULL;
 				word->start = start;
 				word->end = last;
@@ -2212,7 +2798,7 @@ rfc2047_encode_get_rfc822_words (const char *in, gboolean phrase)
 					type = WORD_2047;
 				}
 				
-				word = rfc822_word_new ();
+				word = rfc822_word_new (list);
 				word->next = NULL;
 				word->start = start;
 				word->end = inptr;
@@ -2235,7 +2821,7 @@ rfc2047_encode_get_rfc822_words (const char *in, gboolean phrase)
 	}
 	
 	if (count > 0) {
-		word = rfc822_word_new ();
+		word = rfc822_word_new (list);
 		word->next = NULL;
 		word->start = start;
 		word->end = last;
@@ -2324,8 +2910,6 @@ rfc2047_encode_merge_rfc822_words (rfc822_word **wordsp)
 			word->end = next->end;
 			word->next = next->next;
 			
-			rfc822_word_free (next);
-			
 			next = word;
 		}
 		
@@ -2346,8 +2930,6 @@ rfc2047_encode_merge_rfc822_words (rfc822_word **wordsp)
 			word->end = next->end;
 			word->next = next->next;
 			
-			rfc822_word_free (next);
-			
 			continue;
 		}
 		
@@ -2381,21 +2963,23 @@ g_string_append_len_quoted (GString *out, const char *in, size_t len)
 }
 
 static char *
-rfc2047_encode (GMimeFormatOptions *options, const char *in, gushort safemask, const char *user_charset)
+rfc2047_encode_words (rfc822_word *words, gushort safemask, const char *user_charset)
 {
-	rfc822_word *words, *word, *prev = NULL;
+	rfc822_word *word, *prev = NULL;
 	const char *charset, *start;
 	GMimeCharset mask;
 	GString *out;
-	char *outstr;
 	size_t len;
 	
-	if (!(words = rfc2047_encode_get_rfc822_words (in, safemask & IS_PSAFE)))
-		return g_strdup (in);
-	
-	rfc2047_encode_merge_rfc822_words (&words);
+	/* estimate the length of the output so that the GString won't need to grow */
+	for (len = 0, word = words; word; word = word->next) {
+		if (word->type == WORD_2047)
+			len += GMIME_QP_ENCODE_LEN (word->end - word->start) + 24;
+		else
+			len += (word->end - word->start) + 3;
+	}
 	
-	out = g_string_new ("");
+	out = g_string_sized_new (len);
 	
 	/* output words now with spaces between them */
 	word = words;
@@ -2456,15 +3040,57 @@ rfc2047_encode (GMimeFormatOptions *options, const char *in, gushort safemask, c
 			break;
 		}
 		
-		rfc822_word_free (prev);
-		
 		prev = word;
 		word = word->next;
 	}
 	
-	rfc822_word_free (prev);
+	return g_string_free (out, FALSE);
+}
+
+static char *
+rfc2047_encode (GMimeFormatOptions *options, const char *in, gushort safemask, const char *user_charset)
+{
+	rfc822_word *words, *word, *last;
+	rfc822_word_list list;
+	char *outstr, *key;
+	
+	if (options == NULL)
+		options = g_mime_format_options_get_default ();
+	
+	/* check the memo cache for a previous encoding of the same value */
+	if ((key = _g_mime_format_options_encode_cache_key (options, in, safemask & IS_PSAFE, user_charset))) {
+		if ((outstr = _g_mime_format_options_encode_cache_lookup (options, key))) {
+			g_free (key);
+			return outstr;
+		}
+	}
+	
+	rfc822_word_list_init (&list);
+	
+	if (!(words = rfc2047_encode_get_rfc822_words (&list, in, safemask & IS_PSAFE))) {
+		outstr = g_strdup (in);
+		goto done;
+	}
+	
+	rfc2047_encode_merge_rfc822_words (&words);
+	
+	/* if none of the words need to be quoted or encoded, then the result is
+	 * simply the input with the leading and trailing whitespace removed */
+	for (word = last = words; word && word->type == WORD_ATOM; word = word->next)
+		last = word;
+	
+	if (word == NULL)
+		outstr = g_strndup (words->start, (size_t) (last->end - words->start));
+	else
+		outstr = rfc2047_encode_words (words, safemask, user_charset);
+	
+ done:
+	rfc822_word_list_clear (&list);
 	
-	outstr = g_string_free (out, FALSE);
+	if (key != NULL) {
+		_g_mime_format_options_encode_cache_add (options, key, outstr);
+		g_free (key);
+	}
 	
 	return outstr;
 }
@@ -2514,9 +3140,11 @@ g_mime_utils_header_encode_text (GMimeFormatOptions *options, const char *text,
 
 static char *
 header_fold_tokens (GMimeFormatOptions *options, const char *field, const char *value,
-		    size_t vlen, rfc2047_token *tokens, gboolean structured, gboolean include_field)
+		    size_t vlen, rfc2047_token_list *list, gboolean structured, gboolean include_field)
 {
-	rfc2047_token *token, *next;
+	rfc2047_token *tokens = list->tokens;
+	rfc2047_token *inend = tokens + list->count;
+	rfc2047_token *token;
 	size_t lwsp, tab, len, n;
 	gboolean encoded = FALSE;
 	GString *output;
@@ -2534,8 +3162,7 @@ header_fold_tokens (GMimeFormatOptions *options, const char *field, const char *
 	lwsp = 0;
 	tab = 0;
 	
-	token = tokens;
-	while (token != NULL) {
+	for (token = tokens; token < inend; token++) {
 		if (is_lwsp (token->text[0])) {
 			for (n = 0; n < token->length; n++) {
 				if (token->text[n] == '\r')
@@ -2554,7 +3181,7 @@ header_fold_tokens (GMimeFormatOptions *options, const char *field, const char *
 				}
 			}
 			
-			if (len == 0 && token->next) {
+			if (len == 0 && token + 1 < inend) {
 				g_string_append_c (output, structured ? '\t' : ' ');
 				len = 1;
 			}
@@ -2632,10 +3259,6 @@ header_fold_tokens (GMimeFormatOptions *options, const char *field, const char *
 			lwsp = 0;
 			tab = 0;
 		}
-		
-		next = token->next;
-		rfc2047_token_free (token);
-		token = next;
 	}
 	
 	if (output->str[output->len - 1] != '\n')
@@ -2658,7 +3281,7 @@ header_fold_tokens (GMimeFormatOptions *options, const char *field, const char *
 char *
 g_mime_utils_structured_header_fold (GMimeParserOptions *options, GMimeFormatOptions *format, const char *header)
 {
-	rfc2047_token *tokens;
+	rfc2047_token_list tokens;
 	const char *value;
 	char *folded;
 	char *field;
@@ -2680,8 +3303,10 @@ g_mime_utils_structured_header_fold (GMimeParserOptions *options, GMimeFormatOpt
 	while (*value && is_lwsp (*value))
 		value++;
 	
-	tokens = tokenize_rfc2047_phrase (options, value, &len, -1);
-	folded = header_fold_tokens (format, field, value, len, tokens, TRUE, TRUE);
+	rfc2047_token_list_init (&tokens);
+	tokenize_rfc2047_phrase (options, value, &tokens, &len, -1);
+	folded = header_fold_tokens (format, field, value, len, &tokens, TRUE, TRUE);
+	rfc2047_token_list_clear (&tokens);
 	g_free (field);
 	
 	return folded;
@@ -2703,7 +3328,8 @@ char *
 _g_mime_utils_structured_header_fold (GMimeParserOptions *options, GMimeFormatOptions *format,
 				      const char *field, const char *value)
 {
-	rfc2047_token *tokens;
+	rfc2047_token_list tokens;
+	char *folded;
 	size_t len;
 	
 	if (field == NULL)
@@ -2712,9 +3338,12 @@ _g_mime_utils_structured_header_fold (GMimeParserOptions *options, GMimeFormatOp
 	if (value == NULL)
 		return g_strdup ("\n");
 	
-	tokens = tokenize_rfc2047_phrase (options, value, &len, -1);
+	rfc2047_token_list_init (&tokens);
+	tokenize_rfc2047_phrase (options, value, &tokens, &len, -1);
+	folded = header_fold_tokens (format, field, value, len, &tokens, TRUE, FALSE);
+	rfc2047_token_list_clear (&tokens);
 	
-	return header_fold_tokens (format, field, value, len, tokens, TRUE, FALSE);
+	return folded;
 }
 
 
@@ -2731,7 +3360,7 @@ _g_mime_utils_structured_header_fold (GMimeParserOptions *options, GMimeFormatOp
 char *
 g_mime_utils_unstructured_header_fold (GMimeParserOptions *options, GMimeFormatOptions *format, const char *header)
 {
-	rfc2047_token *tokens;
+	rfc2047_token_list tokens;
 	const char *value;
 	char *folded;
 	char *field;
@@ -2753,8 +3382,10 @@ g_mime_utils_unstructured_header_fold (GMimeParserOptions *options, GMimeFormatO
 	while (*value && is_lwsp (*value))
 		value++;
 	
-	tokens = tokenize_rfc2047_text (options, value, &len, -1);
-	folded = header_fold_tokens (format, field, value, len, tokens, FALSE, TRUE);
+	rfc2047_token_list_init (&tokens);
+	tokenize_rfc2047_text (options, value, &tokens, &len, -1);
+	folded = header_fold_tokens (format, field, value, len, &tokens, FALSE, TRUE);
+	rfc2047_token_list_clear (&tokens);
 	g_free (field);
 	
 	return folded;
@@ -2775,7 +3406,8 @@ g_mime_utils_unstructured_header_fold (GMimeParserOptions *options, GMimeFormatO
 char *
 _g_mime_utils_unstructured_header_fold (GMimeParserOptions *options, GMimeFormatOptions *format, const char *field, const char *value)
 {
-	rfc2047_token *tokens;
+	rfc2047_token_list tokens;
+	char *folded;
 	size_t len;
 	
 	if (field == NULL)
@@ -2784,9 +3416,12 @@ _g_mime_utils_unstructured_header_fold (GMimeParserOptions *options, GMimeFormat
 	if (value == NULL)
 		return g_strdup ("\n");
 	
-	tokens = tokenize_rfc2047_text (options, value, &len, -1);
+	rfc2047_token_list_init (&tokens);
+	tokenize_rfc2047_text (options, value, &tokens, &len, -1);
+	folded = header_fold_tokens (format, field, value, len, &tokens, FALSE, FALSE);
+	rfc2047_token_list_clear (&tokens);
 	
-	return header_fold_tokens (format, field, value, len, tokens, FALSE, FALSE);
+	return folded;
 }
 
 
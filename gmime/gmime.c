@@ -117,6 +117,7 @@ g_mime_init (void)
 	g_mime_format_options_init ();
 	g_mime_parser_options_init ();
 	g_mime_charset_map_init ();
+	g_mime_utils_init ();
 	
 #ifdef ENABLE_CRYPTO
 	/* gpgme_check_version() initializes GpgMe */
@@ -230,4 +231,6 @@ g_mime_shutdown (void)
 	g_mime_format_options_shutdown ();
 	g_mime_parser_options_shutdown ();
 	g_mime_charset_map_shutdown ();
+	g_mime_utils_shutdown ();
+	_g_mime_buffer_pool_clear ();
 }
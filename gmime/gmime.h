@@ -61,6 +61,8 @@
 #include <gmime/gmime-stream-mmap.h>
 #include <gmime/gmime-stream-null.h>
 #include <gmime/gmime-stream-pipe.h>
+#include <gmime/gmime-stream-rope.h>
+#include <gmime/gmime-stream-spill.h>
 #include <gmime/gmime-filter.h>
 #include <gmime/gmime-filter-basic.h>
 #include <gmime/gmime-filter-best.h>
@@ -1631,19 +1631,22 @@ domain_parse (GString *str, const char **in, const char *sentinels)
 	return dotatom_parse (str, in, sentinels);
 }
 
+/* parses an addr-spec into @str (which is reset first); if @domain is
+ * non-%NULL, it will be set to the start of the domain in the input */
 static gboolean
-addrspec_parse (const char **in, const char *sentinels, char **addrspec, int *at)
+addrspec_parse_string (const char **in, const char *sentinels, GString *str, const char **domain, int *at)
 {
 	const char *inptr = *in;
-	GString *str;
 	
-	str = g_string_new ("");
+	g_string_truncate (str, 0);
+	
+	if (domain)
+		*domain = NULL;
 	
 	if (!localpart_parse (str, &inptr))
 		goto error;
 	
 	if (*inptr == '\0' || strchr (sentinels, *inptr)) {
-		*addrspec = g_string_free (str, FALSE);
 		*in = inptr;
 		*at = -1;
 		return TRUE;
@@ -1664,30 +1667,180 @@ addrspec_parse (const char **in, const char *sentinels, char **addrspec, int *at
 	if (*inptr == '\0')
 		goto error;
 	
+	if (domain)
+		*domain = inptr;
+	
 	if (!domain_parse (str, &inptr, sentinels))
 		goto error;
 	
-	*addrspec = g_string_free (str, FALSE);
 	*in = inptr;
 	
 	return TRUE;
 	
  error:
-	g_string_free (str, TRUE);
-	*addrspec = NULL;
 	*in = inptr;
 	*at = -1;
 	
 	return FALSE;
 }
 
+static gboolean
+addrspec_parse (const char **in, const char *sentinels, char **addrspec, int *at)
+{
+	GString *str;
+	
+	str = g_string_new ("");
+	
+	if (!addrspec_parse_string (in, sentinels, str, NULL, at)) {
+		g_string_free (str, TRUE);
+		*addrspec = NULL;
+		return FALSE;
+	}
+	
+	*addrspec = g_string_free (str, FALSE);
+	
+	return TRUE;
+}
+
+
+struct _InternetAddressSpanList {
+	GStringChunk *chunk;
+	GArray *array;
+};
+
+typedef struct {
+	GMimeParserOptions *options;
+	InternetAddressSpanList *spans;
+	GString *addrspec;
+	gint64 offset;
+} AddressParser;
+
+static void
+address_parser_init (AddressParser *parser, GMimeParserOptions *options, InternetAddressSpanList *spans, gint64 offset)
+{
+	parser->addrspec = g_string_sized_new (64);
+	parser->options = options;
+	parser->offset = offset;
+	parser->spans = spans;
+}
+
+static void
+address_parser_clear (AddressParser *parser)
+{
+	g_string_free (parser->addrspec, TRUE);
+}
+
+static const char *
+address_parser_copy_span (AddressParser *parser, const char *in, const char *value, size_t len)
+{
+	/* if the value is identical to the raw input, simply point into the input */
+	if (in != NULL && strncmp (in, value, len) == 0)
+		return in;
+	
+	if (parser->spans->chunk == NULL)
+		parser->spans->chunk = g_string_chunk_new (256);
+	
+	return g_string_chunk_insert_len (parser->spans->chunk, value, len);
+}
+
+static const char *
+address_parser_decode_name (AddressParser *parser, const char *name, size_t len, size_t *outlen, const char **charset)
+{
+	const char *inptr = name;
+	const char *inend = name + len;
+	char *value;
+	
+	/* if the name does not contain quotes, rfc2047 encoded-words or anything
+	 * other than printable ascii, then decoding it would only trim it */
+	while (inptr < inend) {
+		if (*inptr == '"' || *inptr == '\\' || (*inptr == '=' && inptr + 1 < inend && inptr[1] == '?'))
+			break;
+		
+		if ((*inptr < 32 || *inptr > 126) && *inptr != '\t')
+			break;
+		
+		inptr++;
+	}
+	
+	if (inptr == inend) {
+		while (len > 0 && g_ascii_isspace (*name)) {
+			name++;
+			len--;
+		}
+		
+		while (len > 0 && g_ascii_isspace (name[len - 1]))
+			len--;
+		
+		*outlen = len;
+		
+		return name;
+	}
+	
+	value = decode_name (parser->options, name, len, charset, parser->offset);
+	*outlen = strlen (value);
+	name = address_parser_copy_span (parser, NULL, value, *outlen);
+	g_free (value);
+	
+	return name;
+}
+
+/* Note: @local is the start of the addr-spec in the input and @domain is the
+ * start of its domain (or %NULL); the parsed addr-spec is in parser->addrspec */
+static InternetAddress *
+address_parser_add_mailbox (AddressParser *parser, const char *name, size_t len, const char *local,
+			    const char *domain, int at, const char **charset, int group)
+{
+	const char *addrspec = parser->addrspec->str;
+	InternetAddressSpan span;
+	InternetAddress *mailbox;
+	char *value;
+	
+	if (parser->spans == NULL) {
+		if (len > 0)
+			value = decode_name (parser->options, name, len, charset, parser->offset);
+		else
+			value = g_strdup ("");
+		
+		mailbox = _internet_address_mailbox_new (value, addrspec, at);
+		g_free (value);
+		
+		return mailbox;
+	}
+	
+	memset (&span, 0, sizeof (span));
+	span.group = group;
+	
+	if (len > 0)
+		span.name = address_parser_decode_name (parser, name, len, &span.name_length, charset);
+	else
+		span.name = "";
+	
+	span.charset = *charset;
+	
+	if (at >= 0) {
+		span.local_part = address_parser_copy_span (parser, local, addrspec, at);
+		span.local_part_length = at;
+		
+		span.domain_length = parser->addrspec->len - (at + 1);
+		span.domain = address_parser_copy_span (parser, domain, addrspec + at + 1, span.domain_length);
+	} else {
+		span.local_part = address_parser_copy_span (parser, local, addrspec, parser->addrspec->len);
+		span.local_part_length = parser->addrspec->len;
+	}
+	
+	g_array_append_val (parser->spans->array, span);
+	
+	return NULL;
+}
+
 // TODO: rename to angleaddr_parse??
 static gboolean
-mailbox_parse (GMimeParserOptions *options, const char **in, const char *name, InternetAddress **address)
+mailbox_parse (AddressParser *parser, const char **in, const char *name, size_t len, const char **charset,
+	       int group, InternetAddress **address)
 {
-	GMimeRfcComplianceMode mode = g_mime_parser_options_get_address_compliance_mode (options);
+	GMimeRfcComplianceMode mode = g_mime_parser_options_get_address_compliance_mode (parser->options);
 	const char *inptr = *in;
-	char *addrspec = NULL;
+	const char *local, *domain;
 	int at;
 	
 	/* skip over the '<' */
@@ -1727,7 +1880,8 @@ mailbox_parse (GMimeParserOptions *options, const char **in, const char *name, I
 	// ';' as well in case the mailbox is within a group address.
 	//
 	// Example: <third@example.net, fourth@example.net>
-	if (!addrspec_parse (&inptr, COMMA_GREATER_THAN_OR_SEMICOLON, &addrspec, &at))
+	local = inptr;
+	if (!addrspec_parse_string (&inptr, COMMA_GREATER_THAN_OR_SEMICOLON, parser->addrspec, &domain, &at))
 		goto error;
 	
 	if (!skip_cfws (&inptr))
@@ -1751,24 +1905,22 @@ mailbox_parse (GMimeParserOptions *options, const char **in, const char *name, I
 		}
 	}
 	
-	*address = _internet_address_mailbox_new (name, addrspec, at);
-	g_free (addrspec);
+	*address = address_parser_add_mailbox (parser, name, len, local, domain, at, charset, group);
 	*in = inptr;
 	
 	return TRUE;
 	
  error:
-	g_free (addrspec);
 	*address = NULL;
 	*in = inptr;
 	
 	return FALSE;
 }
 
-static gboolean address_list_parse (InternetAddressList *list, GMimeParserOptions *options, const char **in, gboolean is_group, gint64 offset);
+static gboolean address_list_parse (AddressParser *parser, InternetAddressList *list, const char **in, int group);
 
 static gboolean
-group_parse (InternetAddressGroup *group, GMimeParserOptions *options, const char **in, gint64 offset)
+group_parse (AddressParser *parser, InternetAddressList *members, const char **in, int group)
 {
 	const char *inptr = *in;
 	
@@ -1780,7 +1932,7 @@ group_parse (InternetAddressGroup *group, GMimeParserOptions *options, const cha
 		inptr++;
 	
 	if (*inptr != '\0') {
-		address_list_parse (group->members, options, &inptr, TRUE, offset);
+		address_list_parse (parser, members, &inptr, group);
 		
 		if (*inptr != ';') {
 			while (*inptr && *inptr != ';')
@@ -1796,8 +1948,10 @@ group_parse (InternetAddressGroup *group, GMimeParserOptions *options, const cha
 }
 
 static gboolean
-address_parse (GMimeParserOptions *options, AddressParserFlags flags, const char **in, const char **charset, InternetAddress **address, gint64 offset)
+address_parse (AddressParser *parser, AddressParserFlags flags, const char **in, const char **charset,
+	       int group, InternetAddress **address)
 {
+	GMimeParserOptions *options = parser->options;
 	GMimeRfcComplianceMode mode = g_mime_parser_options_get_address_compliance_mode (options);
 	int min_words = g_mime_parser_options_get_allow_addresses_without_domain (options) ? 1 : 0;
 	gboolean trim_leading_quote = FALSE;
@@ -1875,7 +2029,8 @@ address_parse (GMimeParserOptions *options, AddressParserFlags flags, const char
 		/* we've completely gobbled up an addr-spec w/o a domain */
 		char sentinel = *inptr != '\0' ? *inptr : ',';
 		char sentinels[2] = { sentinel, 0 };
-		char *name, *addrspec;
+		const char *name = NULL, *domain;
+		size_t len = 0;
 		int at;
 		
 		/* rewind back to the beginning of the local-part */
@@ -1884,7 +2039,7 @@ address_parse (GMimeParserOptions *options, AddressParserFlags flags, const char
 		if (!(flags & ALLOW_MAILBOX))
 			goto error;
 		
-		if (!addrspec_parse (&inptr, sentinels, &addrspec, &at))
+		if (!addrspec_parse_string (&inptr, sentinels, parser->addrspec, &domain, &at))
 			goto error;
 		
 		skip_lwsp (&inptr);
@@ -1892,30 +2047,21 @@ address_parse (GMimeParserOptions *options, AddressParserFlags flags, const char
 		if (*inptr == '(') {
 			const char *comment = inptr;
 			
-			if (!skip_comment (&inptr)) {
-				g_free (addrspec);
+			if (!skip_comment (&inptr))
 				goto error;
-			}
-			
-			comment++;
 			
-			name = decode_name (options, comment, (size_t) ((inptr - 1) - comment), charset, offset);
-		} else {
-			name = g_strdup ("");
+			name = comment + 1;
+			len = (size_t) ((inptr - 1) - name);
 		}
 		
 		if (*inptr == '>') {
-			if (mode != GMIME_RFC_COMPLIANCE_LOOSE) {
-				g_free (addrspec);
+			if (mode != GMIME_RFC_COMPLIANCE_LOOSE)
 				goto error;
-			}
 			
 			inptr++;
 		}
 		
-		*address = _internet_address_mailbox_new (name, addrspec, at);
-		g_free (addrspec);
-		g_free (name);
+		*address = address_parser_add_mailbox (parser, name, len, start, domain, at, charset, group);
 		*in = inptr;
 		
 		return TRUE;
@@ -1923,8 +2069,8 @@ address_parse (GMimeParserOptions *options, AddressParserFlags flags, const char
 	
 	if (*inptr == ':') {
 		/* rfc2822 group address */
-		InternetAddressGroup *group;
 		const char *phrase = start;
+		InternetAddressSpan span;
 		gboolean retval;
 		char *name;
 		
@@ -1936,17 +2082,37 @@ address_parse (GMimeParserOptions *options, AddressParserFlags flags, const char
 			length--;
 		}
 		
+		if (parser->spans != NULL) {
+			memset (&span, 0, sizeof (span));
+			span.is_group = TRUE;
+			span.group = group;
+			
+			if (length > 0)
+				span.name = address_parser_decode_name (parser, phrase, length, &span.name_length, charset);
+			else
+				span.name = "";
+			
+			span.charset = *charset;
+			
+			g_array_append_val (parser->spans->array, span);
+			*address = NULL;
+			
+			retval = group_parse (parser, NULL, &inptr, parser->spans->array->len - 1);
+			*in = inptr;
+			
+			return retval;
+		}
+		
 		if (length > 0) {
-			name = decode_name (options, phrase, length, charset, offset);
+			name = decode_name (options, phrase, length, charset, parser->offset);
 		} else {
 			name = g_strdup ("");
 		}
 		
-		group = (InternetAddressGroup *) internet_address_group_new (name);
-		*address = (InternetAddress *) group;
+		*address = internet_address_group_new (name);
 		g_free (name);
 		
-		retval = group_parse (group, options, &inptr, offset);
+		retval = group_parse (parser, ((InternetAddressGroup *) *address)->members, &inptr, G_MAXINT);
 		*in = inptr;
 		
 		return retval;
@@ -1958,13 +2124,14 @@ address_parse (GMimeParserOptions *options, AddressParserFlags flags, const char
 	if (*inptr == '@') {
 		/* we're either in the middle of an addr-spec token or we completely gobbled up
 		 * an addr-spec w/o a domain */
-		char *name, *addrspec;
+		const char *name = NULL, *domain;
+		size_t len = 0;
 		int at;
 		
 		/* rewind back to the beginning of the local-part */
 		inptr = start;
 		
-		if (!addrspec_parse (&inptr, COMMA_GREATER_THAN_OR_SEMICOLON, &addrspec, &at))
+		if (!addrspec_parse_string (&inptr, COMMA_GREATER_THAN_OR_SEMICOLON, parser->addrspec, &domain, &at))
 			goto error;
 		
 		skip_lwsp (&inptr);
@@ -1972,28 +2139,18 @@ address_parse (GMimeParserOptions *options, AddressParserFlags flags, const char
 		if (*inptr == '(') {
 			const char *comment = inptr;
 			
-			if (!skip_comment (&inptr)) {
-				g_free (addrspec);
+			if (!skip_comment (&inptr))
 				goto error;
-			}
-			
-			comment++;
 			
-			name = decode_name (options, comment, (size_t) ((inptr - 1) - comment), charset, offset);
-		} else {
-			name = g_strdup ("");
+			name = comment + 1;
+			len = (size_t) ((inptr - 1) - name);
 		}
 		
-		if (!skip_cfws (&inptr)) {
-			g_free (addrspec);
-			g_free (name);
+		if (!skip_cfws (&inptr))
 			goto error;
-		}
 		
 		if (*inptr == '\0') {
-			*address = _internet_address_mailbox_new (name, addrspec, at);
-			g_free (addrspec);
-			g_free (name);
+			*address = address_parser_add_mailbox (parser, name, len, start, domain, at, charset, group);
 			*in = inptr;
 			
 			return TRUE;
@@ -2004,19 +2161,14 @@ address_parse (GMimeParserOptions *options, AddressParserFlags flags, const char
 			 * is an unquoted string with an '@'. */
 			const char *end;
 			
-			if (mode != GMIME_RFC_COMPLIANCE_LOOSE) {
-				g_free (addrspec);
-				g_free (name);
+			if (mode != GMIME_RFC_COMPLIANCE_LOOSE)
 				goto error;
-			}
 			
 			end = inptr;
 			while (end > start && is_lwsp (*(end - 1)))
 				end--;
 			
 			length = (size_t) (end - start);
-			g_free (addrspec);
-			g_free (name);
 			
 			/* fall through to the rfc822 angle-addr token case... */
 		} else {
@@ -2024,18 +2176,13 @@ address_parse (GMimeParserOptions *options, AddressParserFlags flags, const char
 			 * anyway in order to deal with the second Unbalanced Angle Brackets example in
 			 * section 7.1.3: second@example.org> */
 			if (*inptr == '>') {
-				if (mode != GMIME_RFC_COMPLIANCE_LOOSE) {
-					g_free (addrspec);
-					g_free (name);
+				if (mode != GMIME_RFC_COMPLIANCE_LOOSE)
 					goto error;
-				}
 				
 				inptr++;
 			}
 			
-			*address = _internet_address_mailbox_new (name, addrspec, at);
-			g_free (addrspec);
-			g_free (name);
+			*address = address_parser_add_mailbox (parser, name, len, start, domain, at, charset, group);
 			*in = inptr;
 			
 			return TRUE;
@@ -2046,21 +2193,13 @@ address_parse (GMimeParserOptions *options, AddressParserFlags flags, const char
 		/* rfc2822 angle-addr token */
 		const char *phrase = start;
 		gboolean retval;
-		char *name;
 		
 		if (trim_leading_quote) {
 			phrase++;
 			length--;
 		}
 		
-		if (length > 0) {
-			name = decode_name (options, phrase, length, charset, offset);
-		} else {
-			name = g_strdup ("");
-		}
-		
-		retval = mailbox_parse (options, &inptr, name, address);
-		g_free (name);
+		retval = mailbox_parse (parser, &inptr, phrase, length, charset, group, address);
 		*in = inptr;
 		
 		return retval;
@@ -2068,7 +2207,7 @@ address_parse (GMimeParserOptions *options, AddressParserFlags flags, const char
 	
  error:
 	if (g_mime_parser_options_get_warning_callback (options) != NULL)
-		_g_mime_parser_options_warn (options, offset, GMIME_WARN_INVALID_ADDRESS_LIST, *in);
+		_g_mime_parser_options_warn (options, parser->offset, GMIME_WARN_INVALID_ADDRESS_LIST, *in);
 	
 	*address = NULL;
 	*in = inptr;
@@ -2076,13 +2215,17 @@ address_parse (GMimeParserOptions *options, AddressParserFlags flags, const char
 	return FALSE;
 }
 
+/* Note: @group is the index of the group span when parsing the members of a group into
+ * spans, otherwise it is %-1 for top-level addresses and %G_MAXINT for group members */
 static gboolean
-address_list_parse (InternetAddressList *list, GMimeParserOptions *options, const char **in, gboolean is_group, gint64 offset)
+address_list_parse (AddressParser *parser, InternetAddressList *list, const char **in, int group)
 {
-	gboolean can_warn = g_mime_parser_options_get_warning_callback (options) != NULL;
+	gboolean can_warn = g_mime_parser_options_get_warning_callback (parser->options) != NULL;
+	gboolean is_group = group != -1;
 	InternetAddress *address;
 	const char *charset;
 	const char *inptr;
+	guint index;
 	
 	if (!skip_cfws (in))
 		return FALSE;
@@ -2098,13 +2241,14 @@ address_list_parse (InternetAddressList *list, GMimeParserOptions *options, cons
 		if (is_group && *inptr ==  ';')
 			break;
 		
+		index = parser->spans ? parser->spans->array->len : 0;
 		charset = NULL;
 		
-		if (!address_parse (options, ALLOW_ANY, &inptr, &charset, &address, offset)) {
+		if (!address_parse (parser, ALLOW_ANY, &inptr, &charset, group, &address)) {
 			/* skip this address... */
 			while (*inptr && *inptr != ',' && (!is_group || *inptr != ';'))
 				inptr++;
-		} else {
+		} else if (address != NULL) {
 			_internet_address_list_add (list, address);
 			
 			if (charset)
@@ -2112,6 +2256,8 @@ address_list_parse (InternetAddressList *list, GMimeParserOptions *options, cons
 
 			if (INTERNET_ADDRESS_IS_GROUP(address))
 				separator_between_addrs = TRUE;
+		} else if (g_array_index (parser->spans->array, InternetAddressSpan, index).is_group) {
+			separator_between_addrs = TRUE;
 		}
 		
 		/* Note: we loop here in case there are any null addresses between commas */
@@ -2130,7 +2276,7 @@ address_list_parse (InternetAddressList *list, GMimeParserOptions *options, cons
 		} while (TRUE);
 		
 		if (can_warn && !(separator_between_addrs || (*inptr == '\0') || (is_group && *inptr == ';')))
-			_g_mime_parser_options_warn (options, offset, GMIME_WARN_INVALID_ADDRESS_LIST, *in);
+			_g_mime_parser_options_warn (parser->options, parser->offset, GMIME_WARN_INVALID_ADDRESS_LIST, *in);
 	}
 	
 	*in = inptr;
@@ -2160,11 +2306,17 @@ _internet_address_list_parse (GMimeParserOptions *options, const char *str, gint
 {
 	InternetAddressList *list;
 	const char *inptr = str;
+	AddressParser parser;
+	gboolean success;
 	
 	g_return_val_if_fail (str != NULL, NULL);
 	
 	list = internet_address_list_new ();
-	if (!address_list_parse (list, options, &inptr, FALSE, offset) || list->array->len == 0) {
+	address_parser_init (&parser, options, NULL, offset);
+	success = address_list_parse (&parser, list, &inptr, -1);
+	address_parser_clear (&parser);
+	
+	if (!success || list->array->len == 0) {
 		g_object_unref (list);
 		return NULL;
 	}
@@ -2176,11 +2328,14 @@ void
 _internet_address_list_append_parse (InternetAddressList *list, GMimeParserOptions *options, const char *str, gint64 offset)
 {
 	const char *inptr = str;
+	AddressParser parser;
 
 	g_return_if_fail (IS_INTERNET_ADDRESS_LIST (list));
 	g_return_if_fail (str != NULL);
 
-	address_list_parse (list, options, &inptr, FALSE, offset);
+	address_parser_init (&parser, options, NULL, offset);
+	address_list_parse (&parser, list, &inptr, -1);
+	address_parser_clear (&parser);
 
 	g_mime_event_emit (list->changed, NULL);
 }
@@ -2202,3 +2357,166 @@ internet_address_list_append_parse (InternetAddressList *list, GMimeParserOption
 
 	_internet_address_list_append_parse (list, options, str, -1);
 }
+
+
+/**
+ * internet_address_span_list_parse: (skip)
+ * @options: (nullable): a #GMimeParserOptions or %NULL
+ * @str: a string containing internet addresses
+ *
+ * Parses the addresses in @str without constructing any #InternetAddress
+ * objects. Each mailbox and group in @str is represented by an
+ * #InternetAddressSpan whose strings point directly into @str whenever
+ * possible. Only the values that need to be decoded (such as names
+ * containing quoted-strings or rfc2047 encoded-words) are copied into
+ * memory owned by the returned #InternetAddressSpanList.
+ *
+ * Note: @str must remain valid for as long as the returned list is in use.
+ *
+ * Returns: (nullable) (transfer full): a #InternetAddressSpanList or %NULL if
+ * the input string does not contain any addresses.
+ **/
+InternetAddressSpanList *
+internet_address_span_list_parse (GMimeParserOptions *options, const char *str)
+{
+	InternetAddressSpanList *list;
+	const char *inptr = str;
+	AddressParser parser;
+	gboolean success;
+	
+	g_return_val_if_fail (str != NULL, NULL);
+	
+	list = g_slice_new (InternetAddressSpanList);
+	list->array = g_array_sized_new (FALSE, FALSE, sizeof (InternetAddressSpan), 8);
+	list->chunk = NULL;
+	
+	address_parser_init (&parser, options, list, -1);
+	success = address_list_parse (&parser, NULL, &inptr, -1);
+	address_parser_clear (&parser);
+	
+	if (!success || list->array->len == 0) {
+		internet_address_span_list_free (list);
+		return NULL;
+	}
+	
+	return list;
+}
+
+
+/**
+ * internet_address_span_list_free: (skip)
+ * @list: a #InternetAddressSpanList
+ *
+ * Frees the #InternetAddressSpanList and all of the memory used by its spans.
+ **/
+void
+internet_address_span_list_free (InternetAddressSpanList *list)
+{
+	g_return_if_fail (list != NULL);
+	
+	if (list->chunk != NULL)
+		g_string_chunk_free (list->chunk);
+	
+	g_array_free (list->array, TRUE);
+	g_slice_free (InternetAddressSpanList, list);
+}
+
+
+/**
+ * internet_address_span_list_length: (skip)
+ * @list: a #InternetAddressSpanList
+ *
+ * Gets the number of spans in the list. This includes the spans for
+ * the members of any groups.
+ *
+ * Returns: the number of spans in the list.
+ **/
+int
+internet_address_span_list_length (InternetAddressSpanList *list)
+{
+	g_return_val_if_fail (list != NULL, -1);
+	
+	return list->array->len;
+}
+
+
+/**
+ * internet_address_span_list_get_span: (skip)
+ * @list: a #InternetAddressSpanList
+ * @index: index of span to get
+ *
+ * Gets the #InternetAddressSpan at the specified index.
+ *
+ * Returns: (nullable) (transfer none): the #InternetAddressSpan at the specified
+ * index or %NULL if the index is out of range.
+ **/
+const InternetAddressSpan *
+internet_address_span_list_get_span (InternetAddressSpanList *list, int index)
+{
+	g_return_val_if_fail (list != NULL, NULL);
+	g_return_val_if_fail (index >= 0, NULL);
+	
+	if ((guint) index >= list->array->len)
+		return NULL;
+	
+	return &g_array_index (list->array, InternetAddressSpan, index);
+}
+
+
+/**
+ * internet_address_span_list_to_address_list: (skip)
+ * @list: a #InternetAddressSpanList
+ *
+ * Constructs an #InternetAddressList containing the mailboxes and groups
+ * represented by the spans in @list.
+ *
+ * Returns: (transfer full): a new #InternetAddressList.
+ **/
+InternetAddressList *
+internet_address_span_list_to_address_list (InternetAddressSpanList *list)
+{
+	InternetAddressList *addresses, *members;
+	const InternetAddressSpan *span;
+	InternetAddress **ia;
+	char *name, *addr;
+	guint i;
+	
+	g_return_val_if_fail (list != NULL, NULL);
+	
+	addresses = internet_address_list_new ();
+	ia = g_new (InternetAddress *, list->array->len);
+	
+	for (i = 0; i < list->array->len; i++) {
+		span = &g_array_index (list->array, InternetAddressSpan, i);
+		name = g_strndup (span->name, span->name_length);
+		
+		if (span->is_group) {
+			ia[i] = internet_address_group_new (name);
+		} else if (span->domain != NULL) {
+			addr = g_strdup_printf ("%.*s@%.*s", (int) span->local_part_length, span->local_part,
+						(int) span->domain_length, span->domain);
+			ia[i] = _internet_address_mailbox_new (name, addr, (int) span->local_part_length);
+			g_free (addr);
+		} else {
+			addr = g_strndup (span->local_part, span->local_part_length);
+			ia[i] = _internet_address_mailbox_new (name, addr, -1);
+			g_free (addr);
+		}
+		
+		if (span->charset)
+			ia[i]->charset = g_strdup (span->charset);
+		
+		g_free (name);
+		
+		if (span->group >= 0)
+			members = ((InternetAddressGroup *) ia[span->group])->members;
+		else
+			members = addresses;
+		
+		_internet_address_list_add (members, ia[i]);
+	}
+	
+	g_free (ia);
+	
+	return addresses;
+}
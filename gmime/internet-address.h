@@ -216,6 +216,50 @@ void internet_address_list_encode (InternetAddressList *list, GMimeFormatOptions
 InternetAddressList *internet_address_list_parse (GMimeParserOptions *options, const char *str);
 void internet_address_list_append_parse (InternetAddressList *list, GMimeParserOptions *options, const char *str);
 
+
+/**
+ * InternetAddressSpan:
+ * @name: the decoded display name (not nul-terminated)
+ * @name_length: the length of @name in bytes
+ * @local_part: the local-part of the address (not nul-terminated) or %NULL for groups
+ * @local_part_length: the length of @local_part in bytes
+ * @domain: the domain of the address (not nul-terminated) or %NULL if it does not have one
+ * @domain_length: the length of @domain in bytes
+ * @charset: the charset used by the rfc2047 encoded-words in the name or %NULL
+ * @group: the index of the group span that this span is a member of or %-1
+ * @is_group: %TRUE if the span represents a group rather than a mailbox
+ *
+ * A lightweight representation of a mailbox or group address that points
+ * into the string that it was parsed from.
+ **/
+typedef struct {
+	const char *name;
+	size_t name_length;
+	const char *local_part;
+	size_t local_part_length;
+	const char *domain;
+	size_t domain_length;
+	const char *charset;
+	int group;
+	gboolean is_group;
+} InternetAddressSpan;
+
+
+/**
+ * InternetAddressSpanList:
+ *
+ * A list of #InternetAddressSpan structures.
+ **/
+typedef struct _InternetAddressSpanList InternetAddressSpanList;
+
+InternetAddressSpanList *internet_address_span_list_parse (GMimeParserOptions *options, const char *str);
+void internet_address_span_list_free (InternetAddressSpanList *list);
+
+int internet_address_span_list_length (InternetAddressSpanList *list);
+const InternetAddressSpan *internet_address_span_list_get_span (InternetAddressSpanList *list, int index);
+
+InternetAddressList *internet_address_span_list_to_address_list (InternetAddressSpanList *list);
+
 G_END_DECLS
 
 #endif /* __INTERNET_ADDRESS_H__ */
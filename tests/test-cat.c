@@ -454,6 +454,74 @@ test_cat_substream (GMimeStream *whole, struct _StreamPart *parts, int bounded)
 	g_object_unref (sub2);
 }
 
+static void
+test_cat_random_access (GMimeStream *whole, struct _StreamPart *parts, int bounded)
+{
+	GMimeStream *mem, *stream, *cat;
+	gint64 offset, len, n;
+	GByteArray *buffer;
+	char buf[4096];
+	Exception *ex;
+	ssize_t nread;
+	int i;
+	
+	/* split a copy of the whole stream into hundreds of tiny (and some empty) sources */
+	mem = g_mime_stream_mem_new ();
+	g_mime_stream_reset (whole);
+	g_mime_stream_write_to_stream (whole, mem);
+	buffer = g_mime_stream_mem_get_byte_array ((GMimeStreamMem *) mem);
+	len = buffer->len;
+	
+	cat = g_mime_stream_cat_new ();
+	
+	for (offset = 0; offset < len; offset += n) {
+		n = randc () % 64;
+		n = MIN (n, len - offset);
+		stream = g_mime_stream_substream (mem, offset, offset + n);
+		g_mime_stream_cat_add_source ((GMimeStreamCat *) cat, stream);
+		g_object_unref (stream);
+	}
+	
+	if (g_mime_stream_length (cat) != len) {
+		ex = exception_new ("length %lld does not match %lld", (long long) g_mime_stream_length (cat), (long long) len);
+		g_object_unref (cat);
+		g_object_unref (mem);
+		throw (ex);
+	}
+	
+	for (i = 0; i < 256; i++) {
+		offset = (gint64) (len * randf ());
+		
+		if (g_mime_stream_seek (cat, offset, GMIME_STREAM_SEEK_SET) != offset) {
+			ex = exception_new ("could not seek to %lld: %s", (long long) offset, g_strerror (errno));
+			g_object_unref (cat);
+			g_object_unref (mem);
+			throw (ex);
+		}
+		
+		/* a single read should fill the buffer even though it spans many sources */
+		n = MIN ((gint64) sizeof (buf), len - offset);
+		if ((nread = g_mime_stream_read (cat, buf, sizeof (buf))) != n ||
+		    memcmp (buf, buffer->data + offset, n) != 0) {
+			ex = exception_new ("read of %lld bytes at %lld did not match", (long long) n, (long long) offset);
+			g_object_unref (cat);
+			g_object_unref (mem);
+			throw (ex);
+		}
+	}
+	
+	if (g_mime_stream_seek (cat, 0, GMIME_STREAM_SEEK_END) != len ||
+	    g_mime_stream_read (cat, buf, sizeof (buf)) > 0) {
+		ex = exception_new ("seeking to the end of the stream failed");
+		g_object_unref (cat);
+		g_object_unref (mem);
+		throw (ex);
+	}
+	
+	g_object_unref (cat);
+	g_object_unref (mem);
+}
+
 
 typedef void (* checkFunc) (GMimeStream *stream, struct _StreamPart *parts, int bounded);
 
@@ -469,6 +537,7 @@ struct {
 	{ "GMimeStreamCat::seek(unbound)",      test_cat_seek,      FALSE },
 	{ "GMimeStreamCat::substream(bound)",   test_cat_substream, TRUE  },
 	{ "GMimeStreamCat::substream(unbound)", test_cat_substream, FALSE },
+	{ "GMimeStreamCat::seek(many sources)", test_cat_random_access, FALSE },
 };
 
 int main (int argc, char **argv)
@@ -504,6 +504,207 @@ error:
 	g_byte_array_free (actual, TRUE);
 }
 
+static GByteArray *
+encode_with_newline (GMimeContentEncoding encoding, GMimeNewLineFormat newline, gboolean fused,
+		     const unsigned char *input, size_t inlen, size_t size)
+{
+	GMimeStream *ostream, *filtered;
+	GMimeFormatOptions *options;
+	GMimeFilter *filter;
+	GByteArray *actual;
+	size_t n;
+	
+	actual = g_byte_array_new ();
+	ostream = g_mime_stream_mem_new_with_byte_array (actual);
+	g_mime_stream_mem_set_owner ((GMimeStreamMem *) ostream, FALSE);
+	filtered = g_mime_stream_filter_new (ostream);
+	g_object_unref (ostream);
+	
+	if (fused) {
+		filter = g_mime_filter_basic_new_with_newline (encoding, newline, TRUE);
+		g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+		g_object_unref (filter);
+	} else {
+		filter = g_mime_filter_basic_new (encoding, TRUE);
+		g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+		g_object_unref (filter);
+		
+		options = g_mime_format_options_new ();
+		g_mime_format_options_set_newline_format (options, newline);
+		filter = g_mime_format_options_create_newline_filter (options, TRUE);
+		g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+		g_mime_format_options_free (options);
+		g_object_unref (filter);
+	}
+	
+	while (inlen > 0) {
+		n = MIN (inlen, size);
+		g_mime_stream_write (filtered, (const char *) input, n);
+		input += n;
+		inlen -= n;
+	}
+	
+	g_mime_stream_flush (filtered);
+	g_object_unref (filtered);
+	
+	return actual;
+}
+
+static void
+test_encoder_newline (GMimeContentEncoding encoding, GByteArray *input, size_t size)
+{
+	const char *name = g_mime_content_encoding_to_string (encoding);
+	static const char *samples[] = { "", "abc", "abc \n", "abc\r\n\r\ndef\t" };
+	GMimeNewLineFormat newline;
+	GByteArray *expected, *actual;
+	const unsigned char *inbuf;
+	gboolean match;
+	size_t inlen;
+	guint i;
+	
+	testsuite_check ("%s encoding with new-line conversion; buffer-size=%zu", name, size);
+	
+	try {
+		for (newline = GMIME_NEWLINE_FORMAT_UNIX; newline <= GMIME_NEWLINE_FORMAT_DOS; newline++) {
+			for (i = 0; i <= G_N_ELEMENTS (samples); i++) {
+				if (i < G_N_ELEMENTS (samples)) {
+					inbuf = (const unsigned char *) samples[i];
+					inlen = strlen (samples[i]);
+				} else {
+					inbuf = input->data;
+					inlen = input->len;
+				}
+				
+				expected = encode_with_newline (encoding, newline, FALSE, inbuf, inlen, size);
+				actual = encode_with_newline (encoding, newline, TRUE, inbuf, inlen, size);
+				
+				match = actual->len == expected->len && !memcmp (actual->data, expected->data, actual->len);
+				g_byte_array_free (expected, TRUE);
+				g_byte_array_free (actual, TRUE);
+				
+				if (!match)
+					throw (exception_new ("%s output of sample %u does not match the stacked filters",
+							      newline == GMIME_NEWLINE_FORMAT_DOS ? "dos" : "unix", i));
+			}
+		}
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("%s encoding with new-line conversion failed: %s", name, ex->message);
+	} finally;
+}
+
+/* bit-at-a-time crc32 and byte-at-a-time yEnc encoder to check against */
+static guint32
+reference_crc32 (guint32 crc, const unsigned char *inbuf, size_t inlen)
+{
+	size_t i;
+	int k;
+	
+	for (i = 0; i < inlen; i++) {
+		crc ^= inbuf[i];
+		
+		for (k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+	
+	return crc;
+}
+
+static GByteArray *
+reference_yencode (const unsigned char *inbuf, size_t inlen)
+{
+	GByteArray *output = g_byte_array_new ();
+	unsigned char c, escape[2];
+	int already = 0;
+	size_t i;
+	
+	for (i = 0; i < inlen; i++) {
+		c = inbuf[i] + 42;
+		
+		if (c == '\0' || c == '\t' || c == '\r' || c == '\n' || c == '=') {
+			escape[0] = '=';
+			escape[1] = c + 64;
+			g_byte_array_append (output, escape, 2);
+			already += 2;
+		} else {
+			g_byte_array_append (output, &c, 1);
+			already++;
+		}
+		
+		if (already >= 128) {
+			g_byte_array_append (output, (const guint8 *) "\n", 1);
+			already = 0;
+		}
+	}
+	
+	if (already)
+		g_byte_array_append (output, (const guint8 *) "\n", 1);
+	
+	return output;
+}
+
+static void
+test_yenc (GByteArray *input, size_t size)
+{
+	guint32 pcrc, crc, expected_crc;
+	GByteArray *expected;
+	unsigned char *outbuf;
+	size_t outlen, n, i;
+	int state;
+	
+	testsuite_check ("yEnc; buffer-size=%zu", size);
+	
+	expected = reference_yencode (input->data, input->len);
+	expected_crc = GMIME_YENCODE_CRC_FINAL (reference_crc32 (GMIME_YENCODE_CRC_INIT, input->data, input->len));
+	outbuf = g_malloc ((input->len + 2) * 2 + input->len / 64 + 62);
+	
+	try {
+		state = GMIME_YENCODE_STATE_INIT;
+		pcrc = crc = GMIME_YENCODE_CRC_INIT;
+		g_mime_yencode_step ((const unsigned char *) "123456789", 9, outbuf, &state, &pcrc, &crc);
+		if (GMIME_YENCODE_CRC_FINAL (pcrc) != 0xcbf43926)
+			throw (exception_new ("crc32 of the check string is 0x%08x", GMIME_YENCODE_CRC_FINAL (pcrc)));
+		
+		state = GMIME_YENCODE_STATE_INIT;
+		pcrc = crc = GMIME_YENCODE_CRC_INIT;
+		outlen = 0;
+		
+		for (i = 0; i + size < input->len; i += size)
+			outlen += g_mime_yencode_step (input->data + i, size, outbuf + outlen, &state, &pcrc, &crc);
+		
+		outlen += g_mime_yencode_close (input->data + i, input->len - i, outbuf + outlen, &state, &pcrc, &crc);
+		
+		if (outlen != expected->len || memcmp (outbuf, expected->data, outlen) != 0)
+			throw (exception_new ("encoded output does not match"));
+		
+		if (GMIME_YENCODE_CRC_FINAL (pcrc) != expected_crc || GMIME_YENCODE_CRC_FINAL (crc) != expected_crc)
+			throw (exception_new ("encoder crc32 0x%08x does not match 0x%08x", GMIME_YENCODE_CRC_FINAL (pcrc), expected_crc));
+		
+		state = GMIME_YDECODE_STATE_INIT;
+		pcrc = crc = GMIME_YENCODE_CRC_INIT;
+		outlen = 0;
+		
+		for (i = 0; i < expected->len; i += n) {
+			n = MIN (size, expected->len - i);
+			outlen += g_mime_ydecode_step (expected->data + i, n, outbuf + outlen, &state, &pcrc, &crc);
+		}
+		
+		if (outlen != input->len || memcmp (outbuf, input->data, outlen) != 0)
+			throw (exception_new ("decoded output does not match"));
+		
+		if (GMIME_YENCODE_CRC_FINAL (pcrc) != expected_crc || GMIME_YENCODE_CRC_FINAL (crc) != expected_crc)
+			throw (exception_new ("decoder crc32 0x%08x does not match 0x%08x", GMIME_YENCODE_CRC_FINAL (pcrc), expected_crc));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("yEnc failed: %s", ex->message);
+	} finally;
+	
+	g_byte_array_free (expected, TRUE);
+	g_free (outbuf);
+}
+
 int main (int argc, char **argv)
 {
 	const char *datadir = "data/encodings";
@@ -557,6 +758,8 @@ int main (int argc, char **argv)
 	test_encoder (GMIME_CONTENT_ENCODING_BASE64, photo, b64, 1024);
 	test_encoder (GMIME_CONTENT_ENCODING_BASE64, photo, b64, 16);
 	test_encoder (GMIME_CONTENT_ENCODING_BASE64, photo, b64, 1);
+	test_encoder_newline (GMIME_CONTENT_ENCODING_BASE64, photo, 4096);
+	test_encoder_newline (GMIME_CONTENT_ENCODING_BASE64, photo, 1);
 	test_decoder (GMIME_CONTENT_ENCODING_BASE64, b64, photo, 4096);
 	test_decoder (GMIME_CONTENT_ENCODING_BASE64, b64, photo, 1024);
 	test_decoder (GMIME_CONTENT_ENCODING_BASE64, b64, photo, 16);
@@ -568,6 +771,8 @@ int main (int argc, char **argv)
 	test_encoder (GMIME_CONTENT_ENCODING_UUENCODE, photo, uu, 1024);
 	test_encoder (GMIME_CONTENT_ENCODING_UUENCODE, photo, uu, 16);
 	test_encoder (GMIME_CONTENT_ENCODING_UUENCODE, photo, uu, 1);
+	test_encoder_newline (GMIME_CONTENT_ENCODING_UUENCODE, photo, 4096);
+	test_encoder_newline (GMIME_CONTENT_ENCODING_UUENCODE, photo, 1);
 	test_decoder (GMIME_CONTENT_ENCODING_UUENCODE, uu, photo, 4096);
 	test_decoder (GMIME_CONTENT_ENCODING_UUENCODE, uu, photo, 1024);
 	test_decoder (GMIME_CONTENT_ENCODING_UUENCODE, uu, photo, 16);
@@ -584,12 +789,21 @@ int main (int argc, char **argv)
 	test_encoder (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, wikipedia, qp, 1024);
 	test_encoder (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, wikipedia, qp, 16);
 	test_encoder (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, wikipedia, qp, 1);
+	test_encoder_newline (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, wikipedia, 4096);
+	test_encoder_newline (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, wikipedia, 1);
 	test_decoder (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, qp, wikipedia, 4096);
 	test_decoder (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, qp, wikipedia, 1024);
 	test_decoder (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, qp, wikipedia, 16);
 	test_decoder (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, qp, wikipedia, 1);
 	testsuite_end ();
 	
+	testsuite_start ("yEnc");
+	test_yenc (photo, 4096);
+	test_yenc (photo, 1024);
+	test_yenc (photo, 100);
+	test_yenc (photo, 1);
+	testsuite_end ();
+	
 	g_byte_array_free (wikipedia, TRUE);
 	g_byte_array_free (photo, TRUE);
 	g_byte_array_free (b64, TRUE);
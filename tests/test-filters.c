@@ -156,6 +156,181 @@ error:
 	g_byte_array_free (actual, TRUE);
 }
 
+/* converts @input in one go the same way GMimeFilterCharset does, but
+ * without any of its fast paths */
+static GByteArray *
+charset_convert_reference (const char *from, const char *to, GByteArray *input)
+{
+	size_t inleft, outleft;
+	GByteArray *output;
+	char *inbuf, *outbuf;
+	iconv_t cd;
+	
+	cd = g_mime_iconv_open (to, from);
+	output = g_byte_array_sized_new (input->len * 5 + 16);
+	g_byte_array_set_size (output, input->len * 5 + 16);
+	
+	inbuf = (char *) input->data;
+	inleft = input->len;
+	outbuf = (char *) output->data;
+	outleft = output->len;
+	
+	while (inleft > 0) {
+		if (iconv (cd, &inbuf, &inleft, &outbuf, &outleft) != (size_t) -1)
+			continue;
+		
+		if (errno != EILSEQ)
+			break;
+		
+		inbuf++;
+		inleft--;
+	}
+	
+	iconv (cd, NULL, NULL, &outbuf, &outleft);
+	g_mime_iconv_close (cd);
+	
+	g_byte_array_set_size (output, (guint) ((guint8 *) outbuf - output->data));
+	
+	return output;
+}
+
+static void
+test_charset_fast_paths (void)
+{
+	const char *what = "GMimeFilterCharset fast paths";
+	static const char *conversions[][2] = {
+		{ "utf-8", "utf-8" },
+		{ "us-ascii", "utf-8" },
+		{ "iso-8859-1", "utf-8" },
+		{ "koi8-r", "utf-8" },
+		{ "windows-1252", "utf-8" },
+		{ "iso-8859-15", "utf-8" },
+		{ "utf-16le", "utf-8" },
+		{ "utf-16be", "utf-8" },
+		{ "utf-8", "iso-8859-1" }
+	};
+	static const char *pieces[] = {
+		"plain ASCII text ", "\n", "caf\xc3\xa9 ", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+		"\xe9", "\x80", "\xe0\x80", "\xed\xa0\x80", "\xf4\x90\x80\x80", "\xc3"
+	};
+	GByteArray *input, *expected, *actual;
+	GMimeStream *stream, *filtered;
+	GMimeFilter *filter;
+	guint iter, c, i, n;
+	const char *piece;
+	gboolean match;
+	
+	testsuite_check ("%s", what);
+	
+	try {
+		for (iter = 0; iter < 200; iter++) {
+			input = g_byte_array_new ();
+			
+			/* mostly valid UTF-8, with the occasional invalid or truncated sequence */
+			n = 1 + rand () % (iter < 100 ? 16 : 512);
+			for (i = 0; i < n; i++) {
+				piece = pieces[rand () % 10 != 0 ? rand () % 5 : rand () % G_N_ELEMENTS (pieces)];
+				g_byte_array_append (input, (const guint8 *) piece, strlen (piece));
+			}
+			
+			for (c = 0; c < G_N_ELEMENTS (conversions); c++) {
+				expected = charset_convert_reference (conversions[c][0], conversions[c][1], input);
+				
+				actual = g_byte_array_new ();
+				stream = g_mime_stream_mem_new_with_byte_array (actual);
+				g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+				filtered = g_mime_stream_filter_new (stream);
+				filter = g_mime_filter_charset_new (conversions[c][0], conversions[c][1]);
+				g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+				g_object_unref (filter);
+				g_object_unref (stream);
+				
+				for (i = 0; i < input->len; i += n) {
+					n = 1 + rand () % 64;
+					n = MIN (input->len - i, n);
+					g_mime_stream_write (filtered, (const char *) input->data + i, n);
+				}
+				
+				g_mime_stream_flush (filtered);
+				g_object_unref (filtered);
+				
+				match = actual->len == expected->len && !memcmp (actual->data, expected->data, actual->len);
+				g_byte_array_free (expected, TRUE);
+				g_byte_array_free (actual, TRUE);
+				
+				if (!match) {
+					g_byte_array_free (input, TRUE);
+					throw (exception_new ("%s -> %s output does not match iconv (iteration %u)",
+							      conversions[c][0], conversions[c][1], iter));
+				}
+			}
+			
+			g_byte_array_free (input, TRUE);
+		}
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("%s failed: %s", what, ex->message);
+	} finally;
+}
+
+static void
+test_charset_held_back (void)
+{
+	const char *what = "GMimeFilterCharset stateful target";
+	/* iconv holds back a character that may be followed by a combining
+	 * mark when converting to these, so the ASCII that follows must not
+	 * be passed through ahead of it */
+	static const char *targets[][2] = {
+		{ "big5-hkscs", "\xc3\x8a" },
+		{ "euc-jisx0213", "\xe3\x81\x8b" }
+	};
+	GByteArray *input, *expected, *actual;
+	GMimeStream *stream, *filtered;
+	GMimeFilter *filter;
+	gboolean match;
+	size_t n;
+	guint i;
+	
+	testsuite_check ("%s", what);
+	
+	try {
+		for (i = 0; i < G_N_ELEMENTS (targets); i++) {
+			n = strlen (targets[i][1]);
+			input = g_byte_array_new ();
+			g_byte_array_append (input, (const guint8 *) targets[i][1], n);
+			g_byte_array_append (input, (const guint8 *) "A\n", 2);
+			expected = charset_convert_reference ("utf-8", targets[i][0], input);
+			
+			actual = g_byte_array_new ();
+			stream = g_mime_stream_mem_new_with_byte_array (actual);
+			g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+			filtered = g_mime_stream_filter_new (stream);
+			filter = g_mime_filter_charset_new ("utf-8", targets[i][0]);
+			g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+			g_object_unref (filter);
+			g_object_unref (stream);
+			
+			g_mime_stream_write (filtered, (const char *) input->data, n);
+			g_mime_stream_write (filtered, (const char *) input->data + n, 2);
+			g_mime_stream_flush (filtered);
+			g_object_unref (filtered);
+			
+			match = actual->len == expected->len && !memcmp (actual->data, expected->data, actual->len);
+			g_byte_array_free (expected, TRUE);
+			g_byte_array_free (actual, TRUE);
+			g_byte_array_free (input, TRUE);
+			
+			if (!match)
+				throw (exception_new ("utf-8 -> %s output does not match iconv", targets[i][0]));
+		}
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("%s failed: %s", what, ex->message);
+	} finally;
+}
+
 static void
 test_enriched (const char *datadir, const char *input, const char *output)
 {
@@ -321,6 +496,90 @@ error:
 	g_object_unref (filter);
 }
 
+/* pushes @input through @filter by writing it in randomly sized chunks */
+static GByteArray *
+filter_write_chunked (GMimeFilter *filter, GByteArray *input)
+{
+	GMimeStream *stream, *filtered;
+	GByteArray *output;
+	size_t i, n;
+	
+	output = g_byte_array_new ();
+	stream = g_mime_stream_mem_new_with_byte_array (output);
+	g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+	filtered = g_mime_stream_filter_new (stream);
+	g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+	g_object_unref (stream);
+	
+	for (i = 0; i < input->len; i += n) {
+		n = 1 + rand () % 65536;
+		n = MIN (input->len - i, n);
+		g_mime_stream_write (filtered, (const char *) input->data + i, n);
+	}
+	
+	g_mime_stream_flush (filtered);
+	g_object_unref (filtered);
+	
+	return output;
+}
+
+static void
+test_zstd (const char *datadir, const char *filename, guint threads)
+{
+	char *path = g_build_filename (datadir, filename, NULL);
+	const char *what = "GMimeFilterGzip zstd round trip";
+	GByteArray *input, *compressed, *actual;
+	GMimeFilter *zip, *unzip, *copy;
+	
+	if (!g_mime_filter_gzip_format_is_supported (GMIME_FILTER_GZIP_FORMAT_ZSTD)) {
+		g_free (path);
+		return;
+	}
+	
+	testsuite_check ("%s (%u threads)", what, threads);
+	
+	/* make the input big enough to be split between several jobs */
+	actual = read_all_bytes (path, TRUE);
+	input = g_byte_array_new ();
+	while (input->len < 4 * 1024 * 1024)
+		g_byte_array_append (input, actual->data, actual->len);
+	g_byte_array_free (actual, TRUE);
+	g_free (path);
+	
+	zip = g_mime_filter_gzip_new_with_format (GMIME_FILTER_GZIP_MODE_ZIP, GMIME_FILTER_GZIP_FORMAT_ZSTD, 3);
+	g_mime_filter_gzip_set_threads ((GMimeFilterGZip *) zip, threads);
+	unzip = g_mime_filter_gzip_new_with_format (GMIME_FILTER_GZIP_MODE_UNZIP, GMIME_FILTER_GZIP_FORMAT_ZSTD, 0);
+	
+	/* make sure that copies and resets keep the format and settings */
+	copy = g_mime_filter_copy (zip);
+	g_object_unref (zip);
+	zip = copy;
+	
+	compressed = filter_write_chunked (zip, input);
+	g_mime_filter_reset (zip);
+	g_byte_array_free (filter_write_chunked (zip, input), TRUE);
+	actual = filter_write_chunked (unzip, compressed);
+	
+	if (g_mime_filter_gzip_get_format ((GMimeFilterGZip *) zip) != GMIME_FILTER_GZIP_FORMAT_ZSTD ||
+	    g_mime_filter_gzip_get_threads ((GMimeFilterGZip *) zip) != threads) {
+		testsuite_check_failed ("%s failed: the copy lost its settings", what);
+	} else if (compressed->len < 4 || memcmp (compressed->data, "\x28\xb5\x2f\xfd", 4) != 0) {
+		testsuite_check_failed ("%s failed: output is not a zstd frame", what);
+	} else if (compressed->len >= input->len / 2) {
+		testsuite_check_failed ("%s failed: output is not compressed: %u bytes", what, compressed->len);
+	} else if (actual->len != input->len || memcmp (actual->data, input->data, input->len) != 0) {
+		testsuite_check_failed ("%s failed: stream contents do not match", what);
+	} else {
+		testsuite_check_passed ();
+	}
+	
+	g_byte_array_free (compressed, TRUE);
+	g_byte_array_free (actual, TRUE);
+	g_byte_array_free (input, TRUE);
+	g_object_unref (unzip);
+	g_object_unref (zip);
+}
+
 static void
 test_html (const char *datadir, const char *input, const char *output, guint32 citation)
 {
@@ -468,6 +727,457 @@ error:
 	g_object_unref (filter);
 }
 
+static GByteArray *
+filter_crlf (const char *chain, GByteArray *input, gboolean read)
+{
+	GMimeStream *stream, *filtered;
+	GByteArray *output;
+	GMimeFilter *filter;
+	const char *c;
+	
+	output = g_byte_array_new ();
+	
+	if (read) {
+		stream = g_mime_stream_mem_new_with_buffer ((const char *) input->data, input->len);
+		filtered = g_mime_stream_filter_new (stream);
+		g_object_unref (stream);
+	} else {
+		stream = g_mime_stream_mem_new_with_byte_array (output);
+		g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+		filtered = g_mime_stream_filter_new (stream);
+		g_object_unref (stream);
+	}
+	
+	for (c = chain; *c; c++) {
+		if (*c == 'd')
+			filter = g_mime_filter_dos2unix_new (TRUE);
+		else
+			filter = g_mime_filter_unix2dos_new (TRUE);
+		
+		g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+		g_object_unref (filter);
+	}
+	
+	if (read) {
+		stream = g_mime_stream_mem_new_with_byte_array (output);
+		g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+		g_mime_stream_write_to_stream (filtered, stream);
+		g_object_unref (stream);
+	} else {
+		stream = test_stream_onebyte_new (filtered);
+		g_mime_stream_write (stream, (const char *) input->data, input->len);
+		g_mime_stream_flush (stream);
+		g_object_unref (stream);
+	}
+	
+	g_object_unref (filtered);
+	
+	return output;
+}
+
+static void
+test_crlf_in_place (void)
+{
+	const char *what = "GMimeFilterDos2Unix/Unix2Dos in place";
+	static const char *chains[] = { "d", "u", "du", "ud", "udu" };
+	GByteArray *input, *expected, *actual;
+	static const char alphabet[] = "abc \r\r\n\n";
+	char *inbuf, *outbuf, text[] = "\nline one\nline two\n";
+	size_t outlen, outprespace;
+	GMimeFilter *filter;
+	gboolean match;
+	guint i;
+	
+	testsuite_check ("%s", what);
+	
+	input = g_byte_array_new ();
+	for (i = 0; i < 65536; i++)
+		g_byte_array_append (input, (const guint8 *) &alphabet[rand () % (sizeof (alphabet) - 1)], 1);
+	
+	try {
+		/* reading filters the stream's own buffer in place, writing cannot */
+		for (i = 0; i < G_N_ELEMENTS (chains); i++) {
+			expected = filter_crlf (chains[i], input, FALSE);
+			actual = filter_crlf (chains[i], input, TRUE);
+			
+			match = actual->len == expected->len && !memcmp (actual->data, expected->data, actual->len);
+			g_byte_array_free (expected, TRUE);
+			g_byte_array_free (actual, TRUE);
+			
+			if (!match)
+				throw (exception_new ("chain `%s' read and write results do not match", chains[i]));
+		}
+		
+		filter = g_mime_filter_dos2unix_new (FALSE);
+		g_mime_filter_filter (filter, text + 1, sizeof (text) - 2, 1, &outbuf, &outlen, &outprespace);
+		g_object_unref (filter);
+		
+		if (outbuf != text + 1 || outlen != sizeof (text) - 2)
+			throw (exception_new ("dos2unix did not pass LF-only input through"));
+		
+		inbuf = g_strdup ("\rline one\r\nline two\r");
+		filter = g_mime_filter_dos2unix_new (FALSE);
+		g_mime_filter_filter_in_place (filter, inbuf + 1, strlen (inbuf) - 1, 1, &outbuf, &outlen, &outprespace);
+		g_object_unref (filter);
+		
+		match = outbuf == inbuf + 1 && outlen == 17 && !strncmp (outbuf, "line one\nline two", outlen);
+		g_free (inbuf);
+		
+		if (!match)
+			throw (exception_new ("dos2unix did not filter in place"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("%s failed: %s", what, ex->message);
+	} finally;
+	
+	g_byte_array_free (input, TRUE);
+}
+
+static GByteArray *
+filter_read_size (GByteArray *input, size_t read_size)
+{
+	GMimeStream *stream, *filtered;
+	GByteArray *output;
+	GMimeFilter *filter;
+	
+	stream = g_mime_stream_mem_new_with_buffer ((const char *) input->data, input->len);
+	filtered = g_mime_stream_filter_new (stream);
+	g_object_unref (stream);
+	
+	if (read_size > 0)
+		g_mime_stream_filter_set_read_size ((GMimeStreamFilter *) filtered, read_size);
+	
+	filter = g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, TRUE);
+	g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+	g_object_unref (filter);
+	
+	filter = g_mime_filter_unix2dos_new (TRUE);
+	g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+	g_object_unref (filter);
+	
+	output = g_byte_array_new ();
+	stream = g_mime_stream_mem_new_with_byte_array (output);
+	g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+	g_mime_stream_write_to_stream (filtered, stream);
+	g_object_unref (filtered);
+	g_object_unref (stream);
+	
+	return output;
+}
+
+static void
+test_read_size (void)
+{
+	const char *what = "GMimeStreamFilter read sizes";
+	static const size_t sizes[] = { 1, 13, 4096, 65536, 4 * 1024 * 1024 };
+	static const char alphabet[] = "abc= \t\r\n\xe9";
+	GByteArray *input, *expected, *actual;
+	gboolean match;
+	guint i;
+	
+	testsuite_check ("%s", what);
+	
+	input = g_byte_array_new ();
+	for (i = 0; i < 262144; i++)
+		g_byte_array_append (input, (const guint8 *) &alphabet[rand () % (sizeof (alphabet) - 1)], 1);
+	
+	expected = filter_read_size (input, 0);
+	
+	try {
+		for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+			actual = filter_read_size (input, sizes[i]);
+			match = actual->len == expected->len && !memcmp (actual->data, expected->data, actual->len);
+			g_byte_array_free (actual, TRUE);
+			
+			if (!match)
+				throw (exception_new ("read size %zu does not match the default", sizes[i]));
+		}
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("%s failed: %s", what, ex->message);
+	} finally;
+	
+	g_byte_array_free (expected, TRUE);
+	g_byte_array_free (input, TRUE);
+}
+
+/* byte-at-a-time reference implementations of the newline filters */
+static GByteArray *
+reference_convert (char kind, gboolean ensure_newline, const unsigned char *inbuf, size_t inlen)
+{
+	GByteArray *output = g_byte_array_new ();
+	gboolean bol = TRUE;
+	unsigned char c;
+	int pc = '\0';
+	size_t i;
+	
+	for (i = 0; i < inlen; i++) {
+		c = inbuf[i];
+		
+		switch (kind) {
+		case 'd':
+			if (c != '\n' && pc == '\r')
+				g_byte_array_append (output, (const guint8 *) "\r", 1);
+			if (c != '\r')
+				g_byte_array_append (output, &c, 1);
+			break;
+		case 'u':
+			if (c == '\n' && pc != '\r')
+				g_byte_array_append (output, (const guint8 *) "\r", 1);
+			g_byte_array_append (output, &c, 1);
+			break;
+		default:
+			if (c == '.' && bol) {
+				g_byte_array_append (output, &c, 1);
+				bol = FALSE;
+			} else {
+				bol = c == '\n';
+			}
+			g_byte_array_append (output, &c, 1);
+			break;
+		}
+		
+		pc = c;
+	}
+	
+	if (ensure_newline && pc != '\n') {
+		if (kind == 'u' && pc != '\r')
+			g_byte_array_append (output, (const guint8 *) "\r", 1);
+		g_byte_array_append (output, (const guint8 *) "\n", 1);
+	}
+	
+	return output;
+}
+
+static GMimeFilter *
+newline_filter_new (char kind, gboolean ensure_newline)
+{
+	switch (kind) {
+	case 'd': return g_mime_filter_dos2unix_new (ensure_newline);
+	case 'u': return g_mime_filter_unix2dos_new (ensure_newline);
+	default: return g_mime_filter_smtp_data_new ();
+	}
+}
+
+/* pushes @input through the filter in randomly sized chunks, either by
+ * writing to or by reading from a filter stream */
+static GByteArray *
+fuzz_convert (char kind, gboolean ensure_newline, GByteArray *input, gboolean read)
+{
+	GMimeStream *stream, *filtered;
+	GByteArray *output;
+	GMimeFilter *filter;
+	char buf[256];
+	ssize_t nread;
+	size_t i, n;
+	
+	output = g_byte_array_new ();
+	
+	if (read) {
+		stream = g_mime_stream_mem_new_with_buffer ((const char *) input->data, input->len);
+		filtered = g_mime_stream_filter_new (stream);
+		g_mime_stream_filter_set_read_size ((GMimeStreamFilter *) filtered, 1 + rand () % 300);
+		g_object_unref (stream);
+	} else {
+		stream = g_mime_stream_mem_new_with_byte_array (output);
+		g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+		filtered = g_mime_stream_filter_new (stream);
+		g_object_unref (stream);
+	}
+	
+	filter = newline_filter_new (kind, ensure_newline);
+	g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+	g_object_unref (filter);
+	
+	if (read) {
+		while ((nread = g_mime_stream_read (filtered, buf, 1 + rand () % sizeof (buf))) > 0)
+			g_byte_array_append (output, (const guint8 *) buf, nread);
+	} else {
+		for (i = 0; i < input->len; i += n) {
+			n = 1 + rand () % 300;
+			n = MIN (input->len - i, n);
+			g_mime_stream_write (filtered, (const char *) input->data + i, n);
+		}
+		
+		g_mime_stream_flush (filtered);
+	}
+	
+	g_object_unref (filtered);
+	
+	return output;
+}
+
+static void
+test_newline_fuzz (void)
+{
+	const char *what = "GMimeFilterDos2Unix/Unix2Dos/SmtpData equivalence";
+	static const char alphabet[] = "ab.\r\n";
+	static const char kinds[] = "dus";
+	GByteArray *input, *expected, *actual;
+	gboolean ensure_newline, read;
+	guint iter, i, len, k;
+	gboolean match;
+	
+	testsuite_check ("%s", what);
+	
+	try {
+		for (iter = 0; iter < 200; iter++) {
+			input = g_byte_array_new ();
+			/* (a filter stream that is never written to is never completed) */
+			len = 1 + rand () % (iter < 100 ? 16 : 4096);
+			for (i = 0; i < len; i++)
+				g_byte_array_append (input, (const guint8 *) &alphabet[rand () % (sizeof (alphabet) - 1)], 1);
+			
+			for (k = 0; k < sizeof (kinds) - 1; k++) {
+				ensure_newline = kinds[k] != 's' && (iter & 1);
+				read = (iter & 2) != 0;
+				
+				expected = reference_convert (kinds[k], ensure_newline, input->data, input->len);
+				actual = fuzz_convert (kinds[k], ensure_newline, input, read);
+				
+				match = actual->len == expected->len && !memcmp (actual->data, expected->data, actual->len);
+				g_byte_array_free (expected, TRUE);
+				g_byte_array_free (actual, TRUE);
+				
+				if (!match) {
+					g_byte_array_free (input, TRUE);
+					throw (exception_new ("%c filter output does not match the reference (iteration %u, %s)",
+							      kinds[k], iter, read ? "read" : "write"));
+				}
+			}
+			
+			g_byte_array_free (input, TRUE);
+		}
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("%s failed: %s", what, ex->message);
+	} finally;
+}
+
+static void
+checksum_write (GMimeFilter *checksum, GByteArray *input)
+{
+	GMimeStream *stream, *filtered;
+	size_t i, n;
+	
+	stream = g_mime_stream_null_new ();
+	filtered = g_mime_stream_filter_new (stream);
+	g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, checksum);
+	g_object_unref (stream);
+	
+	for (i = 0; i < input->len; i += n) {
+		n = 1 + rand () % 300;
+		n = MIN (input->len - i, n);
+		g_mime_stream_write (filtered, (const char *) input->data + i, n);
+	}
+	
+	g_mime_stream_flush (filtered);
+	g_object_unref (filtered);
+}
+
+static gboolean
+checksum_matches (GMimeFilter *checksum, GChecksumType type, GByteArray *input)
+{
+	char *expected, *actual;
+	gboolean match;
+	
+	expected = g_compute_checksum_for_data (type, input->data, input->len);
+	actual = g_mime_filter_checksum_get_string_for_type ((GMimeFilterChecksum *) checksum, type);
+	match = actual != NULL && !strcmp (actual, expected);
+	g_free (expected);
+	g_free (actual);
+	
+	return match;
+}
+
+static void
+test_checksum_multi (void)
+{
+	const char *what = "GMimeFilterChecksum multiple digests";
+	static const guint lengths[] = { 0, 1, 55, 56, 63, 64, 65, 119, 1000, 100000 };
+	static const GChecksumType types[] = { G_CHECKSUM_MD5, G_CHECKSUM_SHA1, G_CHECKSUM_SHA256 };
+	GMimeFilter *checksum, *copy;
+	GByteArray *input, *half;
+	unsigned char digest[32];
+	gboolean match;
+	size_t n;
+	guint i, j;
+	
+	testsuite_check ("%s", what);
+	
+	try {
+		for (i = 0; i < G_N_ELEMENTS (lengths); i++) {
+			input = g_byte_array_new ();
+			g_byte_array_set_size (input, lengths[i]);
+			for (j = 0; j < lengths[i]; j++)
+				input->data[j] = (unsigned char) rand ();
+			
+			checksum = g_mime_filter_checksum_new_multi ();
+			for (j = 0; j < G_N_ELEMENTS (types); j++)
+				g_mime_filter_checksum_add ((GMimeFilterChecksum *) checksum, types[j]);
+			g_mime_filter_checksum_add_crc32 ((GMimeFilterChecksum *) checksum);
+			
+			/* a copy picks up where the original left off */
+			half = g_byte_array_new ();
+			g_byte_array_append (half, input->data, input->len / 2);
+			checksum_write (checksum, half);
+			copy = g_mime_filter_copy (checksum);
+			g_byte_array_remove_range (input, 0, half->len);
+			checksum_write (copy, input);
+			g_byte_array_prepend (input, half->data, half->len);
+			
+			match = TRUE;
+			for (j = 0; j < G_N_ELEMENTS (types) && match; j++) {
+				match = checksum_matches (copy, types[j], input) &&
+					checksum_matches (checksum, types[j], half);
+			}
+			
+			/* the first digest added is the default one */
+			n = g_mime_filter_checksum_get_digest ((GMimeFilterChecksum *) copy, digest, sizeof (digest));
+			g_byte_array_free (half, TRUE);
+			
+			g_object_unref (checksum);
+			g_object_unref (copy);
+			g_byte_array_free (input, TRUE);
+			
+			if (!match)
+				throw (exception_new ("digests of %u bytes do not match", lengths[i]));
+			
+			if (n != 16)
+				throw (exception_new ("unexpected default digest length: %zu", n));
+		}
+		
+		/* crc32 check value */
+		input = g_byte_array_new ();
+		g_byte_array_append (input, (const guint8 *) "123456789", 9);
+		checksum = g_mime_filter_checksum_new (G_CHECKSUM_MD5);
+		g_mime_filter_checksum_add ((GMimeFilterChecksum *) checksum, G_CHECKSUM_SHA256);
+		g_mime_filter_checksum_add_crc32 ((GMimeFilterChecksum *) checksum);
+		checksum_write (checksum, input);
+		
+		match = g_mime_filter_checksum_get_crc32 ((GMimeFilterChecksum *) checksum) == 0xcbf43926;
+		match = match && checksum_matches (checksum, G_CHECKSUM_MD5, input);
+		match = match && checksum_matches (checksum, G_CHECKSUM_SHA256, input);
+		n = g_mime_filter_checksum_get_digest_for_type ((GMimeFilterChecksum *) checksum, G_CHECKSUM_SHA1, digest, sizeof (digest));
+		
+		g_object_unref (checksum);
+		g_byte_array_free (input, TRUE);
+		
+		if (!match)
+			throw (exception_new ("digests of \"123456789\" do not match"));
+		
+		if (n != 0)
+			throw (exception_new ("got a digest for a type that was never added"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("%s failed: %s", what, ex->message);
+	} finally;
+}
+
 int main (int argc, char **argv)
 {
 	const char *datadir = "data/filters";
@@ -503,11 +1213,16 @@ int main (int argc, char **argv)
 	test_charset_conversion (datadir, "japanese", "iso-2022-jp", "utf-8");
 	test_charset_conversion (datadir, "japanese", "utf-8", "shift-jis");
 	test_charset_conversion (datadir, "japanese", "shift-jis", "utf-8");
+	test_charset_conversion (datadir, "japanese", "utf-8", "utf-8");
+	test_charset_fast_paths ();
+	test_charset_held_back ();
 	
 	test_enriched (datadir, "enriched.txt", "enriched.html");
 	
 	test_gzip (datadir, "lorem-ipsum.txt");
 	test_gunzip (datadir, "lorem-ipsum.txt");
+	test_zstd (datadir, "lorem-ipsum.txt", 0);
+	test_zstd (datadir, "lorem-ipsum.txt", 2);
 	
 	test_html (datadir, "html-input.txt", "html-output.blockquote.html", GMIME_FILTER_HTML_BLOCKQUOTE_CITATION);
 	test_html (datadir, "html-input.txt", "html-output.mark.html", GMIME_FILTER_HTML_MARK_CITATION);
@@ -515,6 +1230,11 @@ int main (int argc, char **argv)
 	
 	test_smtp_data (datadir, "smtp-input.txt", "smtp-output.txt");
 	
+	test_crlf_in_place ();
+	test_read_size ();
+	test_newline_fuzz ();
+	test_checksum_multi ();
+	
 	test_windows (datadir, "french-fable.cp1252.txt", "iso-8859-1", "windows-cp1252");
 	
 	testsuite_end ();
@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
 #include <gmime/gmime.h>
 
@@ -132,6 +133,305 @@ test_utils (void)
 	testsuite_end ();
 }
 
+/* converts @input by calling iconv() directly, skipping invalid bytes
+ * the same way GMimeFilterCharset does, but without its built-in
+ * converters */
+static GByteArray *
+iconv_reference (const char *charset, GByteArray *input)
+{
+	size_t inleft, outleft;
+	GByteArray *output;
+	char *inbuf, *outbuf;
+	iconv_t cd;
+	
+	cd = g_mime_iconv_open ("UTF-8", charset);
+	output = g_byte_array_sized_new (input->len * 4 + 16);
+	g_byte_array_set_size (output, input->len * 4 + 16);
+	
+	inbuf = (char *) input->data;
+	inleft = input->len;
+	outbuf = (char *) output->data;
+	outleft = output->len;
+	
+	while (inleft > 0) {
+		if (iconv (cd, &inbuf, &inleft, &outbuf, &outleft) != (size_t) -1)
+			continue;
+		
+		if (errno != EILSEQ)
+			break;
+		
+		inbuf++;
+		inleft--;
+	}
+	
+	iconv (cd, NULL, NULL, &outbuf, &outleft);
+	g_mime_iconv_close (cd);
+	
+	g_byte_array_set_size (output, (guint) ((guint8 *) outbuf - output->data));
+	
+	return output;
+}
+
+/* converts @input using GMimeFilterCharset, which uses the built-in
+ * converters where there are any */
+static GByteArray *
+filter_convert (const char *charset, GByteArray *input)
+{
+	GMimeStream *stream, *filtered;
+	GMimeFilter *filter;
+	GByteArray *output;
+	
+	output = g_byte_array_new ();
+	stream = g_mime_stream_mem_new_with_byte_array (output);
+	g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+	filtered = g_mime_stream_filter_new (stream);
+	filter = g_mime_filter_charset_new (charset, "UTF-8");
+	g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+	g_object_unref (filter);
+	g_object_unref (stream);
+	
+	g_mime_stream_write (filtered, (const char *) input->data, input->len);
+	g_mime_stream_flush (filtered);
+	g_object_unref (filtered);
+	
+	return output;
+}
+
+static GByteArray *
+random_8bit (void)
+{
+	GByteArray *input = g_byte_array_new ();
+	guint n, i, len;
+	guint8 c;
+	
+	n = 1 + rand () % 64;
+	for (i = 0; i < n; i++) {
+		len = 1 + rand () % 8;
+		
+		while (len-- > 0) {
+			c = (rand () % 2) ? 0x80 + rand () % 128 : rand () % 128;
+			g_byte_array_append (input, &c, 1);
+		}
+	}
+	
+	return input;
+}
+
+static GByteArray *
+random_utf16 (gboolean be)
+{
+	GByteArray *input = g_byte_array_new ();
+	guint16 unit;
+	guint8 bytes[2];
+	guint n, i;
+	
+	n = 1 + rand () % 128;
+	for (i = 0; i < n; i++) {
+		switch (rand () % 8) {
+		case 0: unit = 0x80 + rand () % 0x780; break;            /* 2 byte UTF-8 */
+		case 1: unit = 0x800 + rand () % 0xd000; break;          /* 3 byte UTF-8 */
+		case 2: unit = 0xd800 + rand () % 0x400; break;          /* high surrogate */
+		case 3: unit = 0xdc00 + rand () % 0x400; break;          /* low surrogate */
+		case 4: unit = 0xe000 + rand () % 0x2000; break;
+		default: unit = 1 + rand () % 127; break;                /* ASCII */
+		}
+		
+		bytes[be ? 0 : 1] = unit >> 8;
+		bytes[be ? 1 : 0] = unit & 0xff;
+		g_byte_array_append (input, bytes, 2);
+	}
+	
+	/* sometimes cut off the last code unit */
+	if (rand () % 4 == 0)
+		g_byte_array_set_size (input, input->len - 1);
+	
+	return input;
+}
+
+static void
+test_builtin_converters (void)
+{
+	static const char *charsets[] = {
+		"iso-8859-1", "latin1", "iso-8859-15", "windows-1252", "cp1252", "koi8-r", "utf-16le", "utf-16be"
+	};
+	GByteArray *input, *expected, *actual;
+	gboolean match;
+	guint i, iter;
+	iconv_t cd;
+	
+	testsuite_start ("built-in charset converters");
+	
+	for (i = 0; i < G_N_ELEMENTS (charsets); i++) {
+		testsuite_check ("%s to UTF-8", charsets[i]);
+		
+		try {
+			if ((cd = g_mime_iconv_open ("UTF-8", charsets[i])) == (iconv_t) -1)
+				throw (exception_new ("could not open conversion for %s to UTF-8", charsets[i]));
+			
+			g_mime_iconv_close (cd);
+			
+			for (iter = 0; iter < 500; iter++) {
+				if (!strncmp (charsets[i], "utf-16", 6))
+					input = random_utf16 (charsets[i][6] == 'b');
+				else
+					input = random_8bit ();
+				
+				expected = iconv_reference (charsets[i], input);
+				actual = filter_convert (charsets[i], input);
+				g_byte_array_free (input, TRUE);
+				
+				match = actual->len == expected->len && !memcmp (actual->data, expected->data, actual->len);
+				g_byte_array_free (expected, TRUE);
+				g_byte_array_free (actual, TRUE);
+				
+				if (!match)
+					throw (exception_new ("output does not match iconv (iteration %u)", iter));
+			}
+			
+			testsuite_check_passed ();
+		} catch (ex) {
+			testsuite_check_failed ("%s to UTF-8 failed: %s", charsets[i], ex->message);
+		} finally;
+	}
+	
+	testsuite_end ();
+}
+
+/* the way g_mime_utils_decode_8bit() used to pick a charset: convert
+ * the text into each of the charsets, keeping the first one with the
+ * fewest invalid bytes */
+static char *
+decode_8bit_reference (const char **charsets, const char *text, size_t len)
+{
+	size_t inleft, outleft, ninval, min = len;
+	char *inbuf, *outbuf, *out, *best = NULL;
+	iconv_t cd;
+	guint i;
+	
+	for (i = 0; charsets[i]; i++) {
+		if ((cd = g_mime_iconv_open ("UTF-8", charsets[i])) == (iconv_t) -1)
+			continue;
+		
+		outleft = len * 4 + 16;
+		outbuf = out = g_malloc (outleft + 1);
+		inbuf = (char *) text;
+		inleft = len;
+		ninval = 0;
+		
+		while (inleft > 0 && iconv (cd, &inbuf, &inleft, &outbuf, &outleft) == (size_t) -1) {
+			if (errno == EINVAL) {
+				ninval += inleft;
+				break;
+			}
+			
+			/* skip over the invalid byte */
+			*outbuf++ = '?';
+			outleft--;
+			inleft--;
+			inbuf++;
+			ninval++;
+		}
+		
+		iconv (cd, NULL, NULL, &outbuf, &outleft);
+		g_mime_iconv_close (cd);
+		*outbuf = '\0';
+		
+		if (best == NULL || ninval < min) {
+			g_free (best);
+			min = ninval;
+			best = out;
+		} else {
+			g_free (out);
+		}
+		
+		if (ninval == 0)
+			break;
+	}
+	
+	return best;
+}
+
+static GByteArray *
+random_mixed_8bit (void)
+{
+	static const char *pieces[] = {
+		"caf\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\xed\x9f\xbf", "\xf4\x8f\xbf\xbf",
+		"\xe0\xa0", "\xe0\x80", "\xed\xa0\x80", "\xf0\x80", "\xf4\x90-", "\xc0\xaf", "\xf5-",
+		"\xe9t\xe9", "\xa4", "\x80", "\x9f", "\xc4\xc5", "plain text ", "\r\n"
+	};
+	GByteArray *input = g_byte_array_new ();
+	const char *piece;
+	guint n, i;
+	guint8 c;
+	
+	n = 1 + rand () % 24;
+	for (i = 0; i < n; i++) {
+		if (rand () % 4 == 0) {
+			/* glibc's iconv accepts UTF-8 sequences beyond U+10FFFF
+			 * which decode_8bit() rejects, so never start one */
+			c = 1 + rand () % 0xf3;
+			g_byte_array_append (input, &c, 1);
+		} else {
+			piece = pieces[rand () % G_N_ELEMENTS (pieces)];
+			g_byte_array_append (input, (const guint8 *) piece, strlen (piece));
+		}
+	}
+	
+	return input;
+}
+
+static void
+test_decode_8bit (void)
+{
+	static const char *fallbacks[][6] = {
+		{ "utf-8", "iso-8859-1", NULL },
+		{ "utf-8", "windows-1252", "koi8-r", "iso-8859-15", NULL },
+		{ "us-ascii", "shift_jis", "utf-8", "iso-8859-7", NULL },
+		{ "iso-8859-8", "euc-kr", "windows-1251", NULL },
+		{ "utf-8", "big5", "no-such-charset", "us-ascii", NULL }
+	};
+	GMimeParserOptions *options;
+	char *expected, *actual;
+	GByteArray *input;
+	gboolean match;
+	guint i, iter;
+	
+	testsuite_start ("8bit text decoding");
+	
+	options = g_mime_parser_options_new ();
+	
+	for (i = 0; i < G_N_ELEMENTS (fallbacks); i++) {
+		testsuite_check ("fallback charsets #%u", i);
+		
+		g_mime_parser_options_set_fallback_charsets (options, fallbacks[i]);
+		
+		try {
+			for (iter = 0; iter < 1000; iter++) {
+				input = random_mixed_8bit ();
+				
+				expected = decode_8bit_reference (fallbacks[i], (const char *) input->data, input->len);
+				actual = g_mime_utils_decode_8bit (options, (const char *) input->data, input->len);
+				g_byte_array_free (input, TRUE);
+				
+				match = expected != NULL && !strcmp (expected, actual);
+				g_free (expected);
+				g_free (actual);
+				
+				if (!match)
+					throw (exception_new ("output does not match (iteration %u)", iter));
+			}
+			
+			testsuite_check_passed ();
+		} catch (ex) {
+			testsuite_check_failed ("fallback charsets #%u failed: %s", i, ex->message);
+		} finally;
+	}
+	
+	g_mime_parser_options_free (options);
+	
+	testsuite_end ();
+}
+
 int main (int argc, char **argv)
 {
 	g_mime_init ();
@@ -139,6 +439,8 @@ int main (int argc, char **argv)
 	testsuite_init (argc, argv);
 	
 	test_utils ();
+	test_builtin_converters ();
+	test_decode_8bit ();
 	
 	g_mime_shutdown ();
 	
@@ -99,79 +99,1110 @@ xevcb (GMimeParser *parser, const char *header, const char *value, gint64 offset
 {
 }
 
+static const char *header_regex_names[] = {
+	"From", "To", "Cc", "Subject", "Date", "Message-Id", "In-Reply-To", "Received", "X-Evolution",
+	"X-Evolution-Source", "X-Mailer", "X-Spam-Id", "x-subject-line", "MIME-Version", "Content-Type"
+};
+
+static const char *header_regex_patterns[] = {
+	"^X-Evolution",
+	"^(Subject|From)$",
+	"subject",
+	"^x-.*",
+	"-Id$",
+	"^(?:To|Cc)$",
+	"Received|^Date$",
+	"^Message\\-Id$",
+	"^ Subject $",
+	"^X-.*-Id$",
+	"^(To|Cc)[a-z]*$",
+	"^.*Id"
+};
+
 static void
-test_parser (GMimeParser *parser, GMimeStream *mbox, GMimeStream *summary)
+header_regex_cb (GMimeParser *parser, const char *header, const char *value, gint64 offset, gpointer user_data)
 {
-	gint64 message_begin, message_end, headers_begin, headers_end;
-	GMimeFormatOptions *format = g_mime_format_options_get_default ();
-	InternetAddressList *list;
+	GString *matched = user_data;
+	
+	g_string_append_printf (matched, "%s;", header);
+}
+
+static void
+test_header_regex (void)
+{
+	GString *message, *expected, *matched;
+	GMimeMessage *msg;
+	GMimeParser *parser;
+	GMimeStream *stream;
+	GRegex *regex;
+	guint i, j;
+	
+	message = g_string_new ("");
+	for (i = 0; i < G_N_ELEMENTS (header_regex_names); i++)
+		g_string_append_printf (message, "%s: value\n", header_regex_names[i]);
+	g_string_append (message, "\nThis is the message body.\n");
+	
+	expected = g_string_new ("");
+	matched = g_string_new ("");
+	
+	for (i = 0; i < G_N_ELEMENTS (header_regex_patterns); i++) {
+		testsuite_check ("\"%s\"", header_regex_patterns[i]);
+		
+		regex = g_regex_new (header_regex_patterns[i], G_REGEX_RAW | G_REGEX_EXTENDED | G_REGEX_CASELESS, 0, NULL);
+		g_string_truncate (expected, 0);
+		g_string_truncate (matched, 0);
+		
+		for (j = 0; j < G_N_ELEMENTS (header_regex_names); j++) {
+			if (g_regex_match (regex, header_regex_names[j], 0, NULL))
+				g_string_append_printf (expected, "%s;", header_regex_names[j]);
+		}
+		
+		g_regex_unref (regex);
+		
+		stream = g_mime_stream_mem_new_with_buffer (message->str, message->len);
+		parser = g_mime_parser_new_with_stream (stream);
+		g_mime_parser_set_header_regex (parser, header_regex_patterns[i], header_regex_cb, matched);
+		g_object_unref (stream);
+		
+		msg = g_mime_parser_construct_message (parser, NULL);
+		g_object_unref (parser);
+		
+		if (msg != NULL)
+			g_object_unref (msg);
+		
+		if (strcmp (expected->str, matched->str) != 0)
+			testsuite_check_failed ("\"%s\": expected \"%s\" but got \"%s\"", header_regex_patterns[i],
+						expected->str, matched->str);
+		else
+			testsuite_check_passed ();
+	}
+	
+	g_string_free (expected, TRUE);
+	g_string_free (matched, TRUE);
+	g_string_free (message, TRUE);
+}
+
+static void
+test_parser_stats (void)
+{
+	const char *text = "From: sender@example.com\n"
+		"Subject: statistics\n"
+		"Content-Type: multipart/mixed; boundary=\"b\"\n"
+		"\n"
+		"prologue\n"
+		"--b\n"
+		"Content-Type: text/plain\n"
+		"\n"
+		"--not-a-boundary\n"
+		"--b\n"
+		"Content-Type: text/html\n"
+		"\n"
+		"<p>html</p>\n"
+		"--b--\n";
+	const GMimeParserStats *stats;
+	GMimeMessage *message = NULL;
+	GMimeParser *parser;
+	GMimeStream *stream;
+	
+	stream = g_mime_stream_mem_new_with_buffer (text, strlen (text));
+	parser = g_mime_parser_new_with_stream (stream);
+	g_mime_parser_set_persist_stream (parser, FALSE);
+	g_object_unref (stream);
+	
+	testsuite_check ("disabled by default");
+	if (g_mime_parser_get_stats (parser) == NULL)
+		testsuite_check_passed ();
+	else
+		testsuite_check_failed ("disabled by default: expected NULL");
+	
+	testsuite_check ("counters");
+	try {
+		g_mime_parser_set_collect_stats (parser, TRUE);
+		
+		if (!(message = g_mime_parser_construct_message (parser, NULL)))
+			throw (exception_new ("failed to parse message"));
+		
+		if (!(stats = g_mime_parser_get_stats (parser)))
+			throw (exception_new ("no statistics"));
+		
+		if (stats->bytes_scanned != (gint64) strlen (text))
+			throw (exception_new ("expected %u bytes scanned but got %" G_GINT64_FORMAT, (guint) strlen (text), stats->bytes_scanned));
+		
+		if (stats->headers != 5)
+			throw (exception_new ("expected 5 headers but got %u", stats->headers));
+		
+		if (stats->parts != 3)
+			throw (exception_new ("expected 3 parts but got %u", stats->parts));
+		
+		if (stats->boundary_checks != 4 || stats->boundary_misses != 1)
+			throw (exception_new ("expected 4 boundary checks with 1 miss but got %u with %u", stats->boundary_checks, stats->boundary_misses));
+		
+		if (stats->bytes_buffered == 0 || stats->refills == 0)
+			throw (exception_new ("expected buffered bytes and refills"));
+		
+		if (stats->header_usec < 0 || stats->content_usec < 0 || stats->construct_usec < 0)
+			throw (exception_new ("negative timings"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("counters: %s", ex->message);
+	} finally;
+	
+	if (message != NULL)
+		g_object_unref (message);
+	g_object_unref (parser);
+}
+
+static void
+append_content_length_message (GString *mbox, const char *subject, const char *headers, const char *body, long content_length, gboolean separator)
+{
+	g_string_append_printf (mbox, "From sender@example.com Mon Jan  2 03:04:05 2006\n"
+				"From: sender@example.com\nSubject: %s\n%sContent-Length: %ld\n\n%s",
+				subject, headers, content_length, body);
+	
+	if (separator)
+		g_string_append_c (mbox, '\n');
+}
+
+static GPtrArray *
+parse_content_length_stream (GMimeStream *stream, gboolean trust, gboolean persist, gint64 *scanned, gint64 *offset)
+{
+	GPtrArray *messages = g_ptr_array_new_with_free_func (g_free);
+	const GMimeParserStats *stats;
 	GMimeMessage *message;
-	char *marker, *buf;
-	const char *subject;
-	GMimeObject *body;
-	GDateTime *date;
-	int nmsg = 0;
+	GMimeParser *parser;
+	
+	parser = g_mime_parser_new_with_stream (stream);
+	g_mime_parser_set_format (parser, GMIME_FORMAT_MBOX);
+	g_mime_parser_set_respect_content_length (parser, TRUE);
+	g_mime_parser_set_trust_content_length (parser, trust);
+	g_mime_parser_set_persist_stream (parser, persist);
+	g_mime_parser_set_collect_stats (parser, TRUE);
+	
+	*scanned = 0;
 	
 	while (!g_mime_parser_eos (parser)) {
-		message_begin = g_mime_parser_tell (parser);
 		if (!(message = g_mime_parser_construct_message (parser, NULL)))
-			throw (exception_new ("failed to parse message #%d", nmsg));
+			break;
 		
-		message_end = g_mime_parser_tell (parser);
+		g_ptr_array_add (messages, g_mime_object_to_string ((GMimeObject *) message, NULL));
+		g_object_unref (message);
 		
-		headers_begin = g_mime_parser_get_headers_begin (parser);
-		headers_end = g_mime_parser_get_headers_end (parser);
+		stats = g_mime_parser_get_stats (parser);
+		*scanned += stats->bytes_scanned;
+	}
+	
+	*offset = g_mime_parser_tell (parser);
+	
+	g_object_unref (parser);
+	
+	return messages;
+}
+
+static GPtrArray *
+parse_content_length_mbox (GString *mbox, gboolean trust, gboolean persist, gint64 *scanned)
+{
+	GPtrArray *messages;
+	GMimeStream *stream;
+	gint64 offset;
+	
+	stream = g_mime_stream_mem_new_with_buffer (mbox->str, mbox->len);
+	messages = parse_content_length_stream (stream, trust, persist, scanned, &offset);
+	g_object_unref (stream);
+	
+	return messages;
+}
+
+/* unlike a memory stream, a file stream can seek past the end of the file */
+static GPtrArray *
+parse_content_length_file (GString *mbox, gboolean persist, gint64 *offset)
+{
+	GPtrArray *messages;
+	GMimeStream *stream;
+	gint64 scanned;
+	char *path;
+	int fd;
+	
+	if ((fd = g_file_open_tmp ("test-mbox.XXXXXX", &path, NULL)) == -1)
+		return NULL;
+	
+	stream = g_mime_stream_fs_new (fd);
+	g_mime_stream_write (stream, mbox->str, mbox->len);
+	g_mime_stream_reset (stream);
+	
+	messages = parse_content_length_stream (stream, TRUE, persist, &scanned, offset);
+	g_object_unref (stream);
+	unlink (path);
+	g_free (path);
+	
+	return messages;
+}
+
+static void
+test_trust_content_length (void)
+{
+	const char *multipart = "MIME-Version: 1.0\nContent-Type: multipart/mixed; boundary=\"b\"\n";
+	const char *after = "From sender@example.com Mon Jan  2 03:04:05 2006\n"
+		"From: sender@example.com\nSubject: after\nContent-Length: %03lu\n\n%sFrom the middle of a body\n";
+	GPtrArray *scanned, *trusted, *file;
+	gint64 nscanned, ntrusted, offset;
+	GString *big, *mbox, *inner;
+	size_t hlen, padlen;
+	gboolean persist;
+	char *pad;
+	guint i, j;
+	
+	big = g_string_new ("");
+	g_string_append (big, "From the desk of a sender who did not escape this line.\n");
+	for (i = 0; i < 2048; i++)
+		g_string_append_printf (big, "line %04u of a body that is only ever skipped over\n", i);
+	
+	mbox = g_string_new ("");
+	append_content_length_message (mbox, "valid", "", big->str, (long) big->len, TRUE);
+	append_content_length_message (mbox, "too short", "", "this body is longer than advertised\n", 5, TRUE);
+	append_content_length_message (mbox, "multipart", multipart, "--b\n\nfirst\n--b\n\nsecond\n--b--\n", 29, TRUE);
+	append_content_length_message (mbox, "crlf", "", "windows body\r\n", 14, FALSE);
+	g_string_append (mbox, "\r\n");
+	
+	/* The Content-Length of a message/rfc822 message must not be applied to the body of
+	 * the embedded message, even when it lands on a From-line from there (which it does
+	 * here, as the next message's body has one exactly where it would end). */
+	inner = g_string_new ("From: inner@example.com\nSubject: inner\nX-Padding:");
+	for (i = 0; i < 20; i++)
+		g_string_append (inner, " padding");
+	g_string_append (inner, "\n\nthe embedded body\n");
+	hlen = strstr (inner->str, "the embedded body") - inner->str;
+	append_content_length_message (mbox, "embedded", "Content-Type: message/rfc822\n", inner->str, (long) inner->len, TRUE);
+	padlen = hlen - 1 - (strlen (after) - strlen ("%03lu%sFrom the middle of a body\n") + 3);
+	pad = g_strnfill (padlen, 'x');
+	pad[padlen - 1] = '\n';
+	g_string_append_printf (mbox, after, (unsigned long) (padlen + strlen ("From the middle of a body\n")), pad);
+	g_string_append_c (mbox, '\n');
+	g_string_free (inner, TRUE);
+	g_free (pad);
+	
+	append_content_length_message (mbox, "too long", "", "runs into the next From-line\n", 1000, TRUE);
+	append_content_length_message (mbox, "last", "", "the last body\n", 14, FALSE);
+	
+	for (persist = FALSE; persist <= TRUE; persist++) {
+		testsuite_check ("trusted Content-Length (persist stream = %s)", persist ? "true" : "false");
 		
-		g_mime_stream_printf (summary, "message offsets: %" G_GINT64_FORMAT ", %" G_GINT64_FORMAT "\n",
-				      message_begin, message_end);
-		g_mime_stream_printf (summary, "header offsets: %" G_GINT64_FORMAT ", %" G_GINT64_FORMAT "\n",
-				      headers_begin, headers_end);
+		scanned = parse_content_length_mbox (mbox, FALSE, persist, &nscanned);
+		trusted = parse_content_length_mbox (mbox, TRUE, persist, &ntrusted);
 		
-		marker = g_mime_parser_get_mbox_marker (parser);
-		g_mime_stream_printf (summary, "%s\n", marker);
+		try {
+			/* the overlong Content-Length swallows the last message, just as it does when scanning */
+			if (trusted->len != 7)
+				throw (exception_new ("expected 7 messages but got %u", trusted->len));
+			
+			if (scanned->len != trusted->len)
+				throw (exception_new ("scanned %u messages but trusted %u", scanned->len, trusted->len));
+			
+			for (i = 0; i < trusted->len; i++) {
+				if (strcmp (scanned->pdata[i], trusted->pdata[i]) != 0)
+					throw (exception_new ("message %u does not match when scanned", i));
+			}
+			
+			if (!strstr (trusted->pdata[0], "From the desk of a sender"))
+				throw (exception_new ("unescaped From-line was not part of the body"));
+			
+			if (ntrusted >= nscanned - (gint64) big->len / 2)
+				throw (exception_new ("expected the body to be skipped: scanned %" G_GINT64_FORMAT " of %" G_GINT64_FORMAT " bytes",
+						      ntrusted, nscanned));
+			
+			if (!(file = parse_content_length_file (mbox, persist, &offset)))
+				throw (exception_new ("could not create a temporary file"));
+			
+			for (i = 0; i < file->len && i < scanned->len; i++) {
+				if (strcmp (scanned->pdata[i], file->pdata[i]) != 0)
+					break;
+			}
+			
+			j = file->len;
+			g_ptr_array_free (file, TRUE);
+			
+			if (i < j || j != scanned->len)
+				throw (exception_new ("message %u does not match when parsed from a file", i));
+			
+			if (offset > (gint64) mbox->len)
+				throw (exception_new ("parser offset %" G_GINT64_FORMAT " is past the end of the file", offset));
+			
+			testsuite_check_passed ();
+		} catch (ex) {
+			testsuite_check_failed ("trusted Content-Length (persist stream = %s): %s", persist ? "true" : "false", ex->message);
+		} finally;
 		
-		if ((list = g_mime_message_get_from (message)) != NULL &&
-		    internet_address_list_length (list) > 0) {
-			buf = internet_address_list_to_string (list, format, FALSE);
-			g_mime_stream_printf (summary, "From: %s\n", buf);
-			g_free (buf);
-		}
+		g_ptr_array_free (scanned, TRUE);
+		g_ptr_array_free (trusted, TRUE);
+	}
+	
+	g_string_free (mbox, TRUE);
+	g_string_free (big, TRUE);
+}
+
+static void
+test_trust_huge_content_length (void)
+{
+	const char *body = "the start of a body that is mostly a hole in the file\n";
+	GMimeDataWrapper *content;
+	GMimeMessage *message;
+	GMimeStream *stream, *content_stream;
+	GMimeParser *parser;
+	GMimeObject *part;
+	gint64 length;
+	char buf[64];
+	char *path;
+	char *mbox;
+	int fd;
+	
+	testsuite_check ("trusted Content-Length of 4 GiB or more");
+	
+	/* a (guint) cast would turn this into a 15-byte body */
+	length = (gint64) G_MAXUINT + 16;
+	mbox = g_strdup_printf ("From sender@example.com Mon Jan  2 03:04:05 2006\n"
+				"From: sender@example.com\nSubject: huge\nContent-Length: %" G_GINT64_FORMAT "\n\n%s",
+				length, body);
+	
+	if ((fd = g_file_open_tmp ("test-mbox.XXXXXX", &path, NULL)) == -1) {
+		testsuite_check_warn ("could not create a temporary file");
+		g_free (mbox);
+		return;
+	}
+	
+	/* make the file just long enough (and mostly sparse) for the Content-Length to check out */
+	if (write (fd, mbox, strlen (mbox)) != (ssize_t) strlen (mbox) ||
+	    ftruncate (fd, (off_t) (strlen (mbox) - strlen (body) + length)) == -1) {
+		testsuite_check_warn ("could not create a sparse %" G_GINT64_FORMAT "-byte file", length);
+		unlink (path);
+		g_free (mbox);
+		g_free (path);
+		close (fd);
+		return;
+	}
+	
+	lseek (fd, 0, SEEK_SET);
+	stream = g_mime_stream_fs_new (fd);
+	
+	parser = g_mime_parser_new_with_stream (stream);
+	g_mime_parser_set_format (parser, GMIME_FORMAT_MBOX);
+	g_mime_parser_set_respect_content_length (parser, TRUE);
+	g_mime_parser_set_trust_content_length (parser, TRUE);
+	g_mime_parser_set_persist_stream (parser, FALSE);
+	g_mime_parser_set_spill_threshold (parser, 0);
+	message = NULL;
+	
+	try {
+		if (!(message = g_mime_parser_construct_message (parser, NULL)))
+			throw (exception_new ("failed to parse the message"));
 		
-		if ((list = g_mime_message_get_addresses (message, GMIME_ADDRESS_TYPE_TO)) != NULL &&
-		    internet_address_list_length (list) > 0) {
-			buf = internet_address_list_to_string (list, format, FALSE);
-			g_mime_stream_printf (summary, "To: %s\n", buf);
-			g_free (buf);
-		}
+		part = g_mime_message_get_mime_part (message);
+		if (!GMIME_IS_PART (part) || !(content = g_mime_part_get_content ((GMimePart *) part)))
+			throw (exception_new ("message has no content"));
 		
-		if (!(subject = g_mime_message_get_subject (message)))
-			subject = "";
-		g_mime_stream_printf (summary, "Subject: %s\n", subject);
+		content_stream = g_mime_data_wrapper_get_stream (content);
+		if (g_mime_stream_length (content_stream) != length)
+			throw (exception_new ("unexpected content length: %" G_GINT64_FORMAT, g_mime_stream_length (content_stream)));
 		
-		if (!(date = g_mime_message_get_date (message))) {
-			date = g_date_time_new_from_unix_utc (0);
-		} else {
-			g_date_time_ref (date);
+		g_mime_stream_reset (content_stream);
+		if (g_mime_stream_read (content_stream, buf, strlen (body)) != (ssize_t) strlen (body) ||
+		    strncmp (buf, body, strlen (body)) != 0)
+			throw (exception_new ("content does not match"));
+		
+		if (!g_mime_parser_eos (parser))
+			throw (exception_new ("parser did not skip to the end of the stream"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("trusted Content-Length of 4 GiB or more: %s", ex->message);
+	} finally;
+	
+	if (message != NULL)
+		g_object_unref (message);
+	g_object_unref (parser);
+	g_object_unref (stream);
+	unlink (path);
+	g_free (mbox);
+	g_free (path);
+}
+
+static GPtrArray *
+parse_fed_mbox (GString *mbox, size_t chunk, gboolean persist)
+{
+	GPtrArray *messages = g_ptr_array_new_with_free_func (g_object_unref);
+	GMimeMessage *message;
+	GMimeParser *parser;
+	const char *inptr;
+	gboolean ready;
+	size_t left, n;
+	
+	parser = g_mime_parser_new ();
+	g_mime_parser_set_format (parser, GMIME_FORMAT_MBOX);
+	g_mime_parser_set_persist_stream (parser, persist);
+	
+	inptr = mbox->str;
+	left = mbox->len;
+	
+	while (left > 0) {
+		n = MIN (left, chunk);
+		ready = g_mime_parser_feed (parser, inptr, n);
+		inptr += n;
+		left -= n;
+		
+		while (ready && (message = g_mime_parser_construct_message (parser, NULL))) {
+			g_ptr_array_add (messages, message);
+			ready = g_mime_parser_feed (parser, NULL, 0);
 		}
-		buf = g_mime_utils_header_format_date (date);
-		g_mime_stream_printf (summary, "Date: %s\n", buf);
-		g_date_time_unref (date);
+	}
+	
+	g_mime_parser_finish (parser);
+	
+	while (!g_mime_parser_eos (parser) && (message = g_mime_parser_construct_message (parser, NULL)))
+		g_ptr_array_add (messages, message);
+	
+	g_object_unref (parser);
+	
+	return messages;
+}
+
+static void
+test_feed_consumed_input (void)
+{
+	GPtrArray *expected, *messages;
+	gboolean persist;
+	gint64 scanned;
+	GString *mbox;
+	guint i, j;
+	char *str;
+	
+	mbox = g_string_new ("");
+	for (i = 0; i < 40; i++) {
+		g_string_append_printf (mbox, "From sender@example.com Mon Jan 1 00:00:%02u 2024\n"
+					"From: sender@example.com\nSubject: message %u\n\n", i, i);
+		
+		/* make some of the messages span several of the parser's reads */
+		for (j = 0; j < (i % 5) * 97; j++)
+			g_string_append_printf (mbox, "line %u of message %u\n", j, i);
+		
+		g_string_append (mbox, "\n");
+	}
+	
+	expected = parse_content_length_mbox (mbox, FALSE, FALSE, &scanned);
+	
+	for (persist = FALSE; persist <= TRUE; persist++) {
+		testsuite_check ("fed messages (persist stream = %s)", persist ? "true" : "false");
+		
+		/* keep every message around so that persisted content must outlive the consumed input */
+		messages = parse_fed_mbox (mbox, 61, persist);
+		
+		try {
+			if (messages->len != expected->len)
+				throw (exception_new ("expected %u messages but got %u", expected->len, messages->len));
+			
+			for (i = 0; i < messages->len; i++) {
+				str = g_mime_object_to_string (messages->pdata[i], NULL);
+				j = strcmp (str, expected->pdata[i]);
+				g_free (str);
+				
+				if (j != 0)
+					throw (exception_new ("message %u does not match", i));
+			}
+			
+			testsuite_check_passed ();
+		} catch (ex) {
+			testsuite_check_failed ("fed messages (persist stream = %s): %s", persist ? "true" : "false", ex->message);
+		} finally;
+		
+		g_ptr_array_free (messages, TRUE);
+	}
+	
+	g_ptr_array_free (expected, TRUE);
+	g_string_free (mbox, TRUE);
+}
+
+static void
+test_spill_threshold (void)
+{
+	GMimeDataWrapper *content;
+	GPtrArray *expected;
+	GMimeMessage *message;
+	GMimeParser *parser;
+	GMimeStream *stream;
+	GMimeObject *part;
+	gboolean spilled;
+	GString *big, *mbox;
+	gboolean trust;
+	gint64 nscanned;
+	guint i, n;
+	char *str;
+	
+	big = g_string_new ("");
+	for (i = 0; i < 512; i++)
+		g_string_append_printf (big, "line %04u of a body that is too big to keep in memory\n", i);
+	
+	mbox = g_string_new ("");
+	append_content_length_message (mbox, "big", "", big->str, (long) big->len, TRUE);
+	append_content_length_message (mbox, "small", "", "a small body\n", 13, FALSE);
+	
+	for (trust = FALSE; trust <= TRUE; trust++) {
+		testsuite_check ("spill threshold (trust Content-Length = %s)", trust ? "true" : "false");
+		
+		expected = parse_content_length_mbox (mbox, trust, FALSE, &nscanned);
+		
+		stream = g_mime_stream_mem_new_with_buffer (mbox->str, mbox->len);
+		parser = g_mime_parser_new_with_stream (stream);
+		g_mime_parser_set_format (parser, GMIME_FORMAT_MBOX);
+		g_mime_parser_set_respect_content_length (parser, TRUE);
+		g_mime_parser_set_trust_content_length (parser, trust);
+		g_mime_parser_set_persist_stream (parser, FALSE);
+		g_mime_parser_set_spill_threshold (parser, 4096);
+		g_object_unref (stream);
+		
+		try {
+			for (n = 0; !g_mime_parser_eos (parser); n++) {
+				if (!(message = g_mime_parser_construct_message (parser, NULL)))
+					throw (exception_new ("failed to parse message %u", n));
+				
+				part = g_mime_message_get_mime_part (message);
+				content = g_mime_part_get_content ((GMimePart *) part);
+				stream = g_mime_data_wrapper_get_stream (content);
+				
+				if (!GMIME_IS_STREAM_SPILL (stream)) {
+					g_object_unref (message);
+					throw (exception_new ("message %u content is not a GMimeStreamSpill", n));
+				}
+				
+				spilled = g_mime_stream_spill_get_spilled ((GMimeStreamSpill *) stream);
+				str = g_mime_object_to_string ((GMimeObject *) message, NULL);
+				g_object_unref (message);
+				
+				if (n >= expected->len || strcmp (str, expected->pdata[n]) != 0) {
+					g_free (str);
+					throw (exception_new ("message %u does not match when kept in memory", n));
+				}
+				
+				g_free (str);
+				
+				if (spilled != (n == 0))
+					throw (exception_new ("message %u was %sspilled to disk", n, spilled ? "" : "not "));
+			}
+			
+			if (n != expected->len)
+				throw (exception_new ("expected %u messages but got %u", expected->len, n));
+			
+			testsuite_check_passed ();
+		} catch (ex) {
+			testsuite_check_failed ("spill threshold (trust Content-Length = %s): %s", trust ? "true" : "false", ex->message);
+		} finally;
+		
+		g_ptr_array_free (expected, TRUE);
+		g_object_unref (parser);
+	}
+	
+	g_string_free (mbox, TRUE);
+	g_string_free (big, TRUE);
+}
+
+static void
+content_checksum_cb (GMimeParser *parser, GMimePart *part, GMimeFilterChecksum *checksum, gpointer user_data)
+{
+	GPtrArray *digests = user_data;
+	
+	g_ptr_array_add (digests, g_mime_filter_checksum_get_string_for_type (checksum, G_CHECKSUM_SHA256));
+	g_ptr_array_add (digests, g_strdup_printf ("%08x", g_mime_filter_checksum_get_crc32 (checksum)));
+}
+
+static void
+content_checksum_collect (GMimeObject *parent, GMimeObject *part, gpointer user_data)
+{
+	GPtrArray *digests = user_data;
+	GMimeStream *stream, *content;
+	GMimeFilter *checksum;
+	GByteArray *buffer;
+	size_t outprespace;
+	size_t outlen;
+	char *outbuf;
+	
+	if (!GMIME_IS_PART (part))
+		return;
+	
+	buffer = g_byte_array_new ();
+	stream = g_mime_stream_mem_new_with_byte_array (buffer);
+	g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+	content = g_mime_data_wrapper_get_stream (g_mime_part_get_content ((GMimePart *) part));
+	g_mime_stream_reset (content);
+	g_mime_stream_write_to_stream (content, stream);
+	g_object_unref (stream);
+	
+	checksum = g_mime_filter_checksum_new_multi ();
+	g_mime_filter_checksum_add_crc32 ((GMimeFilterChecksum *) checksum);
+	g_mime_filter_complete (checksum, (char *) buffer->data, buffer->len, 0, &outbuf, &outlen, &outprespace);
+	
+	g_ptr_array_add (digests, g_compute_checksum_for_data (G_CHECKSUM_SHA256, buffer->data, buffer->len));
+	g_ptr_array_add (digests, g_strdup_printf ("%08x", g_mime_filter_checksum_get_crc32 ((GMimeFilterChecksum *) checksum)));
+	
+	g_byte_array_free (buffer, TRUE);
+	g_object_unref (checksum);
+}
+
+static void
+test_content_checksum (void)
+{
+	const char *parts[] = {
+		"Content-Type: text/plain\n\nfirst part\n",
+		"Content-Type: text/plain\r\n\r\nsecond part\r\nwith CRLF\r\n",
+		"Content-Type: text/plain\n\nno trailing newline",
+		"Content-Type: text/plain\n\n",
+		"Content-Type: text/plain\n\nx",
+		"Content-Type: application/octet-stream\nContent-Transfer-Encoding: base64\n\naGVsbG8gd29ybGQK\n",
+	};
+	GPtrArray *expected, *actual;
+	GMimeFilter *checksum;
+	GMimeMessage *message;
+	GMimeParser *parser;
+	GMimeStream *stream;
+	gboolean persist;
+	GString *text;
+	guint i, n;
+	
+	text = g_string_new ("");
+	for (n = 0; n < 2; n++) {
+		g_string_append_printf (text, "From sender@example.com Mon Jan  2 03:04:05 2006\n"
+					"From: sender@example.com\nSubject: message %u\nMIME-Version: 1.0\n"
+					"Content-Type: multipart/mixed; boundary=\"boundary\"\n\n", n);
+		
+		for (i = 0; i < G_N_ELEMENTS (parts); i++)
+			g_string_append_printf (text, "--boundary\n%s\n", parts[i]);
+		
+		g_string_append (text, "--boundary--\n\n");
+		append_content_length_message (text, "single part", "", "a body of known length\n", 23, TRUE);
+	}
+	
+	for (persist = FALSE; persist <= TRUE; persist++) {
+		testsuite_check ("content checksum (persist = %s)", persist ? "true" : "false");
+		
+		expected = g_ptr_array_new_with_free_func (g_free);
+		actual = g_ptr_array_new_with_free_func (g_free);
+		
+		checksum = g_mime_filter_checksum_new (G_CHECKSUM_SHA256);
+		g_mime_filter_checksum_add_crc32 ((GMimeFilterChecksum *) checksum);
+		
+		stream = g_mime_stream_mem_new_with_buffer (text->str, text->len);
+		parser = g_mime_parser_new_with_stream (stream);
+		g_mime_parser_set_format (parser, GMIME_FORMAT_MBOX);
+		g_mime_parser_set_respect_content_length (parser, TRUE);
+		g_mime_parser_set_trust_content_length (parser, TRUE);
+		g_mime_parser_set_persist_stream (parser, persist);
+		g_mime_parser_set_content_checksum (parser, (GMimeFilterChecksum *) checksum, content_checksum_cb, actual);
+		g_object_unref (checksum);
+		g_object_unref (stream);
+		
+		try {
+			for (n = 0; !g_mime_parser_eos (parser); n++) {
+				if (!(message = g_mime_parser_construct_message (parser, NULL)))
+					throw (exception_new ("failed to parse message %u", n));
+				
+				g_mime_message_foreach (message, content_checksum_collect, expected);
+				g_object_unref (message);
+			}
+			
+			if (n != 4)
+				throw (exception_new ("expected 4 messages but got %u", n));
+			
+			if (actual->len != expected->len)
+				throw (exception_new ("expected %u digests but got %u", expected->len, actual->len));
+			
+			for (i = 0; i < expected->len; i++) {
+				if (strcmp (actual->pdata[i], expected->pdata[i]) != 0)
+					throw (exception_new ("digest %u does not match the content: %s vs %s", i,
+							      (char *) actual->pdata[i], (char *) expected->pdata[i]));
+			}
+			
+			testsuite_check_passed ();
+		} catch (ex) {
+			testsuite_check_failed ("content checksum (persist = %s): %s", persist ? "true" : "false", ex->message);
+		} finally;
+		
+		g_ptr_array_free (expected, TRUE);
+		g_ptr_array_free (actual, TRUE);
+		g_object_unref (parser);
+	}
+	
+	g_string_free (text, TRUE);
+}
+
+static void
+limit_warning_cb (gint64 offset, GMimeParserWarning errcode, const gchar *item, gpointer user_data)
+{
+	*((guint *) user_data) |= 1 << errcode;
+}
+
+static GMimeMessage *
+parse_with_limits (GString *text, GMimeParserOptions *options, gboolean *eos)
+{
+	GMimeMessage *message;
+	GMimeParser *parser;
+	GMimeStream *stream;
+	
+	stream = g_mime_stream_mem_new_with_buffer (text->str, text->len);
+	parser = g_mime_parser_new_with_stream (stream);
+	g_object_unref (stream);
+	
+	message = g_mime_parser_construct_message (parser, options);
+	*eos = g_mime_parser_eos (parser);
+	g_object_unref (parser);
+	
+	return message;
+}
+
+/* parses up to 2 messages from an mbox, returning the number of messages */
+static int
+parse_mbox_with_limits (GString *text, GMimeParserOptions *options, char *subjects[2])
+{
+	GMimeMessage *message;
+	GMimeParser *parser;
+	GMimeStream *stream;
+	int n = 0;
+	
+	stream = g_mime_stream_mem_new_with_buffer (text->str, text->len);
+	parser = g_mime_parser_new_with_stream (stream);
+	g_mime_parser_set_format (parser, GMIME_FORMAT_MBOX);
+	g_object_unref (stream);
+	
+	while (!g_mime_parser_eos (parser) && (message = g_mime_parser_construct_message (parser, options))) {
+		if (n < 2)
+			subjects[n] = g_strdup (g_mime_message_get_subject (message));
+		g_object_unref (message);
+		n++;
+	}
+	
+	g_object_unref (parser);
+	
+	return n;
+}
+
+static void
+test_parser_limits (void)
+{
+	char *subjects[2] = { NULL, NULL };
+	GMimeMessage *message = NULL;
+	GMimeParserOptions *options;
+	GMimeObject *part;
+	guint warnings = 0;
+	const char *value;
+	gboolean eos;
+	GString *text;
+	int i, n;
+	
+	text = g_string_new ("");
+	options = g_mime_parser_options_new ();
+	g_mime_parser_options_set_warning_callback (options, limit_warning_cb, &warnings);
+	
+	testsuite_check ("max headers");
+	try {
+		g_string_assign (text, "From: sender@example.com\n");
+		for (i = 0; i < 20; i++)
+			g_string_append_printf (text, "X-Header-%d: value\n", i);
+		g_string_append (text, "\nbody\n");
+		
+		g_mime_parser_options_set_max_headers (options, 5);
+		message = parse_with_limits (text, options, &eos);
+		g_mime_parser_options_set_max_headers (options, 0);
+		
+		if (message == NULL)
+			throw (exception_new ("failed to parse message"));
+		
+		if (!(warnings & (1 << GMIME_CRIT_TOO_MANY_HEADERS)))
+			throw (exception_new ("expected GMIME_CRIT_TOO_MANY_HEADERS"));
+		
+		if (g_mime_header_list_get_count (((GMimeObject *) message)->headers) != 5)
+			throw (exception_new ("expected 5 headers but got %d", g_mime_header_list_get_count (((GMimeObject *) message)->headers)));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("max headers: %s", ex->message);
+	} finally;
+	
+	if (message != NULL)
+		g_object_unref (message);
+	message = NULL;
+	warnings = 0;
+	
+	testsuite_check ("max header size");
+	try {
+		g_string_assign (text, "From: sender@example.com\nSubject: ");
+		for (i = 0; i < 100; i++)
+			g_string_append (text, "0123456789\n ");
+		g_string_append (text, "end\n\nbody\n");
+		
+		g_mime_parser_options_set_max_header_size (options, 100);
+		message = parse_with_limits (text, options, &eos);
+		g_mime_parser_options_set_max_header_size (options, 0);
+		
+		if (message == NULL)
+			throw (exception_new ("failed to parse message"));
+		
+		if (!(warnings & (1 << GMIME_CRIT_HEADER_TOO_LONG)))
+			throw (exception_new ("expected GMIME_CRIT_HEADER_TOO_LONG"));
+		
+		if (!(value = g_mime_message_get_subject (message)) || strlen (value) > 100)
+			throw (exception_new ("subject was not truncated"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("max header size: %s", ex->message);
+	} finally;
+	
+	if (message != NULL)
+		g_object_unref (message);
+	message = NULL;
+	warnings = 0;
+	
+	testsuite_check ("max parts");
+	try {
+		g_string_assign (text, "From: sender@example.com\nContent-Type: multipart/mixed; boundary=\"b\"\n\n");
+		for (i = 0; i < 10; i++)
+			g_string_append_printf (text, "--b\nContent-Type: text/plain\n\npart %d\n", i);
+		g_string_append (text, "--b--\n");
+		
+		g_mime_parser_options_set_max_parts (options, 4);
+		message = parse_with_limits (text, options, &eos);
+		g_mime_parser_options_set_max_parts (options, 0);
+		
+		if (message == NULL)
+			throw (exception_new ("failed to parse message"));
+		
+		if (!(warnings & (1 << GMIME_CRIT_TOO_MANY_PARTS)))
+			throw (exception_new ("expected GMIME_CRIT_TOO_MANY_PARTS"));
+		
+		part = g_mime_message_get_mime_part (message);
+		if (!GMIME_IS_MULTIPART (part) || g_mime_multipart_get_count ((GMimeMultipart *) part) != 3)
+			throw (exception_new ("expected a multipart with 3 subparts"));
+		
+		if (!((GMimeMultipart *) part)->write_end_boundary)
+			throw (exception_new ("expected the end boundary to be found"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("max parts: %s", ex->message);
+	} finally;
+	
+	if (message != NULL)
+		g_object_unref (message);
+	message = NULL;
+	warnings = 0;
+	
+	testsuite_check ("max depth");
+	try {
+		g_string_assign (text, "From: sender@example.com\n");
+		for (i = 0; i < 5; i++)
+			g_string_append_printf (text, "Content-Type: multipart/mixed; boundary=\"b%d\"\n\n--b%d\n", i, i);
+		g_string_append (text, "Content-Type: text/plain\n\nleaf\n");
+		for (i = 4; i >= 0; i--)
+			g_string_append_printf (text, "--b%d--\n", i);
+		
+		g_mime_parser_options_set_max_depth (options, 2);
+		message = parse_with_limits (text, options, &eos);
+		g_mime_parser_options_set_max_depth (options, 0);
+		
+		if (message == NULL)
+			throw (exception_new ("failed to parse message"));
+		
+		if (!(warnings & (1 << GMIME_CRIT_NESTING_OVERFLOW)))
+			throw (exception_new ("expected GMIME_CRIT_NESTING_OVERFLOW"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("max depth: %s", ex->message);
+	} finally;
+	
+	if (message != NULL)
+		g_object_unref (message);
+	message = NULL;
+	warnings = 0;
+	
+	testsuite_check ("max content size");
+	try {
+		g_string_assign (text, "From: sender@example.com\n\n");
+		for (i = 0; i < 10000; i++)
+			g_string_append (text, "This line is part of a very large message body.\n");
+		
+		g_mime_parser_options_set_max_content_size (options, 16384);
+		message = parse_with_limits (text, options, &eos);
+		g_mime_parser_options_set_max_content_size (options, 0);
+		
+		if (message == NULL)
+			throw (exception_new ("failed to parse message"));
+		
+		if (!(warnings & (1 << GMIME_CRIT_CONTENT_TOO_LARGE)))
+			throw (exception_new ("expected GMIME_CRIT_CONTENT_TOO_LARGE"));
+		
+		if (!eos)
+			throw (exception_new ("expected the parser to stop"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("max content size: %s", ex->message);
+	} finally;
+	
+	if (message != NULL)
+		g_object_unref (message);
+	message = NULL;
+	warnings = 0;
+	
+	testsuite_check ("max content size (mbox)");
+	try {
+		g_string_assign (text, "From sender@example.com Mon Jan 1 00:00:00 2024\nSubject: first\n\n");
+		for (i = 0; i < 10000; i++)
+			g_string_append (text, "This line is part of a very large message body.\n");
+		g_string_append (text, "\nFrom sender@example.com Mon Jan 1 00:00:01 2024\nSubject: second\n\nsmall body\n");
+		
+		g_mime_parser_options_set_max_content_size (options, 16384);
+		n = parse_mbox_with_limits (text, options, subjects);
+		g_mime_parser_options_set_max_content_size (options, 0);
+		
+		if (!(warnings & (1 << GMIME_CRIT_CONTENT_TOO_LARGE)))
+			throw (exception_new ("expected GMIME_CRIT_CONTENT_TOO_LARGE"));
+		
+		if (n != 2)
+			throw (exception_new ("expected 2 messages but got %d", n));
+		
+		if (strcmp (subjects[0], "first") != 0 || strcmp (subjects[1], "second") != 0)
+			throw (exception_new ("unexpected messages: %s, %s", subjects[0], subjects[1]));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("max content size (mbox): %s", ex->message);
+	} finally;
+	
+	for (i = 0; i < (int) G_N_ELEMENTS (subjects); i++)
+		g_free (subjects[i]);
+	
+	g_mime_parser_options_free (options);
+	g_string_free (text, TRUE);
+}
+
+static void
+summarize_message (GMimeParser *parser, GMimeMessage *message, gint64 message_begin, GMimeStream *mbox, GMimeStream *summary, int nmsg)
+{
+	gint64 message_end, headers_begin, headers_end;
+	GMimeFormatOptions *format = g_mime_format_options_get_default ();
+	InternetAddressList *list;
+	char *marker, *buf;
+	const char *subject;
+	GMimeObject *body;
+	GDateTime *date;
+	
+	message_end = g_mime_parser_tell (parser);
+	
+	headers_begin = g_mime_parser_get_headers_begin (parser);
+	headers_end = g_mime_parser_get_headers_end (parser);
+	
+	g_mime_stream_printf (summary, "message offsets: %" G_GINT64_FORMAT ", %" G_GINT64_FORMAT "\n",
+			      message_begin, message_end);
+	g_mime_stream_printf (summary, "header offsets: %" G_GINT64_FORMAT ", %" G_GINT64_FORMAT "\n",
+			      headers_begin, headers_end);
+	
+	marker = g_mime_parser_get_mbox_marker (parser);
+	g_mime_stream_printf (summary, "%s\n", marker);
+	
+	if ((list = g_mime_message_get_from (message)) != NULL &&
+	    internet_address_list_length (list) > 0) {
+		buf = internet_address_list_to_string (list, format, FALSE);
+		g_mime_stream_printf (summary, "From: %s\n", buf);
 		g_free (buf);
+	}
+	
+	if ((list = g_mime_message_get_addresses (message, GMIME_ADDRESS_TYPE_TO)) != NULL &&
+	    internet_address_list_length (list) > 0) {
+		buf = internet_address_list_to_string (list, format, FALSE);
+		g_mime_stream_printf (summary, "To: %s\n", buf);
+		g_free (buf);
+	}
+	
+	if (!(subject = g_mime_message_get_subject (message)))
+		subject = "";
+	g_mime_stream_printf (summary, "Subject: %s\n", subject);
+	
+	if (!(date = g_mime_message_get_date (message))) {
+		date = g_date_time_new_from_unix_utc (0);
+	} else {
+		g_date_time_ref (date);
+	}
+	buf = g_mime_utils_header_format_date (date);
+	g_mime_stream_printf (summary, "Date: %s\n", buf);
+	g_date_time_unref (date);
+	g_free (buf);
+	
+	body = g_mime_message_get_mime_part (message);
+	print_mime_struct (summary, body, 0);
+	g_mime_stream_write (summary, "\n", 1);
+	
+	if (mbox) {
+		if (nmsg > 0)
+			g_mime_stream_write (mbox, "\n", 1);
+		
+		g_mime_stream_printf (mbox, "%s\n", marker);
+		g_mime_object_write_to_stream ((GMimeObject *) message, format, mbox);
+	}
+	
+	g_free (marker);
+}
+
+static void
+test_parser (GMimeParser *parser, GMimeStream *mbox, GMimeStream *summary)
+{
+	GMimeMessage *message;
+	gint64 message_begin;
+	int nmsg = 0;
+	
+	while (!g_mime_parser_eos (parser)) {
+		message_begin = g_mime_parser_tell (parser);
+		if (!(message = g_mime_parser_construct_message (parser, NULL)))
+			throw (exception_new ("failed to parse message #%d", nmsg));
 		
-		body = g_mime_message_get_mime_part (message);
-		print_mime_struct (summary, body, 0);
-		g_mime_stream_write (summary, "\n", 1);
+		summarize_message (parser, message, message_begin, mbox, summary, nmsg);
+		g_object_unref (message);
+		nmsg++;
+	}
+}
+
+static void
+test_feed_parser (GMimeParser *parser, const char *data, size_t len, size_t chunk, GMimeStream *summary)
+{
+	GMimeMessage *message;
+	gint64 message_begin;
+	gboolean ready;
+	int nmsg = 0;
+	size_t n;
+	
+	while (len > 0) {
+		n = MIN (len, chunk);
+		ready = g_mime_parser_feed (parser, data, n);
+		data += n;
+		len -= n;
 		
-		if (mbox) {
-			if (nmsg > 0)
-				g_mime_stream_write (mbox, "\n", 1);
+		while (ready) {
+			message_begin = g_mime_parser_tell (parser);
+			if (!(message = g_mime_parser_construct_message (parser, NULL)))
+				throw (exception_new ("failed to parse message #%d", nmsg));
 			
-			g_mime_stream_printf (mbox, "%s\n", marker);
-			g_mime_object_write_to_stream ((GMimeObject *) message, format, mbox);
+			summarize_message (parser, message, message_begin, NULL, summary, nmsg);
+			g_object_unref (message);
+			nmsg++;
+			
+			ready = g_mime_parser_feed (parser, NULL, 0);
 		}
+	}
+	
+	g_mime_parser_finish (parser);
+	
+	while (!g_mime_parser_eos (parser)) {
+		message_begin = g_mime_parser_tell (parser);
+		if (!(message = g_mime_parser_construct_message (parser, NULL)))
+			throw (exception_new ("failed to parse message #%d", nmsg));
 		
+		summarize_message (parser, message, message_begin, NULL, summary, nmsg);
 		g_object_unref (message);
-		g_free (marker);
 		nmsg++;
 	}
 }
@@ -274,12 +1305,13 @@ streams_match (GMimeStream *istream, GMimeStream *ostream)
 int main (int argc, char **argv)
 {
 	const char *datadir = "data/mbox";
-	char input[256], output[256], *tmp, *p, *q;
+	char input[256], output[256], *data, *tmp, *p, *q;
 	GMimeStream *istream, *ostream, *mstream, *pstream;
 	GMimeParser *parser;
 	const char *dent;
 	const char *path;
 	struct stat st;
+	gsize len;
 	GDir *dir;
 	int i;
 #ifdef ENABLE_MBOX_MATCH
@@ -332,6 +1364,7 @@ int main (int argc, char **argv)
 			strcpy (q, dent);
 			
 			tmp = NULL;
+			data = NULL;
 			parser = NULL;
 			istream = NULL;
 			ostream = NULL;
@@ -400,6 +1433,25 @@ int main (int argc, char **argv)
 				if (!streams_match (ostream, pstream))
 					throw (exception_new ("summaries do not match for `%s'", dent));
 				
+				/* now feed the same mbox to a parser in odd-sized chunks */
+				if (!g_file_get_contents (input, &data, &len, NULL))
+					throw (exception_new ("could not read `%s'", input));
+				
+				g_object_unref (parser);
+				parser = g_mime_parser_new ();
+				g_mime_parser_set_format (parser, GMIME_FORMAT_MBOX);
+				g_mime_parser_set_respect_content_length (parser, strstr (dent, "content-length") != NULL);
+				g_mime_parser_set_header_regex (parser, "^X-Evolution", xevcb, NULL);
+				
+				g_object_unref (pstream);
+				pstream = g_mime_stream_mem_new ();
+				test_feed_parser (parser, data, len, 61, pstream);
+				
+				g_mime_stream_reset (ostream);
+				g_mime_stream_reset (pstream);
+				if (!streams_match (ostream, pstream))
+					throw (exception_new ("summaries of the fed mbox do not match for `%s'", dent));
+				
 				testsuite_check_passed ();
 				
 #ifdef ENABLE_MBOX_MATCH
@@ -427,6 +1479,7 @@ int main (int argc, char **argv)
 			if (parser != NULL)
 				g_object_unref (parser);
 			
+			g_free (data);
 			g_free (tmp);
 		}
 		
@@ -506,6 +1559,35 @@ int main (int argc, char **argv)
 	
 	testsuite_end ();
 	
+	testsuite_start ("Header regex");
+	test_header_regex ();
+	testsuite_end ();
+	
+	testsuite_start ("Parser statistics");
+	test_parser_stats ();
+	testsuite_end ();
+	
+	testsuite_start ("Trusted Content-Length");
+	test_trust_content_length ();
+	test_trust_huge_content_length ();
+	testsuite_end ();
+	
+	testsuite_start ("Buffered feed parser");
+	test_feed_consumed_input ();
+	testsuite_end ();
+	
+	testsuite_start ("Spill threshold");
+	test_spill_threshold ();
+	testsuite_end ();
+	
+	testsuite_start ("Content checksums");
+	test_content_checksum ();
+	testsuite_end ();
+	
+	testsuite_start ("Parser limits");
+	test_parser_limits ();
+	testsuite_end ();
+	
 	g_mime_shutdown ();
 	
 	return testsuite_exit ();
@@ -312,6 +312,96 @@ test_addrspec (GMimeParserOptions *options, gboolean test_broken)
 	}
 }
 
+static void
+test_address_spans (GMimeParserOptions *options)
+{
+	GMimeFormatOptions *format = g_mime_format_options_get_default ();
+	const InternetAddressSpan *span;
+	InternetAddressSpanList *spans;
+	InternetAddressList *addrlist;
+	const char *input;
+	char *str;
+	guint i;
+	
+	for (i = 0; i < G_N_ELEMENTS (addrspec); i++) {
+		addrlist = NULL;
+		spans = NULL;
+		str = NULL;
+		
+		testsuite_check ("addrspec[%u]", i);
+		try {
+			input = addrspec[i].input;
+			
+			if (!(spans = internet_address_span_list_parse (options, input)))
+				throw (exception_new ("could not parse: %s", input));
+			
+			span = internet_address_span_list_get_span (spans, 0);
+			if (addrspec[i].charset != NULL) {
+				if (span->charset == NULL)
+					throw (exception_new ("expected '%s' but got NULL charset: %s", addrspec[i].charset, input));
+				if (g_ascii_strcasecmp (addrspec[i].charset, span->charset) != 0)
+					throw (exception_new ("expected '%s' but got '%s' charset: %s", addrspec[i].charset, span->charset, input));
+			} else if (span->charset != NULL) {
+				throw (exception_new ("expected NULL charset but span has a charset of '%s': %s", span->charset, input));
+			}
+			
+			addrlist = internet_address_span_list_to_address_list (spans);
+			
+			str = internet_address_list_to_string (addrlist, format, FALSE);
+			if (strcmp (addrspec[i].display, str) != 0)
+				throw (exception_new ("display strings do not match.\ninput: %s\nexpected: %s\nactual: %s", input, addrspec[i].display, str));
+			g_free (str);
+			
+			str = internet_address_list_to_string (addrlist, format, TRUE);
+			if (strcmp (addrspec[i].encoded, str) != 0)
+				throw (exception_new ("encoded strings do not match.\nexpected: %s\nactual: %s", addrspec[i].encoded, str));
+			
+			testsuite_check_passed ();
+		} catch (ex) {
+			testsuite_check_failed ("addrspec[%u]: %s", i, ex->message);
+		} finally;
+		
+		g_free (str);
+		if (addrlist)
+			g_object_unref (addrlist);
+		internet_address_span_list_free (spans);
+	}
+	
+	testsuite_check ("spans reference the input");
+	try {
+		input = "Jeffrey Stedfast <fejj@gnome.org>, group: user@example.com;";
+		
+		if (!(spans = internet_address_span_list_parse (options, input)))
+			throw (exception_new ("could not parse: %s", input));
+		
+		if (internet_address_span_list_length (spans) != 3)
+			throw (exception_new ("expected 3 spans but got %d", internet_address_span_list_length (spans)));
+		
+		span = internet_address_span_list_get_span (spans, 0);
+		if (span->name != input || span->name_length != 16)
+			throw (exception_new ("name span does not reference the input"));
+		if (span->domain != input + 23 || span->domain_length != 9)
+			throw (exception_new ("domain span does not reference the input"));
+		
+		span = internet_address_span_list_get_span (spans, 1);
+		if (!span->is_group || span->group != -1)
+			throw (exception_new ("expected a top-level group span"));
+		
+		span = internet_address_span_list_get_span (spans, 2);
+		if (span->is_group || span->group != 1)
+			throw (exception_new ("expected a member of group 1"));
+		if (span->local_part != input + 42 || span->local_part_length != 4)
+			throw (exception_new ("local-part span does not reference the input"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("spans reference the input: %s", ex->message);
+	} finally;
+	
+	if (spans)
+		internet_address_span_list_free (spans);
+}
+
 
 static struct {
 	const char *in;
@@ -322,6 +412,12 @@ static struct {
 	{ "Mon, 17 Jan 1994 11:14:55 -0500",
 	  "Mon, 17 Jan 1994 11:14:55 -0500",
 	  758823295, -500 },
+	{ "Mon,17 Jan 1994 11:14:55 -0500 (EST)",
+	  "Mon, 17 Jan 1994 11:14:55 -0500",
+	  758823295, -500 },
+	{ " 17 Jan 1994 11:14 +0130",
+	  "Mon, 17 Jan 1994 11:14:00 +0130",
+	  758799840, 130 },
 	{ "Mon, 17 Jan 01 11:14:55 -0500",
 	  "Wed, 17 Jan 2001 11:14:55 -0500",
 	  979748095, -500 },
@@ -488,8 +584,12 @@ static void
 test_rfc2047 (GMimeParserOptions *options, gboolean test_broken)
 {
 	GMimeFormatOptions *format = g_mime_format_options_get_default ();
+	GMimeFormatOptions *cached;
 	char *enc, *dec;
-	guint i;
+	guint i, j;
+	
+	cached = g_mime_format_options_new ();
+	g_mime_format_options_set_header_encode_cache_size (cached, 4);
 	
 	for (i = 0; i < G_N_ELEMENTS (rfc2047_text); i++) {
 		dec = enc = NULL;
@@ -502,6 +602,14 @@ test_rfc2047 (GMimeParserOptions *options, gboolean test_broken)
 			enc = g_mime_utils_header_encode_text (format, dec, NULL);
 			if (strcmp (rfc2047_text[i].encoded, enc) != 0)
 				throw (exception_new ("encoded text does not match: actual=\"%s\", expected=\"%s\"", enc, rfc2047_text[i].encoded));
+			
+			/* the second time around, the encoded value should come from the cache */
+			for (j = 0; j < 2; j++) {
+				g_free (enc);
+				enc = g_mime_utils_header_encode_text (cached, dec, NULL);
+				if (strcmp (rfc2047_text[i].encoded, enc) != 0)
+					throw (exception_new ("cached encoded text does not match: actual=\"%s\", expected=\"%s\"", enc, rfc2047_text[i].encoded));
+			}
 
 			//dec2 = g_mime_utils_header_decode_text (options, enc);
 			//if (strcmp (rfc2047_text[i].decoded, dec2) != 0)
@@ -537,6 +645,8 @@ test_rfc2047 (GMimeParserOptions *options, gboolean test_broken)
 		g_free (enc);
 	}
 	
+	g_mime_format_options_free (cached);
+	
 #if 0
 	for (i = 0; i < G_N_ELEMENTS (rfc2047_phrase); i++) {
 		dec = enc = NULL;
@@ -852,6 +962,10 @@ int main (int argc, char **argv)
 	test_addrspec (options, TRUE);
 	testsuite_end ();
 	
+	testsuite_start ("addr-spec span parser");
+	test_address_spans (options);
+	testsuite_end ();
+	
 	testsuite_start ("date parser");
 	test_date_parser ();
 	testsuite_end ();
@@ -156,6 +156,17 @@ print_mime_struct_iter (GMimeMessage *message)
 }
 #endif /* PRINT_MIME_STRUCT_ITER */
 
+static void
+print_parser_stats (const GMimeParserStats *stats)
+{
+	fprintf (stdout, "bytes scanned: %" G_GINT64_FORMAT ", buffered: %" G_GINT64_FORMAT "\n",
+		 stats->bytes_scanned, stats->bytes_buffered);
+	fprintf (stdout, "headers: %u, parts: %u, refills: %u\n", stats->headers, stats->parts, stats->refills);
+	fprintf (stdout, "boundary checks: %u (%u misses)\n", stats->boundary_checks, stats->boundary_misses);
+	fprintf (stdout, "usec in headers: %" G_GINT64_FORMAT ", content: %" G_GINT64_FORMAT ", construction: %" G_GINT64_FORMAT "\n",
+		 stats->header_usec, stats->content_usec, stats->construct_usec);
+}
+
 static void
 test_parser (GMimeStream *stream)
 {
@@ -168,12 +179,15 @@ test_parser (GMimeStream *stream)
 	
 	parser = g_mime_parser_new ();
 	g_mime_parser_init_with_stream (parser, stream);
+	g_mime_parser_set_collect_stats (parser, TRUE);
 	
 	ZenTimerStart (NULL);
 	message = g_mime_parser_construct_message (parser, NULL);
 	ZenTimerStop (NULL);
 	ZenTimerReport (NULL, "gmime::parser_construct_message");
 	
+	print_parser_stats (g_mime_parser_get_stats (parser));
+	
 	g_object_unref (parser);
 	
 	ZenTimerStart (NULL);
@@ -226,6 +240,194 @@ test_parser (GMimeStream *stream)
 
 
 
+#ifdef ENABLE_ZENTIMER
+#define HEADER_REGEX_ITERATIONS 1000
+
+static void
+header_regex_cb (GMimeParser *parser, const char *header, const char *value, gint64 offset, gpointer user_data)
+{
+	(*((guint *) user_data))++;
+}
+
+static void
+test_header_regex_cost (GMimeStream *stream)
+{
+	/* literal patterns are matched directly, the last one requires GRegex */
+	const char *patterns[] = { NULL, "^(Subject|From|Date)$", "^X-", "^X-.*-Id$" };
+	GMimeMessage *message;
+	GMimeParser *parser;
+	GMimeStream *mem;
+	uint64_t usec, base = 0;
+	guint matched, i, j;
+	
+	fprintf (stdout, "\nTesting header regex cost...\n\n");
+	
+	mem = g_mime_stream_mem_new ();
+	g_mime_stream_reset (stream);
+	g_mime_stream_write_to_stream (stream, mem);
+	
+	parser = g_mime_parser_new ();
+	
+	for (i = 0; i < G_N_ELEMENTS (patterns); i++) {
+		matched = 0;
+		
+		ZenTimerStart (NULL);
+		for (j = 0; j < HEADER_REGEX_ITERATIONS; j++) {
+			g_mime_stream_reset (mem);
+			g_mime_parser_init_with_stream (parser, mem);
+			g_mime_parser_set_header_regex (parser, patterns[i], header_regex_cb, &matched);
+			
+			if ((message = g_mime_parser_construct_message (parser, NULL)))
+				g_object_unref (message);
+		}
+		ZenTimerStop (NULL);
+		
+		ZenTimerElapsed (NULL, &usec);
+		if (patterns[i] == NULL)
+			base = usec;
+		
+		fprintf (stdout, "%-24s %8.3f usec/message (%+.3f usec for header regex, %u matches/message)\n",
+			 patterns[i] ? patterns[i] : "(none)", (double) usec / HEADER_REGEX_ITERATIONS,
+			 ((double) usec - (double) base) / HEADER_REGEX_ITERATIONS, matched / HEADER_REGEX_ITERATIONS);
+	}
+	
+	g_object_unref (parser);
+	g_object_unref (mem);
+}
+
+#define HEADER_DECODE_ITERATIONS 100
+
+static void
+header_decode_cb (GMimeParser *parser, const char *header, const char *value, gint64 offset, gpointer user_data)
+{
+	GPtrArray *values = user_data;
+	
+	/* phrases (address headers) are stored with a leading '+' and subjects with a leading '-' */
+	g_ptr_array_add (values, g_strconcat (g_ascii_strcasecmp (header, "Subject") ? "+" : "-", value, NULL));
+}
+
+static void
+test_header_decode_cost (GMimeStream *stream)
+{
+	GMimeMessage *message;
+	GMimeParser *parser;
+	GPtrArray *values;
+	const char *value;
+	uint64_t usec;
+	guint i, j;
+	char *str;
+	
+	fprintf (stdout, "\nTesting rfc2047 header decoding cost...\n\n");
+	
+	values = g_ptr_array_new_with_free_func (g_free);
+	
+	g_mime_stream_reset (stream);
+	parser = g_mime_parser_new_with_stream (stream);
+	g_mime_parser_set_header_regex (parser, "^(Subject|From|To|Cc|Reply-To|Sender)$", header_decode_cb, values);
+	
+	while (!g_mime_parser_eos (parser)) {
+		if (!(message = g_mime_parser_construct_message (parser, NULL)))
+			break;
+		
+		g_object_unref (message);
+	}
+	
+	g_object_unref (parser);
+	
+	ZenTimerStart (NULL);
+	for (i = 0; i < HEADER_DECODE_ITERATIONS; i++) {
+		for (j = 0; j < values->len; j++) {
+			value = values->pdata[j];
+			
+			if (value[0] == '-')
+				str = g_mime_utils_header_decode_text (NULL, value + 1);
+			else
+				str = g_mime_utils_header_decode_phrase (NULL, value + 1);
+			
+			g_free (str);
+		}
+	}
+	ZenTimerStop (NULL);
+	
+	ZenTimerElapsed (NULL, &usec);
+	
+	fprintf (stdout, "decoded %u headers: %.3f usec/header\n", values->len,
+		 values->len ? (double) usec / (values->len * HEADER_DECODE_ITERATIONS) : 0.0);
+	
+	g_ptr_array_free (values, TRUE);
+}
+
+#define BOUNDARY_DEPTH 1000
+#define BOUNDARY_LINES 16
+
+static GMimeStream *
+nested_multipart_new (int depth, int lines)
+{
+	/* every level shares a long boundary prefix and every body line starts with "--" */
+	const char *prefix = "----=_NextPart_000_0000_01D00000.00000000";
+	GString *str = g_string_new ("");
+	GMimeStream *stream;
+	int i, j;
+	
+	g_string_append (str, "From: adversary@example.com\nSubject: nested multiparts\nMIME-Version: 1.0\n");
+	
+	for (i = 0; i < depth; i++) {
+		g_string_append_printf (str, "Content-Type: multipart/mixed; boundary=\"%s%04d\"\n\n", prefix, i);
+		g_string_append_printf (str, "--%s%04d\n", prefix, i);
+	}
+	
+	g_string_append (str, "Content-Type: text/plain\n\n");
+	
+	for (i = depth - 1; i >= 0; i--) {
+		for (j = 0; j < lines; j++)
+			g_string_append_printf (str, "--%s%04dX\n", prefix, i);
+		
+		g_string_append_printf (str, "--%s%04d--\n", prefix, i);
+	}
+	
+	stream = g_mime_stream_mem_new_with_buffer (str->str, str->len);
+	g_string_free (str, TRUE);
+	
+	return stream;
+}
+
+static void
+test_boundary_cost (void)
+{
+	GMimeMessage *message;
+	GMimeObject *object;
+	GMimeParser *parser;
+	GMimeStream *stream;
+	uint64_t usec;
+	int depth = 0;
+	
+	fprintf (stdout, "\nTesting boundary matching cost...\n\n");
+	
+	stream = nested_multipart_new (BOUNDARY_DEPTH, BOUNDARY_LINES);
+	parser = g_mime_parser_new_with_stream (stream);
+	
+	ZenTimerStart (NULL);
+	message = g_mime_parser_construct_message (parser, NULL);
+	ZenTimerStop (NULL);
+	
+	ZenTimerElapsed (NULL, &usec);
+	
+	object = message ? message->mime_part : NULL;
+	while (GMIME_IS_MULTIPART (object) && g_mime_multipart_get_count ((GMimeMultipart *) object) > 0) {
+		object = g_mime_multipart_get_part ((GMimeMultipart *) object, 0);
+		depth++;
+	}
+	
+	fprintf (stdout, "parsed %d nested multiparts (%" G_GINT64_FORMAT " bytes): %.3f msec\n",
+		 depth, g_mime_stream_length (stream), (double) usec / 1000.0);
+	
+	if (message)
+		g_object_unref (message);
+	g_object_unref (parser);
+	g_object_unref (stream);
+}
+#endif /* ENABLE_ZENTIMER */
+
 /* you can only enable one of these at a time... */
 /*#define STREAM_BUFFER*/
 /*#define STREAM_MEM*/
@@ -270,6 +472,12 @@ int main (int argc, char **argv)
 	
 	test_parser (stream);
 	
+#ifdef ENABLE_ZENTIMER
+	test_header_regex_cost (stream);
+	test_header_decode_cost (stream);
+	test_boundary_cost ();
+#endif
+	
 	g_object_unref (stream);
 	
 	g_mime_shutdown ();
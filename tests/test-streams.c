@@ -426,6 +426,73 @@ cleanup:
 	
 	return TRUE;
 }
+
+static gboolean
+check_stream_mmap_full (const char *input, const char *output, const char *filename, gint64 start, gint64 end,
+			GMimeStreamMmapHints hints, size_t window_size)
+{
+	GMimeStream *streams[2], *stream;
+	Exception *ex = NULL;
+	int fd[2];
+	
+	if ((fd[0] = open (input, O_RDONLY, 0)) == -1)
+		return FALSE;
+	
+	if ((fd[1] = open (output, O_RDONLY, 0)) == -1) {
+		close (fd[0]);
+		return FALSE;
+	}
+	
+	stream = g_mime_stream_mmap_new_full (fd[0], PROT_READ, MAP_PRIVATE, 0, -1, hints, window_size);
+	if (g_mime_stream_mmap_get_hints ((GMimeStreamMmap *) stream) != hints) {
+		ex = exception_new ("GMimeStreamMmap hints were not kept `%s'", filename);
+		g_object_unref (stream);
+		close (fd[1]);
+		throw (ex);
+	}
+	
+	streams[0] = g_mime_stream_substream (stream, start, end);
+	g_object_unref (stream);
+	
+	streams[1] = g_mime_stream_fs_new (fd[1]);
+	
+	if (!streams_match (streams, filename)) {
+		ex = exception_new ("GMimeStreamMmap streams did not match for `%s'", filename);
+		goto cleanup;
+	}
+	
+	/* read it again now that the window has slid past the start */
+	g_mime_stream_reset (streams[0]);
+	g_mime_stream_reset (streams[1]);
+	
+	if (!streams_match (streams, filename))
+		ex = exception_new ("GMimeStreamMmap streams did not match after reset for `%s'", filename);
+	
+cleanup:
+	
+	g_object_unref (streams[0]);
+	g_object_unref (streams[1]);
+	
+	if (ex != NULL)
+		throw (ex);
+	
+	return TRUE;
+}
+
+static gboolean
+check_stream_mmap_windowed (const char *input, const char *output, const char *filename, gint64 start, gint64 end)
+{
+	return check_stream_mmap_full (input, output, filename, start, end, GMIME_STREAM_MMAP_HINT_SEQUENTIAL, 1);
+}
+
+static gboolean
+check_stream_mmap_hints (const char *input, const char *output, const char *filename, gint64 start, gint64 end)
+{
+	GMimeStreamMmapHints hints = GMIME_STREAM_MMAP_HINT_WILLNEED | GMIME_STREAM_MMAP_HINT_POPULATE |
+		GMIME_STREAM_MMAP_HINT_HUGE_PAGES;
+	
+	return check_stream_mmap_full (input, output, filename, start, end, hints, 0);
+}
 #endif /* HAVE_MMAP */
 
 static gboolean
@@ -537,6 +604,8 @@ static struct {
 	{ "GMimeStreamFile",   check_stream_file   },
 #ifdef HAVE_MMAP
 	{ "GMimeStreamMmap",   check_stream_mmap   },
+	{ "GMimeStreamMmap (windowed)", check_stream_mmap_windowed },
+	{ "GMimeStreamMmap (hints)", check_stream_mmap_hints },
 #endif /* HAVE_MMAP */
 	{ "GMimeStreamBuffer", check_stream_buffer },
 	{ "GMimeStreamGIO",    check_stream_gio    },
@@ -708,6 +777,263 @@ gen_test_data (const char *datadir, char **stream_name)
 	return 0;
 }
 
+static gboolean
+stream_read_matches (GMimeStream *stream, const char *expected, size_t len)
+{
+	char buf[1000];
+	size_t nread = 0;
+	ssize_t n;
+	
+	while (nread < len && (n = g_mime_stream_read (stream, buf, MIN (sizeof (buf), len - nread))) > 0) {
+		if (memcmp (buf, expected + nread, n) != 0)
+			return FALSE;
+		
+		nread += n;
+	}
+	
+	return nread == len && g_mime_stream_eos (stream);
+}
+
+static void
+test_stream_spill (void)
+{
+	GMimeStream *stream, *before, *after;
+	char data[10000];
+	size_t i;
+	
+	for (i = 0; i < sizeof (data); i++)
+		data[i] = (char) ((i * 7) % 251);
+	
+	testsuite_check ("GMimeStreamSpill");
+	stream = g_mime_stream_spill_new_with_threshold (4096);
+	before = after = NULL;
+	
+	try {
+		if (g_mime_stream_write (stream, data, 3000) != 3000)
+			throw (exception_new ("failed to write below the threshold"));
+		
+		if (g_mime_stream_spill_get_spilled ((GMimeStreamSpill *) stream))
+			throw (exception_new ("spilled before reaching the threshold"));
+		
+		/* substreams created before spilling must follow the content to disk */
+		before = g_mime_stream_substream (stream, 1000, 2000);
+		
+		/* line-sized writes, like the parser's, which get gathered once spilled */
+		for (i = 3000; i < sizeof (data); i += 37) {
+			size_t n = MIN (37, sizeof (data) - i);
+			
+			if (g_mime_stream_write (stream, data + i, n) != (ssize_t) n)
+				throw (exception_new ("failed to write past the threshold at offset %" G_GSIZE_FORMAT, i));
+		}
+		
+		if (!g_mime_stream_spill_get_spilled ((GMimeStreamSpill *) stream))
+			throw (exception_new ("did not spill after exceeding the threshold"));
+		
+		if (g_mime_stream_length (stream) != sizeof (data))
+			throw (exception_new ("unexpected length: %" G_GINT64_FORMAT, g_mime_stream_length (stream)));
+		
+		after = g_mime_stream_substream (stream, 5000, 9000);
+		
+		g_mime_stream_reset (stream);
+		if (!stream_read_matches (stream, data, sizeof (data)))
+			throw (exception_new ("content does not match"));
+		
+		if (!stream_read_matches (before, data + 1000, 1000))
+			throw (exception_new ("substream created before spilling does not match"));
+		
+		if (!stream_read_matches (after, data + 5000, 4000))
+			throw (exception_new ("substream created after spilling does not match"));
+		
+		if (g_mime_stream_seek (stream, 4321, GMIME_STREAM_SEEK_SET) != 4321 ||
+		    !stream_read_matches (stream, data + 4321, sizeof (data) - 4321))
+			throw (exception_new ("content does not match after seeking"));
+		
+		if (g_mime_stream_seek (stream, 1, GMIME_STREAM_SEEK_END) != -1)
+			throw (exception_new ("seeking past the end of the content succeeded"));
+		
+		/* overwrite some of the spilled content and read it back through a substream */
+		memset (data + 6000, 'x', 10);
+		if (g_mime_stream_seek (stream, 6000, GMIME_STREAM_SEEK_SET) != 6000 ||
+		    g_mime_stream_write (stream, data + 6000, 10) != 10)
+			throw (exception_new ("failed to overwrite spilled content"));
+		
+		g_mime_stream_reset (after);
+		if (!stream_read_matches (after, data + 5000, 4000))
+			throw (exception_new ("substream does not see overwritten content"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("GMimeStreamSpill: %s", ex->message);
+	} finally;
+	
+	if (before != NULL)
+		g_object_unref (before);
+	if (after != NULL)
+		g_object_unref (after);
+	g_object_unref (stream);
+}
+
+static void
+test_stream_rope (void)
+{
+	GMimeStream *stream, *substream;
+	GByteArray *flat;
+	char data[10000];
+	size_t i;
+	
+	for (i = 0; i < sizeof (data); i++)
+		data[i] = (char) ((i * 13) % 247);
+	
+	testsuite_check ("GMimeStreamRope");
+	stream = g_mime_stream_rope_new_with_chunk_size (100);
+	substream = NULL;
+	flat = NULL;
+	
+	try {
+		/* odd-sized writes so that most of them straddle a chunk boundary */
+		for (i = 0; i < sizeof (data); i += 333) {
+			size_t n = MIN (333, sizeof (data) - i);
+			
+			if (g_mime_stream_write (stream, data + i, n) != (ssize_t) n)
+				throw (exception_new ("failed to write at offset %" G_GSIZE_FORMAT, i));
+		}
+		
+		if (g_mime_stream_length (stream) != sizeof (data))
+			throw (exception_new ("unexpected length: %" G_GINT64_FORMAT, g_mime_stream_length (stream)));
+		
+		if (g_mime_stream_seek (stream, 4321, GMIME_STREAM_SEEK_SET) != 4321 ||
+		    !stream_read_matches (stream, data + 4321, sizeof (data) - 4321))
+			throw (exception_new ("content does not match after seeking"));
+		
+		substream = g_mime_stream_substream (stream, 950, 2050);
+		if (!stream_read_matches (substream, data + 950, 1100))
+			throw (exception_new ("substream does not match"));
+		
+		flat = g_mime_stream_rope_flatten ((GMimeStreamRope *) substream);
+		if (flat->len != 1100 || memcmp (flat->data, data + 950, 1100) != 0)
+			throw (exception_new ("flattened substream does not match"));
+		
+		g_byte_array_unref (flat);
+		flat = g_mime_stream_rope_flatten ((GMimeStreamRope *) stream);
+		if (flat->len != sizeof (data) || memcmp (flat->data, data, sizeof (data)) != 0)
+			throw (exception_new ("flattened stream does not match"));
+		
+		/* like GMimeStreamMem, seeking past the end zero-fills the gap */
+		if (g_mime_stream_seek (stream, 250, GMIME_STREAM_SEEK_END) != sizeof (data) + 250 ||
+		    g_mime_stream_write (stream, "x", 1) != 1)
+			throw (exception_new ("failed to extend the stream"));
+		
+		g_byte_array_unref (flat);
+		flat = g_mime_stream_rope_flatten ((GMimeStreamRope *) stream);
+		if (flat->len != sizeof (data) + 251 || flat->data[sizeof (data) + 120] != 0 || flat->data[sizeof (data) + 250] != 'x')
+			throw (exception_new ("extended stream does not match"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("GMimeStreamRope: %s", ex->message);
+	} finally;
+	
+	if (flat != NULL)
+		g_byte_array_unref (flat);
+	if (substream != NULL)
+		g_object_unref (substream);
+	g_object_unref (stream);
+}
+
+#ifdef HAVE_MMAP
+static void
+test_stream_mmap_windows (void)
+{
+	GMimeStream *stream, *near[2], *far;
+	char *filename = NULL;
+	char data[65536];
+	char buf[100];
+	size_t i;
+	int fd;
+	
+	for (i = 0; i < sizeof (data); i++)
+		data[i] = (char) ((i * 11) % 241);
+	
+	testsuite_check ("GMimeStreamMmap (shared windows)");
+	stream = near[0] = near[1] = far = NULL;
+	
+	try {
+		if ((fd = g_file_open_tmp ("test-streams-XXXXXX", &filename, NULL)) == -1)
+			throw (exception_new ("failed to create a temporary file"));
+		
+		if (write (fd, data, sizeof (data)) != (ssize_t) sizeof (data)) {
+			close (fd);
+			throw (exception_new ("failed to write the temporary file"));
+		}
+		
+		stream = g_mime_stream_mmap_new_full (fd, PROT_READ, MAP_PRIVATE, 0, -1, GMIME_STREAM_MMAP_HINT_NONE, 16384);
+		
+		if (g_mime_stream_read (stream, buf, sizeof (buf)) != sizeof (buf) || memcmp (buf, data, sizeof (buf)) != 0)
+			throw (exception_new ("content does not match"));
+		
+		/* substreams within the parent's window must not map a window of their own */
+		near[0] = g_mime_stream_substream (stream, 1000, 2000);
+		near[1] = g_mime_stream_substream (stream, 4000, 9000);
+		far = g_mime_stream_substream (stream, 40000, 50000);
+		
+		for (i = 0; i < 2; i++) {
+			if (((GMimeStreamMmap *) near[i])->map != NULL)
+				throw (exception_new ("substream %" G_GSIZE_FORMAT " mapped a window before reading", i));
+			
+			if (g_mime_stream_read (near[i], buf, 10) != 10)
+				throw (exception_new ("failed to read substream %" G_GSIZE_FORMAT, i));
+			
+			if (((GMimeStreamMmap *) near[i])->map != ((GMimeStreamMmap *) stream)->map)
+				throw (exception_new ("substream %" G_GSIZE_FORMAT " does not share the parent's window", i));
+		}
+		
+		if (g_mime_stream_read (far, buf, 10) != 10 || memcmp (buf, data + 40000, 10) != 0)
+			throw (exception_new ("distant substream does not match"));
+		
+		if (((GMimeStreamMmap *) far)->map == ((GMimeStreamMmap *) stream)->map)
+			throw (exception_new ("distant substream shares a window that does not cover it"));
+		
+		if (!stream_read_matches (far, data + 40010, 9990))
+			throw (exception_new ("distant substream does not match"));
+		
+		/* a substream that has been read to the end lets go of its window */
+		if (((GMimeStreamMmap *) far)->map != NULL)
+			throw (exception_new ("distant substream still holds a window after reaching the end"));
+		
+		if (!stream_read_matches (near[0], data + 1010, 990))
+			throw (exception_new ("substream 0 does not match"));
+		
+		if (((GMimeStreamMmap *) near[0])->map != NULL)
+			throw (exception_new ("substream 0 still holds a window after reaching the end"));
+		
+		if (!stream_read_matches (near[1], data + 4010, 4990))
+			throw (exception_new ("substream 1 does not match"));
+		
+		g_mime_stream_reset (far);
+		if (!stream_read_matches (far, data + 40000, 10000))
+			throw (exception_new ("distant substream does not match after a reset"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("GMimeStreamMmap (shared windows): %s", ex->message);
+	} finally;
+	
+	for (i = 0; i < 2; i++) {
+		if (near[i] != NULL)
+			g_object_unref (near[i]);
+	}
+	if (far != NULL)
+		g_object_unref (far);
+	if (stream != NULL)
+		g_object_unref (stream);
+	
+	if (filename != NULL) {
+		unlink (filename);
+		g_free (filename);
+	}
+}
+#endif /* HAVE_MMAP */
+
 int main (int argc, char **argv)
 {
 	const char *datadir = "data/streams";
@@ -731,6 +1057,12 @@ int main (int argc, char **argv)
 	
 	testsuite_start ("Stream tests");
 	
+	test_stream_spill ();
+	test_stream_rope ();
+#ifdef HAVE_MMAP
+	test_stream_mmap_windows ();
+#endif
+	
 	p = g_stpcpy (path, datadir);
 	*p++ = G_DIR_SEPARATOR;
 	strcpy (p, "output");